@@ -1243,6 +1243,15 @@ bgfx_shaders = {
 				return wpos.xyz / wpos.w;
 			}
 
+			uniform vec4 u_mesh_position_decode[2];
+
+			// Decodes a mesh vertex position, which may be quantized to the
+			// bounding box of its geometry.
+			vec3 decodeMeshPosition(vec3 _position)
+			{
+				return _position * u_mesh_position_decode[1].xyz + u_mesh_position_decode[0].xyz;
+			}
+
 			#endif // __SHADERLIB_SH__
 		"""
 	}
@@ -224,11 +224,17 @@ bgfx_shaders = {
 			vec4 a_indices   : BLENDINDICES;
 			vec4 a_weight    : BLENDWEIGHT;
 			vec2 a_texcoord0 : TEXCOORD0;
+			vec4 i_data0     : TEXCOORD7;
+			vec4 i_data1     : TEXCOORD6;
+			vec4 i_data2     : TEXCOORD5;
+			vec4 i_data3     : TEXCOORD4;
 		"""
 
 		vs_input_output = """
 		#if defined(SKINNING)
 			$input a_position, a_normal, a_tangent, a_bitangent, a_texcoord0, a_indices, a_weight
+		#elif defined(INSTANCING)
+			$input a_position, a_normal, a_tangent, a_bitangent, a_texcoord0, i_data0, i_data1, i_data2, i_data3
 		#else
 			$input a_position, a_normal, a_tangent, a_bitangent, a_texcoord0
 		#endif
@@ -242,16 +248,20 @@ bgfx_shaders = {
 
 			void main()
 			{
+				vec3 position = decodeMeshPosition(a_position);
 		#if defined(SKINNING)
 				mat4 model;
 				model  = a_weight.x * u_model[int(a_indices.x)];
 				model += a_weight.y * u_model[int(a_indices.y)];
 				model += a_weight.z * u_model[int(a_indices.z)];
 				model += a_weight.w * u_model[int(a_indices.w)];
-				gl_Position = mul(mul(u_modelViewProj, model), vec4(a_position, 1.0));
+				gl_Position = mul(mul(u_modelViewProj, model), vec4(position, 1.0));
 				model = mul(u_model[0], model);
+		#elif defined(INSTANCING)
+				mat4 model = mtxFromCols(i_data0, i_data1, i_data2, i_data3);
+				gl_Position = mul(mul(u_viewProj, model), vec4(position, 1.0));
 		#else
-				gl_Position = mul(mul(u_viewProj, u_model[0]), vec4(a_position, 1.0));
+				gl_Position = mul(mul(u_viewProj, u_model[0]), vec4(position, 1.0));
 				mat4 model = u_model[0];
 		#endif
 
@@ -260,7 +270,7 @@ bgfx_shaders = {
 				vec3 bitangent = decodeNormalUint(a_bitangent);
 				mat3 normal_matrix = cofactor(model);
 
-				v_position = mul(model, vec4(a_position, 1.0)).xyz;
+				v_position = mul(model, vec4(position, 1.0)).xyz;
 				v_normal = normalize(mul(normal_matrix, normal)).xyz;
 				v_tangent = normalize(mul(normal_matrix, tangent)).xyz;
 				v_bitangent = normalize(mul(normal_matrix, bitangent)).xyz;
@@ -278,7 +288,7 @@ bgfx_shaders = {
 				v_texcoord0 = (a_texcoord0 - vec2_splat(0.5))*u_uv_scale.xy + vec2_splat(0.5) + u_uv_offset.xy;
 
 		#if !defined(NO_LIGHT)
-				vec3 pos_offset = a_position + normal * 0.01;
+				vec3 pos_offset = position + normal * 0.01;
 				v_shadow0 = mul(mul(u_cascaded_lights[0], model), vec4(pos_offset, 1.0));
 				v_shadow1 = mul(mul(u_cascaded_lights[1], model), vec4(pos_offset, 1.0));
 				v_shadow2 = mul(mul(u_cascaded_lights[2], model), vec4(pos_offset, 1.0));
@@ -455,7 +465,7 @@ bgfx_shaders = {
 		vs_code = """
 			void main()
 			{
-				gl_Position = mul(u_modelViewProj, vec4(a_position, 1.0));
+				gl_Position = mul(u_modelViewProj, vec4(decodeMeshPosition(a_position), 1.0));
 			}
 		"""
 
@@ -559,6 +569,12 @@ static_compile = [
 	{ shader = "mesh" defines = ["DIFFUSE_MAP" "NO_LIGHT"] }
 	{ shader = "mesh" defines = ["SKINNING" "MASKED"] }
 	{ shader = "mesh" defines = ["NO_LIGHT" "MASKED"] }
+	{ shader = "mesh" defines = ["INSTANCING"] }
+	{ shader = "mesh" defines = ["DIFFUSE_MAP" "INSTANCING"] }
+	{ shader = "mesh" defines = ["INSTANCING" "MASKED"] }
+	{ shader = "mesh" defines = ["INSTANCING" "NO_LIGHT"] }
+	{ shader = "mesh" defines = ["INSTANCING" "MASKED" "NO_LIGHT"] }
+	{ shader = "mesh" defines = ["DIFFUSE_MAP" "INSTANCING" "NO_LIGHT"] }
 	{ shader = "skydome" defines = [] }
 	{ shader = "blit" defines = [] }
 	{ shader = "blit" defines = ["BLEND_ENABLED"] }
@@ -28,7 +28,7 @@ bgfx_shaders = {
 		vs_code = """
 			void main()
 			{
-				gl_Position = mul(u_modelViewProj, vec4(a_position, 1.0));
+				gl_Position = mul(u_modelViewProj, vec4(decodeMeshPosition(a_position), 1.0));
 			}
 		"""
 
@@ -10,13 +10,24 @@ bgfx_shaders = {
 		code = """
 		#if !defined(NO_LIGHT)
 		#	define LIGHT_SIZE 22 // In vec4 units.
-		#	define MAX_NUM_LIGHTS 32
+		#	define MAX_NUM_LIGHTS 256
+		#	define LIGHT_INDICES_WIDTH 1024
+		#	define LIGHT_INDICES_HEIGHT 64
 		#	define MAX_NUM_CASCADES 4
 			uniform vec4 u_lights_num;        // num_dir, num_omni, num_spot
+			uniform vec4 u_light_clusters_params[2];
+		#	define light_clusters_size u_light_clusters_params[0].xyz
+		#	define light_clustering u_light_clusters_params[0].w
+		#	define light_clusters_slice_scale u_light_clusters_params[1].x
+		#	define light_clusters_slice_bias u_light_clusters_params[1].y
 		#if BGFX_SHADER_LANGUAGE_GLSL
 			uniform highp sampler2D u_lights_data; // dir_0, .., dir_n-1, omni_0, .., omni_n-1, spot_0, .., spot_n-1
+			uniform highp sampler2D u_light_clusters; // Offset and count of the lights of each cluster.
+			uniform highp sampler2D u_light_indices; // Local light indices of all clusters.
 		#else
 			SAMPLER2D(u_lights_data, 12); // dir_0, .., dir_n-1, omni_0, .., omni_n-1, spot_0, .., spot_n-1
+			SAMPLER2D(u_light_clusters, 13); // Offset and count of the lights of each cluster.
+			SAMPLER2D(u_light_indices, 14); // Local light indices of all clusters.
 		#endif
 			uniform mat4 u_cascaded_lights[MAX_NUM_CASCADES]; // View-proj-crop matrices for cascaded shadow maps.
 			uniform vec4 u_shadow_map_params[2];
@@ -193,8 +204,33 @@ bgfx_shaders = {
 
 			vec4 lights_data(int offset)
 			{
-				float u = (float(offset) + 0.5) / float(LIGHT_SIZE * MAX_NUM_LIGHTS);
-				return texture2D(u_lights_data, vec2(u, 0.0));
+				float light = floor((float(offset) + 0.5) / float(LIGHT_SIZE));
+				float u = (float(offset) - light * float(LIGHT_SIZE) + 0.5) / float(LIGHT_SIZE);
+				float v = (light + 0.5) / float(MAX_NUM_LIGHTS);
+				return texture2DLod(u_lights_data, vec2(u, v), 0.0);
+			}
+
+			// Returns the offset and count of the lights of the cluster containing the world position p.
+			vec2 light_cluster(vec3 p)
+			{
+				vec4 clip = mul(u_viewProj, vec4(p, 1.0));
+				vec2 ndc = clip.xy / clip.w;
+				float depth = -mul(u_view, vec4(p, 1.0)).z;
+				vec3 size = light_clusters_size;
+
+				float x = clamp(floor((ndc.x * 0.5 + 0.5) * size.x), 0.0, size.x - 1.0);
+				float y = clamp(floor((ndc.y * 0.5 + 0.5) * size.y), 0.0, size.y - 1.0);
+				float z = clamp(floor(log2(max(depth, 1e-6)) * light_clusters_slice_scale + light_clusters_slice_bias), 0.0, size.z - 1.0);
+				vec2 uv = vec2((x + y * size.x + 0.5) / (size.x * size.y), (z + 0.5) / size.z);
+				return texture2DLod(u_light_clusters, uv, 0.0).xy;
+			}
+
+			int light_index(int i)
+			{
+				float row = floor((float(i) + 0.5) / float(LIGHT_INDICES_WIDTH));
+				float u = (float(i) - row * float(LIGHT_INDICES_WIDTH) + 0.5) / float(LIGHT_INDICES_WIDTH);
+				float v = (row + 0.5) / float(LIGHT_INDICES_HEIGHT);
+				return int(texture2DLod(u_light_indices, vec2(u, v), 0.0).x + 0.5);
 			}
 
 			vec3 calc_lighting(mat3 tbn
@@ -334,160 +370,172 @@ bgfx_shaders = {
 						);
 				}
 
-				for (int oi = 0; oi < num_omni; ++oi, loffset += LIGHT_SIZE) {
-					vec3 light_color  = lights_data(loffset + 0).rgb;
-					float intensity   = lights_data(loffset + 0).w;
-					vec3 position     = lights_data(loffset + 1).xyz;
-					float range       = lights_data(loffset + 1).w;
-					float cast_shadow = lights_data(loffset + 21).z;
-					vec3 light_pos    = mul(position, tbn);
-
-					vec3 local_radiance = calc_omni_light(n
-						, v
-						, frag_pos
-						, toLinearAccurate(light_color)
-						, intensity
-						, light_pos
-						, range
-						, albedo
-						, metallic
-						, roughness
-						, f0
-						);
+				int num_local = num_omni + num_spot;
+				int cluster_offset = 0;
+				if (light_clustering != 0.0) {
+					vec2 cluster = light_cluster(shadow_local.xyz);
+					cluster_offset = int(cluster.x + 0.5);
+					num_local = int(cluster.y + 0.5);
+				}
 
-					if (cast_shadow == 1.0 && receive_shadow) {
-						// Tetrahedron normals.
-						CONST(vec3 bn) = vec3(        0.0f,  0.81649661f, -0.57735026f);
-						CONST(vec3 yn) = vec3(        0.0f, -0.81649661f, -0.57735026f);
-						CONST(vec3 gn) = vec3(-0.81649661f,  0.0f,         0.57735026f);
-						CONST(vec3 rn) = vec3( 0.81649661f,  0.0f,         0.57735026f);
-
-						vec3 sl = shadow_local.xyz - position; // Transform to light-local space.
-
-						// Select tetrahedon face.
-						float b = dot(sl, bn);
-						float y = dot(sl, yn);
-						float g = dot(sl, gn);
-						float r = dot(sl, rn);
-						float maximum = max(max(b, y), max(g, r));
-
-						vec4 atlas_u      = lights_data(loffset + 19);
-						vec4 atlas_v      = lights_data(loffset + 20);
-						float atlas_size  = lights_data(loffset + 21).x;
-						float shadow_bias = lights_data(loffset + 21).y;
-
-						vec4 shadow_pos0;
-						vec3 col;
-						vec3 atlas_offset;
-
-						if (maximum == b) {
-							// Tetrahedron mvp matrices.
-							mat4 bmtx = mtxFromCols(lights_data(loffset + 3)
-								, lights_data(loffset + 4)
-								, lights_data(loffset + 5)
-								, lights_data(loffset + 6)
-								);
-							shadow_pos0 = mul(bmtx, shadow_local);
-							col = vec3(0.1, 0.1, 1);
-							atlas_offset = vec3(atlas_u.x, atlas_v.x, atlas_size);
-						} else if (maximum == y) {
-							mat4 ymtx = mtxFromCols(lights_data(loffset + 7)
-								, lights_data(loffset + 8)
-								, lights_data(loffset + 9)
-								, lights_data(loffset + 10)
-								);
-							shadow_pos0 = mul(ymtx, shadow_local);
-							col = vec3(1, 1, 0);
-							atlas_offset = vec3(atlas_u.y, atlas_v.y, atlas_size);
-						} else if (maximum == g) {
-							mat4 gmtx = mtxFromCols(lights_data(loffset + 11)
-								, lights_data(loffset + 12)
-								, lights_data(loffset + 13)
-								, lights_data(loffset + 14)
-								);
-							shadow_pos0 = mul(gmtx, shadow_local);
-							col = vec3(0, 1, 0);
-							atlas_offset = vec3(atlas_u.z, atlas_v.z, atlas_size);
-						} else {
-							mat4 rmtx = mtxFromCols(lights_data(loffset + 15)
-								, lights_data(loffset + 16)
-								, lights_data(loffset + 17)
-								, lights_data(loffset + 18)
-								);
-							shadow_pos0 = mul(rmtx, shadow_local);
-							col = vec3(1, 0, 0);
-							atlas_offset = vec3(atlas_u.w, atlas_v.w, atlas_size);
-						}
+				// Omni lights first, then spot lights.
+				for (int li = 0; li < num_local; ++li) {
+					int light = light_clustering != 0.0 ? light_index(cluster_offset + li) : li;
+					loffset = (num_dir + light) * LIGHT_SIZE;
+
+					if (light < num_omni) {
+						vec3 light_color  = lights_data(loffset + 0).rgb;
+						float intensity   = lights_data(loffset + 0).w;
+						vec3 position     = lights_data(loffset + 1).xyz;
+						float range       = lights_data(loffset + 1).w;
+						float cast_shadow = lights_data(loffset + 21).z;
+						vec3 light_pos    = mul(position, tbn);
+
+						vec3 local_radiance = calc_omni_light(n
+							, v
+							, frag_pos
+							, toLinearAccurate(light_color)
+							, intensity
+							, light_pos
+							, range
+							, albedo
+							, metallic
+							, roughness
+							, f0
+							);
 
-						vec4 atlas_shadow_pos0 = atlas_shadow_coord(shadow_pos0, atlas_offset);
-						if (shadow_coord_inside_atlas_tile(atlas_shadow_pos0, atlas_offset)) {
-							vec3 l = normalize(position - shadow_local.xyz);
-							float ndotl = max(dot(geometric_n, l), 0.05);
+						if (cast_shadow == 1.0 && receive_shadow) {
+							// Tetrahedron normals.
+							CONST(vec3 bn) = vec3(        0.0f,  0.81649661f, -0.57735026f);
+							CONST(vec3 yn) = vec3(        0.0f, -0.81649661f, -0.57735026f);
+							CONST(vec3 gn) = vec3(-0.81649661f,  0.0f,         0.57735026f);
+							CONST(vec3 rn) = vec3( 0.81649661f,  0.0f,         0.57735026f);
+
+							vec3 sl = shadow_local.xyz - position; // Transform to light-local space.
+
+							// Select tetrahedon face.
+							float b = dot(sl, bn);
+							float y = dot(sl, yn);
+							float g = dot(sl, gn);
+							float r = dot(sl, rn);
+							float maximum = max(max(b, y), max(g, r));
+
+							vec4 atlas_u      = lights_data(loffset + 19);
+							vec4 atlas_v      = lights_data(loffset + 20);
+							float atlas_size  = lights_data(loffset + 21).x;
+							float shadow_bias = lights_data(loffset + 21).y;
+
+							vec4 shadow_pos0;
+							vec3 col;
+							vec3 atlas_offset;
+
+							if (maximum == b) {
+								// Tetrahedron mvp matrices.
+								mat4 bmtx = mtxFromCols(lights_data(loffset + 3)
+									, lights_data(loffset + 4)
+									, lights_data(loffset + 5)
+									, lights_data(loffset + 6)
+									);
+								shadow_pos0 = mul(bmtx, shadow_local);
+								col = vec3(0.1, 0.1, 1);
+								atlas_offset = vec3(atlas_u.x, atlas_v.x, atlas_size);
+							} else if (maximum == y) {
+								mat4 ymtx = mtxFromCols(lights_data(loffset + 7)
+									, lights_data(loffset + 8)
+									, lights_data(loffset + 9)
+									, lights_data(loffset + 10)
+									);
+								shadow_pos0 = mul(ymtx, shadow_local);
+								col = vec3(1, 1, 0);
+								atlas_offset = vec3(atlas_u.y, atlas_v.y, atlas_size);
+							} else if (maximum == g) {
+								mat4 gmtx = mtxFromCols(lights_data(loffset + 11)
+									, lights_data(loffset + 12)
+									, lights_data(loffset + 13)
+									, lights_data(loffset + 14)
+									);
+								shadow_pos0 = mul(gmtx, shadow_local);
+								col = vec3(0, 1, 0);
+								atlas_offset = vec3(atlas_u.z, atlas_v.z, atlas_size);
+							} else {
+								mat4 rmtx = mtxFromCols(lights_data(loffset + 15)
+									, lights_data(loffset + 16)
+									, lights_data(loffset + 17)
+									, lights_data(loffset + 18)
+									);
+								shadow_pos0 = mul(rmtx, shadow_local);
+								col = vec3(1, 0, 0);
+								atlas_offset = vec3(atlas_u.w, atlas_v.w, atlas_size);
+							}
 
-							local_radiance *= shadow(u_local_lights_shadow_map
-								, atlas_shadow_pos0
-								, shadow_bias * clamp(1.0 + 2.0 * (1.0 - ndotl) / ndotl, 1.0, 8.0)
-								, local_lights_sm_texel_size
-								, local_lights_shadow_map_samples
-								);
-						} else {
-							local_radiance *= 0.0;
+							vec4 atlas_shadow_pos0 = atlas_shadow_coord(shadow_pos0, atlas_offset);
+							if (shadow_coord_inside_atlas_tile(atlas_shadow_pos0, atlas_offset)) {
+								vec3 l = normalize(position - shadow_local.xyz);
+								float ndotl = max(dot(geometric_n, l), 0.05);
+
+								local_radiance *= shadow(u_local_lights_shadow_map
+									, atlas_shadow_pos0
+									, shadow_bias * clamp(1.0 + 2.0 * (1.0 - ndotl) / ndotl, 1.0, 8.0)
+									, local_lights_sm_texel_size
+									, local_lights_shadow_map_samples
+									);
+							} else {
+								local_radiance *= 0.0;
+							}
 						}
-					}
 
-					radiance += apply_distance_fading(local_radiance, position, camera_pos);
-				}
-
-				for (int si = 0; si < num_spot; ++si, loffset += LIGHT_SIZE) {
-					vec3 light_color  = lights_data(loffset + 0).rgb;
-					float intensity   = lights_data(loffset + 0).w;
-					vec3 position     = lights_data(loffset + 1).xyz;
-					float range       = lights_data(loffset + 1).w;
-					vec3 direction    = lights_data(loffset + 2).xyz;
-					float spot_angle  = lights_data(loffset + 2).w;
-					float cast_shadow = lights_data(loffset + 21).z;
-
-					vec3 local_radiance = calc_spot_light(n
-						, v
-						, frag_pos
-						, toLinearAccurate(light_color)
-						, intensity
-						, mul(direction, tbn)
-						, spot_angle
-						, mul(position, tbn)
-						, range
-						, albedo
-						, metallic
-						, roughness
-						, f0
-						);
-
-					if (cast_shadow == 1.0 && receive_shadow) {
-						mat4 mvp = mtxFromCols(lights_data(loffset + 3)
-							, lights_data(loffset + 4)
-							, lights_data(loffset + 5)
-							, lights_data(loffset + 6)
+						radiance += apply_distance_fading(local_radiance, position, camera_pos);
+					} else {
+						vec3 light_color  = lights_data(loffset + 0).rgb;
+						float intensity   = lights_data(loffset + 0).w;
+						vec3 position     = lights_data(loffset + 1).xyz;
+						float range       = lights_data(loffset + 1).w;
+						vec3 direction    = lights_data(loffset + 2).xyz;
+						float spot_angle  = lights_data(loffset + 2).w;
+						float cast_shadow = lights_data(loffset + 21).z;
+
+						vec3 local_radiance = calc_spot_light(n
+							, v
+							, frag_pos
+							, toLinearAccurate(light_color)
+							, intensity
+							, mul(direction, tbn)
+							, spot_angle
+							, mul(position, tbn)
+							, range
+							, albedo
+							, metallic
+							, roughness
+							, f0
 							);
-						vec4 atlas_u      = lights_data(loffset + 19);
-						vec4 atlas_v      = lights_data(loffset + 20);
-						float atlas_size  = lights_data(loffset + 21).x;
-						float shadow_bias = lights_data(loffset + 21).y;
-						vec3 atlas_offset = vec3(atlas_u.x, atlas_v.x, atlas_size);
-						vec4 atlas_shadow_pos0 = atlas_shadow_coord(mul(mvp, shadow_local), atlas_offset);
-
-						if (shadow_coord_inside_atlas_tile(atlas_shadow_pos0, atlas_offset)) {
-							local_radiance *= shadow(u_local_lights_shadow_map
-								, atlas_shadow_pos0
-								, shadow_bias
-								, local_lights_sm_texel_size
-								, local_lights_shadow_map_samples
+
+						if (cast_shadow == 1.0 && receive_shadow) {
+							mat4 mvp = mtxFromCols(lights_data(loffset + 3)
+								, lights_data(loffset + 4)
+								, lights_data(loffset + 5)
+								, lights_data(loffset + 6)
 								);
-						} else {
-							local_radiance *= 0.0;
+							vec4 atlas_u      = lights_data(loffset + 19);
+							vec4 atlas_v      = lights_data(loffset + 20);
+							float atlas_size  = lights_data(loffset + 21).x;
+							float shadow_bias = lights_data(loffset + 21).y;
+							vec3 atlas_offset = vec3(atlas_u.x, atlas_v.x, atlas_size);
+							vec4 atlas_shadow_pos0 = atlas_shadow_coord(mul(mvp, shadow_local), atlas_offset);
+
+							if (shadow_coord_inside_atlas_tile(atlas_shadow_pos0, atlas_offset)) {
+								local_radiance *= shadow(u_local_lights_shadow_map
+									, atlas_shadow_pos0
+									, shadow_bias
+									, local_lights_sm_texel_size
+									, local_lights_shadow_map_samples
+									);
+							} else {
+								local_radiance *= 0.0;
+							}
 						}
-					}
 
-					radiance += apply_distance_fading(local_radiance, position, camera_pos);
+						radiance += apply_distance_fading(local_radiance, position, camera_pos);
+					}
 				}
 
 				return apply_fog(emission + radiance, camera_distance, sun_color);
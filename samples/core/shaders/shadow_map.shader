@@ -104,11 +104,17 @@ bgfx_shaders = {
 			vec3 a_position : POSITION;
 			vec4 a_indices  : BLENDINDICES;
 			vec4 a_weight   : BLENDWEIGHT;
+			vec4 i_data0    : TEXCOORD7;
+			vec4 i_data1    : TEXCOORD6;
+			vec4 i_data2    : TEXCOORD5;
+			vec4 i_data3    : TEXCOORD4;
 		"""
 
 		vs_input_output = """
 		#if defined(SKINNING)
 			$input a_position, a_indices, a_weight
+		#elif defined(INSTANCING)
+			$input a_position, i_data0, i_data1, i_data2, i_data3
 		#else
 			$input a_position
 		#endif
@@ -117,15 +123,19 @@ bgfx_shaders = {
 		vs_code = """
 			void main()
 			{
+				vec3 position = decodeMeshPosition(a_position);
 		#if defined(SKINNING)
 				mat4 model;
 				model  = a_weight.x * u_model[int(a_indices.x)];
 				model += a_weight.y * u_model[int(a_indices.y)];
 				model += a_weight.z * u_model[int(a_indices.z)];
 				model += a_weight.w * u_model[int(a_indices.w)];
-				gl_Position = mul(mul(u_modelViewProj, model), vec4(a_position, 1.0));
+				gl_Position = mul(mul(u_modelViewProj, model), vec4(position, 1.0));
+		#elif defined(INSTANCING)
+				mat4 model = mtxFromCols(i_data0, i_data1, i_data2, i_data3);
+				gl_Position = mul(mul(u_viewProj, model), vec4(position, 1.0));
 		#else
-				gl_Position = mul(mul(u_viewProj, u_model[0]), vec4(a_position, 1.0));
+				gl_Position = mul(mul(u_viewProj, u_model[0]), vec4(position, 1.0));
 		#endif
 			}
 		"""
@@ -152,5 +162,6 @@ shaders = {
 static_compile = [
 	{ shader = "shadow" defines = [] }
 	{ shader = "shadow" defines = ["SKINNING"] }
+	{ shader = "shadow" defines = ["INSTANCING"] }
 
 ]
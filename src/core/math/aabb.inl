@@ -49,14 +49,7 @@ namespace aabb
 		Vector3 vertices[8];
 		to_vertices(vertices, b);
 
-		vertices[0] = vertices[0] * m;
-		vertices[1] = vertices[1] * m;
-		vertices[2] = vertices[2] * m;
-		vertices[3] = vertices[3] * m;
-		vertices[4] = vertices[4] * m;
-		vertices[5] = vertices[5] * m;
-		vertices[6] = vertices[6] * m;
-		vertices[7] = vertices[7] * m;
+		transform_points_n(vertices, vertices, countof(vertices), m);
 
 		AABB r;
 		aabb::from_points(r, countof(vertices), vertices);
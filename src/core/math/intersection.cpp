@@ -7,10 +7,13 @@
 #include "core/math/constants.h"
 #include "core/math/frustum.inl"
 #include "core/math/intersection.h"
+#include "core/math/matrix4x4.inl"
 #include "core/math/plane3.inl"
+#include "core/math/simd.h"
 #include "core/math/sphere.inl"
 #include "core/math/vector3.inl"
 #include <float.h> // FLT_MAX
+#include <string.h> // memset
 
 namespace crown
 {
@@ -145,65 +148,65 @@ f32 ray_obb_intersection(const Vector3 &from, const Vector3 &dir, const Matrix4x
 
 f32 ray_triangle_intersection(const Vector3 &from, const Vector3 &dir, const Vector3 &v0, const Vector3 &v1, const Vector3 &v2)
 {
-	const Vector3 verts[] = { v0, v1, v2 };
-	const u16 inds[] = { 0, 1, 2 };
-	return ray_mesh_intersection(from, dir, MATRIX4X4_IDENTITY, verts, sizeof(Vector3), inds, 3);
-}
+	// https://en.wikipedia.org/wiki/M%C3%B6ller%E2%80%93Trumbore_intersection_algorithm
 
-f32 ray_mesh_intersection(const Vector3 &from, const Vector3 &dir, const Matrix4x4 &tm, const void *vertices, u32 stride, const u16 *indices, u32 num)
-{
-	bool hit = false;
-	f32 tmin = FLT_MAX;
+	// Find vectors for two edges sharing v0
+	const Vector3 e1 = v1 - v0;
+	const Vector3 e2 = v2 - v0;
 
-	for (u32 i = 0; i < num; i += 3) {
-		const u32 i0 = indices[i + 0];
-		const u32 i1 = indices[i + 1];
-		const u32 i2 = indices[i + 2];
+	// Begin calculating determinant - also used to calculate u parameter
+	const Vector3 P = cross(dir, e2);
 
-		const Vector3 &v0 = *(Vector3 *)((char *)vertices + i0*stride) * tm;
-		const Vector3 &v1 = *(Vector3 *)((char *)vertices + i1*stride) * tm;
-		const Vector3 &v2 = *(Vector3 *)((char *)vertices + i2*stride) * tm;
+	// If determinant is near zero, ray lies in plane of triangle
+	const f32 det = dot(e1, P);
+	if (fequal(det, 0.0f))
+		return -1.0f;
 
-		// https://en.wikipedia.org/wiki/M%C3%B6ller%E2%80%93Trumbore_intersection_algorithm
+	const f32 inv_det = 1.0f / det;
 
-		// Find vectors for two edges sharing v0
-		const Vector3 e1 = v1 - v0;
-		const Vector3 e2 = v2 - v0;
+	// Distance from v0 to ray origin
+	const Vector3 T = from - v0;
 
-		// Begin calculating determinant - also used to calculate u parameter
-		const Vector3 P = cross(dir, e2);
+	// u parameter and test bound
+	const f32 u = dot(T, P) * inv_det;
 
-		// If determinant is near zero, ray lies in plane of triangle
-		const f32 det = dot(e1, P);
-		if (fequal(det, 0.0f))
-			continue;
+	// The intersection lies outside of the triangle
+	if (u < 0.0f || u > 1.0f)
+		return -1.0f;
 
-		const f32 inv_det = 1.0f / det;
+	// Prepare to test v parameter
+	const Vector3 Q = cross(T, e1);
 
-		// Distance from v0 to ray origin
-		const Vector3 T = from - v0;
+	// v parameter and test bound
+	const f32 v = dot(dir, Q) * inv_det;
 
-		// u parameter and test bound
-		const f32 u = dot(T, P) * inv_det;
+	// The intersection lies outside of the triangle
+	if (v < 0.0f || u + v > 1.0f)
+		return -1.0f;
 
-		// The intersection lies outside of the triangle
-		if (u < 0.0f || u > 1.0f)
-			continue;
+	const f32 t = dot(e2, Q) * inv_det;
 
-		// Prepare to test v parameter
-		const Vector3 Q = cross(T, e1);
+	// Ray intersection
+	return t > FLOAT_EPSILON ? t : -1.0f;
+}
 
-		// v parameter and test bound
-		const f32 v = dot(dir, Q) * inv_det;
+template<typename Index>
+static f32 ray_mesh_intersection_internal(const Vector3 &from, const Vector3 &dir, const Matrix4x4 &tm, const void *vertices, u32 stride, const Index *indices, u32 num)
+{
+	bool hit = false;
+	f32 tmin = FLT_MAX;
 
-		// The intersection lies outside of the triangle
-		if (v < 0.0f || u + v > 1.0f)
-			continue;
+	for (u32 i = 0; i < num; i += 3) {
+		const u32 i0 = indices[i + 0];
+		const u32 i1 = indices[i + 1];
+		const u32 i2 = indices[i + 2];
 
-		const f32 t = dot(e2, Q) * inv_det;
+		const Vector3 &v0 = *(Vector3 *)((char *)vertices + i0*stride) * tm;
+		const Vector3 &v1 = *(Vector3 *)((char *)vertices + i1*stride) * tm;
+		const Vector3 &v2 = *(Vector3 *)((char *)vertices + i2*stride) * tm;
 
-		// Ray intersection
-		if (t > FLOAT_EPSILON) {
+		const f32 t = ray_triangle_intersection(from, dir, v0, v1, v2);
+		if (t > 0.0f) {
 			hit = true;
 			tmin = min(t, tmin);
 		}
@@ -212,6 +215,16 @@ f32 ray_mesh_intersection(const Vector3 &from, const Vector3 &dir, const Matrix4
 	return hit ? tmin : -1.0f;
 }
 
+f32 ray_mesh_intersection(const Vector3 &from, const Vector3 &dir, const Matrix4x4 &tm, const void *vertices, u32 stride, const u16 *indices, u32 num)
+{
+	return ray_mesh_intersection_internal(from, dir, tm, vertices, stride, indices, num);
+}
+
+f32 ray_mesh_intersection(const Vector3 &from, const Vector3 &dir, const Matrix4x4 &tm, const void *vertices, u32 stride, const u32 *indices, u32 num)
+{
+	return ray_mesh_intersection_internal(from, dir, tm, vertices, stride, indices, num);
+}
+
 bool plane_3_intersection(Vector3 &ip, const Plane3 &a, const Plane3 &b, const Plane3 &c)
 {
 	const Vector3 na = a.n;
@@ -327,4 +340,268 @@ bool obb_intersects_frustum(const OBB &obb, const Frustum &f)
 	return true;
 }
 
+#if CROWN_SIMD
+namespace intersection
+{
+	/// Four OBBs transposed to SoA: lane i of each vector belongs to the i-th OBB.
+	struct OBBx4
+	{
+		f32x4 center[3];
+		f32x4 axis_x[3];
+		f32x4 axis_y[3];
+		f32x4 axis_z[3];
+	};
+
+	/// Fills @a idx with the 4 indices starting at @a i. Lanes past @a num repeat
+	/// the last index, and the returned mask has their bits cleared.
+	static u32 gather_indices(u32 idx[4], const u32 *indices, u32 i, u32 num)
+	{
+		for (u32 k = 0; k < 4; ++k)
+			idx[k] = indices[i + k < num ? i + k : num - 1];
+
+		return num - i < 4 ? (1u << (num - i)) - 1 : 0xfu;
+	}
+
+	static void transpose_axis(f32x4 axis[3], const OBB *obbs, const u32 idx[4], u32 row)
+	{
+		f32x4 a = f32x4_load(&obbs[idx[0]].tm.x.x + row*4);
+		f32x4 b = f32x4_load(&obbs[idx[1]].tm.x.x + row*4);
+		f32x4 c = f32x4_load(&obbs[idx[2]].tm.x.x + row*4);
+		f32x4 d = f32x4_load(&obbs[idx[3]].tm.x.x + row*4);
+		f32x4_transpose(a, b, c, d);
+
+		if (row < 3) {
+			const f32 *he0 = &obbs[idx[0]].half_extents.x;
+			const f32 *he1 = &obbs[idx[1]].half_extents.x;
+			const f32 *he2 = &obbs[idx[2]].half_extents.x;
+			const f32 *he3 = &obbs[idx[3]].half_extents.x;
+			const f32x4 he = f32x4_set(he0[row], he1[row], he2[row], he3[row]);
+			a = f32x4_mul(a, he);
+			b = f32x4_mul(b, he);
+			c = f32x4_mul(c, he);
+		}
+
+		axis[0] = a;
+		axis[1] = b;
+		axis[2] = c;
+	}
+
+	static void load(OBBx4 &o, const OBB *obbs, const u32 idx[4])
+	{
+		transpose_axis(o.axis_x, obbs, idx, 0);
+		transpose_axis(o.axis_y, obbs, idx, 1);
+		transpose_axis(o.axis_z, obbs, idx, 2);
+		transpose_axis(o.center, obbs, idx, 3);
+	}
+
+	/// Returns n.x*v[0] + n.y*v[1] + n.z*v[2].
+	static inline f32x4 dot(const f32x4 n[3], const f32x4 v[3])
+	{
+		f32x4 r = f32x4_mul(n[0], v[0]);
+		r = f32x4_add(r, f32x4_mul(n[1], v[1]));
+		r = f32x4_add(r, f32x4_mul(n[2], v[2]));
+		return r;
+	}
+
+	/// Returns a + b if @a sign is positive, a - b otherwise.
+	static inline f32x4 add_signed(f32x4 a, f32x4 b, f32 sign)
+	{
+		return sign > 0.0f ? f32x4_add(a, b) : f32x4_sub(a, b);
+	}
+
+} // namespace intersection
+#endif // if CROWN_SIMD
+
+void spheres_intersect_planes(u32 *visible, const Sphere *spheres, const u32 *indices, u32 num, const Plane3 *planes, u32 num_planes)
+{
+	memset(visible, 0, (num + 31) / 32 * sizeof(*visible));
+
+#if CROWN_SIMD
+	for (u32 i = 0; i < num; i += 4) {
+		u32 idx[4];
+		u32 inside = intersection::gather_indices(idx, indices, i, num);
+
+		// Sphere is 16 bytes: transposing 4 of them gives (x, y, z, r) in SoA.
+		f32x4 x = f32x4_load(&spheres[idx[0]].c.x);
+		f32x4 y = f32x4_load(&spheres[idx[1]].c.x);
+		f32x4 z = f32x4_load(&spheres[idx[2]].c.x);
+		f32x4 r = f32x4_load(&spheres[idx[3]].c.x);
+		f32x4_transpose(x, y, z, r);
+
+		for (u32 j = 0; j < num_planes && inside != 0; ++j) {
+			const Plane3 &plane = planes[j];
+			f32x4 dist = f32x4_mul(f32x4_splat(plane.n.x), x);
+			dist = f32x4_add(dist, f32x4_mul(f32x4_splat(plane.n.y), y));
+			dist = f32x4_add(dist, f32x4_mul(f32x4_splat(plane.n.z), z));
+			dist = f32x4_add(dist, r);
+			inside &= f32x4_movemask(f32x4_cmpge(dist, f32x4_splat(plane.d)));
+		}
+
+		visible[i / 32] |= inside << (i % 32);
+	}
+#else
+	for (u32 i = 0; i < num; ++i) {
+		const Sphere &s = spheres[indices[i]];
+
+		bool inside = true;
+		for (u32 j = 0; j < num_planes && inside; ++j)
+			inside = dot(planes[j].n, s.c) + s.r >= planes[j].d;
+
+		visible[i / 32] |= u32(inside) << (i % 32);
+	}
+#endif // if CROWN_SIMD
+}
+
+void obbs_intersect_planes(u32 *visible, const OBB *obbs, const u32 *indices, u32 num, const Plane3 *planes, u32 num_planes)
+{
+	memset(visible, 0, (num + 31) / 32 * sizeof(*visible));
+
+#if CROWN_SIMD
+	for (u32 i = 0; i < num; i += 4) {
+		u32 idx[4];
+		u32 inside = intersection::gather_indices(idx, indices, i, num);
+
+		intersection::OBBx4 o;
+		intersection::load(o, obbs, idx);
+
+		for (u32 j = 0; j < num_planes && inside != 0; ++j) {
+			const Plane3 &plane = planes[j];
+			const f32x4 n[3] = { f32x4_splat(plane.n.x), f32x4_splat(plane.n.y), f32x4_splat(plane.n.z) };
+			f32x4 radius = f32x4_abs(intersection::dot(n, o.axis_x));
+			radius = f32x4_add(radius, f32x4_abs(intersection::dot(n, o.axis_y)));
+			radius = f32x4_add(radius, f32x4_abs(intersection::dot(n, o.axis_z)));
+			const f32x4 dist = f32x4_add(intersection::dot(n, o.center), radius);
+			inside &= f32x4_movemask(f32x4_cmpge(dist, f32x4_splat(plane.d)));
+		}
+
+		visible[i / 32] |= inside << (i % 32);
+	}
+#else
+	for (u32 i = 0; i < num; ++i) {
+		const OBB &obb = obbs[indices[i]];
+		const Vector3 center = translation(obb.tm);
+		const Vector3 axis_x = x(obb.tm) * obb.half_extents.x;
+		const Vector3 axis_y = y(obb.tm) * obb.half_extents.y;
+		const Vector3 axis_z = z(obb.tm) * obb.half_extents.z;
+
+		bool inside = true;
+		for (u32 j = 0; j < num_planes && inside; ++j) {
+			const Plane3 &plane = planes[j];
+			const f32 radius = fabs(dot(plane.n, axis_x))
+				+ fabs(dot(plane.n, axis_y))
+				+ fabs(dot(plane.n, axis_z))
+				;
+			inside = dot(plane.n, center) + radius >= plane.d;
+		}
+
+		visible[i / 32] |= u32(inside) << (i % 32);
+	}
+#endif // if CROWN_SIMD
+}
+
+void obbs_intersect_clip_space(u32 *visible, const OBB *obbs, const u32 *indices, u32 num, const Matrix4x4 &view_proj)
+{
+	memset(visible, 0, (num + 31) / 32 * sizeof(*visible));
+
+	// Signs of the axes of each OBB vertex, in obb::to_vertices() order.
+	static const f32 signs[8][3] =
+	{
+		{ -1.0f, -1.0f, -1.0f },
+		{  1.0f, -1.0f, -1.0f },
+		{  1.0f, -1.0f,  1.0f },
+		{ -1.0f, -1.0f,  1.0f },
+		{ -1.0f,  1.0f, -1.0f },
+		{  1.0f,  1.0f, -1.0f },
+		{  1.0f,  1.0f,  1.0f },
+		{ -1.0f,  1.0f,  1.0f }
+	};
+
+#if CROWN_SIMD
+	const f32 *m = to_float_ptr(view_proj);
+	f32x4 rows[4][4];
+	for (u32 r = 0; r < 4; ++r) {
+		for (u32 c = 0; c < 4; ++c)
+			rows[r][c] = f32x4_splat(m[r*4 + c]);
+	}
+	const f32x4 zero = f32x4_splat(0.0f);
+
+	for (u32 i = 0; i < num; i += 4) {
+		u32 idx[4];
+		const u32 valid = intersection::gather_indices(idx, indices, i, num);
+
+		intersection::OBBx4 o;
+		intersection::load(o, obbs, idx);
+
+		// An OBB is outside the frustum if all its vertices are outside
+		// any one of the six homogeneous clip planes.
+		f32x4 outside[6];
+		for (u32 j = 0; j < countof(signs); ++j) {
+			f32x4 v[3];
+			for (u32 k = 0; k < 3; ++k) {
+				v[k] = intersection::add_signed(o.center[k], o.axis_x[k], signs[j][0]);
+				v[k] = intersection::add_signed(v[k], o.axis_y[k], signs[j][1]);
+				v[k] = intersection::add_signed(v[k], o.axis_z[k], signs[j][2]);
+			}
+
+			f32x4 clip[4];
+			for (u32 c = 0; c < 4; ++c) {
+				clip[c] = f32x4_mul(v[0], rows[0][c]);
+				clip[c] = f32x4_add(clip[c], f32x4_mul(v[1], rows[1][c]));
+				clip[c] = f32x4_add(clip[c], f32x4_mul(v[2], rows[2][c]));
+				clip[c] = f32x4_add(clip[c], rows[3][c]);
+			}
+
+			const f32x4 neg_w = f32x4_sub(zero, clip[3]);
+			const f32x4 out[6] =
+			{
+				f32x4_cmplt(clip[0], neg_w),
+				f32x4_cmpgt(clip[0], clip[3]),
+				f32x4_cmplt(clip[1], neg_w),
+				f32x4_cmpgt(clip[1], clip[3]),
+				f32x4_cmplt(clip[2], neg_w),
+				f32x4_cmpgt(clip[2], clip[3])
+			};
+			for (u32 p = 0; p < countof(out); ++p)
+				outside[p] = j == 0 ? out[p] : f32x4_and(outside[p], out[p]);
+		}
+
+		f32x4 culled = outside[0];
+		for (u32 p = 1; p < countof(outside); ++p)
+			culled = f32x4_or(culled, outside[p]);
+
+		visible[i / 32] |= (~f32x4_movemask(culled) & valid) << (i % 32);
+	}
+#else
+	for (u32 i = 0; i < num; ++i) {
+		const OBB &obb = obbs[indices[i]];
+		const Vector3 center = translation(obb.tm);
+		const Vector3 axes[3] =
+		{
+			x(obb.tm) * obb.half_extents.x,
+			y(obb.tm) * obb.half_extents.y,
+			z(obb.tm) * obb.half_extents.z
+		};
+
+		u32 outside = 0x3f;
+		for (u32 j = 0; j < countof(signs); ++j) {
+			Vector3 v = center;
+			for (u32 k = 0; k < 3; ++k)
+				v = signs[j][k] > 0.0f ? v + axes[k] : v - axes[k];
+
+			const Vector4 vertex = { v.x, v.y, v.z, 1.0f };
+			const Vector4 clip = vertex * view_proj;
+			outside &= u32(clip.x < -clip.w) << 0
+				| u32(clip.x > clip.w) << 1
+				| u32(clip.y < -clip.w) << 2
+				| u32(clip.y > clip.w) << 3
+				| u32(clip.z < -clip.w) << 4
+				| u32(clip.z > clip.w) << 5
+				;
+		}
+
+		visible[i / 32] |= u32(outside == 0) << (i % 32);
+	}
+#endif // if CROWN_SIMD
+}
+
 } // namespace crown
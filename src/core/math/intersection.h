@@ -36,6 +36,9 @@ f32 ray_triangle_intersection(const Vector3 &from, const Vector3 &dir, const Vec
 /// mesh defined by (vertices, stride, indices, num) or -1.0 if no intersection.
 f32 ray_mesh_intersection(const Vector3 &from, const Vector3 &dir, const Matrix4x4 &tm, const void *vertices, u32 stride, const u16 *indices, u32 num);
 
+/// @copydoc ray_mesh_intersection()
+f32 ray_mesh_intersection(const Vector3 &from, const Vector3 &dir, const Matrix4x4 &tm, const void *vertices, u32 stride, const u32 *indices, u32 num);
+
 /// Returns whether the planes @a a, @a b and @a c intersects and if so fills @a ip with the intersection point.
 bool plane_3_intersection(Vector3 &ip, const Plane3 &a, const Plane3 &b, const Plane3 &c);
 
@@ -45,6 +48,19 @@ bool sphere_intersects_frustum(const Sphere &s, const Frustum &f);
 /// Returns whether the OBB @a obb intersects the frustum @a f.
 bool obb_intersects_frustum(const OBB &obb, const Frustum &f);
 
+/// Tests the @a num spheres spheres[indices[i]] against the @a num_planes @a planes.
+/// Sets bit i of the bitmask @a visible if the sphere is not entirely behind any of
+/// the planes, clears it otherwise. @a visible must hold (@a num + 31) / 32 words.
+void spheres_intersect_planes(u32 *visible, const Sphere *spheres, const u32 *indices, u32 num, const Plane3 *planes, u32 num_planes);
+
+/// Same as spheres_intersect_planes() but for the OBBs obbs[indices[i]].
+void obbs_intersect_planes(u32 *visible, const OBB *obbs, const u32 *indices, u32 num, const Plane3 *planes, u32 num_planes);
+
+/// Sets bit i of the bitmask @a visible if the OBB obbs[indices[i]] is not entirely
+/// outside any of the clip planes of @a view_proj, clears it otherwise.
+/// @a visible must hold (@a num + 31) / 32 words.
+void obbs_intersect_clip_space(u32 *visible, const OBB *obbs, const u32 *indices, u32 num, const Matrix4x4 &view_proj);
+
 /// @}
 
 } // namespace crown
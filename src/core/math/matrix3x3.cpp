@@ -4,6 +4,7 @@
  */
 
 #include "core/math/matrix3x3.inl"
+#include "core/math/simd.h"
 
 namespace crown
 {
@@ -69,6 +70,51 @@ Matrix3x3 from_z_axis_angle(f32 angle)
 
 Matrix3x3 from_quaternion(const Quaternion &r)
 {
+#if CROWN_SIMD
+	// Same terms as the scalar version below, one row at a time.
+	const f32x4 q = f32x4_load(&r.x);
+	const f32x4 two = f32x4_splat(2.0f);
+	const f32x4 sign_x = f32x4_set(-1.0f,  1.0f,  1.0f, 0.0f);
+	const f32x4 sign_y = f32x4_set( 1.0f, -1.0f,  1.0f, 0.0f);
+	const f32x4 sign_z = f32x4_set( 1.0f,  1.0f, -1.0f, 0.0f);
+
+	// (-yy, xy, xz) + (-zz, wz, -wy)
+	f32x4 a = f32x4_mul(f32x4_swizzle<1, 0, 0, 0>(q), f32x4_swizzle<1, 1, 2, 0>(q));
+	f32x4 b = f32x4_mul(f32x4_swizzle<2, 3, 3, 0>(q), f32x4_swizzle<2, 2, 1, 0>(q));
+	f32x4 x = f32x4_add(f32x4_set(1.0f, 0.0f, 0.0f, 0.0f), f32x4_mul(two, f32x4_mul(a, sign_x)));
+	x = f32x4_add(x, f32x4_mul(two, f32x4_mul(b, f32x4_set(-1.0f, 1.0f, -1.0f, 0.0f))));
+
+	// (xy, -xx, yz) + (-wz, -zz, wx)
+	a = f32x4_mul(f32x4_swizzle<0, 0, 1, 0>(q), f32x4_swizzle<1, 0, 2, 0>(q));
+	b = f32x4_mul(f32x4_swizzle<3, 2, 3, 0>(q), f32x4_swizzle<2, 2, 0, 0>(q));
+	f32x4 y = f32x4_add(f32x4_set(0.0f, 1.0f, 0.0f, 0.0f), f32x4_mul(two, f32x4_mul(a, sign_y)));
+	y = f32x4_add(y, f32x4_mul(two, f32x4_mul(b, f32x4_set(-1.0f, -1.0f, 1.0f, 0.0f))));
+
+	// (xz, yz, -xx) + (wy, -wx, -yy)
+	a = f32x4_mul(f32x4_swizzle<0, 1, 0, 0>(q), f32x4_swizzle<2, 2, 0, 0>(q));
+	b = f32x4_mul(f32x4_swizzle<3, 3, 1, 0>(q), f32x4_swizzle<1, 0, 1, 0>(q));
+	f32x4 z = f32x4_add(f32x4_set(0.0f, 0.0f, 1.0f, 0.0f), f32x4_mul(two, f32x4_mul(a, sign_z)));
+	z = f32x4_add(z, f32x4_mul(two, f32x4_mul(b, f32x4_set(1.0f, -1.0f, -1.0f, 0.0f))));
+
+	f32 tmp[3][4];
+	f32x4_store(tmp[0], x);
+	f32x4_store(tmp[1], y);
+	f32x4_store(tmp[2], z);
+
+	Matrix3x3 m;
+	m.x.x = tmp[0][0];
+	m.x.y = tmp[0][1];
+	m.x.z = tmp[0][2];
+
+	m.y.x = tmp[1][0];
+	m.y.y = tmp[1][1];
+	m.y.z = tmp[1][2];
+
+	m.z.x = tmp[2][0];
+	m.z.y = tmp[2][1];
+	m.z.z = tmp[2][2];
+	return m;
+#else
 	const float xx = r.x * r.x;
 	const float yy = r.y * r.y;
 	const float zz = r.z * r.z;
@@ -92,6 +138,7 @@ Matrix3x3 from_quaternion(const Quaternion &r)
 	m.z.y = 2.0f * yz - 2.0f * wx;
 	m.z.z = 1.0f - 2.0f * xx - 2.0f * yy;
 	return m;
+#endif // if CROWN_SIMD
 }
 
 Matrix3x3 &invert(Matrix3x3 &m)
@@ -184,4 +184,62 @@ Matrix4x4 &invert(Matrix4x4 &m)
 	return m;
 }
 
+void multiply_n(Matrix4x4 *out, const Matrix4x4 *a, const Matrix4x4 *b, u32 num)
+{
+	for (u32 i = 0; i < num; ++i)
+		out[i] = a[i] * b[i];
+}
+
+void multiply_n(Matrix4x4 *out, const Matrix4x4 *a, const Matrix4x4 &b, u32 num)
+{
+#if CROWN_SIMD
+	const f32x4 bx = f32x4_load(&b.x.x);
+	const f32x4 by = f32x4_load(&b.y.x);
+	const f32x4 bz = f32x4_load(&b.z.x);
+	const f32x4 bt = f32x4_load(&b.t.x);
+
+	for (u32 i = 0; i < num; ++i) {
+		const f32x4 ax = f32x4_load(&a[i].x.x);
+		const f32x4 ay = f32x4_load(&a[i].y.x);
+		const f32x4 az = f32x4_load(&a[i].z.x);
+		const f32x4 at = f32x4_load(&a[i].t.x);
+		f32x4_store(&out[i].x.x, f32x4_mul_rows(ax, bx, by, bz, bt));
+		f32x4_store(&out[i].y.x, f32x4_mul_rows(ay, bx, by, bz, bt));
+		f32x4_store(&out[i].z.x, f32x4_mul_rows(az, bx, by, bz, bt));
+		f32x4_store(&out[i].t.x, f32x4_mul_rows(at, bx, by, bz, bt));
+	}
+#else
+	const Matrix4x4 tmp = b;
+	for (u32 i = 0; i < num; ++i)
+		out[i] = a[i] * tmp;
+#endif
+}
+
+void transform_points_n(Vector3 *out, const Vector3 *points, u32 num, const Matrix4x4 &m)
+{
+#if CROWN_SIMD
+	const f32x4 mx = f32x4_load(&m.x.x);
+	const f32x4 my = f32x4_load(&m.y.x);
+	const f32x4 mz = f32x4_load(&m.z.x);
+	const f32x4 mt = f32x4_load(&m.t.x);
+
+	for (u32 i = 0; i < num; ++i) {
+		f32x4 t = f32x4_mul(f32x4_splat(points[i].x), mx);
+		t = f32x4_add(t, f32x4_mul(f32x4_splat(points[i].y), my));
+		t = f32x4_add(t, f32x4_mul(f32x4_splat(points[i].z), mz));
+		t = f32x4_add(t, mt);
+
+		f32 tmp[4];
+		f32x4_store(tmp, t);
+		out[i].x = tmp[0];
+		out[i].y = tmp[1];
+		out[i].z = tmp[2];
+	}
+#else
+	const Matrix4x4 tmp = m;
+	for (u32 i = 0; i < num; ++i)
+		out[i] = points[i] * tmp;
+#endif
+}
+
 } // namespace crown
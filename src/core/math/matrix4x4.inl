@@ -9,6 +9,7 @@
 #include "core/math/math.h"
 #include "core/math/matrix3x3.inl"
 #include "core/math/quaternion.inl"
+#include "core/math/simd.h"
 #include "core/math/types.h"
 #include "core/math/vector4.inl"
 
@@ -65,6 +66,17 @@ inline Matrix4x4 &operator*=(Matrix4x4 &a, f32 k)
 /// Multiplies the matrix @a a by @a b and returns the result. (i.e. transforms first by @a a then by @a b)
 inline Matrix4x4 &operator*=(Matrix4x4 &a, const Matrix4x4 &b)
 {
+#if CROWN_SIMD
+	const f32x4 bx = f32x4_load(&b.x.x);
+	const f32x4 by = f32x4_load(&b.y.x);
+	const f32x4 bz = f32x4_load(&b.z.x);
+	const f32x4 bt = f32x4_load(&b.t.x);
+	f32x4_store(&a.x.x, f32x4_mul_rows(f32x4_load(&a.x.x), bx, by, bz, bt));
+	f32x4_store(&a.y.x, f32x4_mul_rows(f32x4_load(&a.y.x), bx, by, bz, bt));
+	f32x4_store(&a.z.x, f32x4_mul_rows(f32x4_load(&a.z.x), bx, by, bz, bt));
+	f32x4_store(&a.t.x, f32x4_mul_rows(f32x4_load(&a.t.x), bx, by, bz, bt));
+	return a;
+#else
 	Matrix4x4 tmp;
 
 	tmp.x.x = a.x.x*b.x.x + a.x.y*b.y.x + a.x.z*b.z.x + a.x.w*b.t.x;
@@ -89,6 +101,7 @@ inline Matrix4x4 &operator*=(Matrix4x4 &a, const Matrix4x4 &b)
 
 	a = tmp;
 	return a;
+#endif // if CROWN_SIMD
 }
 
 /// Adds the matrix @a a to @a b and returns the result.
@@ -122,22 +135,45 @@ inline Matrix4x4 operator*(f32 k, Matrix4x4 a)
 /// Multiplies the matrix @a a by the vector @a v and returns the result.
 inline Vector3 operator*(const Vector3 &v, const Matrix4x4 &a)
 {
+#if CROWN_SIMD
+	f32x4 t = f32x4_mul(f32x4_splat(v.x), f32x4_load(&a.x.x));
+	t = f32x4_add(t, f32x4_mul(f32x4_splat(v.y), f32x4_load(&a.y.x)));
+	t = f32x4_add(t, f32x4_mul(f32x4_splat(v.z), f32x4_load(&a.z.x)));
+	t = f32x4_add(t, f32x4_load(&a.t.x));
+
+	f32 tmp[4];
+	f32x4_store(tmp, t);
+	Vector3 r = { tmp[0], tmp[1], tmp[2] };
+	return r;
+#else
 	Vector3 r;
 	r.x = v.x*a.x.x + v.y*a.y.x + v.z*a.z.x + a.t.x;
 	r.y = v.x*a.x.y + v.y*a.y.y + v.z*a.z.y + a.t.y;
 	r.z = v.x*a.x.z + v.y*a.y.z + v.z*a.z.z + a.t.z;
 	return r;
+#endif // if CROWN_SIMD
 }
 
 /// Multiplies the matrix @a by the vector @a v and returns the result.
 inline Vector4 operator*(const Vector4 &v, const Matrix4x4 &a)
 {
+#if CROWN_SIMD
+	Vector4 r;
+	f32x4_store(&r.x, f32x4_mul_rows(f32x4_load(&v.x)
+		, f32x4_load(&a.x.x)
+		, f32x4_load(&a.y.x)
+		, f32x4_load(&a.z.x)
+		, f32x4_load(&a.t.x)
+		));
+	return r;
+#else
 	Vector4 r;
 	r.x = v.x*a.x.x + v.y*a.y.x + v.z*a.z.x + v.w*a.t.x;
 	r.y = v.x*a.x.y + v.y*a.y.y + v.z*a.z.y + v.w*a.t.y;
 	r.z = v.x*a.x.z + v.y*a.y.z + v.z*a.z.z + v.w*a.t.z;
 	r.w = v.x*a.x.w + v.y*a.y.w + v.z*a.z.w + v.w*a.t.w;
 	return r;
+#endif // if CROWN_SIMD
 }
 
 /// Multiplies the matrix @a a by @a b and returns the result. (i.e. transforms first by @a a then by @a b)
@@ -147,6 +183,18 @@ inline Matrix4x4 operator*(Matrix4x4 a, const Matrix4x4 &b)
 	return a;
 }
 
+/// Sets @a out[i] = @a a[i] * @a b[i] for each of the @a num matrices.
+/// @a out can alias @a a or @a b.
+void multiply_n(Matrix4x4 *out, const Matrix4x4 *a, const Matrix4x4 *b, u32 num);
+
+/// Sets @a out[i] = @a a[i] * @a b for each of the @a num matrices.
+/// @a out can alias @a a.
+void multiply_n(Matrix4x4 *out, const Matrix4x4 *a, const Matrix4x4 &b, u32 num);
+
+/// Transforms the @a num @a points by the matrix @a m and stores the
+/// results in @a out. @a out can alias @a points.
+void transform_points_n(Vector3 *out, const Vector3 *points, u32 num, const Matrix4x4 &m);
+
 /// Returns true whether the matrices @a a and @a b are equal.
 inline bool operator==(const Matrix4x4 &a, const Matrix4x4 &b)
 {
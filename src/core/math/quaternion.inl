@@ -7,6 +7,7 @@
 
 #include "core/math/math.h"
 #include "core/math/matrix3x3.inl"
+#include "core/math/simd.h"
 #include "core/math/types.h"
 
 namespace crown
@@ -34,6 +35,18 @@ Quaternion quaternion(const Matrix3x3 &m);
 /// Multiplies the quaternions @a a by @a b and returns the result. (i.e. rotates first by @a a then by @a b).
 inline Quaternion &operator*=(Quaternion &a, const Quaternion &b)
 {
+#if CROWN_SIMD
+	const f32x4 sign = f32x4_set(1.0f, 1.0f, 1.0f, -1.0f);
+	const f32x4 qa = f32x4_load(&a.x);
+	const f32x4 qb = f32x4_load(&b.x);
+
+	f32x4 r = f32x4_mul(f32x4_splat<3>(qa), qb);
+	r = f32x4_add(r, f32x4_mul(f32x4_mul(f32x4_swizzle<0, 1, 2, 0>(qa), f32x4_swizzle<3, 3, 3, 0>(qb)), sign));
+	r = f32x4_add(r, f32x4_mul(f32x4_mul(f32x4_swizzle<1, 2, 0, 1>(qa), f32x4_swizzle<2, 0, 1, 1>(qb)), sign));
+	r = f32x4_sub(r, f32x4_mul(f32x4_swizzle<2, 0, 1, 2>(qa), f32x4_swizzle<1, 2, 0, 2>(qb)));
+	f32x4_store(&a.x, r);
+	return a;
+#else
 	const f32 tx = a.w*b.x + a.x*b.w + a.y*b.z - a.z*b.y;
 	const f32 ty = a.w*b.y + a.y*b.w + a.z*b.x - a.x*b.z;
 	const f32 tz = a.w*b.z + a.z*b.w + a.x*b.y - a.y*b.x;
@@ -43,6 +56,7 @@ inline Quaternion &operator*=(Quaternion &a, const Quaternion &b)
 	a.z = tz;
 	a.w = tw;
 	return a;
+#endif // if CROWN_SIMD
 }
 
 /// Negates the quaternion @a q and returns the result.
@@ -91,10 +105,14 @@ inline Quaternion &normalize(Quaternion &q)
 {
 	const f32 len = length(q);
 	const f32 inv_len = 1.0f / len;
+#if CROWN_SIMD
+	f32x4_store(&q.x, f32x4_mul(f32x4_load(&q.x), f32x4_splat(inv_len)));
+#else
 	q.x *= inv_len;
 	q.y *= inv_len;
 	q.z *= inv_len;
 	q.w *= inv_len;
+#endif
 	return q;
 }
 
@@ -182,6 +200,11 @@ inline Quaternion lerp(const Quaternion &a, const Quaternion &b, f32 t)
 
 	Quaternion r;
 
+#if CROWN_SIMD
+	const f32x4 qa = f32x4_mul(f32x4_splat(t1), f32x4_load(&a.x));
+	const f32x4 qb = f32x4_mul(f32x4_splat(t), f32x4_load(&b.x));
+	f32x4_store(&r.x, dot(a, b) < 0.0f ? f32x4_sub(qa, qb) : f32x4_add(qa, qb));
+#else
 	if (dot(a, b) < 0.0f) {
 		r.x = t1*a.x - t*b.x;
 		r.y = t1*a.y - t*b.y;
@@ -193,6 +216,7 @@ inline Quaternion lerp(const Quaternion &a, const Quaternion &b, f32 t)
 		r.z = t1*a.z + t*b.z;
 		r.w = t1*a.w + t*b.w;
 	}
+#endif // if CROWN_SIMD
 
 	return normalize(r);
 }
@@ -0,0 +1,294 @@
+/*
+ * Copyright (c) 2012-2026 Daniele Bartolini et al.
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include "core/types.h"
+
+/// Set CROWN_SIMD to 0 to force the scalar implementation of the math kernels.
+#ifndef CROWN_SIMD
+	#define CROWN_SIMD 1
+#endif
+
+#define CROWN_SIMD_SSE 0
+#define CROWN_SIMD_NEON 0
+
+#if CROWN_SIMD
+	#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+		#undef CROWN_SIMD_SSE
+		#define CROWN_SIMD_SSE 1
+		#include <emmintrin.h>
+	#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+		#undef CROWN_SIMD_NEON
+		#define CROWN_SIMD_NEON 1
+		#include <arm_neon.h>
+	#else
+		#undef CROWN_SIMD
+		#define CROWN_SIMD 0
+	#endif
+#endif // if CROWN_SIMD
+
+#if CROWN_SIMD
+namespace crown
+{
+/// @addtogroup Math
+/// @{
+
+/// Thin wrappers over the 4-wide float intrinsics of the target CPU.
+///
+/// Kernels built on top of them must perform the same operations, in the
+/// same order, as their scalar counterparts. Fused multiply-add and
+/// reciprocal estimates are never used, so results match the scalar path.
+#if CROWN_SIMD_SSE
+typedef __m128 f32x4;
+
+inline f32x4 f32x4_load(const f32 *p)
+{
+	return _mm_loadu_ps(p);
+}
+
+inline void f32x4_store(f32 *p, f32x4 a)
+{
+	_mm_storeu_ps(p, a);
+}
+
+inline f32x4 f32x4_set(f32 x, f32 y, f32 z, f32 w)
+{
+	return _mm_set_ps(w, z, y, x);
+}
+
+inline f32x4 f32x4_splat(f32 a)
+{
+	return _mm_set1_ps(a);
+}
+
+inline f32x4 f32x4_add(f32x4 a, f32x4 b)
+{
+	return _mm_add_ps(a, b);
+}
+
+inline f32x4 f32x4_sub(f32x4 a, f32x4 b)
+{
+	return _mm_sub_ps(a, b);
+}
+
+inline f32x4 f32x4_mul(f32x4 a, f32x4 b)
+{
+	return _mm_mul_ps(a, b);
+}
+
+/// Returns the vector (a[X], a[Y], a[Z], a[W]).
+template<int X, int Y, int Z, int W>
+inline f32x4 f32x4_swizzle(f32x4 a)
+{
+	return _mm_shuffle_ps(a, a, _MM_SHUFFLE(W, Z, Y, X));
+}
+
+/// Returns the lanes of |a|.
+inline f32x4 f32x4_abs(f32x4 a)
+{
+	return _mm_andnot_ps(_mm_set1_ps(-0.0f), a);
+}
+
+/// Returns all ones in the lanes where a >= b, zero elsewhere.
+inline f32x4 f32x4_cmpge(f32x4 a, f32x4 b)
+{
+	return _mm_cmpge_ps(a, b);
+}
+
+/// Returns all ones in the lanes where a < b, zero elsewhere.
+inline f32x4 f32x4_cmplt(f32x4 a, f32x4 b)
+{
+	return _mm_cmplt_ps(a, b);
+}
+
+/// Returns all ones in the lanes where a > b, zero elsewhere.
+inline f32x4 f32x4_cmpgt(f32x4 a, f32x4 b)
+{
+	return _mm_cmpgt_ps(a, b);
+}
+
+inline f32x4 f32x4_and(f32x4 a, f32x4 b)
+{
+	return _mm_and_ps(a, b);
+}
+
+inline f32x4 f32x4_or(f32x4 a, f32x4 b)
+{
+	return _mm_or_ps(a, b);
+}
+
+inline f32x4 f32x4_min(f32x4 a, f32x4 b)
+{
+	return _mm_min_ps(a, b);
+}
+
+inline f32x4 f32x4_max(f32x4 a, f32x4 b)
+{
+	return _mm_max_ps(a, b);
+}
+
+/// Returns a in the lanes where @a mask is all ones, b elsewhere.
+inline f32x4 f32x4_select(f32x4 mask, f32x4 a, f32x4 b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+/// Returns the sign bits of the lanes of @a a packed in the low 4 bits.
+inline u32 f32x4_movemask(f32x4 a)
+{
+	return (u32)_mm_movemask_ps(a);
+}
+
+/// Transposes the 4x4 matrix whose rows are @a a, @a b, @a c and @a d.
+inline void f32x4_transpose(f32x4 &a, f32x4 &b, f32x4 &c, f32x4 &d)
+{
+	_MM_TRANSPOSE4_PS(a, b, c, d);
+}
+#elif CROWN_SIMD_NEON
+typedef float32x4_t f32x4;
+
+inline f32x4 f32x4_load(const f32 *p)
+{
+	return vld1q_f32(p);
+}
+
+inline void f32x4_store(f32 *p, f32x4 a)
+{
+	vst1q_f32(p, a);
+}
+
+inline f32x4 f32x4_set(f32 x, f32 y, f32 z, f32 w)
+{
+	const f32 v[4] = { x, y, z, w };
+	return vld1q_f32(v);
+}
+
+inline f32x4 f32x4_splat(f32 a)
+{
+	return vdupq_n_f32(a);
+}
+
+inline f32x4 f32x4_add(f32x4 a, f32x4 b)
+{
+	return vaddq_f32(a, b);
+}
+
+inline f32x4 f32x4_sub(f32x4 a, f32x4 b)
+{
+	return vsubq_f32(a, b);
+}
+
+inline f32x4 f32x4_mul(f32x4 a, f32x4 b)
+{
+	return vmulq_f32(a, b);
+}
+
+/// Returns the vector (a[X], a[Y], a[Z], a[W]).
+template<int X, int Y, int Z, int W>
+inline f32x4 f32x4_swizzle(f32x4 a)
+{
+	f32x4 r = vdupq_n_f32(vgetq_lane_f32(a, X));
+	r = vsetq_lane_f32(vgetq_lane_f32(a, Y), r, 1);
+	r = vsetq_lane_f32(vgetq_lane_f32(a, Z), r, 2);
+	r = vsetq_lane_f32(vgetq_lane_f32(a, W), r, 3);
+	return r;
+}
+
+/// Returns the lanes of |a|.
+inline f32x4 f32x4_abs(f32x4 a)
+{
+	return vabsq_f32(a);
+}
+
+/// Returns all ones in the lanes where a >= b, zero elsewhere.
+inline f32x4 f32x4_cmpge(f32x4 a, f32x4 b)
+{
+	return vreinterpretq_f32_u32(vcgeq_f32(a, b));
+}
+
+/// Returns all ones in the lanes where a < b, zero elsewhere.
+inline f32x4 f32x4_cmplt(f32x4 a, f32x4 b)
+{
+	return vreinterpretq_f32_u32(vcltq_f32(a, b));
+}
+
+/// Returns all ones in the lanes where a > b, zero elsewhere.
+inline f32x4 f32x4_cmpgt(f32x4 a, f32x4 b)
+{
+	return vreinterpretq_f32_u32(vcgtq_f32(a, b));
+}
+
+inline f32x4 f32x4_and(f32x4 a, f32x4 b)
+{
+	return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b)));
+}
+
+inline f32x4 f32x4_or(f32x4 a, f32x4 b)
+{
+	return vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b)));
+}
+
+inline f32x4 f32x4_min(f32x4 a, f32x4 b)
+{
+	return vminq_f32(a, b);
+}
+
+inline f32x4 f32x4_max(f32x4 a, f32x4 b)
+{
+	return vmaxq_f32(a, b);
+}
+
+/// Returns a in the lanes where @a mask is all ones, b elsewhere.
+inline f32x4 f32x4_select(f32x4 mask, f32x4 a, f32x4 b)
+{
+	return vbslq_f32(vreinterpretq_u32_f32(mask), a, b);
+}
+
+/// Returns the sign bits of the lanes of @a a packed in the low 4 bits.
+inline u32 f32x4_movemask(f32x4 a)
+{
+	const uint32x4_t s = vshrq_n_u32(vreinterpretq_u32_f32(a), 31);
+	return vgetq_lane_u32(s, 0)
+		| (vgetq_lane_u32(s, 1) << 1)
+		| (vgetq_lane_u32(s, 2) << 2)
+		| (vgetq_lane_u32(s, 3) << 3)
+		;
+}
+
+/// Transposes the 4x4 matrix whose rows are @a a, @a b, @a c and @a d.
+inline void f32x4_transpose(f32x4 &a, f32x4 &b, f32x4 &c, f32x4 &d)
+{
+	const float32x4x2_t ab = vtrnq_f32(a, b);
+	const float32x4x2_t cd = vtrnq_f32(c, d);
+	a = vcombine_f32(vget_low_f32(ab.val[0]), vget_low_f32(cd.val[0]));
+	b = vcombine_f32(vget_low_f32(ab.val[1]), vget_low_f32(cd.val[1]));
+	c = vcombine_f32(vget_high_f32(ab.val[0]), vget_high_f32(cd.val[0]));
+	d = vcombine_f32(vget_high_f32(ab.val[1]), vget_high_f32(cd.val[1]));
+}
+#endif // if CROWN_SIMD_SSE
+
+/// Returns the vector (a[I], a[I], a[I], a[I]).
+template<int I>
+inline f32x4 f32x4_splat(f32x4 a)
+{
+	return f32x4_swizzle<I, I, I, I>(a);
+}
+
+/// Returns a[0]*x + a[1]*y + a[2]*z + a[3]*t, evaluated from left to right.
+inline f32x4 f32x4_mul_rows(f32x4 a, f32x4 x, f32x4 y, f32x4 z, f32x4 t)
+{
+	f32x4 r = f32x4_mul(f32x4_splat<0>(a), x);
+	r = f32x4_add(r, f32x4_mul(f32x4_splat<1>(a), y));
+	r = f32x4_add(r, f32x4_mul(f32x4_splat<2>(a), z));
+	r = f32x4_add(r, f32x4_mul(f32x4_splat<3>(a), t));
+	return r;
+}
+
+/// @}
+
+} // namespace crown
+
+#endif // if CROWN_SIMD
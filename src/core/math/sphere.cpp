@@ -4,6 +4,7 @@
  */
 
 #include "core/math/constants.h"
+#include "core/math/simd.h"
 #include "core/math/sphere.inl"
 
 namespace crown
@@ -79,6 +80,73 @@ namespace sphere
 		}
 	}
 
+	void transform(Sphere *out, const Sphere *spheres, const Matrix4x4 *world, const u32 *indices, u32 num)
+	{
+		u32 i = 0;
+#if CROWN_SIMD
+		// Four spheres at a time, one per lane.
+		for (; i + 4 <= num; i += 4) {
+			const Matrix4x4 &m0 = world[indices[i + 0]];
+			const Matrix4x4 &m1 = world[indices[i + 1]];
+			const Matrix4x4 &m2 = world[indices[i + 2]];
+			const Matrix4x4 &m3 = world[indices[i + 3]];
+
+			f32x4 xx = f32x4_load(&m0.x.x);
+			f32x4 xy = f32x4_load(&m1.x.x);
+			f32x4 xz = f32x4_load(&m2.x.x);
+			f32x4 xw = f32x4_load(&m3.x.x);
+			f32x4_transpose(xx, xy, xz, xw);
+			f32x4 yx = f32x4_load(&m0.y.x);
+			f32x4 yy = f32x4_load(&m1.y.x);
+			f32x4 yz = f32x4_load(&m2.y.x);
+			f32x4 yw = f32x4_load(&m3.y.x);
+			f32x4_transpose(yx, yy, yz, yw);
+			f32x4 zx = f32x4_load(&m0.z.x);
+			f32x4 zy = f32x4_load(&m1.z.x);
+			f32x4 zz = f32x4_load(&m2.z.x);
+			f32x4 zw = f32x4_load(&m3.z.x);
+			f32x4_transpose(zx, zy, zz, zw);
+			f32x4 tx = f32x4_load(&m0.t.x);
+			f32x4 ty = f32x4_load(&m1.t.x);
+			f32x4 tz = f32x4_load(&m2.t.x);
+			f32x4 tw = f32x4_load(&m3.t.x);
+			f32x4_transpose(tx, ty, tz, tw);
+
+			f32x4 cx = f32x4_load(&spheres[indices[i + 0]].c.x);
+			f32x4 cy = f32x4_load(&spheres[indices[i + 1]].c.x);
+			f32x4 cz = f32x4_load(&spheres[indices[i + 2]].c.x);
+			f32x4 r  = f32x4_load(&spheres[indices[i + 3]].c.x);
+			f32x4_transpose(cx, cy, cz, r);
+
+			// Center: c * m.
+			f32x4 ox = f32x4_add(f32x4_add(f32x4_add(f32x4_mul(cx, xx), f32x4_mul(cy, yx)), f32x4_mul(cz, zx)), tx);
+			f32x4 oy = f32x4_add(f32x4_add(f32x4_add(f32x4_mul(cx, xy), f32x4_mul(cy, yy)), f32x4_mul(cz, zy)), ty);
+			f32x4 oz = f32x4_add(f32x4_add(f32x4_add(f32x4_mul(cx, xz), f32x4_mul(cy, yz)), f32x4_mul(cz, zz)), tz);
+
+			// Largest squared scale. The square root is monotonic, so taking it
+			// after the max gives the same result as scale().
+			const f32x4 sx = f32x4_add(f32x4_add(f32x4_mul(xx, xx), f32x4_mul(xy, xy)), f32x4_mul(xz, xz));
+			const f32x4 sy = f32x4_add(f32x4_add(f32x4_mul(yx, yx), f32x4_mul(yy, yy)), f32x4_mul(yz, yz));
+			const f32x4 sz = f32x4_add(f32x4_add(f32x4_mul(zx, zx), f32x4_mul(zy, zy)), f32x4_mul(zz, zz));
+			f32x4 ss = f32x4_max(f32x4_max(sx, sy), sz);
+
+			f32x4_transpose(ox, oy, oz, ss);
+			f32x4_store(&out[i + 0].c.x, ox);
+			f32x4_store(&out[i + 1].c.x, oy);
+			f32x4_store(&out[i + 2].c.x, oz);
+			f32x4_store(&out[i + 3].c.x, ss);
+
+			out[i + 0].r = spheres[indices[i + 0]].r * fsqrt(out[i + 0].r);
+			out[i + 1].r = spheres[indices[i + 1]].r * fsqrt(out[i + 1].r);
+			out[i + 2].r = spheres[indices[i + 2]].r * fsqrt(out[i + 2].r);
+			out[i + 3].r = spheres[indices[i + 3]].r * fsqrt(out[i + 3].r);
+		}
+#endif // if CROWN_SIMD
+
+		for (; i < num; ++i)
+			transform(out[i], spheres[indices[i]], world[indices[i]]);
+	}
+
 } // namespace sphere
 
 } // namespace crown
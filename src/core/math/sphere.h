@@ -38,6 +38,10 @@ namespace sphere
 	///
 	void transform(Sphere &out, const Sphere &s, const Matrix4x4 &m);
 
+	/// Transforms the @a num spheres spheres[indices[i]] by world[indices[i]] and
+	/// stores the results in out[i]. Results match transform() exactly.
+	void transform(Sphere *out, const Sphere *spheres, const Matrix4x4 *world, const u32 *indices, u32 num);
+
 } // namespace sphere
 
 } // namespace crown
@@ -48,6 +48,18 @@ namespace os
 #endif
 	}
 
+	u32 num_cpus()
+	{
+#if CROWN_PLATFORM_WINDOWS
+		SYSTEM_INFO si;
+		GetSystemInfo(&si);
+		return max(1u, (u32)si.dwNumberOfProcessors);
+#else
+		const long num = sysconf(_SC_NPROCESSORS_ONLN);
+		return num > 0 ? (u32)num : 1u;
+#endif
+	}
+
 	void *library_open(const char *path)
 	{
 #if CROWN_PLATFORM_WINDOWS
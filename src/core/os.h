@@ -89,6 +89,9 @@ namespace os
 	/// Suspends execution for @a ms milliseconds.
 	void sleep(u32 ms);
 
+	/// Returns the number of logical processors available.
+	u32 num_cpus();
+
 	/// Opens the library at @a path.
 	void *library_open(const char *path);
 
@@ -131,12 +131,14 @@ namespace profiler_globals
 	void flush()
 	{
 		profiler::flush_local_buffer();
+		ScopedMutex sm(profiler::_buffer_mutex);
 		u32 end = ProfilerEventType::COUNT;
 		array::push(*_buffer, (const char *)&end, (u32)sizeof(end));
 	}
 
 	void clear()
 	{
+		ScopedMutex sm(profiler::_buffer_mutex);
 		array::clear(*_buffer);
 	}
 
@@ -0,0 +1,367 @@
+/*
+ * Copyright (c) 2012-2026 Daniele Bartolini et al.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "core/containers/array.inl"
+#include "core/error/error.h"
+#include "core/memory/globals.h"
+#include "core/memory/memory.inl"
+#include "core/memory/temp_allocator.inl"
+#include "core/platform.h"
+#include "core/profiler.h"
+#include "core/thread/job_system.h"
+#include "core/thread/mutex.h"
+#include "core/thread/scoped_mutex.inl"
+#include "core/thread/semaphore.h"
+#include "core/thread/thread.h"
+#include <stdint.h> // uintptr_t
+
+#define JOB_SYSTEM_MAX_THREADS 64
+#define JOB_DEQUE_SIZE 4096
+
+namespace crown
+{
+/// Chase-Lev work-stealing deque.
+/// The owner thread pushes and pops at the bottom, other threads steal
+/// from the top.
+/// https://fzn.fr/readings/ppopp13.pdf
+struct JobDeque
+{
+	CE_STATIC_ASSERT(is_power_of_2(JOB_DEQUE_SIZE));
+
+	CE_ALIGN_DECL(CROWN_CACHE_LINE_SIZE, std::atomic<s64> _top);
+	CE_ALIGN_DECL(CROWN_CACHE_LINE_SIZE, std::atomic<s64> _bottom);
+	std::atomic<Job *> _jobs[JOB_DEQUE_SIZE];
+
+	JobDeque()
+		: _top(0)
+		, _bottom(0)
+	{
+	}
+
+	/// Owner only.
+	bool push(Job *job)
+	{
+		const s64 b = _bottom.load(std::memory_order_relaxed);
+		const s64 t = _top.load(std::memory_order_acquire);
+
+		if (CE_UNLIKELY(b - t >= JOB_DEQUE_SIZE))
+			return false;
+
+		_jobs[b & (JOB_DEQUE_SIZE - 1)].store(job, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		_bottom.store(b + 1, std::memory_order_relaxed);
+		return true;
+	}
+
+	/// Owner only.
+	Job *pop()
+	{
+		const s64 b = _bottom.load(std::memory_order_relaxed) - 1;
+		_bottom.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		s64 t = _top.load(std::memory_order_relaxed);
+
+		if (t > b) {
+			// Empty.
+			_bottom.store(b + 1, std::memory_order_relaxed);
+			return NULL;
+		}
+
+		Job *job = _jobs[b & (JOB_DEQUE_SIZE - 1)].load(std::memory_order_relaxed);
+		if (t == b) {
+			// Last job, race against thieves.
+			if (!_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				job = NULL;
+			_bottom.store(b + 1, std::memory_order_relaxed);
+		}
+
+		return job;
+	}
+
+	/// Any thread.
+	Job *steal()
+	{
+		s64 t = _top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		const s64 b = _bottom.load(std::memory_order_acquire);
+
+		if (t >= b)
+			return NULL;
+
+		Job *job = _jobs[t & (JOB_DEQUE_SIZE - 1)].load(std::memory_order_relaxed);
+		if (!_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			return NULL;
+
+		return job;
+	}
+};
+
+struct JobSystem
+{
+	u32 _num_threads;
+	JobDeque *_deques;
+	Thread *_threads;
+	Semaphore _semaphore;
+	std::atomic_int _quit;
+
+	Mutex _deferred_mutex;
+	Array<Job *> _deferred; ///< Jobs whose dependency was not satisfied when popped.
+	std::atomic_int _num_deferred;
+
+	Semaphore _wait_semaphore;     ///< Posted when a counter reaches zero.
+	std::atomic_int _num_waiting; ///< Threads blocked in job_system::wait().
+
+	explicit JobSystem(Allocator &a)
+		: _num_threads(0)
+		, _deques(NULL)
+		, _threads(NULL)
+		, _quit(0)
+		, _deferred(a)
+		, _num_deferred(0)
+		, _num_waiting(0)
+	{
+	}
+};
+
+static JobSystem *_job_system = NULL;
+static CE_THREAD_LOCAL u32 _thread_index = UINT32_MAX;
+
+/// Executes @a job and signals its counter.
+static void job_system_execute(JobSystem &js, Job *job)
+{
+	// Only the main thread's events are flushed every frame and nest in its
+	// scopes: jobs run by workers are not profiled.
+	if (_thread_index == 0) {
+		ENTER_PROFILE_SCOPE(job->name != NULL ? job->name : "job");
+		job->function(job->user_data);
+		LEAVE_PROFILE_SCOPE();
+	} else {
+		job->function(job->user_data);
+	}
+
+	if (job->counter->value.fetch_sub(1, std::memory_order_seq_cst) == 1) {
+		// Deferred jobs might be waiting for this counter.
+		if (js._num_deferred.load(std::memory_order_acquire) > 0)
+			js._semaphore.post(js._num_threads - 1);
+
+		// So might threads blocked in wait().
+		const int num_waiting = js._num_waiting.load(std::memory_order_seq_cst);
+		if (num_waiting > 0)
+			js._wait_semaphore.post((u32)num_waiting);
+	}
+}
+
+/// Returns true if @a job can be executed right now, otherwise defers it.
+static bool job_system_ready(JobSystem &js, Job *job)
+{
+	if (job->dependency == NULL || job->dependency->value.load(std::memory_order_acquire) == 0)
+		return true;
+
+	ScopedMutex sm(js._deferred_mutex);
+	array::push_back(js._deferred, job);
+	js._num_deferred.fetch_add(1, std::memory_order_release);
+	return false;
+}
+
+/// Returns the next job to be executed by the thread @a ti or NULL.
+static Job *job_system_next(JobSystem &js, u32 ti)
+{
+	Job *job;
+
+	while ((job = js._deques[ti].pop()) != NULL) {
+		if (job_system_ready(js, job))
+			return job;
+	}
+
+	for (u32 i = 1; i < js._num_threads; ++i) {
+		const u32 victim = (ti + i) % js._num_threads;
+		while ((job = js._deques[victim].steal()) != NULL) {
+			if (job_system_ready(js, job))
+				return job;
+		}
+	}
+
+	if (js._num_deferred.load(std::memory_order_acquire) > 0) {
+		ScopedMutex sm(js._deferred_mutex);
+		for (u32 i = 0; i < array::size(js._deferred); ++i) {
+			job = js._deferred[i];
+			if (job->dependency->value.load(std::memory_order_acquire) == 0) {
+				js._deferred[i] = array::back(js._deferred);
+				array::pop_back(js._deferred);
+				js._num_deferred.fetch_sub(1, std::memory_order_release);
+				return job;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+static s32 job_system_worker(void *user_data)
+{
+	JobSystem &js = *_job_system;
+	_thread_index = (u32)(uintptr_t)user_data;
+
+	while (js._quit.load(std::memory_order_acquire) == 0) {
+		Job *job = job_system_next(js, _thread_index);
+		if (job != NULL)
+			job_system_execute(js, job);
+		else
+			js._semaphore.wait();
+	}
+
+	return 0;
+}
+
+struct ParallelForRange
+{
+	ParallelForFunction function;
+	void *user_data;
+	u32 begin;
+	u32 end;
+};
+
+static void parallel_for_job(void *user_data)
+{
+	ParallelForRange *range = (ParallelForRange *)user_data;
+	range->function(range->begin, range->end, range->user_data);
+}
+
+namespace job_system
+{
+	u32 num_threads()
+	{
+		return _job_system != NULL ? _job_system->_num_threads : 1;
+	}
+
+	void run(Job *jobs, u32 num, JobCounter &counter, const JobCounter *dependency)
+	{
+		CE_ASSERT(_job_system != NULL, "Job system not initialized");
+		CE_ASSERT(_thread_index != UINT32_MAX, "Jobs must be run from the main thread or from other jobs");
+		JobSystem &js = *_job_system;
+
+		counter.value.fetch_add((int)num, std::memory_order_relaxed);
+
+		for (u32 i = 0; i < num; ++i) {
+			jobs[i].counter = &counter;
+			jobs[i].dependency = dependency;
+
+			// Run the job in place if the deque is full.
+			if (!js._deques[_thread_index].push(&jobs[i])) {
+				if (job_system_ready(js, &jobs[i]))
+					job_system_execute(js, &jobs[i]);
+			}
+		}
+
+		if (js._num_threads > 1)
+			js._semaphore.post(min(num, js._num_threads - 1));
+	}
+
+	void wait(const JobCounter &counter)
+	{
+		CE_ASSERT(_thread_index != UINT32_MAX, "Jobs must be waited from the main thread or from other jobs");
+		JobSystem &js = *_job_system;
+
+		while (counter.value.load(std::memory_order_acquire) > 0) {
+			Job *job = job_system_next(js, _thread_index);
+			if (job != NULL) {
+				job_system_execute(js, job);
+				continue;
+			}
+
+			// Nothing to help with: block until some counter reaches zero.
+			// The counter is checked again after registering as a waiter so
+			// that a wakeup posted in between is not missed.
+			js._num_waiting.fetch_add(1, std::memory_order_seq_cst);
+			if (counter.value.load(std::memory_order_seq_cst) > 0)
+				js._wait_semaphore.wait();
+			js._num_waiting.fetch_sub(1, std::memory_order_relaxed);
+		}
+	}
+
+	void parallel_for(u32 num, u32 grain_size, ParallelForFunction function, void *user_data, const char *name)
+	{
+		CE_ENSURE(grain_size > 0);
+
+		if (num <= grain_size || num_threads() == 1) {
+			if (num > 0)
+				function(0, num, user_data);
+			return;
+		}
+
+		const u32 num_jobs = (num + grain_size - 1) / grain_size;
+		TempAllocator4096 ta;
+		Job *jobs = (Job *)ta.allocate(num_jobs*(sizeof(Job) + sizeof(ParallelForRange)), alignof(Job));
+		ParallelForRange *ranges = (ParallelForRange *)&jobs[num_jobs];
+
+		for (u32 i = 0; i < num_jobs; ++i) {
+			ranges[i].function = function;
+			ranges[i].user_data = user_data;
+			ranges[i].begin = i*grain_size;
+			ranges[i].end = min(num, (i + 1)*grain_size);
+
+			jobs[i].function = parallel_for_job;
+			jobs[i].user_data = &ranges[i];
+			jobs[i].name = name;
+		}
+
+		JobCounter counter;
+		run(jobs, num_jobs, counter);
+		wait(counter);
+	}
+
+} // namespace job_system
+
+namespace job_system_globals
+{
+	void init(u32 num_threads)
+	{
+		CE_ASSERT(_job_system == NULL, "Job system already initialized");
+		Allocator &a = default_allocator();
+		num_threads = clamp(num_threads, 1u, (u32)JOB_SYSTEM_MAX_THREADS);
+
+		_job_system = CE_NEW(a, JobSystem)(a);
+		_job_system->_num_threads = num_threads;
+		_job_system->_deques = (JobDeque *)a.allocate(sizeof(JobDeque)*num_threads, alignof(JobDeque));
+		for (u32 i = 0; i < num_threads; ++i)
+			new (&_job_system->_deques[i]) JobDeque();
+
+		// The calling thread is thread 0.
+		_thread_index = 0;
+
+		_job_system->_threads = (Thread *)a.allocate(sizeof(Thread)*num_threads, alignof(Thread));
+		for (u32 i = 1; i < num_threads; ++i) {
+			new (&_job_system->_threads[i]) Thread();
+			_job_system->_threads[i].start(job_system_worker, (void *)(uintptr_t)i);
+		}
+	}
+
+	void shutdown()
+	{
+		CE_ASSERT(_job_system != NULL, "Job system not initialized");
+		Allocator &a = default_allocator();
+		JobSystem &js = *_job_system;
+
+		js._quit.store(1, std::memory_order_release);
+		js._semaphore.post(js._num_threads - 1);
+
+		for (u32 i = 1; i < js._num_threads; ++i) {
+			js._threads[i].stop();
+			js._threads[i].~Thread();
+		}
+		a.deallocate(js._threads);
+
+		for (u32 i = 0; i < js._num_threads; ++i)
+			js._deques[i].~JobDeque();
+		a.deallocate(js._deques);
+
+		CE_DELETE(a, _job_system);
+		_job_system = NULL;
+		_thread_index = UINT32_MAX;
+	}
+
+} // namespace job_system_globals
+
+} // namespace crown
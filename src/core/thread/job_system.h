@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2012-2026 Daniele Bartolini et al.
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include "core/types.h"
+#include <atomic>
+
+namespace crown
+{
+typedef void (*JobFunction)(void *user_data);
+typedef void (*ParallelForFunction)(u32 begin, u32 end, void *user_data);
+
+/// Counts the number of unfinished jobs in a group.
+///
+/// @ingroup Thread
+struct JobCounter
+{
+	std::atomic_int value;
+
+	///
+	JobCounter()
+		: value(0)
+	{
+	}
+};
+
+/// A unit of work to be run by the job system.
+///
+/// @ingroup Thread
+struct Job
+{
+	JobFunction function;
+	void *user_data;
+	const char *name;                ///< Name of the profiler scope, when run by the main thread.
+	JobCounter *counter;             ///< Decremented when the job completes.
+	const JobCounter *dependency;    ///< The job does not start until this counter is zero.
+};
+
+/// Work-stealing job scheduler.
+///
+/// Each thread owns a deque of jobs: it pushes and pops jobs at one end,
+/// while idle threads steal from the other end. Jobs can only be run and
+/// waited for by the thread that initialized the job system or by jobs
+/// themselves.
+///
+/// @ingroup Thread
+namespace job_system
+{
+	/// Returns the number of threads running jobs, including the main thread.
+	u32 num_threads();
+
+	/// Runs the @a num @a jobs. The jobs' counter is set to @a counter and
+	/// their dependency to @a dependency, and @a counter is incremented by
+	/// @a num. The @a jobs must stay valid until @a counter reaches zero.
+	void run(Job *jobs, u32 num, JobCounter &counter, const JobCounter *dependency = NULL);
+
+	/// Waits until @a counter reaches zero, running pending jobs in the meantime.
+	void wait(const JobCounter &counter);
+
+	/// Calls @a function for each range of at most @a grain_size indices
+	/// in [0, num) and waits for all the calls to complete.
+	void parallel_for(u32 num, u32 grain_size, ParallelForFunction function, void *user_data, const char *name);
+
+} // namespace job_system
+
+namespace job_system_globals
+{
+	/// Starts the job system with @a num_threads threads, including the calling one.
+	void init(u32 num_threads);
+
+	///
+	void shutdown();
+
+} // namespace job_system_globals
+
+} // namespace crown
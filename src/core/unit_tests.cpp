@@ -42,17 +42,27 @@
 #include "core/option.inl"
 #include "core/os.h"
 #include "core/process.h"
+#include "core/profiler.h"
 #include "core/strings/dynamic_string.inl"
 #include "core/strings/string.inl"
 #include "core/strings/string_id.inl"
 #include "core/strings/string_view.inl"
 #include "core/thread/condition_variable.h"
+#include "core/thread/job_system.h"
 #include "core/thread/mutex.h"
 #include "core/thread/thread.h"
 #include "core/time.h"
 #include "resource/expression_language.h"
 #include "resource/lua_resource.h"
+#include "resource/mesh.h"
+#include "resource/mesh_resource.h"
+#include "world/culling_set.h"
+#include "world/light_clusters.h"
+#include "world/occlusion_buffer.h"
+#include "world/scene_graph.h"
 #include "world/types.h"
+#include "world/unit_manager.h"
+#include "world/unit_map.inl"
 #include <float.h>
 #include <stdlib.h> // EXIT_SUCCESS, EXIT_FAILURE
 #include <stdio.h>  // printf
@@ -571,6 +581,49 @@ static void test_quaternion()
 		ENSURE(fequal(a.z, 0.0f, 0.00001f));
 		ENSURE(fequal(a.w, 1.0f, 0.00001f));
 	}
+	{
+		const Quaternion a = from_axis_angle(VECTOR3_ZAXIS, PI_HALF);
+		const Quaternion b = from_axis_angle(VECTOR3_XAXIS, PI_HALF);
+		const Quaternion c = a * b;
+		ENSURE(fequal(c.x,  0.5f, 0.00001f));
+		ENSURE(fequal(c.y,  0.5f, 0.00001f));
+		ENSURE(fequal(c.z,  0.5f, 0.00001f));
+		ENSURE(fequal(c.w,  0.5f, 0.00001f));
+
+		const Matrix3x3 m = from_quaternion(a) * from_quaternion(b);
+		const Matrix3x3 n = from_quaternion(b * a);
+		ENSURE(fequal(m.x.x, n.x.x, 0.00001f));
+		ENSURE(fequal(m.x.y, n.x.y, 0.00001f));
+		ENSURE(fequal(m.x.z, n.x.z, 0.00001f));
+		ENSURE(fequal(m.y.x, n.y.x, 0.00001f));
+		ENSURE(fequal(m.y.y, n.y.y, 0.00001f));
+		ENSURE(fequal(m.y.z, n.y.z, 0.00001f));
+		ENSURE(fequal(m.z.x, n.z.x, 0.00001f));
+		ENSURE(fequal(m.z.y, n.z.y, 0.00001f));
+		ENSURE(fequal(m.z.z, n.z.z, 0.00001f));
+	}
+	{
+		Quaternion a = { 1.0f, 2.0f, 3.0f, 4.0f };
+		normalize(a);
+		ENSURE(fequal(length(a), 1.0f, 0.00001f));
+		ENSURE(fequal(a.x, 0.18257f, 0.00001f));
+		ENSURE(fequal(a.w, 0.73029f, 0.00001f));
+	}
+	{
+		const Quaternion a = from_axis_angle(VECTOR3_ZAXIS, 0.0f);
+		const Quaternion b = from_axis_angle(VECTOR3_ZAXIS, PI_HALF);
+		const Quaternion c = lerp(a, b, 0.5f);
+		const Quaternion d = from_axis_angle(VECTOR3_ZAXIS, PI_HALF*0.5f);
+		ENSURE(fequal(c.x, d.x, 0.00001f));
+		ENSURE(fequal(c.y, d.y, 0.00001f));
+		ENSURE(fequal(c.z, d.z, 0.00001f));
+		ENSURE(fequal(c.w, d.w, 0.00001f));
+
+		// Takes the shortest path.
+		const Quaternion e = lerp(a, -b, 0.5f);
+		ENSURE(fequal(e.z, d.z, 0.00001f));
+		ENSURE(fequal(e.w, d.w, 0.00001f));
+	}
 }
 
 static void test_color4()
@@ -934,6 +987,52 @@ static void test_matrix4x4()
 		q = rotation(m);
 		ENSURE(memcmp(&q, &QUATERNION_IDENTITY, sizeof(q)) == 0);
 	}
+	{
+		const Matrix4x4 a[] = {
+			{
+				1.2f, -2.3f, 5.1f, -1.2f,
+				2.2f, -5.1f,  1.1f, -7.4f,
+				3.2f,  3.3f, -3.8f, -9.2f,
+				-6.8f, -2.9f,  1.0f,  4.9f
+			},
+			MATRIX4X4_IDENTITY
+		};
+		const Matrix4x4 b = {
+			3.2f, 4.8f, 6.0f, 5.3f,
+			-1.6f, -7.1f, -2.4f, -6.2f,
+			-3.1f, -2.2f,  8.9f,  8.3f,
+			3.8f,  9.1f, -3.1f, -7.1f
+		};
+		const Matrix4x4 bs[] = { b, b };
+		Matrix4x4 c[countof(a)];
+		multiply_n(c, a, b, countof(a));
+		ENSURE(fequal(c[0].x.x, -12.85f, 0.0001f));
+		ENSURE(fequal(c[0].y.w, 104.95f, 0.0001f));
+		ENSURE(fequal(c[0].t.z, -40.13f, 0.0001f));
+		ENSURE(memcmp(&c[1], &b, sizeof(b)) == 0);
+
+		Matrix4x4 d[countof(a)];
+		multiply_n(d, a, bs, countof(a));
+		ENSURE(memcmp(c, d, sizeof(c)) == 0);
+	}
+	{
+		const Matrix4x4 m = from_quaternion_translation(from_axis_angle(VECTOR3_ZAXIS, PI_HALF), { 1.0f, 2.0f, 3.0f });
+		Vector3 p[] = {
+			{ 1.0f, 0.0f, 0.0f },
+			{ 0.0f, 1.0f, 0.0f },
+			{ 0.0f, 0.0f, 1.0f }
+		};
+		transform_points_n(p, p, countof(p), m);
+		ENSURE(fequal(p[0].x, 1.0f, 0.00001f));
+		ENSURE(fequal(p[0].y, 3.0f, 0.00001f));
+		ENSURE(fequal(p[0].z, 3.0f, 0.00001f));
+		ENSURE(fequal(p[1].x, 0.0f, 0.00001f));
+		ENSURE(fequal(p[1].y, 2.0f, 0.00001f));
+		ENSURE(fequal(p[1].z, 3.0f, 0.00001f));
+		ENSURE(fequal(p[2].x, 1.0f, 0.00001f));
+		ENSURE(fequal(p[2].y, 2.0f, 0.00001f));
+		ENSURE(fequal(p[2].z, 4.0f, 0.00001f));
+	}
 }
 
 static void test_aabb()
@@ -1086,6 +1185,28 @@ static void test_sphere()
 			ENSURE(sphere::contains_point(a, points[i + 2]));
 		}
 	}
+	{
+		Sphere spheres[7];
+		Matrix4x4 world[7];
+		for (u32 i = 0; i < countof(spheres); ++i) {
+			const f32 f = (f32)i;
+			spheres[i].c = { f - 3.0f, 0.5f*f, 2.0f - f };
+			spheres[i].r = 0.25f + 0.5f*f;
+			world[i] = from_quaternion_translation(from_axis_angle(VECTOR3_ZAXIS, 0.7f*f), { 1.5f*f, -f, 3.0f });
+			set_scale(world[i], { 1.0f + 0.1f*f, 2.0f - 0.2f*f, 0.5f + 0.3f*f });
+		}
+
+		const u32 indices[] = { 6, 2, 0, 5, 3, 1, 4 };
+		Sphere out[countof(indices)];
+		sphere::transform(out, spheres, world, indices, countof(indices));
+
+		for (u32 i = 0; i < countof(indices); ++i) {
+			Sphere expected;
+			sphere::transform(expected, spheres[indices[i]], world[indices[i]]);
+			ENSURE(out[i].c == expected.c);
+			ENSURE(out[i].r == expected.r);
+		}
+	}
 }
 
 static void test_obb()
@@ -1912,6 +2033,87 @@ static void test_thread()
 	ENSURE(thread.exit_code() == 0xbadc0d3);
 }
 
+static void test_job_system()
+{
+	memory_globals::init();
+	profiler_globals::init();
+	job_system_globals::init(4);
+	{
+		std::atomic_int sum(0);
+		Job jobs[100];
+		for (u32 i = 0; i < countof(jobs); ++i) {
+			jobs[i].function = [](void *data) { ((std::atomic_int *)data)->fetch_add(1); };
+			jobs[i].user_data = &sum;
+			jobs[i].name = "test";
+		}
+
+		JobCounter counter;
+		job_system::run(jobs, countof(jobs), counter);
+		job_system::wait(counter);
+		ENSURE(counter.value == 0);
+		ENSURE(sum == countof(jobs));
+	}
+	{
+		// Dependent jobs must start after their dependency completes.
+		struct Data
+		{
+			std::atomic_int first;
+			std::atomic_int errors;
+		};
+		Data data;
+		data.first = 0;
+		data.errors = 0;
+
+		Job first[32];
+		Job second[32];
+		for (u32 i = 0; i < countof(first); ++i) {
+			first[i].function = [](void *d) { os::sleep(1); ((Data *)d)->first.fetch_add(1); };
+			first[i].user_data = &data;
+			first[i].name = "first";
+			second[i].function = [](void *d) { if (((Data *)d)->first != 32) ((Data *)d)->errors.fetch_add(1); };
+			second[i].user_data = &data;
+			second[i].name = "second";
+		}
+
+		JobCounter first_counter;
+		JobCounter second_counter;
+		job_system::run(first, countof(first), first_counter);
+		job_system::run(second, countof(second), second_counter, &first_counter);
+		job_system::wait(second_counter);
+		ENSURE(first_counter.value == 0);
+		ENSURE(data.errors == 0);
+	}
+	{
+		const u32 num = 10000;
+		u32 *values = (u32 *)default_allocator().allocate(num*sizeof(u32));
+		memset(values, 0, num*sizeof(u32));
+
+		job_system::parallel_for(num, 64, [](u32 begin, u32 end, void *data) {
+				for (u32 i = begin; i < end; ++i)
+					((u32 *)data)[i] += i;
+			}, values, "test");
+
+		for (u32 i = 0; i < num; ++i)
+			ENSURE(values[i] == i);
+		default_allocator().deallocate(values);
+	}
+	{
+		// Jobs can spawn and wait for other jobs.
+		std::atomic_int sum(0);
+		job_system::parallel_for(16, 1, [](u32 begin, u32 end, void *data) {
+				for (u32 i = begin; i < end; ++i) {
+					job_system::parallel_for(100, 10, [](u32 b, u32 e, void *d) {
+							((std::atomic_int *)d)->fetch_add(e - b);
+						}, data, "inner");
+				}
+			}, &sum, "outer");
+		ENSURE(sum == 1600);
+	}
+	job_system_globals::shutdown();
+	profiler_globals::shutdown();
+	memory_globals::shutdown();
+}
+
 static void test_process()
 {
 #if !CROWN_PLATFORM_EMSCRIPTEN && !CROWN_PLATFORM_WINDOWS
@@ -2366,6 +2568,369 @@ static void test_lua_resource()
 #endif // if CROWN_CAN_COMPILE
 }
 
+#if CROWN_CAN_COMPILE
+// Appends the two triangles of the grid cell whose corners @a v are at (x, y),
+// (x + 1, y), (x, y + 1) and (x + 1, y + 1).
+static void push_quad(Array<u32> &indices, const u32 v[4])
+{
+	array::push_back(indices, v[0]);
+	array::push_back(indices, v[1]);
+	array::push_back(indices, v[3]);
+	array::push_back(indices, v[0]);
+	array::push_back(indices, v[3]);
+	array::push_back(indices, v[2]);
+}
+#endif // if CROWN_CAN_COMPILE
+
+static void test_mesh_simplify()
+{
+#if CROWN_CAN_COMPILE
+	memory_globals::init();
+	{
+		// Flat 8x8 grid with a UV seam along x = 4: the right half uses its
+		// own copies of the seam vertices.
+		const u32 N = 9;
+		Array<Vector3> positions(default_allocator());
+		Array<u32> indices(default_allocator());
+
+		for (u32 y = 0; y < N; ++y) {
+			for (u32 x = 0; x < N; ++x)
+				array::push_back(positions, { f32(x), f32(y), 0.0f });
+		}
+		for (u32 y = 0; y < N; ++y)
+			array::push_back(positions, { 4.0f, f32(y), 0.0f });
+
+		for (u32 y = 0; y < N - 1; ++y) {
+			for (u32 x = 0; x < N - 1; ++x) {
+				u32 v[4] = { y*N + x, y*N + x + 1, (y + 1)*N + x, (y + 1)*N + x + 1 };
+				if (x == 4) {
+					v[0] = N*N + y;
+					v[2] = N*N + y + 1;
+				}
+
+				push_quad(indices, v);
+			}
+		}
+
+		Array<u32> out(default_allocator());
+		f32 error;
+		mesh::simplify(out
+			, error
+			, array::begin(indices)
+			, array::size(indices)
+			, (const f32 *)array::begin(positions)
+			, sizeof(Vector3)
+			, array::size(positions)
+			, 3
+			, FLT_MAX
+			);
+
+		ENSURE(array::size(out) % 3 == 0);
+		ENSURE(array::size(out) < array::size(indices));
+		ENSURE(fequal(error, 0.0f, 0.0001f));
+
+		// Border and seam vertices must survive and no triangle may flip.
+		for (u32 i = 0; i < array::size(positions); ++i) {
+			const Vector3 &p = positions[i];
+			const bool locked = p.x == 0.0f || p.y == 0.0f || p.x == N - 1 || p.y == N - 1 || p.x == 4.0f;
+			if (!locked)
+				continue;
+
+			bool found = false;
+			for (u32 j = 0; j < array::size(out); ++j)
+				found = found || out[j] == i;
+			ENSURE(found);
+		}
+
+		for (u32 i = 0; i < array::size(out); i += 3) {
+			const Vector3 n = cross(positions[out[i + 1]] - positions[out[i]], positions[out[i + 2]] - positions[out[i]]);
+			ENSURE(n.z > 0.0f);
+		}
+	}
+	{
+		// Simplification stops when the error would exceed max_error.
+		const u32 indices[] = { 0, 1, 2, 0, 2, 3, 0, 3, 4, 0, 4, 1 };
+		const Vector3 positions[] =
+		{
+			{ 0.0f, 0.0f, 1.0f },
+			{ 1.0f, 0.0f, 0.0f },
+			{ 0.0f, 1.0f, 0.0f },
+			{-1.0f, 0.0f, 0.0f },
+			{ 0.0f,-1.0f, 0.0f },
+		};
+
+		Array<u32> out(default_allocator());
+		f32 error;
+		mesh::simplify(out, error, indices, countof(indices), (const f32 *)positions, sizeof(Vector3), countof(positions), 3, 0.5f);
+		ENSURE(array::size(out) == countof(indices));
+		ENSURE(error == 0.0f);
+
+		mesh::simplify(out, error, indices, countof(indices), (const f32 *)positions, sizeof(Vector3), countof(positions), 3, FLT_MAX);
+		ENSURE(array::size(out) == 6);
+		ENSURE(error > 0.5f);
+	}
+	memory_globals::shutdown();
+#endif // if CROWN_CAN_COMPILE
+}
+
+static void test_mesh_optimize()
+{
+#if CROWN_CAN_COMPILE
+	memory_globals::init();
+	{
+		// 32x32 grid whose triangles are listed in a scrambled order.
+		const u32 N = 33;
+		Array<Vector3> positions(default_allocator());
+		Array<u32> indices(default_allocator());
+
+		for (u32 y = 0; y < N; ++y) {
+			for (u32 x = 0; x < N; ++x)
+				array::push_back(positions, { f32(x), f32(y), 0.0f });
+		}
+
+		const u32 num_quads = (N - 1)*(N - 1);
+		for (u32 i = 0; i < num_quads; ++i) {
+			const u32 q = (i*97) % num_quads;
+			const u32 x = q % (N - 1);
+			const u32 y = q / (N - 1);
+			const u32 v[4] = { y*N + x, y*N + x + 1, (y + 1)*N + x, (y + 1)*N + x + 1 };
+			push_quad(indices, v);
+		}
+
+		const u32 num_indices = array::size(indices);
+		const u32 num_vertices = array::size(positions);
+		const f32 acmr_before = mesh::acmr(array::begin(indices), num_indices, num_vertices, 16);
+
+		Array<u32> clusters(default_allocator());
+		Array<u32> tmp(default_allocator());
+		Array<u32> out(default_allocator());
+		array::resize(tmp, num_indices);
+		array::resize(out, num_indices);
+		mesh::optimize_vertex_cache(array::begin(tmp), clusters, array::begin(indices), num_indices, num_vertices, 16);
+		ENSURE(array::size(clusters) >= 1);
+		ENSURE(clusters[0] == 0);
+
+		const f32 acmr_cache = mesh::acmr(array::begin(tmp), num_indices, num_vertices, 16);
+		ENSURE(acmr_cache < acmr_before);
+		ENSURE(acmr_cache < 1.0f);
+
+		mesh::optimize_overdraw(array::begin(out)
+			, array::begin(tmp)
+			, num_indices
+			, clusters
+			, (const f32 *)array::begin(positions)
+			, sizeof(Vector3)
+			, num_vertices
+			, 16
+			, 1.05f
+			);
+		ENSURE(mesh::acmr(array::begin(out), num_indices, num_vertices, 16) < acmr_before);
+
+		// Every triangle is still there, with the same winding.
+		HashSet<u64> triangles(default_allocator());
+		for (u32 i = 0; i < num_indices; i += 3)
+			hash_set::insert(triangles, u64(indices[i])*N*N*N*N + u64(indices[i + 1])*N*N + indices[i + 2]);
+
+		for (u32 i = 0; i < num_indices; i += 3) {
+			const u32 *t = &out[i];
+			bool found = false;
+			for (u32 r = 0; !found && r < 3; ++r) {
+				const u64 key = u64(t[r])*N*N*N*N + u64(t[(r + 1) % 3])*N*N + t[(r + 2) % 3];
+				if (hash_set::has(triangles, key)) {
+					hash_set::remove(triangles, key);
+					found = true;
+				}
+			}
+			ENSURE(found);
+		}
+		ENSURE(hash_set::size(triangles) == 0);
+
+		Array<u32> remapped(default_allocator());
+		Array<Vector3> vertices(default_allocator());
+		remapped = out;
+		array::resize(vertices, num_vertices);
+		const u32 num = mesh::optimize_vertex_fetch(array::begin(vertices)
+			, array::begin(remapped)
+			, num_indices
+			, array::begin(positions)
+			, num_vertices
+			, sizeof(Vector3)
+			);
+		ENSURE(num == num_vertices);
+		ENSURE(remapped[0] == 0);
+		for (u32 i = 0; i < num_indices; ++i)
+			ENSURE(vertices[remapped[i]] == positions[out[i]]);
+	}
+	memory_globals::shutdown();
+#endif // if CROWN_CAN_COMPILE
+}
+
+#if CROWN_CAN_COMPILE
+// Builds a bumpy sphere with @a rings * @a segments * 2 triangles.
+static void bumpy_sphere(Array<Vector3> &positions, Array<u32> &indices, u32 rings, u32 segments)
+{
+	for (u32 r = 0; r <= rings; ++r) {
+		const f32 theta = PI * f32(r) / f32(rings);
+		for (u32 s = 0; s <= segments; ++s) {
+			const f32 phi = 2.0f * PI * f32(s) / f32(segments);
+			const f32 radius = 1.0f + 0.05f*fsin(7.0f*theta)*fsin(11.0f*phi);
+			array::push_back(positions, { radius*fsin(theta)*fcos(phi), radius*fcos(theta), radius*fsin(theta)*fsin(phi) });
+		}
+	}
+
+	for (u32 r = 0; r < rings; ++r) {
+		for (u32 s = 0; s < segments; ++s) {
+			const u32 v[4] = { r*(segments + 1) + s, r*(segments + 1) + s + 1, (r + 1)*(segments + 1) + s, (r + 1)*(segments + 1) + s + 1 };
+			push_quad(indices, v);
+		}
+	}
+}
+
+// Builds the BVH of (@a positions, @a indices) into @a nodes and @a triangles and fills @a mg.
+static void bvh_geometry(MeshGeometry &mg, Array<MeshBvhNode> &nodes, Array<u32> &triangles, Array<Vector3> &positions, Array<u32> &indices)
+{
+	Vector3 offset;
+	Vector3 scale;
+	mesh::build_bvh(nodes
+		, triangles
+		, offset
+		, scale
+		, array::begin(indices)
+		, array::size(indices)
+		, (const f32 *)array::begin(positions)
+		, sizeof(Vector3)
+		, 0.0f
+		);
+
+	memset((void *)&mg, 0, sizeof(mg));
+	mg.positions = { array::size(positions), sizeof(Vector3), (char *)array::begin(positions) };
+	mg.indices = { array::size(indices), sizeof(u32), (char *)array::begin(indices) };
+	mg.bvh = { array::size(nodes), offset, scale, array::begin(nodes), array::begin(triangles) };
+}
+
+// Generates @a num rays from outside the unit sphere, aimed near its centre or anywhere.
+static void bvh_rays(Vector3 *from, Vector3 *dir, u32 num, Random &rnd)
+{
+	for (u32 i = 0; i < num; ++i) {
+		Vector3 p = { rnd.unit_float() - 0.5f, rnd.unit_float() - 0.5f, rnd.unit_float() - 0.5f };
+		normalize(p);
+		const Vector3 target = { rnd.unit_float() - 0.5f, rnd.unit_float() - 0.5f, rnd.unit_float() - 0.5f };
+		from[i] = p * 3.0f;
+		dir[i] = i % 4 == 1 ? p : target - from[i];
+	}
+}
+#endif // if CROWN_CAN_COMPILE
+
+static void test_mesh_bvh()
+{
+#if CROWN_CAN_COMPILE
+	memory_globals::init();
+	{
+		// Bumpy sphere with 576 triangles.
+		Array<Vector3> positions(default_allocator());
+		Array<u32> indices(default_allocator());
+		bumpy_sphere(positions, indices, 12, 24);
+
+		Array<MeshBvhNode> nodes(default_allocator());
+		Array<u32> triangles(default_allocator());
+		MeshGeometry mg;
+		bvh_geometry(mg, nodes, triangles, positions, indices);
+		ENSURE(array::size(triangles) == array::size(indices) / 3);
+
+		const u32 num_rays = 256;
+		Vector3 from[num_rays];
+		Vector3 dir[num_rays];
+		Random rnd(42);
+		bvh_rays(from, dir, num_rays, rnd);
+
+		// Same hits as the brute-force test.
+		u32 num_hits = 0;
+		for (u32 i = 0; i < num_rays; ++i) {
+			const f32 expected = ray_mesh_intersection(from[i]
+				, dir[i]
+				, MATRIX4X4_IDENTITY
+				, array::begin(positions)
+				, sizeof(Vector3)
+				, array::begin(indices)
+				, array::size(indices)
+				);
+			const f32 t = mesh_geometry::cast_ray(mg, MATRIX4X4_IDENTITY, from[i], dir[i]);
+			ENSURE(t == expected);
+			num_hits += t >= 0.0f ? 1 : 0;
+		}
+		ENSURE(num_hits > num_rays / 2 && num_hits < num_rays);
+
+		// Rays are cast in object space.
+		Matrix4x4 tm = from_quaternion_translation(from_axis_angle(VECTOR3_YAXIS, 0.7f), { 10.0f, 2.0f, -3.0f });
+		set_scale(tm, { 2.0f, 2.0f, 2.0f });
+		for (u32 i = 0; i < num_rays; i += 4) {
+			const Vector3 world_from = from[i] * tm;
+			const Vector3 world_dir = (from[i] + dir[i]) * tm - world_from;
+			const f32 expected = ray_mesh_intersection(world_from
+				, world_dir
+				, tm
+				, array::begin(positions)
+				, sizeof(Vector3)
+				, array::begin(indices)
+				, array::size(indices)
+				);
+			const f32 t = mesh_geometry::cast_ray(mg, tm, world_from, world_dir);
+			ENSURE(fequal(t, expected, 0.001f));
+		}
+	}
+	memory_globals::shutdown();
+#endif // if CROWN_CAN_COMPILE
+}
+
+static void bench_mesh_bvh()
+{
+#if CROWN_CAN_COMPILE
+	memory_globals::init();
+	{
+		// Bumpy sphere with about 500k triangles.
+		Array<Vector3> positions(default_allocator());
+		Array<u32> indices(default_allocator());
+		bumpy_sphere(positions, indices, 354, 707);
+
+		Array<MeshBvhNode> nodes(default_allocator());
+		Array<u32> triangles(default_allocator());
+		MeshGeometry mg;
+		bvh_geometry(mg, nodes, triangles, positions, indices);
+
+		const u32 num_rays = 16;
+		Vector3 from[num_rays];
+		Vector3 dir[num_rays];
+		Random rnd(42);
+		bvh_rays(from, dir, num_rays, rnd);
+
+		const s64 t0 = time::now();
+		f32 linear[num_rays];
+		for (u32 i = 0; i < num_rays; ++i) {
+			linear[i] = ray_mesh_intersection(from[i]
+				, dir[i]
+				, MATRIX4X4_IDENTITY
+				, array::begin(positions)
+				, sizeof(Vector3)
+				, array::begin(indices)
+				, array::size(indices)
+				);
+		}
+		const s64 t1 = time::now();
+		for (u32 i = 0; i < num_rays; ++i)
+			ENSURE(mesh_geometry::cast_ray(mg, MATRIX4X4_IDENTITY, from[i], dir[i]) == linear[i]);
+		const s64 t2 = time::now();
+
+		printf("  %u rays on %u triangles: linear %.2f ms, BVH %.3f ms\n"
+			, num_rays
+			, array::size(indices) / 3
+			, time::seconds(t1 - t0)*1000.0
+			, time::seconds(t2 - t1)*1000.0
+			);
+	}
+	memory_globals::shutdown();
+#endif // if CROWN_CAN_COMPILE
+}
+
 static void test_time()
 {
 	if (CROWN_PLATFORM_EMSCRIPTEN)
@@ -2444,6 +3009,118 @@ static void test_unit_id()
 	}
 }
 
+static void test_unit_map()
+{
+	memory_globals::init();
+	Allocator &a = default_allocator();
+	{
+		UnitMap<u32> m(a);
+
+		ENSURE(unit_map::size(m) == 0);
+		ENSURE(unit_map::get(m, make_unit(0, 0), 42u) == 42u);
+		ENSURE(!unit_map::has(m, make_unit(10, 0)));
+
+		for (u32 i = 0; i < 5000; ++i)
+			unit_map::set(m, make_unit(i*3, 1), i*i);
+		ENSURE(unit_map::size(m) == 5000);
+		for (u32 i = 0; i < 5000; ++i)
+			ENSURE(unit_map::get(m, make_unit(i*3, 1), 0u) == i*i);
+
+		// Units with the same index but a different generation are not in the map.
+		ENSURE(!unit_map::has(m, make_unit(3, 0)));
+		ENSURE(unit_map::get(m, make_unit(3, 2), 42u) == 42u);
+		unit_map::remove(m, make_unit(3, 2));
+		ENSURE(unit_map::has(m, make_unit(3, 1)));
+
+		unit_map::set(m, make_unit(3, 1), 7u);
+		ENSURE(unit_map::size(m) == 5000);
+		ENSURE(unit_map::get(m, make_unit(3, 1), 0u) == 7u);
+
+		unit_map::remove(m, make_unit(3, 1));
+		ENSURE(!unit_map::has(m, make_unit(3, 1)));
+		ENSURE(unit_map::size(m) == 4999);
+
+		unit_map::remove(m, make_unit(UNIT_INDEX_MASK, 0));
+		ENSURE(unit_map::size(m) == 4999);
+
+		unit_map::clear(m);
+		ENSURE(unit_map::size(m) == 0);
+		for (u32 i = 0; i < 5000; ++i)
+			ENSURE(!unit_map::has(m, make_unit(i*3, 1)));
+	}
+	{
+		// UnitMap agrees with HashMap on units from a UnitManager.
+		UnitManager um(a);
+		UnitMap<u32> um_map(a);
+		HashMap<UnitId, u32> hm_map(a);
+		Array<UnitId> units(a);
+		Random rnd(7);
+
+		const u32 num_units = 1000;
+
+		for (u32 i = 0; i < num_units; ++i) {
+			const UnitId u = um.create();
+			array::push_back(units, u);
+			unit_map::set(um_map, u, i);
+			hash_map::set(hm_map, u, i);
+		}
+
+		for (u32 i = 0; i < 4*num_units; ++i) {
+			const UnitId u = units[rnd.integer(num_units)];
+			ENSURE(unit_map::get(um_map, u, UINT32_MAX) == hash_map::get(hm_map, u, UINT32_MAX));
+		}
+	}
+	memory_globals::shutdown();
+}
+
+static void bench_unit_map()
+{
+	memory_globals::init();
+	Allocator &a = default_allocator();
+	{
+		// Compare lookup times with HashMap.
+		UnitManager um(a);
+		UnitMap<u32> um_map(a);
+		HashMap<UnitId, u32> hm_map(a);
+		Array<UnitId> units(a);
+		Random rnd(7);
+
+		const u32 num_units = 100000;
+		const u32 num_lookups = 2000000;
+
+		for (u32 i = 0; i < num_units; ++i) {
+			const UnitId u = um.create();
+			array::push_back(units, u);
+			unit_map::set(um_map, u, i);
+			hash_map::set(hm_map, u, i);
+		}
+
+		Array<UnitId> keys(a);
+		array::resize(keys, num_lookups);
+		for (u32 i = 0; i < num_lookups; ++i)
+			keys[i] = units[rnd.integer(num_units)];
+
+		u64 sum_hm = 0;
+		const s64 t0 = time::now();
+		for (u32 i = 0; i < num_lookups; ++i)
+			sum_hm += hash_map::get(hm_map, keys[i], UINT32_MAX);
+		const s64 t1 = time::now();
+
+		u64 sum_um = 0;
+		for (u32 i = 0; i < num_lookups; ++i)
+			sum_um += unit_map::get(um_map, keys[i], UINT32_MAX);
+		const s64 t2 = time::now();
+
+		ENSURE(sum_hm == sum_um);
+		printf("  %u lookups: HashMap %.2f ms, UnitMap %.2f ms\n"
+			, num_lookups
+			, time::seconds(t1 - t0)*1000.0
+			, time::seconds(t2 - t1)*1000.0
+			);
+	}
+	memory_globals::shutdown();
+}
+
 static void test_random()
 {
 	{
@@ -2490,6 +3167,579 @@ static void test_frustum()
 	ENSURE(fequal(splits[3].planes[5].d, -100.0f, 0.0001f));
 }
 
+// Returns a 90 degrees perspective projection looking down -z.
+static Matrix4x4 culling_view_proj()
+{
+	const f32 n = 0.1f;
+	const f32 f = 1000.0f;
+	Matrix4x4 view_proj = MATRIX4X4_IDENTITY;
+	view_proj.z.z = (f + n) / (n - f);
+	view_proj.z.w = -1.0f;
+	view_proj.t.z = 2.0f*f*n / (n - f);
+	view_proj.t.w = 0.0f;
+	return view_proj;
+}
+
+// Fills @a spheres and @a obbs with @a num random objects and @a indices with a permutation of them.
+static void culling_objects(Array<Sphere> &spheres, Array<OBB> &obbs, Array<u32> &indices, u32 num, Random &rnd)
+{
+	for (u32 i = 0; i < num; ++i) {
+		const Vector3 p = { rnd.unit_float()*1000.0f - 500.0f, rnd.unit_float()*1000.0f - 500.0f, rnd.unit_float()*1000.0f - 500.0f };
+		Vector3 axis = { rnd.unit_float() - 0.5f, rnd.unit_float() - 0.5f, rnd.unit_float() + 0.1f };
+		normalize(axis);
+
+		const Sphere s = { p, rnd.unit_float()*20.0f };
+		OBB o;
+		o.tm = from_quaternion_translation(from_axis_angle(axis, rnd.unit_float()*PI_TWO), p);
+		o.half_extents = { rnd.unit_float()*10.0f, rnd.unit_float()*10.0f, rnd.unit_float()*10.0f };
+		array::push_back(spheres, s);
+		array::push_back(obbs, o);
+		array::push_back(indices, (i*7919) % num);
+	}
+}
+
+static void test_culling()
+{
+	memory_globals::init();
+	Allocator &a = default_allocator();
+	{
+		Random rnd(11);
+		const u32 num = 1003;
+		const Matrix4x4 view_proj = culling_view_proj();
+
+		Frustum frustum;
+		frustum::from_matrix(frustum, view_proj, true);
+
+		Array<Sphere> spheres(a);
+		Array<OBB> obbs(a);
+		Array<u32> indices(a);
+		culling_objects(spheres, obbs, indices, num, rnd);
+
+		Array<u32> visible(a);
+		array::resize(visible, (num + 31) / 32);
+		const Plane3 *planes = frustum.planes;
+		const u32 num_planes = countof(frustum.planes);
+
+		// Compare with the scalar tests, bit for bit.
+		spheres_intersect_planes(array::begin(visible), array::begin(spheres), array::begin(indices), num, planes, num_planes);
+		u32 num_visible = 0;
+		for (u32 i = 0; i < num; ++i) {
+			const Sphere &s = spheres[indices[i]];
+			bool inside = true;
+			for (u32 j = 0; j < num_planes; ++j)
+				inside &= dot(planes[j].n, s.c) + s.r >= planes[j].d;
+			ENSURE(inside == ((visible[i / 32] & (1u << (i % 32))) != 0));
+			num_visible += u32(inside);
+		}
+		ENSURE(num_visible > 0 && num_visible < num);
+
+		obbs_intersect_planes(array::begin(visible), array::begin(obbs), array::begin(indices), num, planes, num_planes);
+		for (u32 i = 0; i < num; ++i) {
+			const OBB &o = obbs[indices[i]];
+			const Vector3 center = translation(o.tm);
+			const Vector3 axis_x = x(o.tm) * o.half_extents.x;
+			const Vector3 axis_y = y(o.tm) * o.half_extents.y;
+			const Vector3 axis_z = z(o.tm) * o.half_extents.z;
+			bool inside = true;
+			for (u32 j = 0; j < num_planes; ++j) {
+				const f32 radius = fabs(dot(planes[j].n, axis_x))
+					+ fabs(dot(planes[j].n, axis_y))
+					+ fabs(dot(planes[j].n, axis_z))
+					;
+				inside &= dot(planes[j].n, center) + radius >= planes[j].d;
+			}
+			ENSURE(inside == ((visible[i / 32] & (1u << (i % 32))) != 0));
+		}
+
+		obbs_intersect_clip_space(array::begin(visible), array::begin(obbs), array::begin(indices), num, view_proj);
+		for (u32 i = 0; i < num; ++i) {
+			Vector3 vertices[8];
+			obb::to_vertices(vertices, obbs[indices[i]]);
+			u32 outside = 0x3f;
+			for (u32 j = 0; j < countof(vertices); ++j) {
+				const Vector4 v = { vertices[j].x, vertices[j].y, vertices[j].z, 1.0f };
+				const Vector4 clip = v * view_proj;
+				outside &= u32(clip.x < -clip.w) << 0
+					| u32(clip.x > clip.w) << 1
+					| u32(clip.y < -clip.w) << 2
+					| u32(clip.y > clip.w) << 3
+					| u32(clip.z < -clip.w) << 4
+					| u32(clip.z > clip.w) << 5
+					;
+			}
+			ENSURE((outside == 0) == ((visible[i / 32] & (1u << (i % 32))) != 0));
+		}
+	}
+	memory_globals::shutdown();
+}
+
+static void bench_culling()
+{
+	memory_globals::init();
+	Allocator &a = default_allocator();
+	{
+		Random rnd(11);
+		const u32 num = 100003;
+		const Matrix4x4 view_proj = culling_view_proj();
+
+		Frustum frustum;
+		frustum::from_matrix(frustum, view_proj, true);
+
+		Array<Sphere> spheres(a);
+		Array<OBB> obbs(a);
+		Array<u32> indices(a);
+		culling_objects(spheres, obbs, indices, num, rnd);
+
+		Array<u32> visible(a);
+		array::resize(visible, (num + 31) / 32);
+		const Plane3 *planes = frustum.planes;
+		const u32 num_planes = countof(frustum.planes);
+
+		const u32 num_iterations = 20;
+		const s64 t0 = time::now();
+		for (u32 i = 0; i < num_iterations; ++i)
+			spheres_intersect_planes(array::begin(visible), array::begin(spheres), array::begin(indices), num, planes, num_planes);
+		const s64 t1 = time::now();
+		for (u32 i = 0; i < num_iterations; ++i)
+			obbs_intersect_planes(array::begin(visible), array::begin(obbs), array::begin(indices), num, planes, num_planes);
+		const s64 t2 = time::now();
+		for (u32 i = 0; i < num_iterations; ++i)
+			obbs_intersect_clip_space(array::begin(visible), array::begin(obbs), array::begin(indices), num, view_proj);
+		const s64 t3 = time::now();
+
+		const f64 num_objects = f64(num)*num_iterations;
+		printf("  culled objects/us: spheres %.1f, OBBs %.1f, OBBs clip space %.1f\n"
+			, num_objects / (time::seconds(t1 - t0)*1000000.0)
+			, num_objects / (time::seconds(t2 - t1)*1000000.0)
+			, num_objects / (time::seconds(t3 - t2)*1000000.0)
+			);
+	}
+	memory_globals::shutdown();
+}
+
+static void test_culling_set()
+{
+	memory_globals::init();
+	profiler_globals::init();
+	Allocator &a = default_allocator();
+	{
+		Random rnd(23);
+		const u32 num_ids = 509;
+
+		Frustum frustum;
+		frustum.planes[0] = { {  1.0f,  0.0f,  0.0f }, -200.0f };
+		frustum.planes[1] = { { -1.0f,  0.0f,  0.0f }, -150.0f };
+		frustum.planes[2] = { {  0.0f,  1.0f,  0.0f }, -100.0f };
+		frustum.planes[3] = { {  0.0f, -1.0f,  0.0f }, -250.0f };
+		frustum.planes[4] = { {  0.0f,  0.0f,  1.0f }, -300.0f };
+		frustum.planes[5] = { {  0.0f,  0.0f, -1.0f }, -50.0f };
+
+		CullingSet set(a);
+		Array<Sphere> spheres(a);
+		Array<u32> live(a);
+		Array<u32> found(a);
+		array::resize(spheres, num_ids);
+		array::resize(live, num_ids);
+		array::resize(found, num_ids);
+		for (u32 i = 0; i < num_ids; ++i)
+			live[i] = 0;
+
+		for (u32 step = 0; step < 4000; ++step) {
+			const u32 id = rnd.integer(num_ids);
+			const Vector3 p = { rnd.unit_float()*1000.0f - 500.0f, rnd.unit_float()*1000.0f - 500.0f, rnd.unit_float()*1000.0f - 500.0f };
+
+			if (!live[id]) {
+				Cullable c;
+				c.world = MATRIX4X4_IDENTITY;
+				set_translation(c.world, p);
+				c.sphere = { VECTOR3_ZERO, rnd.unit_float()*20.0f };
+				c.obb.tm = MATRIX4X4_IDENTITY;
+				c.obb.half_extents = { c.sphere.r, c.sphere.r, c.sphere.r };
+				c.id = id;
+				c.type = CullableType::MESH;
+				culling_set::add(set, c);
+				spheres[id] = { p, c.sphere.r };
+				live[id] = 1;
+			} else if (rnd.integer(3) == 0) {
+				culling_set::remove(set, CullableType::MESH, id);
+				live[id] = 0;
+			} else {
+				// Move by small amounts most of the time, to exercise both refits and reinsertions.
+				Sphere s = spheres[id];
+				if (rnd.integer(2) == 0)
+					s.c += (p - s.c) * 0.01f;
+				else
+					s.c = p;
+				OBB o;
+				o.tm = MATRIX4X4_IDENTITY;
+				set_translation(o.tm, s.c);
+				o.half_extents = { s.r, s.r, s.r };
+				culling_set::update(set, CullableType::MESH, id, s, o);
+				spheres[id] = s;
+			}
+
+			if (step % 97 != 0)
+				continue;
+
+			u32 num_live = 0;
+			for (u32 i = 0; i < num_ids; ++i) {
+				ENSURE((culling_set::find_object(set, CullableType::MESH, i) != UINT32_MAX) == (live[i] != 0));
+				num_live += live[i];
+			}
+			ENSURE(array::size(set.id) == num_live);
+
+			// Compare the frustum query with brute force.
+			const u32 num_inside = culling_set::query(set, frustum.planes, countof(frustum.planes));
+			for (u32 i = 0; i < num_ids; ++i)
+				found[i] = 0;
+			for (u32 i = 0; i < num_inside; ++i) {
+				const u32 obj = set.id[set.render[i]];
+				ENSURE(found[obj] == 0);
+				found[obj] = 1;
+			}
+			for (u32 i = 0; i < num_ids; ++i) {
+				bool inside = live[i] != 0;
+				for (u32 j = 0; j < countof(frustum.planes) && inside; ++j)
+					inside = dot(frustum.planes[j].n, spheres[i].c) + spheres[i].r >= frustum.planes[j].d;
+				ENSURE(inside == (found[i] != 0));
+			}
+
+			// Compare the sphere query with brute force.
+			const Sphere volume = { p, 50.0f + rnd.unit_float()*250.0f };
+			const u32 num_touching = culling_set::query(set, volume);
+			for (u32 i = 0; i < num_ids; ++i)
+				found[i] = 0;
+			for (u32 i = 0; i < num_touching; ++i) {
+				const u32 obj = set.id[set.render[i]];
+				ENSURE(found[obj] == 0);
+				found[obj] = 1;
+			}
+			for (u32 i = 0; i < num_ids; ++i) {
+				const f32 r_sum = volume.r + spheres[i].r;
+				const bool touching = live[i] != 0 && length_squared(volume.c - spheres[i].c) <= r_sum*r_sum;
+				ENSURE(touching == (found[i] != 0));
+			}
+		}
+	}
+	profiler_globals::shutdown();
+	memory_globals::shutdown();
+}
+
+static void test_occlusion_buffer()
+{
+	memory_globals::init();
+	{
+		// 90 degrees perspective projection looking down -z.
+		const f32 n = 0.1f;
+		const f32 f = 1000.0f;
+		Matrix4x4 view_proj = MATRIX4X4_IDENTITY;
+		view_proj.z.z = (f + n) / (n - f);
+		view_proj.z.w = -1.0f;
+		view_proj.t.z = 2.0f*f*n / (n - f);
+		view_proj.t.w = 0.0f;
+
+		// 20x20 wall at z = -10, covering [-20, 0] on x.
+		const Vector3 vertices[] =
+		{
+			{ -20.0f, -10.0f, -10.0f },
+			{   0.0f, -10.0f, -10.0f },
+			{   0.0f,  10.0f, -10.0f },
+			{ -20.0f,  10.0f, -10.0f }
+		};
+		const u16 indices[] = { 0, 1, 2, 0, 2, 3 };
+
+		OcclusionBuffer ob(default_allocator());
+		ob.reset(126, 64, view_proj);
+		ENSURE(ob._width == 128);
+
+		OBB box;
+		box.tm = from_translation({ -5.0f, 0.0f, -20.0f });
+		box.half_extents = { 1.0f, 1.0f, 1.0f };
+		ENSURE(ob.visible(box));
+
+		ob.add_triangles(MATRIX4X4_IDENTITY, vertices, sizeof(Vector3), indices, countof(indices));
+		ENSURE(ob._num_triangles == 2);
+
+		// Behind the wall.
+		ENSURE(!ob.visible(box));
+		// In front of the wall.
+		box.tm = from_translation({ -5.0f, 0.0f, -5.0f });
+		ENSURE(ob.visible(box));
+		// Intersecting the wall.
+		box.tm = from_translation({ -5.0f, 0.0f, -10.5f });
+		ENSURE(ob.visible(box));
+		// Behind the wall but sticking out of its right edge.
+		box.tm = from_translation({ 0.5f, 0.0f, -20.0f });
+		ENSURE(ob.visible(box));
+		// Crossing the near plane.
+		box.tm = from_translation({ -5.0f, 0.0f, 0.0f });
+		ENSURE(ob.visible(box));
+
+		// Pixels are occluded only if fully covered: move the right edge of the wall to
+		// x = 64.7 on screen and look past it through the uncovered part of pixel 64.
+		ob.reset(128, 64, view_proj);
+		ob.add_triangles(from_translation({ 0.109375f, 0.0f, 0.0f }), vertices, sizeof(Vector3), indices, countof(indices));
+		box.tm = from_translation({ 1.17f, 0.0f, -100.0f });
+		box.half_extents = { 0.05f, 0.05f, 0.05f };
+		ENSURE(ob.visible(box));
+		box.tm = from_translation({ -5.0f, 0.0f, -100.0f });
+		ENSURE(!ob.visible(box));
+
+		// Triangles crossing the near plane are not rasterized.
+		ob.reset(128, 64, view_proj);
+		const Matrix4x4 tm = from_translation({ 0.0f, 0.0f, 10.0f });
+		ob.add_triangles(tm, vertices, sizeof(Vector3), indices, countof(indices));
+		ENSURE(ob._num_triangles == 0);
+	}
+	memory_globals::shutdown();
+}
+
+static void test_light_clusters()
+{
+	memory_globals::init();
+	profiler_globals::init();
+	job_system_globals::init(4);
+	{
+		Random rnd(17);
+		const u32 num_lights = 300;
+
+		// 90 degrees perspective projection looking down -z, 16:9 aspect ratio.
+		const f32 n = 0.1f;
+		const f32 f = 200.0f;
+		Matrix4x4 proj = MATRIX4X4_IDENTITY;
+		proj.x.x = 9.0f / 16.0f;
+		proj.z.z = (f + n) / (n - f);
+		proj.z.w = -1.0f;
+		proj.t.z = 2.0f*f*n / (n - f);
+		proj.t.w = 0.0f;
+		const Matrix4x4 camera = from_quaternion_translation(from_axis_angle(VECTOR3_YAXIS, 0.5f), { 3.0f, 1.0f, -2.0f });
+		const Matrix4x4 view = get_inverted(camera);
+
+		LightClusters lc(default_allocator());
+		lc.reset(16, 9, 24, view, proj, UINT32_MAX);
+		for (u32 i = 0; i < num_lights; ++i) {
+			const Vector3 p = { rnd.unit_float()*200.0f - 100.0f, rnd.unit_float()*40.0f - 20.0f, rnd.unit_float()*200.0f - 200.0f };
+			const f32 range = 1.0f + rnd.unit_float()*15.0f;
+			if (i % 3 != 0) {
+				lc.add_omni({ p, range });
+			} else {
+				Vector3 dir = { rnd.unit_float() - 0.5f, rnd.unit_float() - 0.5f, rnd.unit_float() - 0.5f };
+				normalize(dir);
+				lc.add_spot({ p, range }, p, dir, range, 0.1f + rnd.unit_float()*1.3f);
+			}
+		}
+		lc.assign();
+		ENSURE(lc.num_clusters() == 16*9*24);
+		ENSURE(array::size(lc._indices) > 0);
+
+		// Compare with brute-force sphere versus froxel tests.
+		for (u32 z = 0; z < lc._num_z; ++z) {
+			for (u32 y = 0; y < lc._num_y; ++y) {
+				for (u32 x = 0; x < lc._num_x; ++x) {
+					const u32 c = x + y*lc._num_x + z*lc._num_x*lc._num_y;
+					const AABB box = lc.froxel(x, y, z);
+					const Vector3 center = (box.min + box.max) * 0.5f;
+					const f32 radius = length(box.max - center);
+					u32 count = 0;
+
+					for (u32 i = 0; i < num_lights; ++i) {
+						const Sphere &s = lc._spheres[i];
+						const f32 dx = max(max(box.min.x - s.c.x, s.c.x - box.max.x), 0.0f);
+						const f32 dy = max(max(box.min.y - s.c.y, s.c.y - box.max.y), 0.0f);
+						const f32 dz = max(max(box.min.z - s.c.z, s.c.z - box.max.z), 0.0f);
+						bool hit = dx*dx + dy*dy + dz*dz <= s.r*s.r;
+
+						const LightClusters::Cone &cone = lc._cones[i];
+						if (hit && cone.range >= 0.0f) {
+							const Vector3 v = center - cone.apex;
+							const f32 v1 = dot(v, cone.direction);
+							const f32 dist = cone.cos_angle * fsqrt(max(dot(v, v) - v1*v1, 0.0f)) - v1 * cone.sin_angle;
+							hit = dist <= radius && v1 <= radius + cone.range && v1 >= -radius;
+						}
+
+						if (hit) {
+							ENSURE(count < lc._count[c]);
+							ENSURE(lc._indices[lc._offset[c] + count] == i);
+							++count;
+						}
+					}
+					ENSURE(count == lc._count[c]);
+				}
+			}
+		}
+
+		// Points lit by a light must find it in their cluster.
+		for (u32 j = 0; j < 10000; ++j) {
+			const f32 depth = n + rnd.unit_float()*(f - n);
+			const Vector3 p = { (rnd.unit_float()*2.0f - 1.0f)*depth*16.0f/9.0f, (rnd.unit_float()*2.0f - 1.0f)*depth, -depth };
+			const u32 c = lc.cluster(p);
+
+			for (u32 i = 0; i < num_lights; ++i) {
+				const Sphere &s = lc._spheres[i];
+				const LightClusters::Cone &cone = lc._cones[i];
+				bool lit = distance_squared(p, s.c) < s.r*s.r*0.99f;
+				if (lit && cone.range >= 0.0f) {
+					Vector3 l = p - cone.apex;
+					normalize(l);
+					lit = dot(l, cone.direction) > cone.cos_angle + 0.01f;
+				}
+
+				if (lit) {
+					bool found = false;
+					for (u32 k = 0; k < lc._count[c]; ++k)
+						found |= lc._indices[lc._offset[c] + k] == i;
+					ENSURE(found);
+				}
+			}
+		}
+
+		// Clusters past the index capacity lose their lights.
+		const u32 num_indices = array::size(lc._indices);
+		lc.reset(16, 9, 24, view, proj, num_indices / 2);
+		for (u32 i = 0; i < num_lights; ++i)
+			lc.add_omni({ { rnd.unit_float()*200.0f - 100.0f, 0.0f, -rnd.unit_float()*200.0f }, 10.0f });
+		lc.assign();
+		ENSURE(array::size(lc._indices) == num_indices / 2);
+	}
+	job_system_globals::shutdown();
+	profiler_globals::shutdown();
+	memory_globals::shutdown();
+}
+
+static void test_scene_graph()
+{
+	memory_globals::init();
+	profiler_globals::init();
+	job_system_globals::init(4);
+	Allocator &a = default_allocator();
+	{
+		// Parallel and serial updates must produce identical results.
+		UnitManager um(a);
+		SceneGraph sg_st(a, um);
+		SceneGraph sg_mt(a, um);
+		Random rnd(1337);
+
+		// Many independent trees, several per task, so that the
+		// parallel path splits the nodes at many root boundaries.
+		const u32 num_nodes = 20000;
+		const u32 num_roots = 64;
+		Array<TransformId> st(a);
+		Array<TransformId> mt(a);
+
+		for (u32 i = 0; i < num_nodes; ++i) {
+			const UnitId unit = um.create();
+			const Vector3 pos = { rnd.unit_float()*10.0f, rnd.unit_float()*10.0f, rnd.unit_float()*10.0f };
+			const Quaternion rot = from_axis_angle(VECTOR3_ZAXIS, rnd.unit_float()*PI);
+			const f32 s = 0.5f + rnd.unit_float();
+			const Vector3 scl = { s, s, s };
+			array::push_back(st, sg_st.create(unit, pos, rot, scl));
+			array::push_back(mt, sg_mt.create(unit, pos, rot, scl));
+
+			// Node i belongs to the tree rooted at node i % num_roots.
+			if (i >= num_roots) {
+				const u32 parent = i - num_roots*(1 + rnd.integer(i / num_roots));
+				sg_st.link(st[parent], st[i], pos, rot, scl);
+				sg_mt.link(mt[parent], mt[i], pos, rot, scl);
+			}
+		}
+
+		for (u32 frame = 0; frame < 3; ++frame) {
+			for (u32 i = 0; i < num_nodes / 10; ++i) {
+				const u32 n = rnd.integer(num_nodes);
+				const Vector3 pos = { rnd.unit_float(), rnd.unit_float(), rnd.unit_float() };
+				sg_st.set_local_position(st[n], pos);
+				sg_mt.set_local_position(mt[n], pos);
+			}
+
+			sg_st.update_world_transforms(1);
+			sg_mt.update_world_transforms(8);
+
+			for (u32 i = 0; i < num_nodes; ++i) {
+				const Matrix4x4 ma = sg_st.world_pose(st[i]);
+				const Matrix4x4 mb = sg_mt.world_pose(mt[i]);
+				ENSURE(memcmp(&ma, &mb, sizeof(ma)) == 0);
+			}
+
+			Array<UnitId> st_units(a);
+			Array<Matrix4x4> st_poses(a);
+			Array<UnitId> mt_units(a);
+			Array<Matrix4x4> mt_poses(a);
+			sg_st.get_changed(st_units, st_poses);
+			sg_mt.get_changed(mt_units, mt_poses);
+			ENSURE(array::size(st_units) == array::size(mt_units));
+			ENSURE(memcmp(array::begin(st_units), array::begin(mt_units), array::size(st_units)*sizeof(UnitId)) == 0);
+			ENSURE(memcmp(array::begin(st_poses), array::begin(mt_poses), array::size(st_poses)*sizeof(Matrix4x4)) == 0);
+			sg_st.clear_changed();
+			sg_mt.clear_changed();
+		}
+	}
+	{
+		// Destroying many units at once must produce the same hierarchy
+		// and poses as destroying them one by one.
+		UnitManager um_a(a);
+		UnitManager um_b(a);
+		SceneGraph sg_a(a, um_a);
+		SceneGraph sg_b(a, um_b);
+		Random rnd(42);
+
+		const u32 num_nodes = 5000;
+		Array<UnitId> units(a);
+		Array<TransformId> ta(a);
+		Array<TransformId> tb(a);
+
+		for (u32 i = 0; i < num_nodes; ++i) {
+			const UnitId unit = um_a.create();
+			ENSURE(um_b.create() == unit);
+			const Vector3 pos = { rnd.unit_float()*10.0f, rnd.unit_float()*10.0f, rnd.unit_float()*10.0f };
+			const Quaternion rot = from_axis_angle(VECTOR3_YAXIS, rnd.unit_float()*PI);
+			array::push_back(units, unit);
+			array::push_back(ta, sg_a.create(unit, pos, rot, VECTOR3_ONE));
+			array::push_back(tb, sg_b.create(unit, pos, rot, VECTOR3_ONE));
+
+			if (i > 0 && rnd.integer(10) != 0) {
+				const u32 parent = rnd.integer(i);
+				sg_a.link(ta[parent], ta[i], pos, rot, VECTOR3_ONE);
+				sg_b.link(tb[parent], tb[i], pos, rot, VECTOR3_ONE);
+			}
+		}
+		sg_a.update_world_transforms();
+		sg_b.update_world_transforms();
+
+		Array<UnitId> dead(a);
+		for (u32 i = 0; i < num_nodes; ++i) {
+			if (rnd.integer(3) == 0)
+				array::push_back(dead, units[i]);
+		}
+
+		for (u32 i = 0; i < array::size(dead); ++i)
+			um_a.destroy(dead[i]);
+		um_b.destroy(array::begin(dead), array::size(dead));
+		sg_a.update_world_transforms();
+		sg_b.update_world_transforms();
+
+		for (u32 i = 0; i < num_nodes; ++i) {
+			ENSURE(sg_a.has(units[i]) == sg_b.has(units[i]));
+			if (!sg_a.has(units[i]))
+				continue;
+
+			const TransformId pa = sg_a.parent(ta[i]);
+			const TransformId pb = sg_b.parent(tb[i]);
+			ENSURE(is_valid(pa) == is_valid(pb));
+			if (is_valid(pa))
+				ENSURE(sg_a.owner(pa) == sg_b.owner(pb));
+
+			// Unlinking order differs, so poses can differ by rounding.
+			const Matrix4x4 ma = sg_a.world_pose(ta[i]);
+			const Matrix4x4 mb = sg_b.world_pose(tb[i]);
+			for (u32 j = 0; j < 16; ++j)
+				ENSURE(fequal(to_float_ptr(ma)[j], to_float_ptr(mb)[j], 0.001f));
+		}
+	}
+	job_system_globals::shutdown();
+	profiler_globals::shutdown();
+	memory_globals::shutdown();
+}
+
 #define RUN_TEST(name)      \
 	do {                    \
 		printf(#name "\n"); \
@@ -2523,16 +3773,35 @@ int main_unit_tests()
 	RUN_TEST(test_path);
 	RUN_TEST(test_command_line);
 	RUN_TEST(test_thread);
+	RUN_TEST(test_job_system);
 	RUN_TEST(test_process);
 	RUN_TEST(test_filesystem);
 	RUN_TEST(test_file_monitor);
 	RUN_TEST(test_option);
 	RUN_TEST(test_lua_resource);
+	RUN_TEST(test_mesh_simplify);
+	RUN_TEST(test_mesh_optimize);
+	RUN_TEST(test_mesh_bvh);
 	RUN_TEST(test_time);
 	RUN_TEST(test_expression_language);
 	RUN_TEST(test_unit_id);
+	RUN_TEST(test_unit_map);
 	RUN_TEST(test_random);
 	RUN_TEST(test_frustum);
+	RUN_TEST(test_culling);
+	RUN_TEST(test_culling_set);
+	RUN_TEST(test_occlusion_buffer);
+	RUN_TEST(test_light_clusters);
+	RUN_TEST(test_scene_graph);
+
+	return EXIT_SUCCESS;
+}
+
+int main_benchmarks()
+{
+	RUN_TEST(bench_mesh_bvh);
+	RUN_TEST(bench_unit_map);
+	RUN_TEST(bench_culling);
 
 	return EXIT_SUCCESS;
 }
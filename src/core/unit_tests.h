@@ -10,4 +10,7 @@ namespace crown
 /// Runs all the unit tests.
 int main_unit_tests();
 
+/// Runs all the benchmarks.
+int main_benchmarks();
+
 } // namespace crown
@@ -29,6 +29,7 @@
 #include "core/strings/string.inl"
 #include "core/strings/string_id.inl"
 #include "core/strings/string_stream.inl"
+#include "core/thread/job_system.h"
 #include "core/time.h"
 #include "core/types.h"
 #include "device/console_server.h"
@@ -1158,10 +1159,12 @@ int main_runtime(const DeviceOptions &opts)
 {
 	CE_ASSERT(_device == NULL, "Crown already initialized");
 	console_server_globals::init();
+	job_system_globals::init(opts._num_cpus);
 	_device = CE_NEW(default_allocator(), Device)(opts, *console_server());
 	int ec = _device->main_loop();
 	CE_DELETE(default_allocator(), _device);
 	_device = NULL;
+	job_system_globals::shutdown();
 	console_server_globals::shutdown();
 	return ec;
 }
@@ -7,6 +7,7 @@
 #include "core/command_line.h"
 #include "core/filesystem/path.h"
 #include "core/option.inl"
+#include "core/os.h"
 #include "core/strings/dynamic_string.inl"
 #include "device/device_options.h"
 #include <errno.h>
@@ -62,6 +63,10 @@ static void help(const char *msg = NULL)
 		"  --window-rect <x y w h>         Set the main window's position and size.\n"
 		"  --string-id <string>            Print the 32- and 64-bits IDs of <string>.\n"
 		"  --run-unit-tests                Run unit tests and quit.\n"
+		"  --run-benchmarks                Run benchmarks and quit.\n"
+		"\n"
+		"Data Compiler Options:\n"
+		"  --no-mesh-optimization          Do not reorder mesh triangles and vertices for the GPU.\n"
 		"\n"
 		"Full documentation at https://docs.crownengine.org/html/" CROWN_MANUAL_VERSION "/reference/command_line.html\n"
 		);
@@ -86,6 +91,7 @@ DeviceOptions::DeviceOptions(Allocator &a, int argc, const char **argv)
 	, _do_compile(false)
 	, _do_continue(false)
 	, _do_bundle(false)
+	, _optimize_meshes(true)
 	, _server(false)
 	, _pumped(false)
 	, _hidden(false)
@@ -94,6 +100,7 @@ DeviceOptions::DeviceOptions(Allocator &a, int argc, const char **argv)
 	, _console_port(0)
 	, _window_x(0)
 	, _window_y(0)
+	, _num_cpus(os::num_cpus())
 	, _window_width(CROWN_DEFAULT_WINDOW_WIDTH)
 	, _window_height(CROWN_DEFAULT_WINDOW_HEIGHT)
 	, _renderer_type(RendererType::AUTO)
@@ -136,6 +143,7 @@ int DeviceOptions::parse(bool *quit)
 
 	_do_compile = cl.has_option("compile");
 	_do_bundle = cl.has_option("bundle");
+	_optimize_meshes = !cl.has_option("no-mesh-optimization");
 	if (_do_compile || _do_bundle) {
 		_platform = cl.get_parameter(0, "platform");
 
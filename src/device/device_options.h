@@ -43,6 +43,7 @@ struct DeviceOptions
 	bool _do_compile;
 	bool _do_continue;
 	bool _do_bundle;
+	bool _optimize_meshes;
 	bool _server;
 	bool _pumped;
 	bool _hidden;
@@ -51,6 +52,7 @@ struct DeviceOptions
 	u16 _console_port;
 	u16 _window_x;
 	u16 _window_y;
+	u32 _num_cpus;
 	Option<u16> _window_width;
 	Option<u16> _window_height;
 	Option<RendererType::Enum> _renderer_type;
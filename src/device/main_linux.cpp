@@ -2660,6 +2660,9 @@ int main(int argc, char **argv)
 	if (cl.has_option("run-unit-tests")) {
 		return main_unit_tests();
 	}
+	if (cl.has_option("run-benchmarks")) {
+		return main_benchmarks();
+	}
 #endif
 
 	InitGlobals m;
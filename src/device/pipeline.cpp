@@ -153,6 +153,77 @@ static void lookup_default_shaders(Pipeline &pl)
 	pl._bloom_upsample_shader = pl._shader_manager->shader(STRING_ID_32("bloom_upsample", UINT32_C(0x26773c9c)));
 	pl._bloom_combine_shader = pl._shader_manager->shader(STRING_ID_32("bloom_combine", UINT32_C(0x4413efa4)));
 	pl._tonemap_shader = pl._shader_manager->shader(STRING_ID_32("tonemap", UINT32_C(0x7089b06b)));
+
+	// Older shader libraries may lack the instanced shadow variant.
+	pl._shadow_instancing_shader = pl._shader_manager->shader(STRING_ID_32("shadow+INSTANCING", UINT32_C(0x4864212b)));
+	if (!pl._shader_manager->has(STRING_ID_32("shadow+INSTANCING", UINT32_C(0x4864212b))))
+		pl._shadow_instancing_shader.program = BGFX_INVALID_HANDLE;
+}
+
+/// Draws the stencil "hourglass" pattern used to render omni lights' tiles
+/// as 4 strips into the local lights shadow map of @a view_id.
+static void submit_omni_stencil_pattern(Pipeline &pl, bgfx::ViewId view_id)
+{
+	const u16 sm_w = (u16)pl._render_settings.local_lights_shadow_map_size.x;
+	const f32 step = f32(pl._local_lights_tile_size) / f32(sm_w) * 0.5f;
+	const s32 num_cols = sm_w / pl._local_lights_tile_size;
+	const s32 num_rows = num_cols;
+	const s32 num_pins = num_cols + 1;
+	const s32 num_necks = num_pins - 1;
+	const u32 num_vertices = num_pins*num_pins + num_necks*num_necks;
+	const u32 num_triangles = num_necks*num_necks * 2;
+	const u32 num_indices = num_triangles * 3;
+
+	if (bgfx::getAvailTransientVertexBuffer(num_vertices, PosVertex::pos_layout) == num_vertices
+		&& bgfx::getAvailTransientIndexBuffer(num_indices) == num_indices) {
+		// Build vertex buffer.
+		bgfx::TransientVertexBuffer vb;
+		bgfx::allocTransientVertexBuffer(&vb, num_vertices, PosVertex::pos_layout);
+		PosVertex *v = (PosVertex *)vb.data;
+
+		for (s32 h = 0; h < num_pins + num_necks; ++h) {
+			s32 start_w = h % 2;
+			for (s32 w = start_w; w < num_pins + num_necks; w += 2) {
+				const f32 xi = w * step;
+				const f32 yi = h * step;
+				*v++ = { xi, yi, 0.0f };
+			}
+		}
+
+		// Build index buffer.
+		bgfx::TransientIndexBuffer ib;
+		bgfx::allocTransientIndexBuffer(&ib, num_indices);
+		u16 *ind = (u16 *)ib.data;
+
+		const s32 gap = num_cols + 1;
+		const s32 row_stride = 2 * gap - 1;
+
+		for (s32 r = 0; r < num_rows; ++r) {
+			for (s32 c = 0; c < num_cols; ++c) {
+				const s32 t = r * row_stride + c;
+				// Top triangle.
+				*ind++ = t;
+				*ind++ = t + 1;
+				*ind++ = t + gap;
+				// Bottom triangle.
+				*ind++ = t + gap;
+				*ind++ = t + 2 * gap;
+				*ind++ = t + 2 * gap - 1;
+			}
+		}
+
+		bgfx::setState(0);
+		bgfx::setStencil(BGFX_STENCIL_TEST_ALWAYS
+			| BGFX_STENCIL_FUNC_REF(1)
+			| BGFX_STENCIL_FUNC_RMASK(0xff)
+			| BGFX_STENCIL_OP_FAIL_S_REPLACE
+			| BGFX_STENCIL_OP_FAIL_Z_REPLACE
+			| BGFX_STENCIL_OP_PASS_Z_REPLACE
+			);
+		bgfx::setVertexBuffer(0, &vb);
+		bgfx::setIndexBuffer(&ib);
+		bgfx::submit(view_id, pl._shadow_shader.program);
+	}
 }
 
 Pipeline::Pipeline(ShaderManager &sm)
@@ -176,6 +247,13 @@ Pipeline::Pipeline(ShaderManager &sm)
 	, _sun_shadow_map_frame_buffer(BGFX_INVALID_HANDLE)
 	, _local_lights_shadow_map_texture(BGFX_INVALID_HANDLE)
 	, _local_lights_shadow_map_frame_buffer(BGFX_INVALID_HANDLE)
+	, _sun_shadow_cache_texture(BGFX_INVALID_HANDLE)
+	, _sun_shadow_cache_frame_buffer(BGFX_INVALID_HANDLE)
+	, _local_lights_shadow_cache_texture(BGFX_INVALID_HANDLE)
+	, _local_lights_shadow_cache_frame_buffer(BGFX_INVALID_HANDLE)
+	, _shadow_cache_epoch(0)
+	, _shadow_cache_owner(NULL)
+	, _shadow_cache_clear(false)
 	, _bloom_map(BGFX_INVALID_HANDLE)
 	, _map_pixel_size(BGFX_INVALID_HANDLE)
 	, _bloom_params(BGFX_INVALID_HANDLE)
@@ -202,6 +280,13 @@ bool Pipeline::selection_enabled() const
 		;
 }
 
+bool Pipeline::shadow_caching_enabled() const
+{
+	return (_render_settings.flags & RenderSettingsFlags::SHADOW_CACHING) != 0
+		&& (bgfx::getCaps()->supported & BGFX_CAPS_TEXTURE_BLIT) != 0
+		;
+}
+
 void Pipeline::create(u16 width, u16 height, const RenderSettings &render_settings)
 {
 	_render_settings = render_settings;
@@ -222,6 +307,12 @@ void Pipeline::create(u16 width, u16 height, const RenderSettings &render_settin
 	_u_cascaded_lights = bgfx::createUniform("u_cascaded_lights", bgfx::UniformType::Mat4, MAX_NUM_CASCADES);
 	_u_shadow_map_params = bgfx::createUniform("u_shadow_map_params", bgfx::UniformType::Vec4, 2);
 
+	// Shadow maps receive a copy of the cache textures when caching is enabled.
+	const u64 shadow_map_flags = shadow_caching_enabled()
+		? BGFX_TEXTURE_RT | BGFX_TEXTURE_BLIT_DST | BGFX_SAMPLER_COMPARE_LEQUAL
+		: BGFX_TEXTURE_RT | BGFX_SAMPLER_COMPARE_LEQUAL
+		;
+
 	// Create cascaded shadow map resources.
 	if (bgfx::isValid(_sun_shadow_map_texture))
 		bgfx::destroy(_sun_shadow_map_texture);
@@ -230,7 +321,7 @@ void Pipeline::create(u16 width, u16 height, const RenderSettings &render_settin
 		, false
 		, 1
 		, bgfx::TextureFormat::D32F
-		, BGFX_TEXTURE_RT | BGFX_SAMPLER_COMPARE_LEQUAL
+		, shadow_map_flags
 		);
 	const bgfx::TextureHandle fbtextures[] =
 	{
@@ -248,7 +339,7 @@ void Pipeline::create(u16 width, u16 height, const RenderSettings &render_settin
 		, false
 		, 1
 		, bgfx::TextureFormat::D24S8
-		, BGFX_TEXTURE_RT | BGFX_SAMPLER_COMPARE_LEQUAL
+		, shadow_map_flags
 		);
 	const bgfx::TextureHandle llfbtextures[] =
 	{
@@ -258,6 +349,38 @@ void Pipeline::create(u16 width, u16 height, const RenderSettings &render_settin
 		bgfx::destroy(_local_lights_shadow_map_frame_buffer);
 	_local_lights_shadow_map_frame_buffer = bgfx::createFrameBuffer(countof(llfbtextures), llfbtextures);
 
+	// Create static shadow casters cache resources.
+	if (bgfx::isValid(_sun_shadow_cache_frame_buffer))
+		bgfx::destroy(_sun_shadow_cache_frame_buffer);
+	_sun_shadow_cache_frame_buffer = BGFX_INVALID_HANDLE;
+	if (bgfx::isValid(_local_lights_shadow_cache_frame_buffer))
+		bgfx::destroy(_local_lights_shadow_cache_frame_buffer);
+	_local_lights_shadow_cache_frame_buffer = BGFX_INVALID_HANDLE;
+
+	if (shadow_caching_enabled()) {
+		// Textures are attached to the frame buffers, which destroy them.
+		_sun_shadow_cache_texture = bgfx::createTexture2D((u16)_render_settings.sun_shadow_map_size.x
+			, (u16)_render_settings.sun_shadow_map_size.y
+			, false
+			, 1
+			, bgfx::TextureFormat::D32F
+			, BGFX_TEXTURE_RT
+			);
+		_sun_shadow_cache_frame_buffer = bgfx::createFrameBuffer(1, &_sun_shadow_cache_texture, true);
+
+		_local_lights_shadow_cache_texture = bgfx::createTexture2D((u16)_render_settings.local_lights_shadow_map_size.x
+			, (u16)_render_settings.local_lights_shadow_map_size.y
+			, false
+			, 1
+			, bgfx::TextureFormat::D24S8
+			, BGFX_TEXTURE_RT
+			);
+		_local_lights_shadow_cache_frame_buffer = bgfx::createFrameBuffer(1, &_local_lights_shadow_cache_texture, true);
+
+		++_shadow_cache_epoch;
+		_shadow_cache_clear = true;
+	}
+
 	// FIXME: this is a pretty dumb allocation scheme but it's fine for now.
 	_local_lights_tile_size = best_square_size((u32)_render_settings.local_lights_shadow_map_size.x
 		, (u32)_render_settings.local_lights_shadow_map_size.y
@@ -270,16 +393,35 @@ void Pipeline::create(u16 width, u16 height, const RenderSettings &render_settin
 
 	_lights_num = bgfx::createUniform("u_lights_num", bgfx::UniformType::Vec4, 1);
 	_lights_data = bgfx::createUniform("u_lights_data", bgfx::UniformType::Sampler);
-	_lights_data_texture = bgfx::createTexture2D(MAX_NUM_LIGHTS * LIGHT_SIZE
-		, 1
+	_lights_data_texture = bgfx::createTexture2D(LIGHT_SIZE
+		, MAX_NUM_LIGHTS
 		, false
 		, 1
 		, bgfx::TextureFormat::RGBA32F
 		, BGFX_SAMPLER_MIN_POINT | BGFX_SAMPLER_MAG_POINT
 		);
 
+	_light_clusters_params = bgfx::createUniform("u_light_clusters_params", bgfx::UniformType::Vec4, 2);
+	_light_clusters = bgfx::createUniform("u_light_clusters", bgfx::UniformType::Sampler);
+	_light_clusters_texture = bgfx::createTexture2D(LIGHT_CLUSTERS_X * LIGHT_CLUSTERS_Y
+		, LIGHT_CLUSTERS_Z
+		, false
+		, 1
+		, bgfx::TextureFormat::RG32F
+		, BGFX_SAMPLER_MIN_POINT | BGFX_SAMPLER_MAG_POINT
+		);
+	_light_indices = bgfx::createUniform("u_light_indices", bgfx::UniformType::Sampler);
+	_light_indices_texture = bgfx::createTexture2D(LIGHT_INDICES_WIDTH
+		, LIGHT_INDICES_HEIGHT
+		, false
+		, 1
+		, bgfx::TextureFormat::R32F
+		, BGFX_SAMPLER_MIN_POINT | BGFX_SAMPLER_MAG_POINT
+		);
+
 	_fog_data = bgfx::createUniform("u_fog_data", bgfx::UniformType::Vec4, 2);
 	_lighting_params = bgfx::createUniform("u_lighting_params", bgfx::UniformType::Vec4);
+	_mesh_position_decode = bgfx::createUniform("u_mesh_position_decode", bgfx::UniformType::Vec4, 2);
 
 	_bloom_map = bgfx::createUniform("s_bloom_map", bgfx::UniformType::Sampler);
 	_map_pixel_size = bgfx::createUniform("u_map_pixel_size", bgfx::UniformType::Vec4);
@@ -300,10 +442,22 @@ void Pipeline::destroy()
 	for (u32 id = 0; id < View::COUNT; ++id)
 		bgfx::setViewFrameBuffer(id, BGFX_INVALID_HANDLE);
 
+	bgfx::destroy(_mesh_position_decode);
+	_mesh_position_decode = BGFX_INVALID_HANDLE;
 	bgfx::destroy(_lighting_params);
 	_lighting_params = BGFX_INVALID_HANDLE;
 	bgfx::destroy(_fog_data);
 	_fog_data = BGFX_INVALID_HANDLE;
+	bgfx::destroy(_light_indices_texture);
+	_light_indices_texture = BGFX_INVALID_HANDLE;
+	bgfx::destroy(_light_indices);
+	_light_indices = BGFX_INVALID_HANDLE;
+	bgfx::destroy(_light_clusters_texture);
+	_light_clusters_texture = BGFX_INVALID_HANDLE;
+	bgfx::destroy(_light_clusters);
+	_light_clusters = BGFX_INVALID_HANDLE;
+	bgfx::destroy(_light_clusters_params);
+	_light_clusters_params = BGFX_INVALID_HANDLE;
 	bgfx::destroy(_lights_data_texture);
 	_lights_data_texture = BGFX_INVALID_HANDLE;
 	bgfx::destroy(_lights_data);
@@ -321,6 +475,16 @@ void Pipeline::destroy()
 	bgfx::destroy(_local_lights_shadow_map_texture);
 	_local_lights_shadow_map_texture = BGFX_INVALID_HANDLE;
 
+	// Destroy static shadow casters cache resources.
+	if (bgfx::isValid(_local_lights_shadow_cache_frame_buffer))
+		bgfx::destroy(_local_lights_shadow_cache_frame_buffer);
+	_local_lights_shadow_cache_frame_buffer = BGFX_INVALID_HANDLE;
+	_local_lights_shadow_cache_texture = BGFX_INVALID_HANDLE;
+	if (bgfx::isValid(_sun_shadow_cache_frame_buffer))
+		bgfx::destroy(_sun_shadow_cache_frame_buffer);
+	_sun_shadow_cache_frame_buffer = BGFX_INVALID_HANDLE;
+	_sun_shadow_cache_texture = BGFX_INVALID_HANDLE;
+
 	// Destroy cascaded shadow map resources.
 	bgfx::destroy(_u_cascaded_lights);
 	_u_cascaded_lights = BGFX_INVALID_HANDLE;
@@ -593,17 +757,30 @@ void Pipeline::reset(u16 width, u16 height)
 			bgfx::setViewRect(id, 0, 0, width, height);
 			bgfx::setViewMode(id, bgfx::ViewMode::DepthAscending);
 			bgfx::setViewFrameBuffer(id, _color_sdr);
+		} else if (id >= View::CASCADE_CACHE_0 && id < View::CASCADE_CACHE_LAST) {
+			view_name = "sm_cascade_cache";
+			bgfx::setViewFrameBuffer(id, _sun_shadow_cache_frame_buffer);
+			bgfx::setViewClear(id, BGFX_CLEAR_DEPTH, 0xffffffff, 1.0f, 0);
+		} else if (id == View::SM_LOCAL_CACHE_CLEAR) {
+			view_name = "sm_local_lights_cache_clear";
+			bgfx::setViewFrameBuffer(id, _local_lights_shadow_cache_frame_buffer);
+			bgfx::setViewRect(id, 0, 0, (u16)_render_settings.local_lights_shadow_map_size.x, (u16)_render_settings.local_lights_shadow_map_size.y);
+			bgfx::setViewTransform(id, to_float_ptr(MATRIX4X4_IDENTITY), to_float_ptr(sm_local_clear_proj));
+		} else if (id >= View::SM_LOCAL_CACHE_0 && id < View::SM_LOCAL_CACHE_LAST) {
+			view_name = "sm_local_lights_cache";
+			bgfx::setViewFrameBuffer(id, _local_lights_shadow_cache_frame_buffer);
 		} else if (id == View::CASCADE_CLEAR) {
 			view_name = "sm_cascade_clear";
 			bgfx::setViewFrameBuffer(id, _sun_shadow_map_frame_buffer);
 			bgfx::setViewRect(id, 0, 0, (u16)_render_settings.sun_shadow_map_size.x, (u16)_render_settings.sun_shadow_map_size.y);
+			// RenderWorld copies the cache texture over the cleared shadow map when any cascade uses it.
 			bgfx::setViewClear(id, BGFX_CLEAR_DEPTH, 0xffffffff, 1.0f, 0);
 		} else if (id >= View::CASCADE_0 && id < View::CASCADE_LAST) {
 			view_name = "sm_cascade";
 			bgfx::setViewFrameBuffer(id, _sun_shadow_map_frame_buffer);
 		} else if (id == View::SM_LOCAL_CLEAR) {
 			view_name = "sm_local_lights_clear";
-			bgfx::setViewClear(id, BGFX_CLEAR_DEPTH | BGFX_CLEAR_STENCIL, 0, 1.0f, 0);
+			bgfx::setViewClear(id, shadow_caching_enabled() ? BGFX_CLEAR_NONE : BGFX_CLEAR_DEPTH | BGFX_CLEAR_STENCIL, 0, 1.0f, 0);
 			bgfx::setViewFrameBuffer(id, _local_lights_shadow_map_frame_buffer);
 			bgfx::setViewRect(id, 0, 0, (u16)_render_settings.local_lights_shadow_map_size.x, (u16)_render_settings.local_lights_shadow_map_size.y);
 			bgfx::setViewTransform(id, to_float_ptr(MATRIX4X4_IDENTITY), to_float_ptr(sm_local_clear_proj));
@@ -615,6 +792,7 @@ void Pipeline::reset(u16 width, u16 height)
 		} else if (id == View::MESH) {
 			view_name = "mesh";
 			bgfx::setViewRect(id, 0, 0, width, height);
+			bgfx::setViewMode(id, bgfx::ViewMode::Sequential); // Sorted by RenderWorld.
 			bgfx::setViewFrameBuffer(id, _colors[0]);
 		} else if (id == View::BLOOM_COPY) {
 			view_name = "bloom_copy";
@@ -738,6 +916,17 @@ void Pipeline::render(u16 width, u16 height, const Matrix4x4 &view, const Matrix
 		if (id >= View::SPRITE_0 && id < View::SPRITE_LAST) {
 			bgfx::setViewTransform(id, to_float_ptr(view), to_float_ptr(proj));
 			bgfx::touch(id);
+		} else if (id == View::SM_LOCAL_CACHE_CLEAR) {
+			const bool render_local_lights_shadows = (_render_settings.flags & RenderSettingsFlags::LOCAL_LIGHTS) != 0
+				&& (_render_settings.flags & RenderSettingsFlags::LOCAL_LIGHTS_SHADOWS) != 0
+				;
+			if (render_local_lights_shadows && shadow_caching_enabled()) {
+				// Tiles are cleared by the views that render them, the
+				// stencil pattern must be cleared once after creation.
+				bgfx::setViewClear(id, _shadow_cache_clear ? BGFX_CLEAR_DEPTH | BGFX_CLEAR_STENCIL : BGFX_CLEAR_NONE, 0, 1.0f, 0);
+				_shadow_cache_clear = false;
+				submit_omni_stencil_pattern(*this, id);
+			}
 		} else if (id == View::CASCADE_CLEAR) {
 			bgfx::touch(id);
 		} else if (id == View::SM_LOCAL_CLEAR) {
@@ -745,67 +934,9 @@ void Pipeline::render(u16 width, u16 height, const Matrix4x4 &view, const Matrix
 				&& (_render_settings.flags & RenderSettingsFlags::LOCAL_LIGHTS_SHADOWS) != 0
 				;
 			if (render_local_lights_shadows) {
-				// Draw stencil "hourglass" pattern for omni lights.
-				const u16 sm_w = (u16)_render_settings.local_lights_shadow_map_size.x;
-				const f32 step = f32(_local_lights_tile_size) / f32(sm_w) * 0.5f;
-				const s32 num_cols = sm_w / _local_lights_tile_size;
-				const s32 num_rows = num_cols;
-				const s32 num_pins = num_cols + 1;
-				const s32 num_necks = num_pins - 1;
-				const u32 num_vertices = num_pins*num_pins + num_necks*num_necks;
-				const u32 num_triangles = num_necks*num_necks * 2;
-				const u32 num_indices = num_triangles * 3;
-
-				if (bgfx::getAvailTransientVertexBuffer(num_vertices, PosVertex::pos_layout) == num_vertices
-					&& bgfx::getAvailTransientIndexBuffer(num_indices) == num_indices) {
-					// Build vertex buffer.
-					bgfx::TransientVertexBuffer vb;
-					bgfx::allocTransientVertexBuffer(&vb, num_vertices, PosVertex::pos_layout);
-					PosVertex *v = (PosVertex *)vb.data;
-
-					for (s32 h = 0; h < num_pins + num_necks; ++h) {
-						s32 start_w = h % 2;
-						for (s32 w = start_w; w < num_pins + num_necks; w += 2) {
-							const f32 xi = w * step;
-							const f32 yi = h * step;
-							*v++ = { xi, yi, 0.0f };
-						}
-					}
-
-					// Build index buffer.
-					bgfx::TransientIndexBuffer ib;
-					bgfx::allocTransientIndexBuffer(&ib, num_indices);
-					u16 *ind = (u16 *)ib.data;
-
-					const s32 gap = num_cols + 1;
-					const s32 row_stride = 2 * gap - 1;
-
-					for (s32 r = 0; r < num_rows; ++r) {
-						for (s32 c = 0; c < num_cols; ++c) {
-							const s32 t = r * row_stride + c;
-							// Top triangle.
-							*ind++ = t;
-							*ind++ = t + 1;
-							*ind++ = t + gap;
-							// Bottom triangle.
-							*ind++ = t + gap;
-							*ind++ = t + 2 * gap;
-							*ind++ = t + 2 * gap - 1;
-						}
-					}
-
-					bgfx::setState(0);
-					bgfx::setStencil(BGFX_STENCIL_TEST_ALWAYS
-						| BGFX_STENCIL_FUNC_REF(1)
-						| BGFX_STENCIL_FUNC_RMASK(0xff)
-						| BGFX_STENCIL_OP_FAIL_S_REPLACE
-						| BGFX_STENCIL_OP_FAIL_Z_REPLACE
-						| BGFX_STENCIL_OP_PASS_Z_REPLACE
-						);
-					bgfx::setVertexBuffer(0, &vb);
-					bgfx::setIndexBuffer(&ib);
-					bgfx::submit(id, _shadow_shader.program);
-				}
+				if (shadow_caching_enabled())
+					bgfx::blit(id, _local_lights_shadow_map_texture, 0, 0, _local_lights_shadow_cache_texture);
+				submit_omni_stencil_pattern(*this, id);
 			}
 		} else if (id == View::MESH) {
 			bgfx::setViewTransform(id, to_float_ptr(view), to_float_ptr(proj));
@@ -12,12 +12,21 @@
 #include <bgfx/bgfx.h>
 
 #define LIGHT_SIZE 22     // Size of a light in vec4 units.
-#define MAX_NUM_LIGHTS 32 // Maximum number of lights per frame.
+#define MAX_NUM_LIGHTS 256 // Maximum number of lights per frame.
+#define MAX_NUM_UNCLUSTERED_LIGHTS 32 // Maximum number of lights per frame when light clustering is disabled.
+#define LIGHT_CLUSTERS_X 16
+#define LIGHT_CLUSTERS_Y 9
+#define LIGHT_CLUSTERS_Z 24
+#define LIGHT_INDICES_WIDTH 1024
+#define LIGHT_INDICES_HEIGHT 64
+#define LIGHT_INDICES_MAX (LIGHT_INDICES_WIDTH * LIGHT_INDICES_HEIGHT) // Maximum number of light indices in all clusters.
 #define MAX_NUM_SPRITE_LAYERS 8
 #define MAX_NUM_CASCADES 4
 #define LIGHTS_DATA_SLOT 12
 #define CASCADED_SHADOW_MAP_SLOT MATERIAL_MAX_TEXTURE_SLOTS
 #define LOCAL_LIGHTS_SHADOW_MAP_SLOT 11
+#define LIGHT_CLUSTERS_SLOT 13
+#define LIGHT_INDICES_SLOT 14
 #define LOCAL_LIGHTS_MAX_SHADOW_CASTERS 16 // Maximum number of local shadow-casting lights per frame.
 CE_STATIC_ASSERT(LOCAL_LIGHTS_MAX_SHADOW_CASTERS <= MAX_NUM_LIGHTS);
 #define LOCAL_LIGHTS_SM_MAX_VIEWS (LOCAL_LIGHTS_MAX_SHADOW_CASTERS * 4) // Worst case all omni casters.
@@ -29,7 +38,12 @@ struct View
 	{
 		COLOR_0,
 		COLOR_1,
-		CASCADE_CLEAR,
+		CASCADE_CACHE_0,
+		CASCADE_CACHE_LAST    = CASCADE_CACHE_0 + MAX_NUM_CASCADES,
+		SM_LOCAL_CACHE_CLEAR  = CASCADE_CACHE_LAST,
+		SM_LOCAL_CACHE_0,
+		SM_LOCAL_CACHE_LAST   = SM_LOCAL_CACHE_0 + LOCAL_LIGHTS_SM_MAX_VIEWS,
+		CASCADE_CLEAR         = SM_LOCAL_CACHE_LAST,
 		CASCADE_0,
 		CASCADE_LAST          = CASCADE_0 + MAX_NUM_CASCADES,
 		SM_LOCAL_CLEAR        = CASCADE_LAST,
@@ -108,12 +122,27 @@ struct Pipeline
 	u16 _local_lights_tile_size;
 	u16 _local_lights_tile_cols;
 
+	// Shadow maps of static casters, copied into the shadow maps above every frame.
+	bgfx::TextureHandle _sun_shadow_cache_texture;
+	bgfx::FrameBufferHandle _sun_shadow_cache_frame_buffer;
+	bgfx::TextureHandle _local_lights_shadow_cache_texture;
+	bgfx::FrameBufferHandle _local_lights_shadow_cache_frame_buffer;
+	u32 _shadow_cache_epoch;         ///< Incremented whenever the cache textures are created.
+	const void *_shadow_cache_owner; ///< RenderWorld whose casters are in the cache textures.
+	bool _shadow_cache_clear;        ///< Whether the cache textures must be cleared.
+
 	// Lighting.
 	bgfx::UniformHandle _lights_num;
 	bgfx::UniformHandle _lights_data;
 	bgfx::TextureHandle _lights_data_texture;
+	bgfx::UniformHandle _light_clusters_params;
+	bgfx::UniformHandle _light_clusters;
+	bgfx::TextureHandle _light_clusters_texture; ///< Offset and count of the lights of each cluster.
+	bgfx::UniformHandle _light_indices;
+	bgfx::TextureHandle _light_indices_texture;  ///< Light indices of all clusters.
 	bgfx::UniformHandle _fog_data;
 	bgfx::UniformHandle _lighting_params;
+	bgfx::UniformHandle _mesh_position_decode; ///< Offset and scale of quantized mesh positions.
 
 	// Bloom.
 	bgfx::FrameBufferHandle _bloom_frame_buffers[BLOOM_MIPS];
@@ -140,6 +169,7 @@ struct Pipeline
 	ShaderData _selection_shader;
 	ShaderData _shadow_shader;
 	ShaderData _shadow_skinning_shader;
+	ShaderData _shadow_instancing_shader;
 	ShaderData _skydome_shader;
 	ShaderData _bloom_downsample_shader;
 	ShaderData _bloom_upsample_shader;
@@ -152,6 +182,9 @@ struct Pipeline
 	///
 	bool selection_enabled() const;
 
+	/// Returns whether static shadow casters are rendered into the cache textures.
+	bool shadow_caching_enabled() const;
+
 	///
 	void create(u16 width, u16 height, const RenderSettings &render_settings);
 
@@ -1917,6 +1917,77 @@ void load_api(LuaEnvironment &env)
 			stack.push_unit(world->spawn_unit(name, flags, pos, rot, scl));
 			return 1;
 		});
+	env.add_module_function("World", "spawn_units", [](lua_State *L) {
+			LuaStack stack(L, +1);
+			const int nargs = stack.num_args();
+
+			World *world          = stack.get_world(1);
+			const StringId64 name = stack.get_resource_name(2);
+			const int count_int   = stack.get_int(3);
+			LUA_ASSERT(count_int >= 0, stack, "Count must be non-negative");
+			const u32 count       = (u32)count_int;
+
+			char name_str[RESOURCE_ID_BUF_LEN];
+			LUA_ASSERT(device()->_resource_manager->can_get(RESOURCE_TYPE_UNIT, name)
+				, stack
+				, "Unit not loaded: " RESOURCE_ID_FMT_STR
+				, resource_id(RESOURCE_TYPE_UNIT, name).to_string(name_str, sizeof(name_str))
+				);
+			CE_UNUSED(name_str);
+
+			Array<Vector3> pos(default_allocator());
+			Array<Quaternion> rot(default_allocator());
+			Array<Vector3> scl(default_allocator());
+			Array<UnitId> units(default_allocator());
+			array::resize(units, count);
+
+			if (nargs > 3 && !stack.is_nil(4)) {
+				LUA_ASSERT(stack.is_table(4), stack, "Table expected");
+				LUA_ASSERT(lua_objlen(L, 4) == count, stack, "Mismatched positions array size");
+				array::resize(pos, count);
+				for (u32 i = 0; i < count; ++i) {
+					lua_rawgeti(L, 4, i + 1);
+					pos[i] = stack.get_vector3(-1);
+					stack.pop(1);
+				}
+			}
+			if (nargs > 4 && !stack.is_nil(5)) {
+				LUA_ASSERT(stack.is_table(5), stack, "Table expected");
+				LUA_ASSERT(lua_objlen(L, 5) == count, stack, "Mismatched rotations array size");
+				array::resize(rot, count);
+				for (u32 i = 0; i < count; ++i) {
+					lua_rawgeti(L, 5, i + 1);
+					rot[i] = stack.get_quaternion(-1);
+					stack.pop(1);
+				}
+			}
+			if (nargs > 5 && !stack.is_nil(6)) {
+				LUA_ASSERT(stack.is_table(6), stack, "Table expected");
+				LUA_ASSERT(lua_objlen(L, 6) == count, stack, "Mismatched scales array size");
+				array::resize(scl, count);
+				for (u32 i = 0; i < count; ++i) {
+					lua_rawgeti(L, 6, i + 1);
+					scl[i] = stack.get_vector3(-1);
+					stack.pop(1);
+				}
+			}
+
+			world->spawn_units(name
+				, count
+				, array::empty(pos) ? NULL : array::begin(pos)
+				, array::empty(rot) ? NULL : array::begin(rot)
+				, array::empty(scl) ? NULL : array::begin(scl)
+				, array::begin(units)
+				);
+
+			stack.push_table(count);
+			for (u32 i = 0; i < count; ++i) {
+				stack.push_key_begin(i + 1);
+				stack.push_unit(units[i]);
+				stack.push_key_end();
+			}
+			return 1;
+		});
 	env.add_module_function("World", "spawn_empty_unit", [](lua_State *L) {
 			LuaStack stack(L, +1);
 			stack.push_unit(stack.get_world(1)->spawn_empty_unit());
@@ -1932,6 +2003,22 @@ void load_api(LuaEnvironment &env)
 			stack.get_world(1)->destroy_unit(stack.get_unit(2));
 			return 0;
 		});
+	env.add_module_function("World", "destroy_units", [](lua_State *L) {
+			LuaStack stack(L);
+			LUA_ASSERT(stack.is_table(2), stack, "Table expected");
+
+			const u32 num = (u32)lua_objlen(L, 2);
+			Array<UnitId> units(default_allocator());
+			array::resize(units, num);
+			for (u32 i = 0; i < num; ++i) {
+				lua_rawgeti(L, 2, i + 1);
+				units[i] = stack.get_unit(-1);
+				stack.pop(1);
+			}
+
+			stack.get_world(1)->destroy_units(array::begin(units), num);
+			return 0;
+		});
 	env.add_module_function("World", "num_units", [](lua_State *L) {
 			LuaStack stack(L, +1);
 			stack.push_int(stack.get_world(1)->num_units());
@@ -3211,12 +3211,16 @@ int main_data_compiler(const DeviceOptions &opts)
 
 	MeshCache mesh_cache;
 
+	// Toggling mesh optimization changes the compiled meshes: make it part of
+	// their data version so that they are all recompiled.
+	const u32 mesh_version = RESOURCE_VERSION_MESH | (opts._optimize_meshes ? 0u : 1u << 24);
+
 	DataCompiler *dc = CE_NEW(default_allocator(), DataCompiler)(opts, *console_server());
 	dc->register_compiler("config",           RESOURCE_VERSION_CONFIG,           config_resource_internal::compile);
 	dc->register_compiler("font",             RESOURCE_VERSION_FONT,             font_resource_internal::compile);
 	dc->register_compiler("level",            RESOURCE_VERSION_LEVEL,            level_resource_internal::compile);
 	dc->register_compiler("material",         RESOURCE_VERSION_MATERIAL,         material_resource_internal::compile);
-	dc->register_compiler("mesh",             RESOURCE_VERSION_MESH,             mesh_resource_internal::compile, &mesh_cache);
+	dc->register_compiler("mesh",             mesh_version,                      mesh_resource_internal::compile, &mesh_cache);
 	dc->register_compiler("mesh_skeleton",    RESOURCE_VERSION_MESH_SKELETON,    mesh_skeleton_resource_internal::compile);
 	dc->register_compiler("mesh_animation",   RESOURCE_VERSION_MESH_ANIMATION,   mesh_animation_resource_internal::compile);
 	dc->register_compiler("package",          RESOURCE_VERSION_PACKAGE,          package_resource_internal::compile);
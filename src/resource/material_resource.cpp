@@ -507,6 +507,26 @@ namespace material_resource_internal
 
 		opts.add_requirement("shader", shader_library.c_str());
 
+		// Look for a statically compiled instanced variant of the shader.
+		StringId32 instanced_shader_id(0u);
+		if (!has_code) {
+			u32 i = 0;
+			for (; i < vector::size(defines); ++i) {
+				if (defines[i] == "SKINNING" || defines[i] == "INSTANCING")
+					break;
+			}
+
+			if (i == vector::size(defines)) {
+				vector::push_back(defines, StringView("INSTANCING"));
+				instanced_shader_id = shader_compiler::static_variant(shader_library
+					, shader_name
+					, defines
+					, opts
+					);
+				vector::pop_back(defines);
+			}
+		}
+
 		data.add_shader_uniforms();
 
 		// Parse uniforms and textures.
@@ -559,6 +579,7 @@ namespace material_resource_internal
 		MaterialResource mr;
 		mr.version             = RESOURCE_HEADER(RESOURCE_VERSION_MATERIAL);
 		mr.shader              = shader_id;
+		mr.instanced_shader    = instanced_shader_id;
 		mr.num_textures        = array::size(data.textures);
 		mr.texture_data_offset = sizeof(mr);
 		mr.num_uniforms        = array::size(data.uniforms);
@@ -573,6 +594,7 @@ namespace material_resource_internal
 		// Write
 		opts.write(mr.version);
 		opts.write(mr.shader);
+		opts.write(mr.instanced_shader);
 		opts.write(mr.num_textures);
 		opts.write(mr.texture_data_offset);
 		opts.write(mr.num_uniforms);
@@ -19,6 +19,7 @@ struct MaterialResource
 {
 	u32 version;
 	StringId32 shader;
+	StringId32 instanced_shader; // 0 if the shader has no static INSTANCING variant.
 	u32 num_textures;
 	u32 texture_data_offset;
 	u32 num_uniforms;
@@ -15,6 +15,7 @@
 #   include "core/list.inl"
 #   include "core/math/aabb.inl"
 #   include "core/math/constants.h"
+#   include "core/math/math.inl"
 #   include "core/math/matrix4x4.inl"
 #   include "core/math/random.inl"
 #   include "core/math/sphere.inl"
@@ -33,12 +34,19 @@
 #   include "resource/mesh_obj.h"
 #   include "resource/mesh_resource.h"
 #   include <bx/error.h>
+#   include <bx/math.h> // bx::halfFromFloat
 #   include <bx/readerwriter.h>
+#   include <float.h> // FLT_MAX
 #   include <mikktspace.h>
+#   include <stb_sprintf.h>
 #   include <vertexlayout.h> // bgfx::write, bgfx::read
 
 LOG_SYSTEM(MESH, "mesh")
 
+#define VERTEX_CACHE_SIZE 16     // Entries of the post-transform cache to optimize for.
+#define OVERDRAW_THRESHOLD 1.05f // Largest ACMR increase allowed to reduce overdraw.
+#define MAX_PART_VERTICES 65536  // Largest number of vertices addressable with 16-bit indices.
+
 namespace crown
 {
 namespace mesh
@@ -115,25 +123,31 @@ namespace mesh
 		return array::size(g._uvs) != 0;
 	}
 
-	static u32 vertex_stride(Geometry &g)
+	static u32 vertex_stride(Geometry &g, bool compact = false)
 	{
 		u32 stride = 0;
-		stride += 3 * sizeof(f32);
+		stride += compact ? 4*sizeof(s16) : 3*sizeof(f32);
 		stride += has_normals(g) ? sizeof(u32) : 0;
 		stride += has_tangents(g) ? sizeof(u32) : 0;
 		stride += has_bitangents(g) ? sizeof(u32) : 0;
-		stride += has_bones(g) ? 8*sizeof(f32) : 0;
-		stride += has_uvs(g) ? 2*sizeof(f32) : 0;
+		stride += has_bones(g) ? (compact ? 8*sizeof(u8) : 8*sizeof(f32)) : 0;
+		stride += has_uvs(g) ? (compact ? 2*sizeof(u16) : 2*sizeof(f32)) : 0;
 		return stride;
 	}
 
-	static bgfx::VertexLayout vertex_layout(Geometry &g)
+	// Returns the vertex layout of @a g. The compact layout stores positions
+	// as 16-bit integers normalized to the OBB, UVs as half floats, and bone
+	// indices and weights as 8-bit integers.
+	static bgfx::VertexLayout vertex_layout(Geometry &g, bool compact = false)
 	{
 		bgfx::VertexLayout layout;
 		memset((void *)&layout, 0, sizeof(layout));
 
 		layout.begin();
-		layout.add(bgfx::Attrib::Position, 3, bgfx::AttribType::Float);
+		if (compact)
+			layout.add(bgfx::Attrib::Position, 4, bgfx::AttribType::Int16, true);
+		else
+			layout.add(bgfx::Attrib::Position, 3, bgfx::AttribType::Float);
 
 		if (has_normals(g))
 			layout.add(bgfx::Attrib::Normal, 4, bgfx::AttribType::Uint8, true, true);
@@ -145,17 +159,98 @@ namespace mesh
 			layout.add(bgfx::Attrib::Bitangent, 4, bgfx::AttribType::Uint8, true, true);
 
 		if (has_bones(g)) {
-			layout.add(bgfx::Attrib::Indices, 4, bgfx::AttribType::Float);
-			layout.add(bgfx::Attrib::Weight, 4, bgfx::AttribType::Float);
+			if (compact) {
+				layout.add(bgfx::Attrib::Indices, 4, bgfx::AttribType::Uint8);
+				layout.add(bgfx::Attrib::Weight, 4, bgfx::AttribType::Uint8, true);
+			} else {
+				layout.add(bgfx::Attrib::Indices, 4, bgfx::AttribType::Float);
+				layout.add(bgfx::Attrib::Weight, 4, bgfx::AttribType::Float);
+			}
 		}
 
 		if (has_uvs(g))
-			layout.add(bgfx::Attrib::TexCoord0, 2, bgfx::AttribType::Float);
+			layout.add(bgfx::Attrib::TexCoord0, 2, compact ? bgfx::AttribType::Half : bgfx::AttribType::Float);
 
 		layout.end();
 		return layout;
 	}
 
+	static s16 to_snorm16(f32 val)
+	{
+		return s16(fround(clamp(val, -1.0f, 1.0f) * 32767.0f));
+	}
+
+	// Converts the vertices of @a g in @a vertex_buffer to the compact layout.
+	// Positions are normalized to @a obb.
+	static void compact_vertices(Array<char> &out, const Array<char> &vertex_buffer, Geometry &g, const OBB &obb)
+	{
+		const u32 stride = vertex_stride(g);
+		const u32 compact_stride = vertex_stride(g, true);
+		const u32 num_vertices = array::size(vertex_buffer) / stride;
+		const Vector3 center = translation(obb.tm);
+		const Vector3 half = obb.half_extents;
+
+		array::resize(out, num_vertices * compact_stride);
+
+		for (u32 i = 0; i < num_vertices; ++i) {
+			const char *src = array::begin(vertex_buffer) + i*stride;
+			char *dst = array::begin(out) + i*compact_stride;
+
+			Vector3 p;
+			memcpy(&p, src, sizeof(p));
+			const s16 q[4] =
+			{
+				half.x > 0.0f ? to_snorm16((p.x - center.x) / half.x) : s16(0),
+				half.y > 0.0f ? to_snorm16((p.y - center.y) / half.y) : s16(0),
+				half.z > 0.0f ? to_snorm16((p.z - center.z) / half.z) : s16(0),
+				0
+			};
+			memcpy(dst, q, sizeof(q));
+			src += sizeof(p);
+			dst += sizeof(q);
+
+			// Packed normal, tangent and bitangent.
+			const u32 num_packed = (has_normals(g) ? 1 : 0) + (has_tangents(g) ? 1 : 0) + (has_bitangents(g) ? 1 : 0);
+			memcpy(dst, src, num_packed*sizeof(u32));
+			src += num_packed*sizeof(u32);
+			dst += num_packed*sizeof(u32);
+
+			if (has_bones(g)) {
+				Vector4 b;
+				Vector4 w;
+				memcpy(&b, src, sizeof(b));
+				memcpy(&w, src + sizeof(b), sizeof(w));
+
+				const f32 *wf = to_float_ptr(w);
+				u8 indices[4] = { u8(b.x), u8(b.y), u8(b.z), u8(b.w) };
+				u8 weights[4];
+				u32 sum = 0;
+				u32 largest = 0;
+				for (u32 k = 0; k < 4; ++k) {
+					weights[k] = u8(fround(clamp(wf[k], 0.0f, 1.0f) * 255.0f));
+					sum += weights[k];
+					largest = wf[k] > wf[largest] ? k : largest;
+				}
+
+				// Make the weights sum to one again after rounding.
+				if (sum != 0)
+					weights[largest] = u8(clamp(s32(weights[largest]) + 255 - s32(sum), 0, 255));
+
+				memcpy(dst, indices, sizeof(indices));
+				memcpy(dst + sizeof(indices), weights, sizeof(weights));
+				src += sizeof(b) + sizeof(w);
+				dst += sizeof(indices) + sizeof(weights);
+			}
+
+			if (has_uvs(g)) {
+				Vector2 uv;
+				memcpy(&uv, src, sizeof(uv));
+				const u16 h[2] = { bx::halfFromFloat(uv.x), bx::halfFromFloat(uv.y) };
+				memcpy(dst, h, sizeof(h));
+			}
+		}
+	}
+
 	static u32 to_unorm(f32 val, f32 scale)
 	{
 		return u32(fround(clamp(val, 0.0f, 1.0f) * scale));
@@ -276,7 +371,7 @@ namespace mesh
 		genTangSpaceDefault(&context);
 	}
 
-	static s32 generate_vertex_and_index_buffers(Geometry &g, CompileOptions &opts)
+	static void generate_vertex_and_index_buffers(Geometry &g)
 	{
 		TempAllocator512 ta;
 		Buffer vertex(ta);
@@ -365,12 +460,6 @@ namespace mesh
 
 			if (index == INVALID_VERTEX_INDEX) {
 				index = array::size(g._vertex_buffer) / vertex_size;
-				RETURN_IF_FALSE(MESH, index <= UINT16_MAX
-					, opts
-					, "Mesh has too many vertices: %u (max %u)"
-					, index + 1
-					, UINT16_MAX + 1u
-					);
 
 				const u32 vertex_offset = array::size(g._vertex_buffer);
 				array::push(g._vertex_buffer, array::begin(vertex), vertex_size);
@@ -378,10 +467,8 @@ namespace mesh
 				hash_map::set(vertex_map, stored_key, index);
 			}
 
-			array::push_back(g._index_buffer, (u16)index);
+			array::push_back(g._index_buffer, index);
 		}
-
-		return 0;
 	}
 
 	static void geometry_names(Vector<DynamicString> &names, const Mesh &m, const DynamicString &geometry)
@@ -471,10 +558,322 @@ namespace mesh
 		return sphere;
 	}
 
+	struct LodSettings
+	{
+		f32 ratio;     ///< Fraction of the source triangles to keep.
+		f32 max_error; ///< Maximum error, relative to the bounding sphere radius.
+	};
+
+	static s32 parse_lods(Array<LodSettings> &lods, const char *json, CompileOptions &opts)
+	{
+		TempAllocator1024 ta;
+		JsonArray arr(ta);
+		RETURN_IF_ERROR(sjson::parse_array(arr, json));
+
+		for (u32 i = 0; i < array::size(arr); ++i) {
+			JsonObject obj(ta);
+			RETURN_IF_ERROR(sjson::parse_object(obj, arr[i]));
+
+			LodSettings lod;
+			lod.ratio = RETURN_IF_ERROR(sjson::parse_float(obj["ratio"]));
+			lod.max_error = FLT_MAX;
+			if (json_object::has(obj, "max_error")) {
+				lod.max_error = RETURN_IF_ERROR(sjson::parse_float(obj["max_error"]));
+				RETURN_IF_FALSE(MESH, lod.max_error >= 0.0f
+					, opts
+					, "LOD max_error must be positive"
+					);
+			}
+
+			RETURN_IF_FALSE(MESH, lod.ratio > 0.0f && lod.ratio <= 1.0f
+				, opts
+				, "LOD ratio must be in (0, 1]"
+				);
+			array::push_back(lods, lod);
+		}
+
+		return 0;
+	}
+
+	static void write_geometry(CompileOptions &opts
+		, const Vector<DynamicString> &names
+		, const char *suffix
+		, Geometry &g
+		, bool compact
+		, const OBB &obb
+		, const Sphere &sphere
+		, f32 lod_error
+		, f32 lod_ratio
+		, const Array<char> &vertex_buffer
+		, const Array<u32> &index_buffer
+		)
+	{
+		opts.write(vector::size(names));
+		for (u32 i = 0; i < vector::size(names); ++i) {
+			TempAllocator256 ta;
+			DynamicString name(ta);
+			name = names[i];
+			name += suffix;
+			opts.write(name.to_string_id()._id);
+		}
+
+		const bgfx::VertexLayout layout = mesh::vertex_layout(g, compact);
+		const u32 stride = mesh::vertex_stride(g, compact);
+		const u32 num_vertices = array::size(vertex_buffer) / vertex_stride(g);
+		const u32 index_stride = num_vertices > MAX_PART_VERTICES ? sizeof(u32) : sizeof(u16);
+
+		BgfxWriter writer(opts._binary_writer);
+		bgfx::write(&writer, layout);
+		opts.write(obb);
+		opts.write(sphere);
+		opts.write(lod_error);
+		opts.write(lod_ratio);
+
+		opts.write(num_vertices);
+		opts.write(stride);
+		opts.write(array::size(index_buffer));
+		opts.write(index_stride);
+
+		// Grow the BVH by a quantization step of the compact positions, so
+		// that it bounds the positions decoded at runtime.
+		Array<MeshBvhNode> bvh_nodes(default_allocator());
+		Array<u32> bvh_triangles(default_allocator());
+		Vector3 bvh_offset;
+		Vector3 bvh_scale;
+		const Vector3 &half = obb.half_extents;
+		mesh::build_bvh(bvh_nodes
+			, bvh_triangles
+			, bvh_offset
+			, bvh_scale
+			, array::begin(index_buffer)
+			, array::size(index_buffer)
+			, (const f32 *)array::begin(vertex_buffer)
+			, vertex_stride(g)
+			, compact ? max(half.x, half.y, half.z) / 32767.0f : 0.0f
+			);
+		opts.write(array::size(bvh_nodes));
+		opts.write(bvh_offset);
+		opts.write(bvh_scale);
+
+		if (compact) {
+			Array<char> compact_buffer(default_allocator());
+			compact_vertices(compact_buffer, vertex_buffer, g, obb);
+			opts.write(compact_buffer);
+		} else {
+			opts.write(vertex_buffer);
+		}
+
+		if (index_stride == sizeof(u32)) {
+			opts.write(array::begin(index_buffer), array::size(index_buffer) * sizeof(u32));
+		} else {
+			for (u32 i = 0; i < array::size(index_buffer); ++i)
+				opts.write((u16)index_buffer[i]);
+		}
+
+		opts.write(array::begin(bvh_nodes), array::size(bvh_nodes) * sizeof(MeshBvhNode));
+		opts.write(array::begin(bvh_triangles), array::size(bvh_triangles) * sizeof(u32));
+	}
+
+	// Reorders the triangle list @a indices for post-transform cache reuse,
+	// then sorts clusters of it to reduce overdraw.
+	static void optimize_triangles(Array<u32> &indices, const Array<char> &vertex_buffer, u32 stride)
+	{
+		const u32 num_vertices = array::size(vertex_buffer) / stride;
+		const u32 num_indices = array::size(indices);
+
+		Array<u32> tmp(default_allocator());
+		Array<u32> clusters(default_allocator());
+		array::resize(tmp, num_indices);
+
+		mesh::optimize_vertex_cache(array::begin(tmp)
+			, clusters
+			, array::begin(indices)
+			, num_indices
+			, num_vertices
+			, VERTEX_CACHE_SIZE
+			);
+		mesh::optimize_overdraw(array::begin(indices)
+			, array::begin(tmp)
+			, num_indices
+			, clusters
+			, (const f32 *)array::begin(vertex_buffer)
+			, stride
+			, num_vertices
+			, VERTEX_CACHE_SIZE
+			, OVERDRAW_THRESHOLD
+			);
+	}
+
+	// Optimizes the order of the triangles and vertices of @a g for the GPU.
+	// Returns the ACMR before and after the optimization.
+	static void optimize_buffers(f32 &acmr_before, f32 &acmr_after, Geometry &g, u32 stride)
+	{
+		const u32 num_vertices = array::size(g._vertex_buffer) / stride;
+		const u32 num_indices = array::size(g._index_buffer);
+		Array<u32> &indices = g._index_buffer;
+
+		acmr_before = mesh::acmr(array::begin(indices), num_indices, num_vertices, VERTEX_CACHE_SIZE);
+		optimize_triangles(indices, g._vertex_buffer, stride);
+		acmr_after = mesh::acmr(array::begin(indices), num_indices, num_vertices, VERTEX_CACHE_SIZE);
+
+		Array<char> vertex_buffer(default_allocator());
+		array::resize(vertex_buffer, array::size(g._vertex_buffer));
+		const u32 num = mesh::optimize_vertex_fetch(array::begin(vertex_buffer)
+			, array::begin(indices)
+			, num_indices
+			, array::begin(g._vertex_buffer)
+			, num_vertices
+			, stride
+			);
+		array::resize(vertex_buffer, num*stride);
+
+		g._vertex_buffer = vertex_buffer;
+	}
+
+	// Copies the vertices referenced by the @a num_indices @a indices to
+	// @a vertex_buffer, in order of first use, and stores the remapped indices
+	// in @a index_buffer.
+	static void extract_buffers(Array<char> &vertex_buffer
+		, Array<u32> &index_buffer
+		, const Array<char> &src_vertex_buffer
+		, u32 stride
+		, const u32 *indices
+		, u32 num_indices
+		)
+	{
+		const u32 num_vertices = array::size(src_vertex_buffer) / stride;
+
+		Array<u32> new_index(default_allocator());
+		array::resize(new_index, num_vertices);
+		for (u32 i = 0; i < num_vertices; ++i)
+			new_index[i] = UINT32_MAX;
+
+		array::clear(vertex_buffer);
+		array::clear(index_buffer);
+		array::reserve(index_buffer, num_indices);
+
+		for (u32 i = 0; i < num_indices; ++i) {
+			const u32 v = indices[i];
+			if (new_index[v] == UINT32_MAX) {
+				new_index[v] = array::size(vertex_buffer) / stride;
+				array::push(vertex_buffer, &src_vertex_buffer[v*stride], stride);
+			}
+
+			array::push_back(index_buffer, new_index[v]);
+		}
+	}
+
+	// Splits the triangle list @a indices into consecutive runs of triangles
+	// that reference at most @a max_vertices vertices each. Stores the first
+	// triangle of each run in @a parts.
+	static void split_triangles(Array<u32> &parts, const Array<u32> &indices, u32 num_vertices, u32 max_vertices)
+	{
+		array::clear(parts);
+		array::push_back(parts, 0u);
+		if (num_vertices <= max_vertices)
+			return;
+
+		// A vertex belongs to the current part if its mark equals the part number.
+		Array<u32> mark(default_allocator());
+		array::resize(mark, num_vertices);
+		for (u32 i = 0; i < num_vertices; ++i)
+			mark[i] = UINT32_MAX;
+
+		u32 part_vertices = 0;
+		for (u32 t = 0; t < array::size(indices) / 3; ++t) {
+			const u32 part = array::size(parts) - 1;
+			u32 new_vertices = 0;
+			for (u32 k = 0; k < 3; ++k)
+				new_vertices += mark[indices[t*3 + k]] != part ? 1 : 0;
+
+			if (part_vertices + new_vertices > max_vertices) {
+				array::push_back(parts, t);
+				part_vertices = 0;
+			}
+
+			for (u32 k = 0; k < 3; ++k) {
+				const u32 v = indices[t*3 + k];
+				if (mark[v] != array::size(parts) - 1) {
+					mark[v] = array::size(parts) - 1;
+					++part_vertices;
+				}
+			}
+		}
+	}
+
+	// Returns the bounding box of the vertices in @a vertex_buffer.
+	static OBB obb(const Array<char> &vertex_buffer, u32 stride)
+	{
+		AABB aabb;
+		aabb::reset(aabb);
+		aabb::from_points(aabb, array::size(vertex_buffer) / stride, stride, array::begin(vertex_buffer));
+
+		OBB obb;
+		obb.tm = from_quaternion_translation(QUATERNION_IDENTITY, aabb::center(aabb));
+		obb.half_extents = (aabb.max - aabb.min) * 0.5f;
+		return obb;
+	}
+
+	// Returns a bounding sphere of the vertices in @a vertex_buffer.
+	static Sphere sphere(const Array<char> &vertex_buffer, u32 stride)
+	{
+		Sphere sphere;
+		sphere::reset(sphere);
+		sphere::add_points(sphere, array::size(vertex_buffer) / stride, stride, array::begin(vertex_buffer));
+		return sphere;
+	}
+
+	// Simplifies @a src_vertex_buffer and @a src_index_buffer to the level of
+	// detail @a lod and stores the result, with unused vertices stripped, in
+	// @a vertex_buffer and @a index_buffer. Returns the simplification error in
+	// @a error.
+	static void generate_lod(Array<char> &vertex_buffer
+		, Array<u32> &index_buffer
+		, f32 &error
+		, const Array<char> &src_vertex_buffer
+		, const Array<u32> &src_index_buffer
+		, u32 stride
+		, const LodSettings &lod
+		, f32 radius
+		, bool optimize
+		)
+	{
+		const u32 num_vertices = array::size(src_vertex_buffer) / stride;
+		const u32 num_indices = array::size(src_index_buffer);
+
+		Array<u32> lod_indices(default_allocator());
+		mesh::simplify(lod_indices
+			, error
+			, array::begin(src_index_buffer)
+			, num_indices
+			, (const f32 *)array::begin(src_vertex_buffer)
+			, stride
+			, num_vertices
+			, max(3u, u32(f32(num_indices/3) * lod.ratio) * 3)
+			, lod.max_error < FLT_MAX ? lod.max_error * radius : FLT_MAX
+			);
+
+		if (optimize)
+			optimize_triangles(lod_indices, src_vertex_buffer, stride);
+
+		// Keep the vertices in order of first use.
+		extract_buffers(vertex_buffer
+			, index_buffer
+			, src_vertex_buffer
+			, stride
+			, array::begin(lod_indices)
+			, array::size(lod_indices)
+			);
+	}
+
 	s32 write(Mesh &m, CompileOptions &opts)
 	{
 		TempAllocator4096 ta;
 		bool calculate_tangents = true;
+		bool compact = false;
+		bool split = false;
+		const bool optimize = opts._data_compiler._options->_optimize_meshes;
+		Array<LodSettings> lods(default_allocator());
 		DynamicString importer_settings(ta);
 		importer_settings.set(opts.source_path(), u32(strrchr(opts.source_path(), '.') - opts.source_path()));
 		importer_settings += ".importer_settings";
@@ -488,9 +887,29 @@ namespace mesh
 			calculate_tangents = tangents == "calculate";
 		}
 
-		opts.write(RESOURCE_HEADER(RESOURCE_VERSION_MESH));
-		opts.write(hash_map::size(m._geometries));
+		if (json_object::has(settings, "vertex_format")) {
+			DynamicString vertex_format(ta);
+			RETURN_IF_ERROR(sjson::parse_string(vertex_format, settings["vertex_format"]));
+			RETURN_IF_FALSE(MESH, vertex_format == "full" || vertex_format == "compact"
+				, opts
+				, "Unknown vertex format: '%s'"
+				, vertex_format.c_str()
+				);
+			compact = vertex_format == "compact";
+		}
+
+		if (json_object::has(settings, "split_geometries")) {
+			split = RETURN_IF_ERROR(sjson::parse_bool(settings["split_geometries"]));
+		}
 
+		if (json_object::has(settings, "lods")) {
+			s32 err = parse_lods(lods, settings["lods"], opts);
+			ENSURE_OR_RETURN(MESH, err == 0, opts);
+		}
+
+		// Generate and optimize the buffers of all geometries first: splitting
+		// changes the number of geometries to write.
+		u32 num_geometries = 0;
 		auto cur = hash_map::begin(m._geometries);
 		auto end = hash_map::end(m._geometries);
 		for (; cur != end; ++cur) {
@@ -498,31 +917,151 @@ namespace mesh
 
 			Vector<DynamicString> geo_names(default_allocator());
 			geometry_names(geo_names, m, cur->first);
-			u32 num_geo_names = vector::size(geo_names);
-
-			opts.write(num_geo_names);
-			for (u32 i = 0; i < num_geo_names; ++i)
-				opts.write(geo_names[i].to_string_id()._id);
 
 			Geometry *geo = (Geometry *)&cur->second;
 			if (calculate_tangents)
 				generate_tangent_space(*geo);
-			ENSURE_OR_RETURN(MESH, mesh::generate_vertex_and_index_buffers(*geo, opts) == 0, opts);
+			mesh::generate_vertex_and_index_buffers(*geo);
+
+			const u32 stride = mesh::vertex_stride(*geo);
+
+			if (compact) {
+				for (u32 i = 0; i < array::size(geo->_bones); ++i) {
+					RETURN_IF_FALSE(MESH, geo->_bones[i] <= 255.0f
+						, opts
+						, "Compact vertex format supports up to 256 bones"
+						);
+				}
+			}
+
+			if (optimize) {
+				f32 acmr_before;
+				f32 acmr_after;
+				optimize_buffers(acmr_before, acmr_after, *geo, stride);
+
+				logi(MESH, "%s: ACMR %.3f -> %.3f"
+					, vector::size(geo_names) != 0 ? geo_names[0].c_str() : cur->first.c_str()
+					, acmr_before
+					, acmr_after
+					);
+			}
+
+			Array<u32> parts(default_allocator());
+			split_triangles(parts
+				, geo->_index_buffer
+				, array::size(geo->_vertex_buffer) / stride
+				, split ? MAX_PART_VERTICES : UINT32_MAX
+				);
+			num_geometries += array::size(parts) * (1 + array::size(lods));
+		}
+
+		opts.write(RESOURCE_HEADER(RESOURCE_VERSION_MESH));
+		opts.write(num_geometries);
+
+		cur = hash_map::begin(m._geometries);
+		for (; cur != end; ++cur) {
+			HASH_MAP_SKIP_HOLE(m._geometries, cur);
+
+			Vector<DynamicString> geo_names(default_allocator());
+			geometry_names(geo_names, m, cur->first);
 
-			bgfx::VertexLayout layout = mesh::vertex_layout(*geo);
-			u32 stride = mesh::vertex_stride(*geo);
+			Geometry *geo = (Geometry *)&cur->second;
+			const u32 stride = mesh::vertex_stride(*geo);
+			const OBB geo_obb = mesh::obb(*geo);
+			const Sphere geo_sphere = mesh::sphere(*geo);
+
+			// Write each part past the first as a separate geometry named <node>_part<N>.
+			Array<u32> parts(default_allocator());
+			split_triangles(parts
+				, geo->_index_buffer
+				, array::size(geo->_vertex_buffer) / stride
+				, split ? MAX_PART_VERTICES : UINT32_MAX
+				);
 
-			BgfxWriter writer(opts._binary_writer);
-			bgfx::write(&writer, layout);
-			opts.write(mesh::obb(*geo));
-			opts.write(mesh::sphere(*geo));
+			for (u32 p = 0; p < array::size(parts); ++p) {
+				Array<char> part_vertex_buffer(default_allocator());
+				Array<u32> part_index_buffer(default_allocator());
+				const Array<char> *vb = &geo->_vertex_buffer;
+				const Array<u32> *ib = &geo->_index_buffer;
+				OBB part_obb = geo_obb;
+				Sphere part_sphere = geo_sphere;
+				char part_suffix[16] = "";
+
+				if (array::size(parts) > 1) {
+					const u32 first = parts[p];
+					const u32 last = p + 1 < array::size(parts) ? parts[p + 1] : array::size(geo->_index_buffer) / 3;
+					extract_buffers(part_vertex_buffer
+						, part_index_buffer
+						, geo->_vertex_buffer
+						, stride
+						, &geo->_index_buffer[first*3]
+						, (last - first)*3
+						);
+					vb = &part_vertex_buffer;
+					ib = &part_index_buffer;
+					part_obb = mesh::obb(part_vertex_buffer, stride);
+					part_sphere = mesh::sphere(part_vertex_buffer, stride);
+
+					if (p != 0)
+						stbsp_snprintf(part_suffix, sizeof(part_suffix), "_part%u", p);
+
+					logi(MESH, "%s%s: %u vertices, %u triangles"
+						, vector::size(geo_names) != 0 ? geo_names[0].c_str() : cur->first.c_str()
+						, part_suffix
+						, array::size(part_vertex_buffer) / stride
+						, array::size(part_index_buffer) / 3
+						);
+				}
 
-			opts.write(array::size(geo->_vertex_buffer) / stride);
-			opts.write(stride);
-			opts.write(array::size(geo->_index_buffer));
+				write_geometry(opts
+					, geo_names
+					, part_suffix
+					, *geo
+					, compact
+					, part_obb
+					, part_sphere
+					, 0.0f
+					, 1.0f
+					, *vb
+					, *ib
+					);
 
-			opts.write(geo->_vertex_buffer);
-			opts.write(array::begin(geo->_index_buffer), array::size(geo->_index_buffer) * sizeof(u16));
+				// Write each level of detail as a separate geometry named <node>_lod<N>.
+				for (u32 i = 0; i < array::size(lods); ++i) {
+					Array<char> vertex_buffer(default_allocator());
+					Array<u32> index_buffer(default_allocator());
+					f32 error;
+					generate_lod(vertex_buffer, index_buffer, error, *vb, *ib, stride, lods[i], part_sphere.r, optimize);
+
+					const f32 radius = max(part_sphere.r, FLT_EPSILON);
+					const u32 num_triangles = array::size(*ib) / 3;
+					const f32 ratio = num_triangles != 0 ? f32(array::size(index_buffer) / 3) / f32(num_triangles) : 1.0f;
+
+					char suffix[32];
+					stbsp_snprintf(suffix, sizeof(suffix), "%s_lod%u", part_suffix, i + 1);
+
+					logi(MESH, "%s%s: %u -> %u triangles (error %.4f)"
+						, vector::size(geo_names) != 0 ? geo_names[0].c_str() : cur->first.c_str()
+						, suffix
+						, num_triangles
+						, array::size(index_buffer) / 3
+						, error / radius
+						);
+
+					write_geometry(opts
+						, geo_names
+						, suffix
+						, *geo
+						, compact
+						, part_obb
+						, part_sphere
+						, error / radius
+						, ratio
+						, vertex_buffer
+						, index_buffer
+						);
+				}
+			}
 		}
 
 		return 0;
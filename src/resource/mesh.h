@@ -51,7 +51,7 @@ struct Geometry
 	Array<u32> _uv_indices;
 
 	Array<char> _vertex_buffer;
-	Array<u16> _index_buffer;
+	Array<u32> _index_buffer;
 
 	///
 	explicit Geometry(Allocator &a);
@@ -94,6 +94,66 @@ namespace mesh
 	///
 	s32 write(Mesh &m, CompileOptions &opts);
 
+	/// Simplifies the triangle list @a indices of @a num_vertices vertices, whose
+	/// positions are 3 floats every @a stride bytes from @a positions, to at most
+	/// @a target_num_indices indices, stopping earlier if the error would exceed
+	/// @a max_error. Edges are collapsed in order of quadric error. Vertices on
+	/// open borders and on attribute seams (vertices sharing a position) never
+	/// move. Stores the simplified indices in @a out and the error, as a distance,
+	/// in @a error.
+	void simplify(Array<u32> &out
+		, f32 &error
+		, const u32 *indices
+		, u32 num_indices
+		, const f32 *positions
+		, u32 stride
+		, u32 num_vertices
+		, u32 target_num_indices
+		, f32 max_error
+		);
+
+	/// Returns the average number of vertex shader invocations per triangle
+	/// (ACMR) of the triangle list @a indices with a FIFO post-transform
+	/// cache of @a cache_size entries.
+	f32 acmr(const u32 *indices, u32 num_indices, u32 num_vertices, u32 cache_size);
+
+	/// Reorders the triangle list @a indices into @a out to improve reuse of a
+	/// post-transform cache of @a cache_size entries (Tipsify, Sander et al.
+	/// 2007). Stores in @a clusters the first triangle of each run of triangles
+	/// that starts with a flushed cache.
+	void optimize_vertex_cache(u32 *out
+		, Array<u32> &clusters
+		, const u32 *indices
+		, u32 num_indices
+		, u32 num_vertices
+		, u32 cache_size
+		);
+
+	/// Splits the @a clusters from optimize_vertex_cache() further where the
+	/// ACMR stays below @a threshold times the ACMR of @a indices, then sorts
+	/// them into @a out so that the outermost clusters are drawn first.
+	void optimize_overdraw(u32 *out
+		, const u32 *indices
+		, u32 num_indices
+		, const Array<u32> &clusters
+		, const f32 *positions
+		, u32 stride
+		, u32 num_vertices
+		, u32 cache_size
+		, f32 threshold
+		);
+
+	/// Copies the @a vertices to @a vertices_out in the order they are first
+	/// referenced by @a indices and remaps @a indices accordingly. Returns the
+	/// number of vertices referenced.
+	u32 optimize_vertex_fetch(void *vertices_out
+		, u32 *indices
+		, u32 num_indices
+		, const void *vertices
+		, u32 num_vertices
+		, u32 stride
+		);
+
 } // namespace mesh
 
 struct MeshCache
@@ -0,0 +1,370 @@
+/*
+ * Copyright (c) 2012-2026 Daniele Bartolini et al.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "config.h"
+#include "core/containers/array.inl"
+#include "core/math/constants.h"
+#include "core/math/intersection.h"
+#include "core/math/matrix4x4.inl"
+#include "core/math/vector3.inl"
+#include "core/memory/globals.h"
+#include "resource/mesh_resource.h"
+#include <float.h> // FLT_MAX
+#include <math.h>  // floorf, ceilf
+
+#define BVH_MAX_LEAF_TRIANGLES 4 // Must fit in the 3 low bits of MeshBvhNode::data.
+#define BVH_MAX_SAH_DEPTH 64     // Nodes deeper than this are split at the median.
+#define BVH_MAX_DEPTH 128        // Stack size of the traversal.
+#define BVH_NUM_BINS 16          // Number of candidate splits per node.
+
+namespace crown
+{
+namespace mesh_geometry
+{
+	// Returns whether the ray (@a from, 1 / @a inv_dir) hits the bounds of
+	// @a node between 0 and @a tmax and, if so, the entry distance in @a tnear.
+	static bool ray_node(f32 &tnear
+		, const BvhData &bvh
+		, const MeshBvhNode &node
+		, const Vector3 &from
+		, const Vector3 &inv_dir
+		, f32 tmax
+		)
+	{
+		const f32 x0 = (bvh.min.x + f32(node.min[0])*bvh.scale.x - from.x) * inv_dir.x;
+		const f32 y0 = (bvh.min.y + f32(node.min[1])*bvh.scale.y - from.y) * inv_dir.y;
+		const f32 z0 = (bvh.min.z + f32(node.min[2])*bvh.scale.z - from.z) * inv_dir.z;
+		const f32 x1 = (bvh.min.x + f32(node.max[0])*bvh.scale.x - from.x) * inv_dir.x;
+		const f32 y1 = (bvh.min.y + f32(node.max[1])*bvh.scale.y - from.y) * inv_dir.y;
+		const f32 z1 = (bvh.min.z + f32(node.max[2])*bvh.scale.z - from.z) * inv_dir.z;
+
+		const f32 t0 = max(max(min(x0, x1), min(y0, y1)), max(min(z0, z1), 0.0f));
+		const f32 t1 = min(min(max(x0, x1), max(y0, y1)), min(max(z0, z1), tmax));
+		tnear = t0;
+		return t0 <= t1;
+	}
+
+	static u32 index(const IndexData &indices, u32 i)
+	{
+		return indices.stride == sizeof(u32)
+			? ((const u32 *)indices.data)[i]
+			: ((const u16 *)indices.data)[i]
+			;
+	}
+
+	f32 cast_ray(const MeshGeometry &mg, const Matrix4x4 &tm, const Vector3 &from, const Vector3 &dir)
+	{
+		const BvhData &bvh = mg.bvh;
+		if (bvh.num_nodes == 0)
+			return -1.0f;
+
+		// Cast in object space: affine transforms preserve the ray parameter.
+		const Matrix4x4 inv = get_inverted(tm);
+		const Vector3 o = from * inv;
+		Vector3 d;
+		d.x = dir.x*inv.x.x + dir.y*inv.y.x + dir.z*inv.z.x;
+		d.y = dir.x*inv.x.y + dir.y*inv.y.y + dir.z*inv.z.y;
+		d.z = dir.x*inv.x.z + dir.y*inv.y.z + dir.z*inv.z.z;
+
+		Vector3 inv_d;
+		inv_d.x = d.x != 0.0f ? 1.0f / d.x : FLT_MAX;
+		inv_d.y = d.y != 0.0f ? 1.0f / d.y : FLT_MAX;
+		inv_d.z = d.z != 0.0f ? 1.0f / d.z : FLT_MAX;
+
+		struct StackEntry
+		{
+			u32 node;
+			f32 tnear;
+		};
+		StackEntry stack[BVH_MAX_DEPTH];
+		u32 num = 0;
+
+		f32 tmin = FLT_MAX;
+		f32 tnear;
+		if (!ray_node(tnear, bvh, bvh.nodes[0], o, inv_d, tmin))
+			return -1.0f;
+		stack[num++] = { 0u, tnear };
+
+		while (num != 0) {
+			const StackEntry e = stack[--num];
+			if (e.tnear > tmin)
+				continue;
+
+			const MeshBvhNode &node = bvh.nodes[e.node];
+			const u32 num_triangles = node.data & 7;
+
+			if (num_triangles != 0) {
+				const u32 first = node.data >> 3;
+				for (u32 i = first; i < first + num_triangles; ++i) {
+					const u32 tri = bvh.triangles[i];
+					const Vector3 &v0 = *(const Vector3 *)(mg.positions.data + index(mg.indices, tri*3 + 0)*mg.positions.stride);
+					const Vector3 &v1 = *(const Vector3 *)(mg.positions.data + index(mg.indices, tri*3 + 1)*mg.positions.stride);
+					const Vector3 &v2 = *(const Vector3 *)(mg.positions.data + index(mg.indices, tri*3 + 2)*mg.positions.stride);
+
+					const f32 t = ray_triangle_intersection(o, d, v0, v1, v2);
+					if (t > 0.0f)
+						tmin = min(t, tmin);
+				}
+				continue;
+			}
+
+			// Visit the nearest child first.
+			const u32 left = e.node + 1;
+			const u32 right = node.data >> 3;
+			f32 tleft;
+			f32 tright;
+			const bool hit_left = ray_node(tleft, bvh, bvh.nodes[left], o, inv_d, tmin);
+			const bool hit_right = ray_node(tright, bvh, bvh.nodes[right], o, inv_d, tmin);
+
+			if (hit_left && hit_right) {
+				CE_ENSURE(num + 2 <= BVH_MAX_DEPTH);
+				if (tleft <= tright) {
+					stack[num++] = { right, tright };
+					stack[num++] = { left, tleft };
+				} else {
+					stack[num++] = { left, tleft };
+					stack[num++] = { right, tright };
+				}
+			} else if (hit_left) {
+				stack[num++] = { left, tleft };
+			} else if (hit_right) {
+				stack[num++] = { right, tright };
+			}
+		}
+
+		return tmin < FLT_MAX ? tmin : -1.0f;
+	}
+
+} // namespace mesh_geometry
+
+#if CROWN_CAN_COMPILE
+namespace mesh
+{
+	struct BvhBuilder
+	{
+		Array<MeshBvhNode> *nodes;
+		Array<u32> *triangles;
+		Array<AABB> bounds;
+		Array<Vector3> centroids;
+		Vector3 min;
+		Vector3 scale;
+
+		explicit BvhBuilder(Allocator &a)
+			: nodes(NULL)
+			, triangles(NULL)
+			, bounds(a)
+			, centroids(a)
+		{
+		}
+	};
+
+	static f32 half_area(const AABB &b)
+	{
+		const Vector3 e = b.max - b.min;
+		return e.x*e.y + e.y*e.z + e.z*e.x;
+	}
+
+	static void grow(AABB &b, const AABB &other)
+	{
+		b.min = min(b.min, other.min);
+		b.max = max(b.max, other.max);
+	}
+
+	// Quantizes @a bounds so that the decoded bounds contain them.
+	static void quantize(MeshBvhNode &node, const BvhBuilder &b, const AABB &bounds)
+	{
+		const f32 *mmin = to_float_ptr(b.min);
+		const f32 *scale = to_float_ptr(b.scale);
+		const f32 *bmin = to_float_ptr(bounds.min);
+		const f32 *bmax = to_float_ptr(bounds.max);
+
+		for (u32 i = 0; i < 3; ++i) {
+			if (scale[i] == 0.0f) {
+				node.min[i] = 0;
+				node.max[i] = 0;
+				continue;
+			}
+
+			s32 qmin = clamp(s32(floorf((bmin[i] - mmin[i]) / scale[i])), 0, 65535);
+			s32 qmax = clamp(s32(ceilf((bmax[i] - mmin[i]) / scale[i])), 0, 65535);
+			while (qmin > 0 && mmin[i] + f32(qmin)*scale[i] > bmin[i])
+				--qmin;
+			while (qmax < 65535 && mmin[i] + f32(qmax)*scale[i] < bmax[i])
+				++qmax;
+
+			node.min[i] = u16(qmin);
+			node.max[i] = u16(qmax);
+		}
+	}
+
+	// Builds the subtree over the @a num triangles from @a first and returns
+	// the index of its root.
+	static u32 build_node(BvhBuilder &b, u32 first, u32 num, u32 depth)
+	{
+		Array<u32> &triangles = *b.triangles;
+
+		AABB bounds = b.bounds[triangles[first]];
+		AABB centroid_bounds = { b.centroids[triangles[first]], b.centroids[triangles[first]] };
+		for (u32 i = first + 1; i < first + num; ++i) {
+			grow(bounds, b.bounds[triangles[i]]);
+			centroid_bounds.min = min(centroid_bounds.min, b.centroids[triangles[i]]);
+			centroid_bounds.max = max(centroid_bounds.max, b.centroids[triangles[i]]);
+		}
+
+		const u32 node = array::size(*b.nodes);
+		MeshBvhNode n;
+		quantize(n, b, bounds);
+		n.data = (first << 3) | num;
+		array::push_back(*b.nodes, n);
+
+		if (num <= BVH_MAX_LEAF_TRIANGLES)
+			return node;
+
+		// Split along the longest axis of the centroids.
+		const Vector3 extent = centroid_bounds.max - centroid_bounds.min;
+		const u32 axis = extent.x > extent.y
+			? (extent.x > extent.z ? 0 : 2)
+			: (extent.y > extent.z ? 1 : 2)
+			;
+		const f32 axis_min = to_float_ptr(centroid_bounds.min)[axis];
+		const f32 axis_extent = to_float_ptr(extent)[axis];
+
+		u32 mid = first + num/2;
+
+		if (axis_extent > 0.0f && depth < BVH_MAX_SAH_DEPTH) {
+			// Binned surface area heuristic.
+			u32 bin_count[BVH_NUM_BINS] = { 0 };
+			AABB bin_bounds[BVH_NUM_BINS];
+			const f32 k = f32(BVH_NUM_BINS) / axis_extent;
+
+			for (u32 i = first; i < first + num; ++i) {
+				const u32 t = triangles[i];
+				const u32 bin = min(u32((to_float_ptr(b.centroids[t])[axis] - axis_min) * k), u32(BVH_NUM_BINS - 1));
+				if (bin_count[bin]++ == 0)
+					bin_bounds[bin] = b.bounds[t];
+				else
+					grow(bin_bounds[bin], b.bounds[t]);
+			}
+
+			// Area of the triangles right of each split.
+			f32 right_area[BVH_NUM_BINS];
+			u32 right_count[BVH_NUM_BINS];
+			AABB acc = bin_bounds[BVH_NUM_BINS - 1];
+			u32 count = 0;
+			for (u32 i = BVH_NUM_BINS - 1; i > 0; --i) {
+				if (bin_count[i] != 0) {
+					if (count == 0)
+						acc = bin_bounds[i];
+					else
+						grow(acc, bin_bounds[i]);
+				}
+				count += bin_count[i];
+				right_count[i] = count;
+				right_area[i] = count != 0 ? half_area(acc) : 0.0f;
+			}
+
+			u32 best_split = 0;
+			f32 best_cost = FLT_MAX;
+			count = 0;
+			for (u32 i = 0; i < BVH_NUM_BINS - 1; ++i) {
+				if (bin_count[i] != 0) {
+					if (count == 0)
+						acc = bin_bounds[i];
+					else
+						grow(acc, bin_bounds[i]);
+				}
+				count += bin_count[i];
+
+				if (count == 0 || right_count[i + 1] == 0)
+					continue;
+
+				const f32 cost = f32(count)*half_area(acc) + f32(right_count[i + 1])*right_area[i + 1];
+				if (cost < best_cost) {
+					best_cost = cost;
+					best_split = i;
+				}
+			}
+
+			if (best_cost < FLT_MAX) {
+				u32 l = first;
+				u32 r = first + num;
+				while (l < r) {
+					const u32 t = triangles[l];
+					const u32 bin = min(u32((to_float_ptr(b.centroids[t])[axis] - axis_min) * k), u32(BVH_NUM_BINS - 1));
+					if (bin <= best_split) {
+						++l;
+					} else {
+						--r;
+						exchange(triangles[l], triangles[r]);
+					}
+				}
+				mid = l;
+			}
+		}
+
+		build_node(b, first, mid - first, depth + 1);
+		const u32 right = build_node(b, mid, first + num - mid, depth + 1);
+		(*b.nodes)[node].data = right << 3;
+		return node;
+	}
+
+	void build_bvh(Array<MeshBvhNode> &nodes
+		, Array<u32> &triangles
+		, Vector3 &offset
+		, Vector3 &scale
+		, const u32 *indices
+		, u32 num_indices
+		, const f32 *positions
+		, u32 stride
+		, f32 margin
+		)
+	{
+		const u32 num_triangles = num_indices / 3;
+
+		array::clear(nodes);
+		array::resize(triangles, num_triangles);
+		offset = VECTOR3_ZERO;
+		scale = VECTOR3_ZERO;
+		if (num_triangles == 0)
+			return;
+
+		BvhBuilder b(default_allocator());
+		b.nodes = &nodes;
+		b.triangles = &triangles;
+		array::resize(b.bounds, num_triangles);
+		array::resize(b.centroids, num_triangles);
+
+		const Vector3 grow_by = { margin, margin, margin };
+		AABB mesh_bounds;
+		for (u32 t = 0; t < num_triangles; ++t) {
+			const Vector3 &p0 = *(const Vector3 *)((const char *)positions + indices[t*3 + 0]*stride);
+			const Vector3 &p1 = *(const Vector3 *)((const char *)positions + indices[t*3 + 1]*stride);
+			const Vector3 &p2 = *(const Vector3 *)((const char *)positions + indices[t*3 + 2]*stride);
+
+			AABB &tb = b.bounds[t];
+			tb.min = min(min(p0, p1), p2) - grow_by;
+			tb.max = max(max(p0, p1), p2) + grow_by;
+			b.centroids[t] = (tb.min + tb.max) * 0.5f;
+			triangles[t] = t;
+
+			if (t == 0)
+				mesh_bounds = tb;
+			else
+				grow(mesh_bounds, tb);
+		}
+
+		b.min = mesh_bounds.min;
+		b.scale = (mesh_bounds.max - mesh_bounds.min) * (1.0f / 65535.0f);
+		array::reserve(nodes, 2*num_triangles / BVH_MAX_LEAF_TRIANGLES + 1);
+		build_node(b, 0, num_triangles, 0);
+
+		offset = b.min;
+		scale = b.scale;
+	}
+
+} // namespace mesh
+#endif // if CROWN_CAN_COMPILE
+
+} // namespace crown
@@ -0,0 +1,327 @@
+/*
+ * Copyright (c) 2012-2026 Daniele Bartolini et al.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "config.h"
+
+#if CROWN_CAN_COMPILE
+#   include "core/containers/array.inl"
+#   include "core/math/constants.h"
+#   include "core/math/vector3.inl"
+#   include "core/memory/globals.h"
+#   include "resource/mesh.h"
+#   include <algorithm> // std::stable_sort
+#   include <string.h>  // memcpy
+
+namespace crown
+{
+namespace mesh
+{
+	f32 acmr(const u32 *indices, u32 num_indices, u32 num_vertices, u32 cache_size)
+	{
+		if (num_indices < 3)
+			return 0.0f;
+
+		// A vertex is in the FIFO cache if it entered it less than cache_size misses ago.
+		Array<u32> timestamp(default_allocator());
+		array::resize(timestamp, num_vertices);
+		memset(array::begin(timestamp), 0, num_vertices*sizeof(u32));
+
+		u32 misses = 0;
+		for (u32 i = 0; i < num_indices; ++i) {
+			const u32 v = indices[i];
+			if (timestamp[v] == 0 || misses - timestamp[v] >= cache_size) {
+				++misses;
+				timestamp[v] = misses;
+			}
+		}
+
+		return f32(misses) / f32(num_indices / 3);
+	}
+
+	// Returns the next vertex to fan around, or UINT32_MAX when all the
+	// triangles have been emitted. Sets @a flushed if the vertex is not in the
+	// cache anymore.
+	static u32 tipsify_next_vertex(bool &flushed
+		, u32 &cursor
+		, Array<u32> &dead_end
+		, const Array<u32> &candidates
+		, const Array<u32> &live
+		, const Array<u32> &cache_time
+		, u32 time
+		, u32 cache_size
+		)
+	{
+		u32 best = UINT32_MAX;
+		s32 best_priority = -1;
+
+		// Prefer the candidate that will still be in the cache after all of its
+		// triangles have been emitted, and that entered the cache first.
+		for (u32 i = 0; i < array::size(candidates); ++i) {
+			const u32 v = candidates[i];
+			if (live[v] == 0)
+				continue;
+
+			s32 priority = 0;
+			if (time - cache_time[v] + 2*live[v] <= cache_size)
+				priority = s32(time - cache_time[v]);
+
+			if (priority > best_priority) {
+				best_priority = priority;
+				best = v;
+			}
+		}
+
+		if (best != UINT32_MAX)
+			return best;
+
+		// Dead end: go back to a recently used vertex.
+		while (array::size(dead_end) != 0) {
+			const u32 v = array::back(dead_end);
+			array::pop_back(dead_end);
+
+			if (live[v] != 0)
+				return v;
+		}
+
+		// Nothing left in the neighbourhood: jump to the next unprocessed vertex.
+		flushed = true;
+		for (; cursor < array::size(live); ++cursor) {
+			if (live[cursor] != 0)
+				return cursor;
+		}
+
+		return UINT32_MAX;
+	}
+
+	void optimize_vertex_cache(u32 *out
+		, Array<u32> &clusters
+		, const u32 *indices
+		, u32 num_indices
+		, u32 num_vertices
+		, u32 cache_size
+		)
+	{
+		Allocator &a = default_allocator();
+		const u32 num_triangles = num_indices / 3;
+
+		array::clear(clusters);
+		if (num_triangles == 0)
+			return;
+
+		// Triangles around each vertex.
+		Array<u32> live(a);
+		Array<u32> adjacency_offset(a);
+		Array<u32> adjacency(a);
+		array::resize(live, num_vertices);
+		array::resize(adjacency_offset, num_vertices + 1);
+		array::resize(adjacency, num_indices);
+		memset(array::begin(live), 0, num_vertices*sizeof(u32));
+
+		for (u32 i = 0; i < num_indices; ++i)
+			++live[indices[i]];
+
+		adjacency_offset[0] = 0;
+		for (u32 i = 0; i < num_vertices; ++i)
+			adjacency_offset[i + 1] = adjacency_offset[i] + live[i];
+
+		Array<u32> fill(a);
+		array::resize(fill, num_vertices);
+		memcpy(array::begin(fill), array::begin(adjacency_offset), num_vertices*sizeof(u32));
+		for (u32 i = 0; i < num_indices; ++i)
+			adjacency[fill[indices[i]]++] = i / 3;
+
+		Array<u32> cache_time(a);
+		Array<u8> emitted(a);
+		Array<u32> dead_end(a);
+		Array<u32> candidates(a);
+		array::resize(cache_time, num_vertices);
+		array::resize(emitted, num_triangles);
+		memset(array::begin(cache_time), 0, num_vertices*sizeof(u32));
+		memset(array::begin(emitted), 0, num_triangles);
+		array::reserve(dead_end, num_indices);
+
+		u32 time = cache_size + 1;
+		u32 cursor = 0;
+		u32 num_emitted = 0;
+		bool flushed = true;
+		u32 fan = 0;
+		while (live[fan] == 0)
+			++fan;
+
+		while (fan != UINT32_MAX) {
+			if (flushed)
+				array::push_back(clusters, num_emitted);
+
+			array::clear(candidates);
+
+			for (u32 i = adjacency_offset[fan]; i < adjacency_offset[fan + 1]; ++i) {
+				const u32 t = adjacency[i];
+				if (emitted[t])
+					continue;
+
+				for (u32 k = 0; k < 3; ++k) {
+					const u32 v = indices[t*3 + k];
+					array::push_back(dead_end, v);
+					array::push_back(candidates, v);
+					--live[v];
+
+					if (time - cache_time[v] > cache_size)
+						cache_time[v] = time++;
+				}
+
+				emitted[t] = 1;
+				out[num_emitted*3 + 0] = indices[t*3 + 0];
+				out[num_emitted*3 + 1] = indices[t*3 + 1];
+				out[num_emitted*3 + 2] = indices[t*3 + 2];
+				++num_emitted;
+			}
+
+			flushed = false;
+			fan = tipsify_next_vertex(flushed, cursor, dead_end, candidates, live, cache_time, time, cache_size);
+		}
+
+		CE_ENSURE(num_emitted == num_triangles);
+	}
+
+	struct Cluster
+	{
+		u32 first;
+		u32 num;
+		Vector3 centroid;
+		Vector3 normal;
+		f32 sort_key;
+	};
+
+	void optimize_overdraw(u32 *out
+		, const u32 *indices
+		, u32 num_indices
+		, const Array<u32> &hard_clusters
+		, const f32 *positions
+		, u32 stride
+		, u32 num_vertices
+		, u32 cache_size
+		, f32 threshold
+		)
+	{
+		Allocator &a = default_allocator();
+		const u32 num_triangles = num_indices / 3;
+		const f32 target_acmr = acmr(indices, num_indices, num_vertices, cache_size) * threshold;
+
+		// Split the hard clusters wherever the cache would not mind restarting
+		// from empty, so that there are more pieces to sort.
+		Array<Cluster> clusters(a);
+		Array<u32> timestamp(a);
+		array::resize(timestamp, num_vertices);
+		memset(array::begin(timestamp), 0, num_vertices*sizeof(u32));
+
+		// Vertices that entered the cache before the current cluster started
+		// count as misses, as if the cache had been flushed.
+		u32 misses = 0;
+
+		for (u32 c = 0; c < array::size(hard_clusters); ++c) {
+			const u32 end = c + 1 < array::size(hard_clusters) ? hard_clusters[c + 1] : num_triangles;
+			u32 first = hard_clusters[c];
+			u32 cluster_misses = misses;
+
+			for (u32 t = hard_clusters[c]; t < end; ++t) {
+				for (u32 k = 0; k < 3; ++k) {
+					const u32 v = indices[t*3 + k];
+					if (timestamp[v] <= cluster_misses || misses - timestamp[v] >= cache_size) {
+						++misses;
+						timestamp[v] = misses;
+					}
+				}
+
+				if (t + 1 < end && f32(misses - cluster_misses) / f32(t + 1 - first) <= target_acmr) {
+					array::push_back(clusters, { first, t + 1 - first, VECTOR3_ZERO, VECTOR3_ZERO, 0.0f });
+					first = t + 1;
+					cluster_misses = misses;
+				}
+			}
+
+			array::push_back(clusters, { first, end - first, VECTOR3_ZERO, VECTOR3_ZERO, 0.0f });
+		}
+
+		// Draw first the clusters facing away from the centre of the mesh: they
+		// are the most likely to occlude the others from any point of view.
+		Vector3 mesh_centroid = VECTOR3_ZERO;
+		f32 mesh_area = 0.0f;
+
+		for (u32 c = 0; c < array::size(clusters); ++c) {
+			Cluster &cluster = clusters[c];
+			f32 area = 0.0f;
+
+			for (u32 t = cluster.first; t < cluster.first + cluster.num; ++t) {
+				const Vector3 p0 = *(const Vector3 *)((const char *)positions + indices[t*3 + 0]*stride);
+				const Vector3 p1 = *(const Vector3 *)((const char *)positions + indices[t*3 + 1]*stride);
+				const Vector3 p2 = *(const Vector3 *)((const char *)positions + indices[t*3 + 2]*stride);
+				const Vector3 n = cross(p1 - p0, p2 - p0);
+				const f32 w = length(n);
+
+				cluster.centroid += (p0 + p1 + p2) * (w / 3.0f);
+				cluster.normal += n;
+				area += w;
+			}
+
+			mesh_centroid += cluster.centroid;
+			mesh_area += area;
+
+			if (area > 0.0f)
+				cluster.centroid *= 1.0f / area;
+		}
+
+		if (mesh_area > 0.0f)
+			mesh_centroid *= 1.0f / mesh_area;
+
+		for (u32 c = 0; c < array::size(clusters); ++c) {
+			Cluster &cluster = clusters[c];
+			const f32 len = length(cluster.normal);
+			cluster.sort_key = len > 0.0f ? dot(cluster.centroid - mesh_centroid, cluster.normal) / len : 0.0f;
+		}
+
+		std::stable_sort(array::begin(clusters), array::end(clusters), [](const Cluster &x, const Cluster &y) {
+				return x.sort_key > y.sort_key;
+			});
+
+		u32 n = 0;
+		for (u32 c = 0; c < array::size(clusters); ++c) {
+			memcpy(&out[n], &indices[clusters[c].first*3], clusters[c].num*3*sizeof(u32));
+			n += clusters[c].num*3;
+		}
+	}
+
+	u32 optimize_vertex_fetch(void *vertices_out
+		, u32 *indices
+		, u32 num_indices
+		, const void *vertices
+		, u32 num_vertices
+		, u32 stride
+		)
+	{
+		Array<u32> remap(default_allocator());
+		array::resize(remap, num_vertices);
+		for (u32 i = 0; i < num_vertices; ++i)
+			remap[i] = UINT32_MAX;
+
+		u32 n = 0;
+		for (u32 i = 0; i < num_indices; ++i) {
+			const u32 v = indices[i];
+
+			if (remap[v] == UINT32_MAX) {
+				memcpy((char *)vertices_out + n*stride, (const char *)vertices + v*stride, stride);
+				remap[v] = n++;
+			}
+
+			indices[i] = remap[v];
+		}
+
+		return n;
+	}
+
+} // namespace mesh
+
+} // namespace crown
+
+#endif // if CROWN_CAN_COMPILE
@@ -15,6 +15,7 @@
 #include "core/math/matrix4x4.inl"
 #include "core/math/vector2.inl"
 #include "core/math/vector3.inl"
+#include "core/memory/memory.inl"
 #include "core/memory/temp_allocator.inl"
 #include "core/strings/dynamic_string.inl"
 #include "core/strings/string_id.inl"
@@ -113,6 +114,12 @@ namespace mesh_resource_internal
 			Sphere sphere;
 			br.read(sphere);
 
+			f32 lod_error;
+			br.read(lod_error);
+
+			f32 lod_ratio;
+			br.read(lod_ratio);
+
 			u32 num_verts;
 			br.read(num_verts);
 
@@ -122,14 +129,39 @@ namespace mesh_resource_internal
 			u32 num_inds;
 			br.read(num_inds);
 
+			u32 index_stride;
+			br.read(index_stride);
+
+			u32 num_bvh_nodes;
+			br.read(num_bvh_nodes);
+
+			Vector3 bvh_min;
+			br.read(bvh_min);
+
+			Vector3 bvh_scale;
+			br.read(bvh_scale);
+
+			// Compact geometries store positions as 16-bit integers normalized
+			// to the OBB. Keep a decoded copy of them for CPU queries.
+			u8 num_components;
+			bgfx::AttribType::Enum position_type;
+			bool normalized;
+			bool as_int;
+			layout.decode(bgfx::Attrib::Position, num_components, position_type, normalized, as_int);
+			const bool compact = position_type == bgfx::AttribType::Int16;
+
 			const u32 vsize = num_verts*stride;
-			const u32 isize = num_inds*sizeof(u16);
+			const u32 isize = num_inds*index_stride;
+			const u32 bsize = alignof(MeshBvhNode) + num_bvh_nodes*sizeof(MeshBvhNode) + num_inds/3*sizeof(u32);
+			const u32 psize = compact ? num_verts*sizeof(Vector3) + alignof(Vector3) : 0;
 
-			const u32 size = sizeof(MeshGeometry) + vsize + isize;
+			const u32 size = sizeof(MeshGeometry) + vsize + isize + bsize + psize;
 
 			MeshGeometry *mg = (MeshGeometry *)a.allocate(size, alignof(MeshGeometry));
 			mg->obb             = obb;
 			mg->sphere          = sphere;
+			mg->lod_error       = lod_error;
+			mg->lod_ratio       = lod_ratio;
 			mg->layout          = layout;
 			mg->vertex_buffer   = BGFX_INVALID_HANDLE;
 			mg->index_buffer    = BGFX_INVALID_HANDLE;
@@ -137,10 +169,41 @@ namespace mesh_resource_internal
 			mg->vertices.stride = stride;
 			mg->vertices.data   = (char *)&mg[1];
 			mg->indices.num     = num_inds;
+			mg->indices.stride  = index_stride;
 			mg->indices.data    = mg->vertices.data + vsize;
 
+			mg->bvh.num_nodes   = num_bvh_nodes;
+			mg->bvh.min         = bvh_min;
+			mg->bvh.scale       = bvh_scale;
+			mg->bvh.nodes       = (MeshBvhNode *)memory::align_top(mg->indices.data + isize, alignof(MeshBvhNode));
+			mg->bvh.triangles   = (u32 *)&mg->bvh.nodes[num_bvh_nodes];
+
 			br.read(mg->vertices.data, vsize);
 			br.read(mg->indices.data, isize);
+			br.read(mg->bvh.nodes, num_bvh_nodes*sizeof(MeshBvhNode));
+			br.read(mg->bvh.triangles, num_inds/3*sizeof(u32));
+
+			if (compact) {
+				const Vector3 offset = translation(obb.tm);
+				const Vector3 scale = obb.half_extents;
+				mg->position_decode[0] = { offset.x, offset.y, offset.z, 0.0f };
+				mg->position_decode[1] = { scale.x, scale.y, scale.z, 0.0f };
+				mg->positions.num    = num_verts;
+				mg->positions.stride = sizeof(Vector3);
+				mg->positions.data   = (char *)memory::align_top(&mg->bvh.triangles[num_inds/3], alignof(Vector3));
+
+				for (u32 v = 0; v < num_verts; ++v) {
+					const s16 *q = (const s16 *)(mg->vertices.data + v*stride);
+					Vector3 *p = (Vector3 *)mg->positions.data + v;
+					p->x = offset.x + max(q[0] / 32767.0f, -1.0f) * scale.x;
+					p->y = offset.y + max(q[1] / 32767.0f, -1.0f) * scale.y;
+					p->z = offset.z + max(q[2] / 32767.0f, -1.0f) * scale.z;
+				}
+			} else {
+				mg->position_decode[0] = { 0.0f, 0.0f, 0.0f, 0.0f };
+				mg->position_decode[1] = { 1.0f, 1.0f, 1.0f, 0.0f };
+				mg->positions = mg->vertices;
+			}
 
 			array::push_back(mr->geometries, mg);
 		}
@@ -156,13 +219,29 @@ namespace mesh_resource_internal
 			MeshGeometry &mg = *mr->geometries[i];
 
 			const u32 vsize = mg.vertices.num * mg.vertices.stride;
-			const u32 isize = mg.indices.num * sizeof(u16);
+			const u32 isize = mg.indices.num * mg.indices.stride;
+			const bool index32 = mg.indices.stride == sizeof(u32);
+			CE_ASSERT(!index32 || (bgfx::getCaps()->supported & BGFX_CAPS_INDEX32) != 0
+				, "32-bit indices are not supported, compile the mesh with split_geometries = true"
+				);
+#if CROWN_DEBUG
+			if (mg.layout.has(bgfx::Attrib::TexCoord0)) {
+				u8 num_components;
+				bgfx::AttribType::Enum type;
+				bool normalized;
+				bool as_int;
+				mg.layout.decode(bgfx::Attrib::TexCoord0, num_components, type, normalized, as_int);
+				CE_ASSERT(type != bgfx::AttribType::Half || (bgfx::getCaps()->supported & BGFX_CAPS_VERTEX_ATTRIB_HALF) != 0
+					, "Half-float vertex attributes are not supported, compile the mesh with vertex_format = \"full\""
+					);
+			}
+#endif
 
 			const bgfx::Memory *vmem = bgfx::makeRef(mg.vertices.data, vsize);
 			const bgfx::Memory *imem = bgfx::makeRef(mg.indices.data, isize);
 
 			bgfx::VertexBufferHandle vbh = bgfx::createVertexBuffer(vmem, mg.layout);
-			bgfx::IndexBufferHandle ibh  = bgfx::createIndexBuffer(imem);
+			bgfx::IndexBufferHandle ibh  = bgfx::createIndexBuffer(imem, index32 ? BGFX_BUFFER_INDEX32 : BGFX_BUFFER_NONE);
 			CE_ASSERT(bgfx::isValid(vbh), "Invalid vertex buffer");
 			CE_ASSERT(bgfx::isValid(ibh), "Invalid index buffer");
 
@@ -27,7 +27,27 @@ struct VertexData
 struct IndexData
 {
 	u32 num;
-	char *data; // size = num*sizeof(u16)
+	u32 stride; ///< sizeof(u16) or sizeof(u32).
+	char *data; // size = num*stride
+};
+
+/// Node of a bounding volume hierarchy over the triangles of a geometry.
+/// Bounds are quantized to 16 bits relative to BvhData::min and
+/// BvhData::scale. The left child of an inner node immediately follows it.
+struct MeshBvhNode
+{
+	u16 min[3];
+	u16 max[3];
+	u32 data; ///< Leaf: first triangle << 3 | number of triangles. Inner: right child << 3.
+};
+
+struct BvhData
+{
+	u32 num_nodes;
+	Vector3 min;        ///< Decoded position of quantized bound 0.
+	Vector3 scale;      ///< Size of a quantization step.
+	MeshBvhNode *nodes; // size = num_nodes*sizeof(MeshBvhNode)
+	u32 *triangles;     ///< Index of the triangles referenced by the leaves.
 };
 
 struct MeshGeometry
@@ -37,8 +57,13 @@ struct MeshGeometry
 	bgfx::IndexBufferHandle index_buffer;
 	OBB obb;
 	Sphere sphere;
+	f32 lod_error; ///< Simplification error relative to the sphere radius, 0 if authored.
+	f32 lod_ratio; ///< Fraction of the source triangles kept, 1 if authored.
+	Vector4 position_decode[2]; ///< Offset and scale that decode the vertex positions in shaders.
 	VertexData vertices;
 	IndexData indices;
+	VertexData positions; ///< Vertex positions as 3 floats, for ray casts and occlusion culling.
+	BvhData bvh;
 };
 
 struct MeshNode
@@ -59,12 +84,37 @@ struct MeshResource
 	const MeshGeometry *geometry(StringId32 name) const;
 };
 
+namespace mesh_geometry
+{
+	/// Returns the distance along the ray (@a from, @a dir) to the closest
+	/// intersection with the triangles of @a mg transformed by @a tm, or -1.0
+	/// if no intersection.
+	f32 cast_ray(const MeshGeometry &mg, const Matrix4x4 &tm, const Vector3 &from, const Vector3 &dir);
+
+} // namespace mesh_geometry
+
 #if CROWN_CAN_COMPILE
 namespace mesh
 {
 	///
 	s32 parse(Mesh &m, Buffer &buf, CompileOptions &opts);
 
+	/// Builds a BVH over the triangle list @a indices, whose vertex positions
+	/// are 3 floats every @a stride bytes from @a positions. Triangle bounds
+	/// are grown by @a margin. Stores the nodes in @a nodes, the triangles
+	/// referenced by the leaves in @a triangles and the quantization frame in
+	/// @a offset and @a scale.
+	void build_bvh(Array<MeshBvhNode> &nodes
+		, Array<u32> &triangles
+		, Vector3 &offset
+		, Vector3 &scale
+		, const u32 *indices
+		, u32 num_indices
+		, const f32 *positions
+		, u32 stride
+		, f32 margin
+		);
+
 } // namespace mesh
 #endif
 
@@ -0,0 +1,381 @@
+/*
+ * Copyright (c) 2012-2026 Daniele Bartolini et al.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "config.h"
+
+#if CROWN_CAN_COMPILE
+#   include "core/containers/array.inl"
+#   include "core/math/vector3.inl"
+#   include "core/memory/globals.h"
+#   include "resource/mesh.h"
+#   include <algorithm> // std::sort
+#   include <float.h>   // FLT_MAX
+#   include <string.h>  // memcpy
+
+namespace crown
+{
+namespace mesh
+{
+	/// Sum of the squared distances to a set of planes, weighted by the area
+	/// of the triangles the planes come from.
+	struct Quadric
+	{
+		f64 a00, a11, a22;
+		f64 a10, a20, a21;
+		f64 b0, b1, b2;
+		f64 c;
+		f64 w; ///< Sum of the weights.
+	};
+
+	struct Collapse
+	{
+		f32 cost;
+		u32 from;
+		u32 to;
+	};
+
+	static void quadric_from_triangle(Quadric &q, const Vector3 &p0, const Vector3 &p1, const Vector3 &p2)
+	{
+		memset(&q, 0, sizeof(q));
+
+		const Vector3 n = cross(p1 - p0, p2 - p0);
+		const f32 len = length(n);
+		if (len == 0.0f)
+			return;
+
+		const f64 w = 0.5*len;
+		const f64 x = n.x / len;
+		const f64 y = n.y / len;
+		const f64 z = n.z / len;
+		const f64 d = -(x*p0.x + y*p0.y + z*p0.z);
+
+		q.a00 = w*x*x;
+		q.a11 = w*y*y;
+		q.a22 = w*z*z;
+		q.a10 = w*x*y;
+		q.a20 = w*x*z;
+		q.a21 = w*y*z;
+		q.b0  = w*x*d;
+		q.b1  = w*y*d;
+		q.b2  = w*z*d;
+		q.c   = w*d*d;
+		q.w   = w;
+	}
+
+	static void quadric_add(Quadric &q, const Quadric &o)
+	{
+		q.a00 += o.a00;
+		q.a11 += o.a11;
+		q.a22 += o.a22;
+		q.a10 += o.a10;
+		q.a20 += o.a20;
+		q.a21 += o.a21;
+		q.b0  += o.b0;
+		q.b1  += o.b1;
+		q.b2  += o.b2;
+		q.c   += o.c;
+		q.w   += o.w;
+	}
+
+	// Returns the mean squared distance of @a p to the planes of @a q.
+	static f32 quadric_error(const Quadric &q, const Vector3 &p)
+	{
+		if (q.w == 0.0)
+			return 0.0f;
+
+		const f64 x = p.x;
+		const f64 y = p.y;
+		const f64 z = p.z;
+		const f64 e = q.a00*x*x + q.a11*y*y + q.a22*z*z
+			+ 2.0*(q.a10*x*y + q.a20*x*z + q.a21*y*z)
+			+ 2.0*(q.b0*x + q.b1*y + q.b2*z)
+			+ q.c
+			;
+		return f32((e < 0.0 ? -e : e) / q.w);
+	}
+
+	// Returns whether moving vertex @a from onto vertex @a to keeps the
+	// triangles around @a from facing the same way and the surface manifold.
+	static bool collapse_valid(u32 from
+		, u32 to
+		, const Array<u32> &indices
+		, const Array<u32> &adjacency_offset
+		, const Array<u32> &adjacency
+		, const Array<Vector3> &positions
+		, const Array<u32> &remap
+		)
+	{
+		u32 num_shared_triangles = 0;
+
+		for (u32 i = adjacency_offset[from]; i < adjacency_offset[from + 1]; ++i) {
+			const u32 *tri = &indices[adjacency[i]*3];
+			if (tri[0] == to || tri[1] == to || tri[2] == to) {
+				++num_shared_triangles;
+				continue;
+			}
+
+			const Vector3 p0 = positions[tri[0]];
+			const Vector3 p1 = positions[tri[1]];
+			const Vector3 p2 = positions[tri[2]];
+			const Vector3 q0 = tri[0] == from ? positions[to] : p0;
+			const Vector3 q1 = tri[1] == from ? positions[to] : p1;
+			const Vector3 q2 = tri[2] == from ? positions[to] : p2;
+
+			const Vector3 n_old = cross(p1 - p0, p2 - p0);
+			const Vector3 n_new = cross(q1 - q0, q2 - q0);
+			if (dot(n_old, n_new) <= 0.0f && length_squared(n_old) > 0.0f)
+				return false;
+		}
+
+		// The only vertices adjacent to both ends of the edge must be the
+		// opposite corners of the triangles sharing it.
+		u32 num_shared_vertices = 0;
+		for (u32 i = adjacency_offset[from]; i < adjacency_offset[from + 1]; ++i) {
+			const u32 *tri = &indices[adjacency[i]*3];
+
+			for (u32 k = 0; k < 3; ++k) {
+				const u32 v = tri[k];
+				if (v == from || v == to)
+					continue;
+
+				bool shared = false;
+				for (u32 j = adjacency_offset[to]; !shared && j < adjacency_offset[to + 1]; ++j) {
+					const u32 *tri_to = &indices[adjacency[j]*3];
+					shared = remap[tri_to[0]] == remap[v]
+						|| remap[tri_to[1]] == remap[v]
+						|| remap[tri_to[2]] == remap[v]
+						;
+				}
+
+				// Each shared vertex is seen from both triangles it belongs to around @a from.
+				num_shared_vertices += shared ? 1 : 0;
+			}
+		}
+
+		return num_shared_vertices <= 2*num_shared_triangles;
+	}
+
+	void simplify(Array<u32> &out
+		, f32 &error
+		, const u32 *indices
+		, u32 num_indices
+		, const f32 *positions
+		, u32 stride
+		, u32 num_vertices
+		, u32 target_num_indices
+		, f32 max_error
+		)
+	{
+		const u32 MAX_PASSES = 100;
+
+		array::resize(out, num_indices);
+		memcpy(array::begin(out), indices, num_indices*sizeof(u32));
+		error = 0.0f;
+
+		if (num_indices <= target_num_indices)
+			return;
+
+		Allocator &a = default_allocator();
+
+		Array<Vector3> pos(a);
+		array::resize(pos, num_vertices);
+		for (u32 i = 0; i < num_vertices; ++i)
+			memcpy(&pos[i], (const char *)positions + i*stride, sizeof(Vector3));
+
+		// Map each vertex to the first vertex with the same position.
+		Array<u32> remap(a);
+		Array<u32> order(a);
+		array::resize(remap, num_vertices);
+		array::resize(order, num_vertices);
+		for (u32 i = 0; i < num_vertices; ++i)
+			order[i] = i;
+
+		std::sort(array::begin(order), array::end(order), [&pos](u32 x, u32 y) {
+				const Vector3 &px = pos[x];
+				const Vector3 &py = pos[y];
+				if (px.x != py.x) return px.x < py.x;
+				if (px.y != py.y) return px.y < py.y;
+				if (px.z != py.z) return px.z < py.z;
+				return x < y;
+			});
+
+		// Vertices sharing a position lie on a UV or normal seam and must not move.
+		Array<u8> locked(a);
+		array::resize(locked, num_vertices);
+		memset(array::begin(locked), 0, num_vertices);
+
+		for (u32 i = 0; i < num_vertices;) {
+			u32 j = i + 1;
+			while (j < num_vertices && pos[order[j]] == pos[order[i]])
+				++j;
+
+			for (u32 k = i; k < j; ++k)
+				remap[order[k]] = order[i];
+			if (j - i > 1)
+				locked[order[i]] = 1;
+
+			i = j;
+		}
+
+		// Vertices on open borders and non-manifold edges must not move either.
+		Array<u64> edges(a);
+		array::reserve(edges, num_indices);
+		for (u32 i = 0; i < num_indices; i += 3) {
+			for (u32 k = 0; k < 3; ++k) {
+				const u64 v0 = remap[out[i + k]];
+				const u64 v1 = remap[out[i + (k + 1) % 3]];
+				array::push_back(edges, v0 < v1 ? (v0 << 32) | v1 : (v1 << 32) | v0);
+			}
+		}
+		std::sort(array::begin(edges), array::end(edges));
+
+		for (u32 i = 0; i < array::size(edges);) {
+			u32 j = i + 1;
+			while (j < array::size(edges) && edges[j] == edges[i])
+				++j;
+
+			if (j - i != 2) {
+				locked[u32(edges[i] >> 32)] = 1;
+				locked[u32(edges[i] & UINT32_MAX)] = 1;
+			}
+
+			i = j;
+		}
+
+		for (u32 i = 0; i < num_vertices; ++i)
+			locked[i] = locked[remap[i]];
+
+		Array<Quadric> quadrics(a);
+		array::resize(quadrics, num_vertices);
+		memset(array::begin(quadrics), 0, num_vertices*sizeof(Quadric));
+
+		for (u32 i = 0; i < num_indices; i += 3) {
+			Quadric q;
+			quadric_from_triangle(q, pos[out[i + 0]], pos[out[i + 1]], pos[out[i + 2]]);
+			quadric_add(quadrics[out[i + 0]], q);
+			quadric_add(quadrics[out[i + 1]], q);
+			quadric_add(quadrics[out[i + 2]], q);
+		}
+
+		Array<u32> collapse(a);
+		array::resize(collapse, num_vertices);
+		for (u32 i = 0; i < num_vertices; ++i)
+			collapse[i] = i;
+
+		Array<u32> adjacency_offset(a);
+		Array<u32> adjacency(a);
+		Array<Collapse> collapses(a);
+		Array<u8> touched(a);
+		array::resize(adjacency_offset, num_vertices + 1);
+		array::resize(touched, num_vertices);
+
+		const u32 target_num_triangles = target_num_indices / 3;
+		const f32 max_cost = max_error < FLT_MAX ? max_error*max_error : FLT_MAX;
+		f32 cost = 0.0f;
+		u32 num = num_indices;
+
+		for (u32 pass = 0; pass < MAX_PASSES && num/3 > target_num_triangles; ++pass) {
+			// Triangles around each vertex.
+			memset(array::begin(adjacency_offset), 0, (num_vertices + 1)*sizeof(u32));
+			for (u32 i = 0; i < num; ++i)
+				++adjacency_offset[out[i] + 1];
+			for (u32 i = 0; i < num_vertices; ++i)
+				adjacency_offset[i + 1] += adjacency_offset[i];
+
+			array::resize(adjacency, num);
+			for (u32 i = 0; i < num; ++i)
+				adjacency[adjacency_offset[out[i]]++] = i / 3;
+			for (u32 i = num_vertices; i > 0; --i)
+				adjacency_offset[i] = adjacency_offset[i - 1];
+			adjacency_offset[0] = 0;
+
+			// Cheapest valid collapse of each free vertex onto one of its neighbours.
+			array::clear(collapses);
+			for (u32 v = 0; v < num_vertices; ++v) {
+				if (locked[v] || adjacency_offset[v] == adjacency_offset[v + 1])
+					continue;
+
+				Collapse best = { FLT_MAX, v, UINT32_MAX };
+				for (u32 i = adjacency_offset[v]; i < adjacency_offset[v + 1]; ++i) {
+					const u32 *tri = &out[adjacency[i]*3];
+
+					for (u32 k = 0; k < 3; ++k) {
+						const u32 u = tri[k];
+						if (u == v)
+							continue;
+
+						const f32 c = quadric_error(quadrics[v], pos[u]);
+						if (c < best.cost && collapse_valid(v, u, out, adjacency_offset, adjacency, pos, remap)) {
+							best.cost = c;
+							best.to = u;
+						}
+					}
+				}
+
+				if (best.to != UINT32_MAX && best.cost <= max_cost)
+					array::push_back(collapses, best);
+			}
+
+			std::sort(array::begin(collapses), array::end(collapses), [](const Collapse &x, const Collapse &y) {
+					return x.cost != y.cost ? x.cost < y.cost : x.from < y.from;
+				});
+
+			// Apply the collapses whose neighbourhoods do not overlap, so that
+			// the costs and checks computed above are still exact.
+			memset(array::begin(touched), 0, num_vertices);
+			u32 num_removed = 0;
+
+			for (u32 i = 0; i < array::size(collapses) && num/3 - num_removed > target_num_triangles; ++i) {
+				const Collapse &c = collapses[i];
+				if (touched[c.to])
+					continue;
+
+				bool free = true;
+				for (u32 j = adjacency_offset[c.from]; free && j < adjacency_offset[c.from + 1]; ++j) {
+					const u32 *tri = &out[adjacency[j]*3];
+					free = !touched[tri[0]] && !touched[tri[1]] && !touched[tri[2]];
+				}
+				if (!free)
+					continue;
+
+				for (u32 j = adjacency_offset[c.from]; j < adjacency_offset[c.from + 1]; ++j) {
+					const u32 *tri = &out[adjacency[j]*3];
+					touched[tri[0]] = touched[tri[1]] = touched[tri[2]] = 1;
+					num_removed += (tri[0] == c.to || tri[1] == c.to || tri[2] == c.to) ? 1 : 0;
+				}
+
+				collapse[c.from] = c.to;
+				quadric_add(quadrics[c.to], quadrics[c.from]);
+				cost = max(cost, c.cost);
+			}
+
+			if (num_removed == 0)
+				break;
+
+			// Remap the triangles and drop the degenerate ones.
+			u32 n = 0;
+			for (u32 i = 0; i < num; i += 3) {
+				const u32 i0 = collapse[out[i + 0]];
+				const u32 i1 = collapse[out[i + 1]];
+				const u32 i2 = collapse[out[i + 2]];
+				if (remap[i0] == remap[i1] || remap[i1] == remap[i2] || remap[i2] == remap[i0])
+					continue;
+
+				out[n++] = i0;
+				out[n++] = i1;
+				out[n++] = i2;
+			}
+			num = n;
+		}
+
+		array::resize(out, num);
+		error = fsqrt(cost);
+	}
+
+} // namespace mesh
+
+} // namespace crown
+
+#endif // if CROWN_CAN_COMPILE
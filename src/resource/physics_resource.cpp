@@ -270,7 +270,7 @@ namespace physics_resource_internal
 		if (needs_points) {
 			cd.size += sizeof(u32) + sizeof(Vector3)*array::size(points);
 			if (cd.type == ColliderType::MESH)
-				cd.size += sizeof(u32) + sizeof(u16)*array::size(point_indices);
+				cd.size += sizeof(u32) + sizeof(u32)*array::size(point_indices);
 		}
 
 		FileBuffer fb(output);
@@ -296,7 +296,7 @@ namespace physics_resource_internal
 			if (cd.type == ColliderType::MESH) {
 				bw.write(array::size(point_indices));
 				for (u32 ii = 0; ii < array::size(point_indices); ++ii)
-					bw.write((u16)point_indices[ii]);
+					bw.write(point_indices[ii]);
 			}
 		}
 		return 0;
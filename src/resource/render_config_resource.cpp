@@ -7,6 +7,8 @@
 #include "core/containers/hash_map.inl"
 #include "core/json/json_object.inl"
 #include "core/json/sjson.h"
+#include "core/math/constants.h"
+#include "core/math/vector2.inl"
 #include "core/strings/string.inl"
 #include "core/strings/string_id.inl"
 #include "resource/compile_options.inl"
@@ -136,6 +138,18 @@ namespace render_settings
 			} else if (cur->first == "lod_fade_duration") {
 				Value v; v.type = Value::FLOAT; v.value.f = RETURN_IF_ERROR(sjson::parse_float(cur->second));
 				hash_map::set(rs, cur->first.to_string_id(), v);
+			} else if (cur->first == "shadow_caching") {
+				Value v; v.type = Value::BOOL; v.value.b = RETURN_IF_ERROR(sjson::parse_bool(cur->second));
+				hash_map::set(rs, cur->first.to_string_id(), v);
+			} else if (cur->first == "light_clustering") {
+				Value v; v.type = Value::BOOL; v.value.b = RETURN_IF_ERROR(sjson::parse_bool(cur->second));
+				hash_map::set(rs, cur->first.to_string_id(), v);
+			} else if (cur->first == "occlusion_culling") {
+				Value v; v.type = Value::BOOL; v.value.b = RETURN_IF_ERROR(sjson::parse_bool(cur->second));
+				hash_map::set(rs, cur->first.to_string_id(), v);
+			} else if (cur->first == "occlusion_buffer_size") {
+				Value v; v.type = Value::VECTOR2; v.value.v2 = RETURN_IF_ERROR(sjson::parse_vector2(cur->second));
+				hash_map::set(rs, cur->first.to_string_id(), v);
 			} else {
 				logw(RENDER_CONFIG_RESOURCE
 					, "Unknown render_settings property '%.*s'"
@@ -214,6 +228,14 @@ namespace render_settings
 				rs.local_lights_distance_culling_cutoff = v.value.f;
 			} else if (key == STRING_ID_32("lod_fade_duration", UINT32_C(0x98ff46dd))) {
 				rs.lod_fade_duration = v.value.f;
+			} else if (key == STRING_ID_32("shadow_caching", UINT32_C(0x04917824))) {
+				set_flag(rs.flags, RenderSettingsFlags::SHADOW_CACHING, v.value.b);
+			} else if (key == STRING_ID_32("light_clustering", UINT32_C(0x7ae32ad3))) {
+				set_flag(rs.flags, RenderSettingsFlags::LIGHT_CLUSTERING, v.value.b);
+			} else if (key == STRING_ID_32("occlusion_culling", UINT32_C(0xc1cb5d37))) {
+				set_flag(rs.flags, RenderSettingsFlags::OCCLUSION_CULLING, v.value.b);
+			} else if (key == STRING_ID_32("occlusion_buffer_size", UINT32_C(0xa992f59b))) {
+				rs.occlusion_buffer_size = max(v.value.v2, VECTOR2_ONE);
 			} else {
 				logw(RENDER_CONFIG_RESOURCE
 					, "Unknown render_settings property 0x%08x"
@@ -263,6 +285,8 @@ namespace render_config_resource_internal
 			| RenderSettingsFlags::LOCAL_LIGHTS
 			| RenderSettingsFlags::LOCAL_LIGHTS_SHADOWS
 			| RenderSettingsFlags::SUN_SHADOW_CONTRIBUTION_CULLING
+			| RenderSettingsFlags::SHADOW_CACHING
+			| RenderSettingsFlags::LIGHT_CLUSTERING
 			| RenderSettingsFlags::BLOOM
 			;
 		rcr.render_settings.sun_shadow_map_size = { 4096.0f, 4096.0f };
@@ -289,6 +313,7 @@ namespace render_config_resource_internal
 		rcr.render_settings.local_lights_distance_culling_fade = 30.0f;
 		rcr.render_settings.local_lights_distance_culling_cutoff = 60.0f;
 		rcr.render_settings.lod_fade_duration = 0.2f;
+		rcr.render_settings.occlusion_buffer_size = { 256.0f, 128.0f };
 		rcr.render_settings.msaa_quality = msaa_quality_samples(STRING_ID_32("ultra", UINT32_C(0xf13839af)));
 
 		// Parse.
@@ -321,6 +346,7 @@ namespace render_config_resource_internal
 		opts.write(rcr.render_settings.local_lights_distance_culling_fade);
 		opts.write(rcr.render_settings.local_lights_distance_culling_cutoff);
 		opts.write(rcr.render_settings.lod_fade_duration);
+		opts.write(rcr.render_settings.occlusion_buffer_size);
 		opts.write(rcr.render_settings.msaa_quality);
 
 		return 0;
@@ -24,7 +24,10 @@ struct RenderSettingsFlags
 		MSAA                            = u32(1) << 5, ///< Whether multisample AA is enabled.
 		OBJECT_CONTRIBUTION_CULLING     = u32(1) << 6, ///< Whether contribution culling for visible objects is enabled.
 		SUN_SHADOW_CONTRIBUTION_CULLING = u32(1) << 7, ///< Whether contribution culling for sun shadows is enabled.
-		SELECTION                       = u32(1) << 8  ///< Whether selection rendering is enabled.
+		SELECTION                       = u32(1) << 8, ///< Whether selection rendering is enabled.
+		OCCLUSION_CULLING               = u32(1) << 9, ///< Whether software occlusion culling for visible objects is enabled.
+		SHADOW_CACHING                  = u32(1) << 10, ///< Whether static shadow casters are cached in the shadow maps.
+		LIGHT_CLUSTERING                = u32(1) << 11  ///< Whether local lights are assigned to clusters on the CPU.
 	};
 };
 
@@ -42,6 +45,7 @@ struct RenderSettings
 	f32 local_lights_distance_culling_fade;   ///< Distance from camera at which local lights start to fade.
 	f32 local_lights_distance_culling_cutoff; ///< Distance from camera at which local lights disappear.
 	f32 lod_fade_duration;                    ///< Duration in seconds of LOD crossfades.
+	Vector2 occlusion_buffer_size;            ///< Size in pixels of the software occlusion buffer.
 	u32 msaa_quality;
 };
 
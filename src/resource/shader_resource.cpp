@@ -1252,9 +1252,11 @@ namespace shader_resource_internal
 
 	typedef HashMap<DynamicString, MetadataCacheEntry> MetadataCache;
 	typedef HashMap<DynamicString, DynamicString> ShaderLibraryCache;
+	typedef HashMap<DynamicString, Array<u32>> StaticVariantsCache; ///< Shader library path -> ids of its static_compile variants.
 
 	static MetadataCache *s_metadata_cache = NULL;
 	static ShaderLibraryCache *s_shader_library_cache = NULL;
+	static StaticVariantsCache *s_static_variants_cache = NULL;
 
 	static MetadataCache &metadata_cache()
 	{
@@ -1272,6 +1274,14 @@ namespace shader_resource_internal
 		return *s_shader_library_cache;
 	}
 
+	static StaticVariantsCache &static_variants_cache()
+	{
+		if (s_static_variants_cache == NULL)
+			s_static_variants_cache = CE_NEW(default_allocator(), StaticVariantsCache)(default_allocator());
+
+		return *s_static_variants_cache;
+	}
+
 	static void metadata_cache_key(DynamicString &key
 		, Platform::Enum platform
 		, const DynamicString &shader_library
@@ -1353,6 +1363,21 @@ namespace shader_resource_internal
 			hash_map::set(shader_library_cache(), shader, shader_library);
 	}
 
+	/// Returns whether the shader library at @a path lists @a shader_id in its
+	/// static_compile section. Returns false if the library has not been cached.
+	static bool is_static_variant(const DynamicString &path, StringId32 shader_id)
+	{
+		const Array<u32> deffault(default_allocator());
+		const Array<u32> &ids = hash_map::get(static_variants_cache(), path, deffault);
+
+		for (u32 i = 0; i < array::size(ids); ++i) {
+			if (ids[i] == shader_id._id)
+				return true;
+		}
+
+		return false;
+	}
+
 	struct BgfxShader
 	{
 		ALLOCATOR_AWARE;
@@ -2981,6 +3006,23 @@ namespace shader_compiler
 			CE_DELETE(default_allocator(), s_shader_library_cache);
 			s_shader_library_cache = NULL;
 		}
+
+		if (s_static_variants_cache != NULL) {
+			CE_DELETE(default_allocator(), s_static_variants_cache);
+			s_static_variants_cache = NULL;
+		}
+	}
+
+	/// Caches the ids of the static_compile variants of the library at @a path parsed by @a sc.
+	static void cache_static_variants(const DynamicString &path, const ShaderCompiler &sc)
+	{
+		Array<u32> ids(default_allocator());
+		for (u32 i = 0; i < vector::size(sc._static_compile); ++i) {
+			const StaticCompile &sta = sc._static_compile[i];
+			array::push_back(ids, ShaderCompiler::shader_variant_id(sta._shader.c_str(), sta._defines)._id);
+		}
+
+		hash_map::set(static_variants_cache(), path, ids);
 	}
 
 	s32 compile_variant(bool &has_code
@@ -2999,6 +3041,7 @@ namespace shader_compiler
 		DynamicString shader_library_path(default_allocator());
 		DynamicString shader_name(default_allocator());
 		DynamicString cache_key(default_allocator());
+		bool parsed = false;
 
 		for (u32 i = 0; i < vector::size(defines); ++i) {
 			TempAllocator64 ta;
@@ -3035,23 +3078,25 @@ namespace shader_compiler
 			}
 
 			RETURN_IF_FALSE(SHADER_RESOURCE, i < n, opts, "Shader not found");
+			cache_static_variants(shader_library_path, sc);
+			parsed = true;
 		} else {
 			shader_library_path = shader_library;
 			shader_library_path += ".shader";
-			sc.parse(shader_library_path.c_str(), false);
-		}
 
-		// Check whether the shader library contains the variant in static_compile.
-		has_code = true;
-		for (u32 i = 0; i < vector::size(sc._static_compile); ++i) {
-			const StaticCompile &sta = sc._static_compile[i];
-
-			if (shader_id == ShaderCompiler::shader_variant_id(sta._shader.c_str(), sta._defines)) {
-				has_code = false; // Code is compiled into the shader resource itself.
-				break;
+			// The library is parsed at most once per compile session to
+			// find its static variants.
+			if (!hash_map::has(static_variants_cache(), shader_library_path)) {
+				sc.parse(shader_library_path.c_str(), false);
+				cache_static_variants(shader_library_path, sc);
+				parsed = true;
 			}
 		}
 
+		// Check whether the shader library contains the variant in static_compile.
+		// Its code is then compiled into the shader resource itself.
+		has_code = !is_static_variant(shader_library_path, shader_id);
+
 		if (!has_code) {
 			metadata_cache_key(cache_key, opts._platform, shader_library, shader_name, defines_dyn);
 
@@ -3068,6 +3113,9 @@ namespace shader_compiler
 			}
 		}
 
+		if (!parsed)
+			sc.parse(shader_library_path.c_str(), false);
+
 		s32 err = sc.compile_variant(fb, uniform_meta, sampler_meta, shader_name, defines_dyn, !has_code);
 		ENSURE_OR_RETURN(SHADER_RESOURCE, err == 0, opts);
 
@@ -3083,6 +3131,43 @@ namespace shader_compiler
 		return 0;
 	}
 
+	StringId32 static_variant(const DynamicString &shader_library
+		, StringView &shader
+		, Vector<StringView> &defines
+		, CompileOptions &opts
+		)
+	{
+		if (shader_library.empty())
+			return StringId32(0u);
+
+		Vector<DynamicString> defines_dyn(default_allocator());
+		DynamicString shader_library_path(default_allocator());
+		DynamicString shader_name(default_allocator());
+
+		for (u32 i = 0; i < vector::size(defines); ++i) {
+			TempAllocator64 ta;
+			DynamicString tmp(ta);
+			tmp = defines[i];
+			vector::push_back(defines_dyn, tmp);
+		}
+		std::sort(vector::begin(defines_dyn), vector::end(defines_dyn));
+
+		shader_name = shader;
+		const StringId32 shader_id = ShaderCompiler::shader_variant_id(shader_name.c_str(), defines_dyn);
+
+		shader_library_path = shader_library;
+		shader_library_path += ".shader";
+		if (!hash_map::has(static_variants_cache(), shader_library_path)) {
+			ShaderCompiler sc(opts);
+			if (sc.parse(shader_library_path.c_str(), false) != 0)
+				return StringId32(0u);
+
+			cache_static_variants(shader_library_path, sc);
+		}
+
+		return is_static_variant(shader_library_path, shader_id) ? shader_id : StringId32(0u);
+	}
+
 } // namespace shader_compiler
 #endif // if CROWN_CAN_COMPILE
 
@@ -97,6 +97,14 @@ namespace shader_compiler
 		, Vector<ShaderResource::Sampler> *sampler_meta = NULL
 		);
 
+	/// Returns the id of the @a shader variant with @a defines if @a shader_library lists it in
+	/// its static_compile section, or StringId32(0u) otherwise.
+	StringId32 static_variant(const DynamicString &shader_library
+		, StringView &shader
+		, Vector<StringView> &defines
+		, CompileOptions &opts
+		);
+
 } // namespace shader_compiler
 #endif // if CROWN_CAN_COMPILE
 
@@ -85,15 +85,15 @@ struct Platform
 #define RESOURCE_VERSION_STATE_MACHINE    RESOURCE_VERSION(8)
 #define RESOURCE_VERSION_CONFIG           RESOURCE_VERSION(2)
 #define RESOURCE_VERSION_FONT             RESOURCE_VERSION(1)
-#define RESOURCE_VERSION_UNIT             RESOURCE_VERSION(25)
+#define RESOURCE_VERSION_UNIT             RESOURCE_VERSION(26)
 #define RESOURCE_VERSION_LEVEL            (RESOURCE_VERSION_UNIT + 6) //!< Level embeds UnitResource
-#define RESOURCE_VERSION_MATERIAL         RESOURCE_VERSION(10)
-#define RESOURCE_VERSION_MESH             RESOURCE_VERSION(12)
+#define RESOURCE_VERSION_MATERIAL         RESOURCE_VERSION(11)
+#define RESOURCE_VERSION_MESH             RESOURCE_VERSION(15)
 #define RESOURCE_VERSION_MESH_SKELETON    RESOURCE_VERSION(1)
 #define RESOURCE_VERSION_MESH_ANIMATION   RESOURCE_VERSION(3)
 #define RESOURCE_VERSION_PACKAGE          RESOURCE_VERSION(11)
 #define RESOURCE_VERSION_PHYSICS_CONFIG   RESOURCE_VERSION(5)
-#define RESOURCE_VERSION_RENDER_CONFIG    RESOURCE_VERSION(8)
+#define RESOURCE_VERSION_RENDER_CONFIG    RESOURCE_VERSION(11)
 #define RESOURCE_VERSION_STAT_CONFIG      RESOURCE_VERSION(1)
 #define RESOURCE_VERSION_SCRIPT           RESOURCE_VERSION(4)
 #define RESOURCE_VERSION_SHADER           RESOURCE_VERSION(18)
@@ -203,6 +203,14 @@ static s32 compile_mesh_renderer(Buffer &output, UnitCompiler &compiler, FlatJso
 	} else {
 		mrd.flags |= RenderableFlags::SHADOW_CASTER;
 	}
+	if (flat_json_object::has(obj, "data.static_shadows")) {
+		bool static_shadows = RETURN_IF_ERROR(sjson::parse_bool(flat_json_object::get(obj, "data.static_shadows")));
+		mrd.flags |= static_shadows ? RenderableFlags::STATIC_SHADOW : 0u;
+	}
+	if (flat_json_object::has(obj, "data.occluder")) {
+		bool occluder = RETURN_IF_ERROR(sjson::parse_bool(flat_json_object::get(obj, "data.occluder")));
+		mrd.flags |= occluder ? RenderableFlags::OCCLUDER : 0u;
+	}
 
 	FileBuffer fb(output);
 	BinaryWriter bw(fb);
@@ -301,7 +309,10 @@ static s32 compile_lod_group(Buffer &output, UnitCompiler &compiler, FlatJsonObj
 
 		LodDesc desc;
 		desc.unit_index   = UINT32_MAX;
-		desc.screen_size  = RETURN_IF_ERROR(sjson::parse_float(level_data["screen_size"]));
+		desc.screen_size  = -1.0f;
+		if (json_object::has(level_data, "screen_size")) {
+			desc.screen_size = RETURN_IF_ERROR(sjson::parse_float(level_data["screen_size"]));
+		}
 
 		if (mesh_renderer_unit_id != GUID_ZERO) {
 			const u32 root_unit_index = compiler._unit_roots[compiler._current_unit_index];
@@ -323,7 +334,7 @@ static s32 compile_lod_group(Buffer &output, UnitCompiler &compiler, FlatJsonObj
 				);
 		}
 
-		RETURN_IF_FALSE(UNIT_COMPILER, desc.screen_size >= 0.0f && desc.screen_size <= 1.0f
+		RETURN_IF_FALSE(UNIT_COMPILER, desc.screen_size == -1.0f || (desc.screen_size >= 0.0f && desc.screen_size <= 1.0f)
 			, opts
 			, "LOD level screen_size height threshold must be in [0, 1]"
 			);
@@ -331,7 +342,18 @@ static s32 compile_lod_group(Buffer &output, UnitCompiler &compiler, FlatJsonObj
 		array::push_back(levels, desc);
 	}
 
-	std::sort(array::begin(levels)
+	// Derived screen sizes are only known at runtime and cannot be ordered
+	// against authored ones.
+	u32 num_derived = 0;
+	for (u32 i = 0; i < array::size(levels); ++i)
+		num_derived += u32(levels[i].screen_size == -1.0f);
+	RETURN_IF_FALSE(UNIT_COMPILER, num_derived == 0 || num_derived == array::size(levels)
+		, opts
+		, "LOD levels must either all have a screen_size or none"
+		);
+
+	// Levels without a screen_size keep their authored order.
+	std::stable_sort(array::begin(levels)
 		, array::end(levels)
 		, [](const LodDesc &a, const LodDesc &b) {
 			return a.screen_size > b.screen_size;
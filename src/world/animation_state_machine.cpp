@@ -4,7 +4,6 @@
  */
 
 #include "core/containers/array.inl"
-#include "core/containers/hash_map.inl"
 #include "core/containers/types.h"
 #include "core/event_stream.inl"
 #include "core/math/constants.h"
@@ -22,6 +21,7 @@
 #include "world/render_world.h"
 #include "world/types.h"
 #include "world/unit_manager.h"
+#include "world/unit_map.inl"
 #include "world/world.h"
 #include "device/log.h"
 
@@ -57,6 +57,7 @@ AnimationStateMachine::AnimationStateMachine(Allocator &a
 	, _world(&world)
 {
 	_unit_destroy_callback.destroy = unit_destroyed_callback_bridge;
+	_unit_destroy_callback.destroy_batch = NULL;
 	_unit_destroy_callback.user_data = this;
 	_unit_destroy_callback.node.next = NULL;
 	_unit_destroy_callback.node.prev = NULL;
@@ -120,13 +121,16 @@ void AnimationStateMachine::allocate(Machine &m, UnitId unit, const StateMachine
 
 		u32 size = sizeof(AnimationSkeletonInstance)
 			+ sizeof(UnitId) * skeleton_resource->num_bones
+			+ sizeof(TransformId) * skeleton_resource->num_bones
 			+ sizeof(Matrix4x4) * skeleton_resource->num_bones
 			;
 		AnimationSkeletonInstance *skeleton = (AnimationSkeletonInstance *)default_allocator().allocate(size, alignof(AnimationSkeletonInstance));
 		skeleton->num_bones = skeleton_resource->num_bones;
 		skeleton->offsets = mesh_skeleton_resource::binding_matrices(skeleton_resource);
 		skeleton->bone_lookup = (UnitId *)&skeleton[1];
-		skeleton->bones = (Matrix4x4 *)(skeleton->bone_lookup + skeleton_resource->num_bones);
+		skeleton->bone_transforms = (TransformId *)(skeleton->bone_lookup + skeleton_resource->num_bones);
+		skeleton->bones = (Matrix4x4 *)(skeleton->bone_transforms + skeleton_resource->num_bones);
+		skeleton->frame = UINT32_MAX;
 		m.skeleton = skeleton;
 
 		for (u32 i = 0; i < skeleton_resource->num_bones; ++i)
@@ -141,6 +145,8 @@ void AnimationStateMachine::allocate(Machine &m, UnitId unit, const StateMachine
 				, local_transforms[i].rotation
 				, local_transforms[i].scale
 				);
+			skeleton->bone_transforms[i] = ti;
+
 			if (parents[i] != UINT16_MAX) {
 				TransformId parent_ti = scene_graph.instance(skeleton->bone_lookup[parents[i]]);
 				scene_graph.link(parent_ti
@@ -171,7 +177,7 @@ void AnimationStateMachine::create_instances(const void *components_data
 
 	for (u32 i = 0; i < num; ++i) {
 		UnitId unit = unit_lookup[unit_index[i]];
-		CE_ASSERT(!hash_map::has(_map, unit), "Unit already has a state machine component");
+		CE_ASSERT(!unit_map::has(_map, unit), "Unit already has a state machine component");
 
 		const StateMachineResource *smr = (StateMachineResource *)_resource_manager->get(RESOURCE_TYPE_STATE_MACHINE, state_machines[i].state_machine_resource);
 
@@ -180,7 +186,7 @@ void AnimationStateMachine::create_instances(const void *components_data
 
 		u32 last = array::size(_machines);
 		array::push_back(_machines, m);
-		hash_map::set(_map, unit, last);
+		unit_map::set(_map, unit, last);
 	}
 }
 
@@ -221,18 +227,18 @@ void AnimationStateMachine::destroy(StateMachineId state_machine)
 	_machines[state_machine.i] = _machines[last_i];
 
 	array::pop_back(_machines);
-	hash_map::set(_map, last_u, state_machine.i);
-	hash_map::remove(_map, u);
+	unit_map::set(_map, last_u, state_machine.i);
+	unit_map::remove(_map, u);
 }
 
 StateMachineId AnimationStateMachine::instance(UnitId unit)
 {
-	return make_instance(hash_map::get(_map, unit, UINT32_MAX));
+	return make_instance(unit_map::get(_map, unit, UINT32_MAX));
 }
 
 bool AnimationStateMachine::has(UnitId unit)
 {
-	return hash_map::has(_map, unit);
+	return unit_map::has(_map, unit);
 }
 
 u32 AnimationStateMachine::variable_id(StateMachineId state_machine, StringId32 name)
@@ -342,7 +348,7 @@ void AnimationStateMachine::update(float dt, SceneGraph &scene_graph)
 				, mi.time
 				, mi.unit
 				, scene_graph
-				, mi.skeleton->bone_lookup
+				, mi.skeleton->bone_transforms
 				, _events
 				, mi.time + dt*speed > mi.time_total
 				);
@@ -36,7 +36,7 @@ struct AnimationStateMachine
 	u32 _marker;
 	ResourceManager *_resource_manager;
 	UnitManager *_unit_manager;
-	HashMap<UnitId, u32> _map;
+	UnitMap<u32> _map;
 	Array<Machine> _machines;
 	EventStream _events;
 	UnitDestroyCallback _unit_destroy_callback;
@@ -0,0 +1,549 @@
+/*
+ * Copyright (c) 2012-2026 Daniele Bartolini et al.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "core/containers/array.inl"
+#include "core/math/aabb.h"
+#include "core/math/intersection.h"
+#include "core/math/obb.inl"
+#include "core/math/sphere.inl"
+#include "core/math/vector3.inl"
+#include "core/memory/allocator.h"
+#include "core/profiler.h"
+#include "world/culling_set.h"
+
+namespace crown
+{
+namespace culling_set
+{
+	// Dynamic AABB tree. Leaves store the bounds of the objects' world spheres enlarged by a
+	// margin, so that objects moving by small amounts do not need to be reinserted. The tree is
+	// kept balanced with AVL rotations.
+
+	static AABB tree_fat_aabb(const Sphere &s)
+	{
+		const f32 r = s.r*1.125f + 0.05f;
+		const Vector3 e = { r, r, r };
+		return { s.c - e, s.c + e };
+	}
+
+	static AABB tree_merge(const AABB &a, const AABB &b)
+	{
+		return { min(a.min, b.min), max(a.max, b.max) };
+	}
+
+	static f32 tree_area(const AABB &b)
+	{
+		const Vector3 d = b.max - b.min;
+		return d.x*d.y + d.y*d.z + d.z*d.x;
+	}
+
+	static bool tree_contains(const AABB &a, const Sphere &s)
+	{
+		return a.min.x <= s.c.x - s.r && s.c.x + s.r <= a.max.x
+			&& a.min.y <= s.c.y - s.r && s.c.y + s.r <= a.max.y
+			&& a.min.z <= s.c.z - s.r && s.c.z + s.r <= a.max.z
+			;
+	}
+
+	static u32 tree_alloc_node(CullingSet &set)
+	{
+		u32 n = set.free_node;
+		if (n != UINT32_MAX) {
+			set.free_node = set.nodes[n].parent;
+		} else {
+			n = array::size(set.nodes);
+			array::resize(set.nodes, n + 1);
+		}
+
+		CullingNode &node = set.nodes[n];
+		node.parent = UINT32_MAX;
+		node.child[0] = UINT32_MAX;
+		node.child[1] = UINT32_MAX;
+		node.entry = UINT32_MAX;
+		node.height = 0;
+		return n;
+	}
+
+	static void tree_free_node(CullingSet &set, u32 n)
+	{
+		set.nodes[n].parent = set.free_node;
+		set.nodes[n].height = -1;
+		set.free_node = n;
+	}
+
+	static void tree_replace_child(CullingSet &set, u32 parent, u32 old_child, u32 new_child)
+	{
+		if (parent == UINT32_MAX)
+			set.root = new_child;
+		else if (set.nodes[parent].child[0] == old_child)
+			set.nodes[parent].child[0] = new_child;
+		else
+			set.nodes[parent].child[1] = new_child;
+	}
+
+	// Rotates the grandchildren of @a a up if its subtrees are unbalanced and returns the new
+	// root of the subtree.
+	static u32 tree_balance(CullingSet &set, u32 a)
+	{
+		CullingNode *nodes = array::begin(set.nodes);
+		if (nodes[a].child[0] == UINT32_MAX || nodes[a].height < 2)
+			return a;
+
+		// Rotate the taller child (@a up) in place of @a a.
+		const s32 balance = nodes[nodes[a].child[1]].height - nodes[nodes[a].child[0]].height;
+		if (balance >= -1 && balance <= 1)
+			return a;
+
+		const u32 up_side = balance > 1 ? 1 : 0;
+		const u32 up = nodes[a].child[up_side];
+		const u32 other = nodes[a].child[1 - up_side];
+		const u32 f = nodes[up].child[0];
+		const u32 g = nodes[up].child[1];
+
+		nodes[up].child[0] = a;
+		nodes[up].parent = nodes[a].parent;
+		nodes[a].parent = up;
+		tree_replace_child(set, nodes[up].parent, a, up);
+
+		// Keep the taller grandchild under @a up and move the other one under @a a.
+		const u32 keep = nodes[f].height > nodes[g].height ? f : g;
+		const u32 move = keep == f ? g : f;
+		nodes[up].child[1] = keep;
+		nodes[a].child[up_side] = move;
+		nodes[move].parent = a;
+
+		nodes[a].aabb = tree_merge(nodes[other].aabb, nodes[move].aabb);
+		nodes[a].height = 1 + max(nodes[other].height, nodes[move].height);
+		nodes[up].aabb = tree_merge(nodes[a].aabb, nodes[keep].aabb);
+		nodes[up].height = 1 + max(nodes[a].height, nodes[keep].height);
+		return up;
+	}
+
+	// Refits and rebalances the ancestors of a modified node starting from @a n.
+	static void tree_refit(CullingSet &set, u32 n)
+	{
+		while (n != UINT32_MAX) {
+			n = tree_balance(set, n);
+
+			CullingNode &node = set.nodes[n];
+			const CullingNode &c0 = set.nodes[node.child[0]];
+			const CullingNode &c1 = set.nodes[node.child[1]];
+			node.height = 1 + max(c0.height, c1.height);
+			node.aabb = tree_merge(c0.aabb, c1.aabb);
+			n = node.parent;
+		}
+	}
+
+	static void tree_insert_leaf(CullingSet &set, u32 leaf)
+	{
+		if (set.root == UINT32_MAX) {
+			set.root = leaf;
+			set.nodes[leaf].parent = UINT32_MAX;
+			return;
+		}
+
+		// Find the best sibling with the surface area heuristic.
+		const AABB leaf_aabb = set.nodes[leaf].aabb;
+		u32 index = set.root;
+		while (set.nodes[index].child[0] != UINT32_MAX) {
+			const CullingNode &node = set.nodes[index];
+			const f32 area = tree_area(node.aabb);
+			const f32 combined_area = tree_area(tree_merge(node.aabb, leaf_aabb));
+			const f32 cost = 2.0f*combined_area;
+			const f32 inheritance_cost = 2.0f*(combined_area - area);
+
+			f32 child_cost[2];
+			for (u32 i = 0; i < 2; ++i) {
+				const CullingNode &child = set.nodes[node.child[i]];
+				const f32 merged_area = tree_area(tree_merge(child.aabb, leaf_aabb));
+				child_cost[i] = child.child[0] == UINT32_MAX
+					? merged_area + inheritance_cost
+					: merged_area - tree_area(child.aabb) + inheritance_cost
+					;
+			}
+
+			if (cost < child_cost[0] && cost < child_cost[1])
+				break;
+
+			index = child_cost[0] < child_cost[1] ? node.child[0] : node.child[1];
+		}
+
+		const u32 sibling = index;
+		const u32 old_parent = set.nodes[sibling].parent;
+		const u32 new_parent = tree_alloc_node(set);
+		CullingNode &np = set.nodes[new_parent];
+		np.parent = old_parent;
+		np.child[0] = sibling;
+		np.child[1] = leaf;
+		np.aabb = tree_merge(leaf_aabb, set.nodes[sibling].aabb);
+		np.height = set.nodes[sibling].height + 1;
+		tree_replace_child(set, old_parent, sibling, new_parent);
+		set.nodes[sibling].parent = new_parent;
+		set.nodes[leaf].parent = new_parent;
+
+		tree_refit(set, new_parent);
+	}
+
+	static void tree_remove_leaf(CullingSet &set, u32 leaf)
+	{
+		if (leaf == set.root) {
+			set.root = UINT32_MAX;
+			return;
+		}
+
+		const u32 parent = set.nodes[leaf].parent;
+		const u32 grand_parent = set.nodes[parent].parent;
+		const u32 sibling = set.nodes[parent].child[0] == leaf
+			? set.nodes[parent].child[1]
+			: set.nodes[parent].child[0]
+			;
+
+		tree_replace_child(set, grand_parent, parent, sibling);
+		set.nodes[sibling].parent = grand_parent;
+		tree_free_node(set, parent);
+
+		tree_refit(set, grand_parent);
+	}
+
+	static void tree_insert(CullingSet &set, u32 entry)
+	{
+		const u32 n = tree_alloc_node(set);
+		set.nodes[n].aabb = tree_fat_aabb(set.sphere_w[entry]);
+		set.nodes[n].entry = entry;
+		set.leaf[entry] = n;
+		tree_insert_leaf(set, n);
+	}
+
+	static void tree_remove(CullingSet &set, u32 entry)
+	{
+		const u32 n = set.leaf[entry];
+		tree_remove_leaf(set, n);
+		tree_free_node(set, n);
+	}
+
+	// Reinserts the leaf of @a entry if its world sphere moved out of the leaf bounds.
+	static void tree_update(CullingSet &set, u32 entry)
+	{
+		const u32 n = set.leaf[entry];
+		if (tree_contains(set.nodes[n].aabb, set.sphere_w[entry]))
+			return;
+
+		tree_remove_leaf(set, n);
+		set.nodes[n].aabb = tree_fat_aabb(set.sphere_w[entry]);
+		tree_insert_leaf(set, n);
+	}
+
+	// Sets the index of the object @a object_id of type @a type to @a index.
+	static void set_slot(CullingSet &set, CullableType::Enum type, u32 object_id, u32 index)
+	{
+		const u32 key = object_id*CullableType::COUNT + type;
+		const u32 size = array::size(set.slot);
+		if (key >= size) {
+			if (index == UINT32_MAX)
+				return;
+
+			array::reserve(set.slot, key + 1);
+			array::resize(set.slot, key + 1);
+			for (u32 i = size; i < key; ++i)
+				set.slot[i] = UINT32_MAX;
+		}
+
+		set.slot[key] = index;
+	}
+
+	// Moves the object at index @a from to index @a to.
+	static void move_object(CullingSet &set, u32 from, u32 to)
+	{
+		set.id[to]       = set.id[from];
+		set.type[to]     = set.type[from];
+		set.sphere_w[to] = set.sphere_w[from];
+		set.obb_w[to]    = set.obb_w[from];
+		set.leaf[to]     = set.leaf[from];
+		set.nodes[set.leaf[to]].entry = to;
+		set_slot(set, set.type[to], set.id[to], to);
+	}
+
+	// Pushes @a node to the query stack. @a mask is the set of planes (or 1 for spheres) the node
+	// must still be tested against, 0 if the whole subtree is known to be visible.
+	static void tree_push(CullingSet &set, u32 node, u32 mask)
+	{
+		array::push_back(set.stack, node);
+		array::push_back(set.stack, mask);
+	}
+
+	// Pops the node on top of the query stack and its @a mask.
+	static u32 tree_pop(CullingSet &set, u32 &mask)
+	{
+		const u32 top = array::size(set.stack);
+		mask = set.stack[top - 1];
+		const u32 node = set.stack[top - 2];
+		array::resize(set.stack, top - 2);
+		return node;
+	}
+
+	u32 query(CullingSet &set, const Plane3 *planes, u32 num_planes)
+	{
+		ENTER_PROFILE_SCOPE(__func__);
+		CE_ENSURE(num_planes <= 32);
+
+		array::clear(set.render);
+		array::clear(set.pending);
+		array::clear(set.stack);
+		if (set.root != UINT32_MAX)
+			tree_push(set, set.root, num_planes == 32 ? UINT32_MAX : (1u << num_planes) - 1);
+
+		while (array::size(set.stack) != 0) {
+			u32 mask;
+			const CullingNode &node = set.nodes[tree_pop(set, mask)];
+
+			if (mask != 0) {
+				const Vector3 center = (node.aabb.min + node.aabb.max) * 0.5f;
+				const Vector3 extents = (node.aabb.max - node.aabb.min) * 0.5f;
+
+				bool outside = false;
+				for (u32 j = 0; j < num_planes && !outside; ++j) {
+					if ((mask & (1u << j)) == 0)
+						continue;
+
+					const Plane3 &plane = planes[j];
+					const f32 dist = dot(plane.n, center) - plane.d;
+					const f32 radius = fabs(plane.n.x)*extents.x
+						+ fabs(plane.n.y)*extents.y
+						+ fabs(plane.n.z)*extents.z
+						;
+					outside = dist + radius < 0.0f;
+					if (dist - radius >= 0.0f)
+						mask &= ~(1u << j);
+				}
+
+				if (outside)
+					continue;
+			}
+
+			if (node.child[0] != UINT32_MAX) {
+				tree_push(set, node.child[0], mask);
+				tree_push(set, node.child[1], mask);
+				continue;
+			}
+
+			// Leaves whose bounds straddle a plane are tested in batches below.
+			if (mask != 0)
+				array::push_back(set.pending, node.entry);
+			else
+				array::push_back(set.render, node.entry);
+		}
+
+		const u32 num_pending = array::size(set.pending);
+		if (num_pending != 0) {
+			array::resize(set.visible, (num_pending + 31) / 32);
+			spheres_intersect_planes(array::begin(set.visible)
+				, array::begin(set.sphere_w)
+				, array::begin(set.pending)
+				, num_pending
+				, planes
+				, num_planes
+				);
+
+			for (u32 i = 0; i < num_pending; ++i) {
+				if ((set.visible[i / 32] & (1u << (i % 32))) != 0)
+					array::push_back(set.render, set.pending[i]);
+			}
+		}
+
+		LEAVE_PROFILE_SCOPE();
+		return array::size(set.render);
+	}
+
+	u32 query(CullingSet &set, const Sphere &sphere)
+	{
+		ENTER_PROFILE_SCOPE(__func__);
+
+		array::clear(set.render);
+		array::clear(set.stack);
+		if (set.root != UINT32_MAX)
+			tree_push(set, set.root, 1u);
+
+		const f32 r_sq = sphere.r*sphere.r;
+		while (array::size(set.stack) != 0) {
+			u32 mask;
+			const CullingNode &node = set.nodes[tree_pop(set, mask)];
+
+			if (mask != 0) {
+				const Vector3 nearest = max(node.aabb.min, min(sphere.c, node.aabb.max));
+				if (length_squared(nearest - sphere.c) > r_sq)
+					continue;
+
+				// The whole subtree is visible if the farthest corner is inside the sphere.
+				const Vector3 d0 = node.aabb.min - sphere.c;
+				const Vector3 d1 = node.aabb.max - sphere.c;
+				const Vector3 farthest = max(max(d0, -d0), max(d1, -d1));
+				if (length_squared(farthest) <= r_sq)
+					mask = 0;
+			}
+
+			if (node.child[0] != UINT32_MAX) {
+				tree_push(set, node.child[0], mask);
+				tree_push(set, node.child[1], mask);
+				continue;
+			}
+
+			const Sphere &sphere_w = set.sphere_w[node.entry];
+			const f32 r_sum = sphere.r + sphere_w.r;
+			if (mask == 0 || length_squared(sphere.c - sphere_w.c) <= r_sum*r_sum)
+				array::push_back(set.render, node.entry);
+		}
+
+		LEAVE_PROFILE_SCOPE();
+		return array::size(set.render);
+	}
+
+	u32 find_object(const CullingSet &set, CullableType::Enum type, u32 object_id)
+	{
+		const u32 key = object_id*CullableType::COUNT + type;
+		return key < array::size(set.slot) ? set.slot[key] : UINT32_MAX;
+	}
+
+	void add(CullingSet &set, const Cullable &object)
+	{
+		Sphere sw;
+		sphere::transform(sw, object.sphere, object.world);
+
+		OBB obbw;
+		obb::transform(obbw, object.obb, object.world);
+
+		array::push_back(set.sphere_w, sw);
+		array::push_back(set.obb_w, obbw);
+		array::push_back(set.id, object.id);
+		array::push_back(set.type, object.type);
+		array::push_back(set.leaf, UINT32_MAX);
+		tree_insert(set, array::size(set.id) - 1);
+		set_slot(set, object.type, object.id, array::size(set.id) - 1);
+	}
+
+	void update(CullingSet &set, CullableType::Enum type, u32 object_id, const Sphere &sphere_w, const OBB &obb_w)
+	{
+		const u32 i = find_object(set, type, object_id);
+		if (i == UINT32_MAX)
+			return;
+
+		set.sphere_w[i] = sphere_w;
+		set.obb_w[i] = obb_w;
+		tree_update(set, i);
+	}
+
+	void update(CullingSet &set, const Cullable &object)
+	{
+		const u32 i = find_object(set, object.type, object.id);
+		if (i == UINT32_MAX)
+			return;
+
+		sphere::transform(set.sphere_w[i], object.sphere, object.world);
+		obb::transform(set.obb_w[i], object.obb, object.world);
+		tree_update(set, i);
+	}
+
+	void remove(CullingSet &set, CullableType::Enum type, u32 object_id)
+	{
+		u32 ind = find_object(set, type, object_id);
+		if (ind == UINT32_MAX)
+			return;
+
+		u32 last = array::size(set.id) - 1;
+
+		tree_remove(set, ind);
+		set_slot(set, type, object_id, UINT32_MAX);
+		if (ind != last)
+			move_object(set, last, ind);
+
+		array::pop_back(set.id);
+		array::pop_back(set.type);
+		array::pop_back(set.sphere_w);
+		array::pop_back(set.obb_w);
+		array::pop_back(set.leaf);
+	}
+
+	void fixup(CullingSet &set, CullableType::Enum type, u32 inst, u32 last)
+	{
+		// Remove any entry that still points at the destroyed index.
+		culling_set::remove(set, type, inst);
+
+		// If we destroyed the last element, there is nothing else to fix.
+		if (inst == last)
+			return;
+
+		// The entry that referred to the former last index must now point to inst.
+		const u32 i = find_object(set, type, last);
+		if (i == UINT32_MAX)
+			return;
+
+		set.id[i] = inst;
+		set_slot(set, type, last, UINT32_MAX);
+		set_slot(set, type, inst, i);
+	}
+
+	void fixup(Allocator &a, CullingSet &set, CullableType::Enum type, const u32 *indices, u32 num, u32 size)
+	{
+		if (num == 0)
+			return;
+
+		if (num == 1) {
+			fixup(set, type, indices[0], size - 1);
+			return;
+		}
+
+		// Replay the moves to find where each instance ends up.
+		u32 *remap = (u32 *)a.allocate(size*sizeof(u32)*2);
+		u32 *orig = remap + size;
+		for (u32 i = 0; i < size; ++i) {
+			remap[i] = i;
+			orig[i] = i;
+		}
+
+		u32 last = size - 1;
+		for (u32 i = 0; i < num; ++i, --last) {
+			const u32 inst = indices[i];
+			remap[inst] = UINT32_MAX;
+
+			if (inst != last) {
+				remap[orig[last]] = inst;
+				orig[inst] = orig[last];
+			}
+		}
+
+		// Remove the entries of destroyed instances and remap the others in a single pass.
+		for (u32 i = 0; i < array::size(set.id); ++i)
+			set_slot(set, set.type[i], set.id[i], UINT32_MAX);
+
+		u32 n = 0;
+		for (u32 i = 0; i < array::size(set.id); ++i) {
+			u32 id = set.id[i];
+			if (set.type[i] == type) {
+				id = remap[id];
+				if (id == UINT32_MAX) {
+					tree_remove(set, i);
+					continue;
+				}
+			}
+
+			set.id[i] = id;
+			if (n != i)
+				move_object(set, i, n);
+			else
+				set_slot(set, set.type[n], id, n);
+			++n;
+		}
+
+		array::resize(set.id, n);
+		array::resize(set.type, n);
+		array::resize(set.sphere_w, n);
+		array::resize(set.obb_w, n);
+		array::resize(set.leaf, n);
+
+		a.deallocate(remap);
+	}
+
+} // namespace culling_set
+
+} // namespace crown
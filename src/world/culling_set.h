@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2012-2026 Daniele Bartolini et al.
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include "core/containers/types.h"
+#include "core/math/types.h"
+#include "core/memory/types.h"
+#include "core/types.h"
+
+namespace crown
+{
+struct CullableType
+{
+	enum Enum
+	{
+		MESH,
+		SPRITE,
+		LOD_GROUP,
+		LIGHT,
+
+		COUNT
+	};
+};
+
+struct Cullable
+{
+	Matrix4x4 world;          ///< World pose of the object.
+	Sphere sphere;            ///< Culling sphere of the object in local space.
+	OBB obb;
+	u32 id;                   ///< ID of the object.
+	CullableType::Enum type;  ///< Type of the object.
+};
+
+/// Node of the dynamic AABB tree used to accelerate CullingSet queries.
+struct CullingNode
+{
+	AABB aabb;    ///< Enlarged bounds of the object for leaves, union of children otherwise.
+	u32 parent;   ///< Parent node, or next free node if the node is free.
+	u32 child[2]; ///< Children nodes, UINT32_MAX for leaves.
+	u32 entry;    ///< Index of the object in the CullingSet for leaves.
+	s32 height;   ///< 0 for leaves, -1 for free nodes.
+};
+
+/// Set of objects culled against view volumes.
+///
+/// Objects are stored in arrays indexed by their position in the set and
+/// their world spheres are kept in a dynamic AABB tree to accelerate queries.
+///
+/// @ingroup World
+struct CullingSet
+{
+	Array<Sphere> sphere_w;
+	Array<OBB> obb_w;
+	Array<u32> id;
+	Array<CullableType::Enum> type;
+	Array<u32> visible;       ///< Visibility bitmask of the objects being culled.
+	Array<u32> render;
+	Array<u32> pending;       ///< Tree leaves the current query must test one by one.
+	Array<u32> leaf;          ///< Tree leaf of each object.
+	Array<CullingNode> nodes; ///< Dynamic AABB tree of the objects' world spheres.
+	Array<u32> slot;          ///< Index of each object by id * CullableType::COUNT + type, UINT32_MAX if not in the set.
+	Array<u32> stack;         ///< Pairs of tree node and plane mask still to be visited by the current query.
+	u32 root;
+	u32 free_node;
+
+	explicit CullingSet(Allocator &a)
+		: sphere_w(a)
+		, obb_w(a)
+		, id(a)
+		, type(a)
+		, visible(a)
+		, render(a)
+		, pending(a)
+		, leaf(a)
+		, nodes(a)
+		, slot(a)
+		, stack(a)
+		, root(UINT32_MAX)
+		, free_node(UINT32_MAX)
+	{
+	}
+};
+
+namespace culling_set
+{
+	/// Adds @a object to the @a set.
+	void add(CullingSet &set, const Cullable &object);
+
+	/// Sets the world bounds of the object @a object_id of type @a type if it is in the @a set.
+	void update(CullingSet &set, CullableType::Enum type, u32 object_id, const Sphere &sphere_w, const OBB &obb_w);
+
+	/// Updates the world bounds of @a object if it is in the @a set.
+	void update(CullingSet &set, const Cullable &object);
+
+	/// Removes the object @a object_id of type @a type from the @a set if it is in it.
+	void remove(CullingSet &set, CullableType::Enum type, u32 object_id);
+
+	/// Returns the index of the object @a object_id of type @a type in the @a set, or UINT32_MAX
+	/// if it is not in the set.
+	u32 find_object(const CullingSet &set, CullableType::Enum type, u32 object_id);
+
+	/// Collects the objects whose world sphere is inside all @a planes into set.render
+	/// and returns their number.
+	u32 query(CullingSet &set, const Plane3 *planes, u32 num_planes);
+
+	/// Collects the objects whose world sphere intersects @a sphere into set.render
+	/// and returns their number.
+	u32 query(CullingSet &set, const Sphere &sphere);
+
+	/// Fixes the set indices when the instance at index @a inst is destroyed and the
+	/// @a last instance is moved into its slot.
+	void fixup(CullingSet &set, CullableType::Enum type, u32 inst, u32 last);
+
+	/// Fixes the set indices when the @a num instances at @a indices, sorted in descending
+	/// order, are destroyed one after the other by moving the last instance into their slots.
+	void fixup(Allocator &a, CullingSet &set, CullableType::Enum type, const u32 *indices, u32 num, u32 size);
+
+} // namespace culling_set
+
+} // namespace crown
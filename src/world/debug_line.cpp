@@ -206,7 +206,8 @@ void DebugLine::add_obb(const Matrix4x4 &tm, const Vector3 &half_extents, const
 	add_line(vertices[3], vertices[7], color);
 }
 
-void DebugLine::add_mesh(const Matrix4x4 &tm, const void *vertices, u32 stride, const u16 *indices, u32 num, const Color4 &color)
+template<typename T>
+static void add_mesh(DebugLine &dl, const Matrix4x4 &tm, const void *vertices, u32 stride, const T *indices, u32 num, const Color4 &color)
 {
 	for (u32 i = 0; i < num; i += 3) {
 		const u32 i0 = indices[i + 0];
@@ -217,12 +218,22 @@ void DebugLine::add_mesh(const Matrix4x4 &tm, const void *vertices, u32 stride,
 		const Vector3 &v1 = *(Vector3 *)((char *)vertices + i1*stride) * tm;
 		const Vector3 &v2 = *(Vector3 *)((char *)vertices + i2*stride) * tm;
 
-		add_line(v0, v1, color);
-		add_line(v1, v2, color);
-		add_line(v2, v0, color);
+		dl.add_line(v0, v1, color);
+		dl.add_line(v1, v2, color);
+		dl.add_line(v2, v0, color);
 	}
 }
 
+void DebugLine::add_mesh(const Matrix4x4 &tm, const void *vertices, u32 stride, const u16 *indices, u32 num, const Color4 &color)
+{
+	crown::add_mesh(*this, tm, vertices, stride, indices, num, color);
+}
+
+void DebugLine::add_mesh(const Matrix4x4 &tm, const void *vertices, u32 stride, const u32 *indices, u32 num, const Color4 &color)
+{
+	crown::add_mesh(*this, tm, vertices, stride, indices, num, color);
+}
+
 void DebugLine::reset()
 {
 	array::clear(_lines);
@@ -73,6 +73,9 @@ struct DebugLine
 	/// Adds the mesh described by (vertices, stride, indices, num).
 	void add_mesh(const Matrix4x4 &tm, const void *vertices, u32 stride, const u16 *indices, u32 num, const Color4 &color);
 
+	/// @copydoc DebugLine::add_mesh()
+	void add_mesh(const Matrix4x4 &tm, const void *vertices, u32 stride, const u32 *indices, u32 num, const Color4 &color);
+
 	/// Resets all the lines.
 	void reset();
 
@@ -0,0 +1,379 @@
+/*
+ * Copyright (c) 2012-2026 Daniele Bartolini et al.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "core/containers/array.inl"
+#include "core/math/aabb.inl"
+#include "core/math/constants.h"
+#include "core/math/math.inl"
+#include "core/math/matrix4x4.inl"
+#include "core/math/simd.h"
+#include "core/math/vector3.inl"
+#include "core/thread/job_system.h"
+#include "world/light_clusters.h"
+#include <bx/math.h>
+#include <float.h> // FLT_MAX
+#include <string.h> // memcmp, memset
+
+namespace crown
+{
+namespace light_clusters
+{
+	/// Slices start at least this far from the eye.
+	static const f32 MIN_SLICE_NEAR = 1e-3f;
+
+	static Vector3 unproject(const Matrix4x4 &inv_proj, f32 x, f32 y, f32 z)
+	{
+		const Vector4 ndc = { x, y, z, 1.0f };
+		const Vector4 p = ndc * inv_proj;
+		return { p.x / p.w, p.y / p.w, p.z / p.w };
+	}
+
+	/// Returns the point at view depth @a depth along the ray from @a a to @a b.
+	static Vector3 point_at_depth(const Vector3 &a, const Vector3 &b, f32 depth)
+	{
+		const f32 t = (-depth - a.z) / (b.z - a.z);
+		return a + (b - a) * t;
+	}
+
+#if !CROWN_SIMD
+	/// Returns the squared distance between the sphere center @a c and the box (@a min, @a max).
+	static f32 box_distance_squared(const Vector3 &c, const Vector3 &min, const Vector3 &max)
+	{
+		const f32 dx = crown::max(crown::max(min.x - c.x, c.x - max.x), 0.0f);
+		const f32 dy = crown::max(crown::max(min.y - c.y, c.y - max.y), 0.0f);
+		const f32 dz = crown::max(crown::max(min.z - c.z, c.z - max.z), 0.0f);
+		return dx*dx + dy*dy + dz*dz;
+	}
+#endif // if !CROWN_SIMD
+
+	/// Returns whether the cone @a cone intersects the sphere (@a c, @a r).
+	static bool cone_intersects_sphere(const LightClusters::Cone &cone, const Vector3 &c, f32 r)
+	{
+		const Vector3 v = c - cone.apex;
+		const f32 v_len_sq = dot(v, v);
+		const f32 v1_len = dot(v, cone.direction);
+		const f32 dist = cone.cos_angle * fsqrt(crown::max(v_len_sq - v1_len*v1_len, 0.0f)) - v1_len * cone.sin_angle;
+
+		return dist <= r
+			&& v1_len <= r + cone.range
+			&& v1_len >= -r
+			;
+	}
+
+	/// Sets the bits of the lights intersecting the clusters of the slices [begin; end).
+	static void assign_slices(u32 begin, u32 end, void *user_data)
+	{
+		LightClusters &lc = *(LightClusters *)user_data;
+		const u32 num_xy = lc._num_x * lc._num_y;
+		const u32 num_lights = array::size(lc._spheres);
+
+		for (u32 z = begin; z < end; ++z) {
+			const u32 row = z * lc._slice_stride;
+			u32 *masks = array::begin(lc._masks) + z * num_xy * lc._num_words;
+
+			for (u32 i = 0; i < num_lights; ++i) {
+				const Sphere &s = lc._spheres[i];
+				const LightClusters::Cone &cone = lc._cones[i];
+				const f32 r2 = s.r * s.r;
+
+				// Skip lights outside the slice depth range. It bounds all the
+				// froxels in the slice so this never rejects an intersecting light.
+				const f32 slice_dz = crown::max(crown::max(lc._slice_min_z[z] - s.c.z, s.c.z - lc._slice_max_z[z]), 0.0f);
+				if (slice_dz*slice_dz > r2)
+					continue;
+
+#if CROWN_SIMD
+				const f32x4 zero = f32x4_splat(0.0f);
+				const f32x4 cx = f32x4_splat(s.c.x);
+				const f32x4 cy = f32x4_splat(s.c.y);
+				const f32x4 cz = f32x4_splat(s.c.z);
+				const f32x4 r2x4 = f32x4_splat(r2);
+#endif // if CROWN_SIMD
+
+				for (u32 j = 0; j < num_xy; j += 4) {
+#if CROWN_SIMD
+					const f32x4 dx = f32x4_max(f32x4_max(f32x4_sub(f32x4_load(&lc._min_x[row + j]), cx), f32x4_sub(cx, f32x4_load(&lc._max_x[row + j]))), zero);
+					const f32x4 dy = f32x4_max(f32x4_max(f32x4_sub(f32x4_load(&lc._min_y[row + j]), cy), f32x4_sub(cy, f32x4_load(&lc._max_y[row + j]))), zero);
+					const f32x4 dz = f32x4_max(f32x4_max(f32x4_sub(f32x4_load(&lc._min_z[row + j]), cz), f32x4_sub(cz, f32x4_load(&lc._max_z[row + j]))), zero);
+					const f32x4 d2 = f32x4_add(f32x4_add(f32x4_mul(dx, dx), f32x4_mul(dy, dy)), f32x4_mul(dz, dz));
+					u32 hits = ~f32x4_movemask(f32x4_cmpgt(d2, r2x4)) & 0xf;
+#else
+					u32 hits = 0;
+					for (u32 k = 0; k < 4; ++k) {
+						const Vector3 min = { lc._min_x[row + j + k], lc._min_y[row + j + k], lc._min_z[row + j + k] };
+						const Vector3 max = { lc._max_x[row + j + k], lc._max_y[row + j + k], lc._max_z[row + j + k] };
+						hits |= u32(!(box_distance_squared(s.c, min, max) > r2)) << k;
+					}
+#endif // if CROWN_SIMD
+
+					while (hits != 0) {
+						const u32 k = bx::countTrailingZeros(hits);
+						hits &= hits - 1;
+
+						const u32 xy = j + k;
+						if (xy >= num_xy)
+							break;
+
+						if (cone.range >= 0.0f) {
+							const Vector3 min = { lc._min_x[row + xy], lc._min_y[row + xy], lc._min_z[row + xy] };
+							const Vector3 max = { lc._max_x[row + xy], lc._max_y[row + xy], lc._max_z[row + xy] };
+							const Vector3 c = (min + max) * 0.5f;
+							if (!cone_intersects_sphere(cone, c, length(max - c)))
+								continue;
+						}
+
+						masks[xy * lc._num_words + i / 32] |= u32(1) << (i % 32);
+					}
+				}
+			}
+
+			for (u32 xy = 0; xy < num_xy; ++xy) {
+				u32 count = 0;
+				for (u32 w = 0; w < lc._num_words; ++w)
+					count += bx::countBits(masks[xy * lc._num_words + w]);
+				lc._count[z * num_xy + xy] = count;
+			}
+		}
+	}
+
+	/// Writes the light indices of the clusters of the slices [begin; end).
+	static void write_indices(u32 begin, u32 end, void *user_data)
+	{
+		LightClusters &lc = *(LightClusters *)user_data;
+		const u32 num_xy = lc._num_x * lc._num_y;
+
+		for (u32 c = begin * num_xy; c < end * num_xy; ++c) {
+			const u32 *masks = array::begin(lc._masks) + c * lc._num_words;
+			u32 *indices = array::begin(lc._indices) + lc._offset[c];
+			u32 n = 0;
+
+			for (u32 w = 0; w < lc._num_words && n < lc._count[c]; ++w) {
+				u32 bits = masks[w];
+				while (bits != 0 && n < lc._count[c]) {
+					indices[n++] = w * 32 + bx::countTrailingZeros(bits);
+					bits &= bits - 1;
+				}
+			}
+		}
+	}
+
+} // namespace light_clusters
+
+LightClusters::LightClusters(Allocator &a)
+	: _min_x(a)
+	, _min_y(a)
+	, _min_z(a)
+	, _max_x(a)
+	, _max_y(a)
+	, _max_z(a)
+	, _slice_min_z(a)
+	, _slice_max_z(a)
+	, _spheres(a)
+	, _cones(a)
+	, _masks(a)
+	, _offset(a)
+	, _count(a)
+	, _indices(a)
+	, _view(MATRIX4X4_IDENTITY)
+	, _proj(MATRIX4X4_IDENTITY)
+	, _num_x(0)
+	, _num_y(0)
+	, _num_z(0)
+	, _slice_stride(0)
+	, _num_words(0)
+	, _max_indices(0)
+	, _near(0.0f)
+	, _far(0.0f)
+	, _slice_scale(0.0f)
+	, _slice_bias(0.0f)
+{
+}
+
+void LightClusters::reset(u32 num_x, u32 num_y, u32 num_z, const Matrix4x4 &view, const Matrix4x4 &proj, u32 max_indices)
+{
+	CE_ENSURE(num_x > 0 && num_y > 0 && num_z > 0);
+
+	_view = view;
+	_max_indices = max_indices;
+	array::clear(_spheres);
+	array::clear(_cones);
+	array::clear(_indices);
+
+	// Froxels are in view space and only depend on the projection.
+	if (num_x == _num_x && num_y == _num_y && num_z == _num_z && memcmp(&proj, &_proj, sizeof(proj)) == 0)
+		return;
+
+	_proj = proj;
+	_num_x = num_x;
+	_num_y = num_y;
+	_num_z = num_z;
+	_slice_stride = (num_x * num_y + 3) & ~3u;
+
+	const Matrix4x4 inv_proj = get_inverted(proj);
+	_near = -light_clusters::unproject(inv_proj, 0.0f, 0.0f, -1.0f).z;
+	_far = -light_clusters::unproject(inv_proj, 0.0f, 0.0f, 1.0f).z;
+
+	// Exponential slices. The first slice extends to the near plane when
+	// that is closer than MIN_SLICE_NEAR.
+	const f32 slice_near = max(_near, light_clusters::MIN_SLICE_NEAR);
+	const f32 slice_far = max(_far, slice_near * 2.0f);
+	_slice_scale = f32(num_z) / log2f(slice_far / slice_near);
+	_slice_bias = -log2f(slice_near) * _slice_scale;
+
+	const u32 size = num_z * _slice_stride;
+	array::resize(_min_x, size);
+	array::resize(_min_y, size);
+	array::resize(_min_z, size);
+	array::resize(_max_x, size);
+	array::resize(_max_y, size);
+	array::resize(_max_z, size);
+	array::resize(_slice_min_z, num_z);
+	array::resize(_slice_max_z, num_z);
+
+	for (u32 z = 0; z < num_z; ++z) {
+		const f32 depth_near = z == 0 ? _near : slice_near * exp2f(f32(z) / _slice_scale);
+		const f32 depth_far = z == num_z - 1 ? _far : slice_near * exp2f(f32(z + 1) / _slice_scale);
+		const u32 row = z * _slice_stride;
+
+		_slice_min_z[z] = FLT_MAX;
+		_slice_max_z[z] = -FLT_MAX;
+
+		for (u32 y = 0; y < num_y; ++y) {
+			for (u32 x = 0; x < num_x; ++x) {
+				const f32 x0 = -1.0f + 2.0f * f32(x + 0) / f32(num_x);
+				const f32 x1 = -1.0f + 2.0f * f32(x + 1) / f32(num_x);
+				const f32 y0 = -1.0f + 2.0f * f32(y + 0) / f32(num_y);
+				const f32 y1 = -1.0f + 2.0f * f32(y + 1) / f32(num_y);
+				const f32 corners[4][2] = { { x0, y0 }, { x1, y0 }, { x0, y1 }, { x1, y1 } };
+
+				Vector3 points[8];
+				for (u32 i = 0; i < countof(corners); ++i) {
+					const Vector3 a = light_clusters::unproject(inv_proj, corners[i][0], corners[i][1], -1.0f);
+					const Vector3 b = light_clusters::unproject(inv_proj, corners[i][0], corners[i][1], 1.0f);
+					points[i*2 + 0] = light_clusters::point_at_depth(a, b, depth_near);
+					points[i*2 + 1] = light_clusters::point_at_depth(a, b, depth_far);
+				}
+
+				AABB box;
+				aabb::from_points(box, countof(points), points);
+
+				const u32 i = row + y * num_x + x;
+				_min_x[i] = box.min.x;
+				_min_y[i] = box.min.y;
+				_min_z[i] = box.min.z;
+				_max_x[i] = box.max.x;
+				_max_y[i] = box.max.y;
+				_max_z[i] = box.max.z;
+				_slice_min_z[z] = min(_slice_min_z[z], box.min.z);
+				_slice_max_z[z] = max(_slice_max_z[z], box.max.z);
+			}
+		}
+
+		// Padding froxels are empty and never intersect any light.
+		for (u32 i = row + num_x * num_y; i < row + _slice_stride; ++i) {
+			_min_x[i] = FLT_MAX;
+			_min_y[i] = FLT_MAX;
+			_min_z[i] = FLT_MAX;
+			_max_x[i] = -FLT_MAX;
+			_max_y[i] = -FLT_MAX;
+			_max_z[i] = -FLT_MAX;
+		}
+	}
+}
+
+void LightClusters::add_omni(const Sphere &sphere)
+{
+	Sphere s;
+	s.c = sphere.c * _view;
+	s.r = sphere.r;
+	array::push_back(_spheres, s);
+
+	Cone cone;
+	cone.apex = VECTOR3_ZERO;
+	cone.range = -1.0f;
+	cone.direction = VECTOR3_ZERO;
+	cone.cos_angle = 0.0f;
+	cone.sin_angle = 0.0f;
+	array::push_back(_cones, cone);
+}
+
+void LightClusters::add_spot(const Sphere &sphere, const Vector3 &position, const Vector3 &direction, f32 range, f32 angle)
+{
+	add_omni(sphere);
+
+	// Cones wider than a half-space are only tested with their bounding sphere.
+	if (angle < PI_HALF) {
+		Cone &cone = array::back(_cones);
+		cone.apex = position * _view;
+		cone.range = range;
+		cone.direction = ((position + direction) * _view) - cone.apex;
+		normalize(cone.direction);
+		cone.cos_angle = fcos(angle);
+		cone.sin_angle = fsin(angle);
+	}
+}
+
+void LightClusters::assign()
+{
+	const u32 num_clusters = this->num_clusters();
+	_num_words = (array::size(_spheres) + 31) / 32;
+
+	array::resize(_masks, num_clusters * _num_words);
+	array::resize(_offset, num_clusters);
+	array::resize(_count, num_clusters);
+	if (array::size(_masks) != 0)
+		memset(array::begin(_masks), 0, array::size(_masks) * sizeof(u32));
+	memset(array::begin(_count), 0, num_clusters * sizeof(u32));
+
+	if (_num_words != 0)
+		job_system::parallel_for(_num_z, 1, light_clusters::assign_slices, this, "light_clusters.assign");
+
+	// Clusters past the capacity of the index list lose their lights.
+	u32 num_indices = 0;
+	for (u32 c = 0; c < num_clusters; ++c) {
+		_offset[c] = num_indices;
+		_count[c] = min(_count[c], _max_indices - num_indices);
+		num_indices += _count[c];
+	}
+
+	array::resize(_indices, num_indices);
+	if (num_indices != 0)
+		job_system::parallel_for(_num_z, 1, light_clusters::write_indices, this, "light_clusters.indices");
+}
+
+u32 LightClusters::num_clusters() const
+{
+	return _num_x * _num_y * _num_z;
+}
+
+u32 LightClusters::cluster(const Vector3 &p) const
+{
+	const Vector4 clip = Vector4 { p.x, p.y, p.z, 1.0f } * _proj;
+	const f32 ndc_x = clip.x / clip.w;
+	const f32 ndc_y = clip.y / clip.w;
+	const f32 depth = -p.z;
+
+	const f32 fx = ffloor((ndc_x * 0.5f + 0.5f) * f32(_num_x));
+	const f32 fy = ffloor((ndc_y * 0.5f + 0.5f) * f32(_num_y));
+	const f32 fz = depth > 0.0f ? ffloor(log2f(depth) * _slice_scale + _slice_bias) : 0.0f;
+
+	const u32 x = u32(clamp(fx, 0.0f, f32(_num_x - 1)));
+	const u32 y = u32(clamp(fy, 0.0f, f32(_num_y - 1)));
+	const u32 z = u32(clamp(fz, 0.0f, f32(_num_z - 1)));
+	return x + y * _num_x + z * _num_x * _num_y;
+}
+
+AABB LightClusters::froxel(u32 x, u32 y, u32 z) const
+{
+	CE_ENSURE(x < _num_x && y < _num_y && z < _num_z);
+	const u32 i = z * _slice_stride + y * _num_x + x;
+
+	AABB box;
+	box.min = { _min_x[i], _min_y[i], _min_z[i] };
+	box.max = { _max_x[i], _max_y[i], _max_z[i] };
+	return box;
+}
+
+} // namespace crown
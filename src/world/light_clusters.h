@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2012-2026 Daniele Bartolini et al.
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include "core/containers/types.h"
+#include "core/math/types.h"
+#include "core/memory/types.h"
+#include "core/types.h"
+
+namespace crown
+{
+/// Assignment of local lights to the clusters of a froxel grid.
+///
+/// The view frustum is divided into num_x * num_y tiles in NDC and num_z
+/// slices exponentially distributed between the near and far view depths.
+/// Each cluster lists the lights whose bounds intersect the cluster's view
+/// space AABB. Spot lights are additionally tested against the cluster's
+/// bounding sphere with their cone. Clusters are processed one slice per
+/// job, four clusters at a time with the SIMD kernels when available.
+///
+/// @ingroup World
+struct LightClusters
+{
+	struct Cone
+	{
+		Vector3 apex;
+		f32 range; ///< Negative for lights without a cone.
+		Vector3 direction;
+		f32 cos_angle;
+		f32 sin_angle;
+	};
+
+	Array<f32> _min_x;      ///< View space froxel bounds, one row of
+	Array<f32> _min_y;      ///< _slice_stride entries per slice.
+	Array<f32> _min_z;
+	Array<f32> _max_x;
+	Array<f32> _max_y;
+	Array<f32> _max_z;
+	Array<f32> _slice_min_z; ///< View space depth range of all the froxels in a slice.
+	Array<f32> _slice_max_z;
+	Array<Sphere> _spheres; ///< View space light bounds.
+	Array<Cone> _cones;     ///< View space light cones.
+	Array<u32> _masks;      ///< _num_words bits per cluster, bit i set if light i intersects the cluster.
+	Array<u32> _offset;     ///< Offset of the cluster's lights in _indices.
+	Array<u32> _count;      ///< Number of lights in the cluster.
+	Array<u32> _indices;    ///< Light indices of all clusters.
+	Matrix4x4 _view;
+	Matrix4x4 _proj;
+	u32 _num_x;
+	u32 _num_y;
+	u32 _num_z;
+	u32 _slice_stride;
+	u32 _num_words;
+	u32 _max_indices;
+	f32 _near;
+	f32 _far;
+	f32 _slice_scale;       ///< Slice of view depth d is floor(log2(d) * _slice_scale + _slice_bias).
+	f32 _slice_bias;
+
+	///
+	explicit LightClusters(Allocator &a);
+
+	/// Removes all the lights and rebuilds the froxel grid of @a num_x * @a num_y * @a num_z
+	/// clusters from @a view and @a proj. @a proj must map depth to [-1; 1]. At most
+	/// @a max_indices light indices are stored across all clusters.
+	void reset(u32 num_x, u32 num_y, u32 num_z, const Matrix4x4 &view, const Matrix4x4 &proj, u32 max_indices);
+
+	/// Adds an omni light bounded by the world space @a sphere.
+	void add_omni(const Sphere &sphere);
+
+	/// Adds a spot light bounded by the world space @a sphere with apex @a position,
+	/// direction @a direction, length @a range and half angle @a angle.
+	void add_spot(const Sphere &sphere, const Vector3 &position, const Vector3 &direction, f32 range, f32 angle);
+
+	/// Assigns the lights to the clusters. Lights are identified by the order they
+	/// were added in.
+	void assign();
+
+	/// Returns the number of clusters.
+	u32 num_clusters() const;
+
+	/// Returns the index of the cluster containing the view space point @a p.
+	u32 cluster(const Vector3 &p) const;
+
+	/// Returns the view space bounds of the cluster @a x, @a y, @a z.
+	AABB froxel(u32 x, u32 y, u32 z) const;
+};
+
+} // namespace crown
@@ -23,16 +23,18 @@ Material::Material(Allocator &a)
 	CE_UNUSED(a);
 }
 
-void Material::bind(u8 view, u32 depth) const
+void Material::bind(u8 view, u32 depth, bool instanced, u8 discard) const
 {
 	using namespace material_resource;
+	CE_ASSERT(!instanced || has_instanced_shader(), "Material has no instanced shader");
+	const ShaderData &shader = instanced ? _instanced_shader : _shader;
 
 	const TextureData *td = texture_data_array(_resource);
 
 	// Keep every sampler declared by the shader bound. Some backends cannot
 	// leave it unbound even when the shader skips the texture access at runtime.
-	for (u32 si = 0; si < _shader.num_samplers; ++si) {
-		const ShaderResource::Sampler &sampler = _shader.samplers[si];
+	for (u32 si = 0; si < shader.num_samplers; ++si) {
+		const ShaderResource::Sampler &sampler = shader.samplers[si];
 		if (sampler.stage >= MATERIAL_MAX_TEXTURE_SLOTS)
 			continue;
 
@@ -70,9 +72,20 @@ void Material::bind(u8 view, u32 depth) const
 		bgfx::setUniform(buh, (char *)uh + sizeof(uh->uniform_handle));
 	}
 
-	bgfx::setState(_shader.state | BGFX_STATE_MSAA);
-	bgfx::setStencil(_shader.stencil_front, _shader.stencil_back);
-	bgfx::submit(view, _shader.program, depth);
+	bgfx::setState(shader.state | BGFX_STATE_MSAA);
+	bgfx::setStencil(shader.stencil_front, shader.stencil_back);
+	bgfx::submit(view, shader.program, depth, discard);
+}
+
+void Material::submit(u8 view, u32 depth, bool instanced, u8 discard) const
+{
+	CE_ASSERT(!instanced || has_instanced_shader(), "Material has no instanced shader");
+	bgfx::submit(view, instanced ? _instanced_shader.program : _shader.program, depth, discard);
+}
+
+bool Material::has_instanced_shader() const
+{
+	return bgfx::isValid(_instanced_shader.program);
 }
 
 template<typename T>
@@ -24,6 +24,8 @@ struct Material
 	const MaterialResource *_resource;
 	char *_data;
 	ShaderData _shader;
+	ShaderData _instanced_shader; ///< Program is invalid if the shader has no INSTANCING variant.
+	u32 _id;                      ///< Unique id, used to sort draw calls.
 #if CROWN_CAN_RELOAD
 	Array<TextureResource *> _texture_resources;
 #endif
@@ -31,8 +33,17 @@ struct Material
 	///
 	explicit Material(Allocator &a);
 
-	///
-	void bind(u8 view, u32 depth = 0u) const;
+	/// Binds textures, uniforms and state and submits to @a view. If @a instanced is true, the
+	/// INSTANCING variant of the shader is used and instance data must have been set already.
+	/// @a discard is forwarded to bgfx::submit().
+	void bind(u8 view, u32 depth = 0u, bool instanced = false, u8 discard = BGFX_DISCARD_ALL) const;
+
+	/// Submits to @a view reusing the textures, uniforms and state of a previous bind() of this
+	/// material whose @a discard flags kept them.
+	void submit(u8 view, u32 depth = 0u, bool instanced = false, u8 discard = BGFX_DISCARD_ALL) const;
+
+	/// Returns whether the material can be drawn with bind(..., instanced = true).
+	bool has_instanced_shader() const;
 
 	/// Sets the @a value of the variable @a name.
 	void set_float(StringId32 name, f32 value);
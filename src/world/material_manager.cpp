@@ -28,6 +28,18 @@ static const bgfx::UniformType::Enum s_bgfx_uniform_type[] =
 };
 CE_STATIC_ASSERT(countof(s_bgfx_uniform_type) == UniformType::COUNT);
 
+static void material_manager_set_instanced_shader(Material *m, ShaderManager &sm)
+{
+	const StringId32 name = m->_resource->instanced_shader;
+
+	if (name._id != 0 && sm.has(name)) {
+		m->_instanced_shader = sm.shader(name);
+	} else {
+		m->_instanced_shader = m->_shader;
+		m->_instanced_shader.program = BGFX_INVALID_HANDLE;
+	}
+}
+
 MaterialManager::MaterialManager(Allocator &a, ResourceManager &rm, ShaderManager &sm)
 	: _allocator(&a)
 	, _resource_manager(&rm)
@@ -36,6 +48,7 @@ MaterialManager::MaterialManager(Allocator &a, ResourceManager &rm, ShaderManage
 {
 	memset(_default_samplers, UINT8_MAX, sizeof(_default_samplers));
 	_default_texture = BGFX_INVALID_HANDLE;
+	_next_material_id = 0;
 }
 
 MaterialManager::~MaterialManager()
@@ -144,7 +157,9 @@ Material *MaterialManager::create_material(const MaterialResource *resource)
 	material->_material_manager = this;
 	material->_resource = resource;
 	material->_data = (char *)&material[1];
+	material->_id = _next_material_id++;
 	material->_shader = _shader_manager->shader(resource->shader);
+	material_manager_set_instanced_shader(material, *_shader_manager);
 
 	const char *dynamic_data = (char *)resource + resource->dynamic_data_offset;
 	memcpy(material->_data, dynamic_data, resource->dynamic_data_size);
@@ -191,6 +206,7 @@ void MaterialManager::reload_shaders(const ShaderResource *old_resource, const S
 		Material *m = cur->second;
 		if (m->_shader.resource == old_resource) {
 			m->_shader = _shader_manager->shader(m->_resource->shader);
+			material_manager_set_instanced_shader(m, *_shader_manager);
 		}
 	}
 #else
@@ -24,6 +24,7 @@ struct MaterialManager
 	HashMap<const MaterialResource *, Material *> _materials;
 	bgfx::UniformHandle _default_samplers[MATERIAL_MAX_TEXTURE_SLOTS];
 	bgfx::TextureHandle _default_texture;
+	u32 _next_material_id;
 
 	///
 	MaterialManager(Allocator &a, ResourceManager &rm, ShaderManager &sm);
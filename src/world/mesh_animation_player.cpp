@@ -10,6 +10,7 @@
 #include "core/math/matrix4x4.inl"
 #include "core/math/quaternion.inl"
 #include "core/math/vector3.inl"
+#include "core/memory/temp_allocator.inl"
 #include "core/profiler.h"
 #include "core/strings/string_id.inl"
 #include "device/device.h"
@@ -169,7 +170,7 @@ namespace mesh_animation_player
 		return index.index != UINT32_MAX && index.id == anim_id;
 	}
 
-	void evaluate(MeshAnimationPlayer &p, AnimationId anim_id, f32 time, UnitId unit, SceneGraph &scene_graph, const UnitId *bone_lookup, EventStream &events, bool reset)
+	void evaluate(MeshAnimationPlayer &p, AnimationId anim_id, f32 time, UnitId unit, SceneGraph &scene_graph, const TransformId *bone_transforms, EventStream &events, bool reset)
 	{
 		MeshAnimationPlayer::Index &index = p._indices[anim_id & ANIMATION_INDEX_MASK];
 		MeshAnimation &anim = p._animations[index.index];
@@ -199,6 +200,16 @@ namespace mesh_animation_player
 
 		const u16 *bone_ids = mesh_animation_resource::bone_ids(anim.animation_resource);
 
+		TempAllocator4096 ta;
+		Array<TransformId> position_transforms(ta);
+		Array<Vector3> positions(ta);
+		Array<TransformId> rotation_transforms(ta);
+		Array<Quaternion> rotations(ta);
+		array::reserve(position_transforms, anim.num_tracks);
+		array::reserve(positions, anim.num_tracks);
+		array::reserve(rotation_transforms, anim.num_tracks);
+		array::reserve(rotations, anim.num_tracks);
+
 		// Evaluate animation data at current time.
 		for (u32 track_id = 0; track_id < anim.num_tracks; ++track_id) {
 			AnimationTrackSegment *track = track_segment(p, anim, track_id);
@@ -211,17 +222,20 @@ namespace mesh_animation_player
 
 			if (track->keys[0].h.type == AnimationKeyHeader::Type::POSITION) {
 				Vector3 pos = lerp(track->keys[0].p.value, track->keys[1].p.value, t);
-				TransformId ti = scene_graph.instance(bone_lookup[bone_ids[track_id]]);
-				scene_graph.set_local_position(ti, pos);
+				array::push_back(position_transforms, bone_transforms[bone_ids[track_id]]);
+				array::push_back(positions, pos);
 			} else if (track->keys[0].h.type == AnimationKeyHeader::Type::ROTATION) {
 				Quaternion rot = lerp(track->keys[0].r.value, track->keys[1].r.value, t);
-				TransformId ti = scene_graph.instance(bone_lookup[bone_ids[track_id]]);
-				scene_graph.set_local_rotation(ti, rot);
+				array::push_back(rotation_transforms, bone_transforms[bone_ids[track_id]]);
+				array::push_back(rotations, rot);
 			} else {
 				CE_FATAL("Unknown key type %u in track %u", track->keys[0].h.type, track_id);
 			}
 		}
 
+		scene_graph.set_local_positions(array::begin(position_transforms), array::begin(positions), array::size(positions));
+		scene_graph.set_local_rotations(array::begin(rotation_transforms), array::begin(rotations), array::size(rotations));
+
 		// Generate events.
 		const u16 *event_times = mesh_animation_resource::event_times(anim.animation_resource);
 		const u16 *event_end = event_times + anim.animation_resource->num_events;
@@ -71,7 +71,9 @@ namespace mesh_animation_player
 	bool has(MeshAnimationPlayer &p, AnimationId anim_id);
 
 	///
-	void evaluate(MeshAnimationPlayer &p, AnimationId anim_id, f32 time, UnitId unit, SceneGraph &scene_graph, const UnitId *bone_lookup, EventStream &events, bool reset);
+	/// Evaluates the animation @a anim_id at @a time and writes the resulting
+	/// local poses to the @a bone_transforms in @a scene_graph.
+	void evaluate(MeshAnimationPlayer &p, AnimationId anim_id, f32 time, UnitId unit, SceneGraph &scene_graph, const TransformId *bone_transforms, EventStream &events, bool reset);
 
 	///
 	void reload(MeshAnimationPlayer &p, const MeshAnimationResource *old_resource, const MeshAnimationResource *new_resource);
@@ -0,0 +1,294 @@
+/*
+ * Copyright (c) 2012-2026 Daniele Bartolini et al.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "core/containers/array.inl"
+#include "core/math/math.inl"
+#include "core/math/matrix4x4.inl"
+#include "core/math/obb.inl"
+#include "core/math/simd.h"
+#include "world/occlusion_buffer.h"
+#include <float.h> // FLT_MAX
+
+namespace crown
+{
+namespace occlusion_buffer
+{
+	/// Vertices with clip space w below this are considered to cross the near plane.
+	static const f32 NEAR_W = 1e-4f;
+
+	struct ScreenVertex
+	{
+		f32 x;
+		f32 y;
+		f32 z;
+	};
+
+	static ScreenVertex to_screen(const Vector4 &clip, f32 width, f32 height)
+	{
+		const f32 inv_w = 1.0f / clip.w;
+		ScreenVertex v;
+		v.x = (clip.x*inv_w*0.5f + 0.5f) * width;
+		v.y = (0.5f - clip.y*inv_w*0.5f) * height;
+		v.z = clip.z*inv_w;
+		return v;
+	}
+
+	/// Returns the set of clip planes @a clip is outside of. The near plane is handled separately.
+	static u32 outcode(const Vector4 &clip)
+	{
+		return u32(clip.x < -clip.w) << 0
+			| u32(clip.x > clip.w) << 1
+			| u32(clip.y < -clip.w) << 2
+			| u32(clip.y > clip.w) << 3
+			| u32(clip.z > clip.w) << 4
+			;
+	}
+
+	/// Coefficients of the edge function A*x + B*y + C from @a a to @a b. It is
+	/// positive on the inside of counter-clockwise (in screen space) triangles.
+	struct Edge
+	{
+		f32 a;
+		f32 b;
+		f32 c;
+	};
+
+	static Edge edge(const ScreenVertex &a, const ScreenVertex &b)
+	{
+		Edge e;
+		e.a = a.y - b.y;
+		e.b = b.x - a.x;
+		e.c = -(e.a*a.x + e.b*a.y);
+		return e;
+	}
+
+	static void draw_triangle(OcclusionBuffer &ob, ScreenVertex v0, ScreenVertex v1, ScreenVertex v2)
+	{
+		f32 area = (v1.x - v0.x)*(v2.y - v0.y) - (v2.x - v0.x)*(v1.y - v0.y);
+		if (area < 0.0f) {
+			const ScreenVertex tmp = v1;
+			v1 = v2;
+			v2 = tmp;
+			area = -area;
+		}
+
+		if (!(area > 0.0f))
+			return;
+
+		// Range of pixels whose centers are inside the bounds of the triangle.
+		const f32 min_x = fceil(min(v0.x, min(v1.x, v2.x)) - 0.5f);
+		const f32 max_x = ffloor(max(v0.x, max(v1.x, v2.x)) - 0.5f);
+		const f32 min_y = fceil(min(v0.y, min(v1.y, v2.y)) - 0.5f);
+		const f32 max_y = ffloor(max(v0.y, max(v1.y, v2.y)) - 0.5f);
+		if (max_x < 0.0f || min_x > f32(ob._width - 1) || max_y < 0.0f || min_y > f32(ob._height - 1))
+			return;
+
+		const u32 x0 = u32(max(min_x, 0.0f));
+		const u32 x1 = u32(min(max_x, f32(ob._width - 1)));
+		const u32 y0 = u32(max(min_y, 0.0f));
+		const u32 y1 = u32(min(max_y, f32(ob._height - 1)));
+
+		// Move the edges inward by half a pixel, so that the functions at pixel
+		// centers are non-negative only for pixels the triangle fully covers.
+		Edge e0 = edge(v1, v2);
+		Edge e1 = edge(v2, v0);
+		Edge e2 = edge(v0, v1);
+		e0.c -= (fabs(e0.a) + fabs(e0.b))*0.5f;
+		e1.c -= (fabs(e1.a) + fabs(e1.b))*0.5f;
+		e2.c -= (fabs(e2.a) + fabs(e2.b))*0.5f;
+
+		// Depth is interpolated at the farthest corner of each pixel, and never
+		// exceeds the farthest vertex, to not occlude more than the triangle does.
+		const f32 dzdx = ((v1.z - v0.z)*(v2.y - v0.y) - (v2.z - v0.z)*(v1.y - v0.y)) / area;
+		const f32 dzdy = ((v2.z - v0.z)*(v1.x - v0.x) - (v1.z - v0.z)*(v2.x - v0.x)) / area;
+		const f32 dzc = v0.z - dzdx*v0.x - dzdy*v0.y + (fabs(dzdx) + fabs(dzdy))*0.5f;
+		const f32 z_max = max(v0.z, max(v1.z, v2.z));
+
+#if CROWN_SIMD
+		const f32x4 zero = f32x4_splat(0.0f);
+		const f32x4 offsets = f32x4_set(0.5f, 1.5f, 2.5f, 3.5f);
+		const f32x4 a0 = f32x4_splat(e0.a);
+		const f32x4 a1 = f32x4_splat(e1.a);
+		const f32x4 a2 = f32x4_splat(e2.a);
+		const f32x4 dzdx4 = f32x4_splat(dzdx);
+		const f32x4 z_max4 = f32x4_splat(z_max);
+#endif
+
+		for (u32 y = y0; y <= y1; ++y) {
+			const f32 py = f32(y) + 0.5f;
+			const f32 r0 = e0.b*py + e0.c;
+			const f32 r1 = e1.b*py + e1.c;
+			const f32 r2 = e2.b*py + e2.c;
+			const f32 rz = dzdy*py + dzc;
+			f32 *row = array::begin(ob._depth) + y*ob._width;
+
+#if CROWN_SIMD
+			const f32x4 r04 = f32x4_splat(r0);
+			const f32x4 r14 = f32x4_splat(r1);
+			const f32x4 r24 = f32x4_splat(r2);
+			const f32x4 rz4 = f32x4_splat(rz);
+
+			for (u32 x = x0 & ~3u; x <= x1; x += 4) {
+				const f32x4 px = f32x4_add(f32x4_splat(f32(x)), offsets);
+				f32x4 inside = f32x4_cmpge(f32x4_add(f32x4_mul(a0, px), r04), zero);
+				inside = f32x4_and(inside, f32x4_cmpge(f32x4_add(f32x4_mul(a1, px), r14), zero));
+				inside = f32x4_and(inside, f32x4_cmpge(f32x4_add(f32x4_mul(a2, px), r24), zero));
+				if (f32x4_movemask(inside) == 0)
+					continue;
+
+				const f32x4 z = f32x4_min(f32x4_add(f32x4_mul(dzdx4, px), rz4), z_max4);
+				const f32x4 depth = f32x4_load(row + x);
+				f32x4_store(row + x, f32x4_select(inside, f32x4_min(z, depth), depth));
+			}
+#else
+			for (u32 x = x0; x <= x1; ++x) {
+				const f32 px = f32(x) + 0.5f;
+				if (e0.a*px + r0 >= 0.0f && e1.a*px + r1 >= 0.0f && e2.a*px + r2 >= 0.0f) {
+					const f32 z = min(dzdx*px + rz, z_max);
+					row[x] = z < row[x] ? z : row[x];
+				}
+			}
+#endif // if CROWN_SIMD
+		}
+	}
+
+	/// Rasterizes the @a num indices of the triangle list (@a vertices, @a stride, @a indices).
+	template<typename T>
+	static void add_triangles(OcclusionBuffer &ob, const Matrix4x4 &world, const void *vertices, u32 stride, const T *indices, u32 num)
+	{
+		const Matrix4x4 mvp = world * ob._view_proj;
+		const f32 width = f32(ob._width);
+		const f32 height = f32(ob._height);
+
+		for (u32 i = 0; i + 2 < num; i += 3) {
+			Vector4 clip[3];
+			u32 outside = UINT32_MAX;
+			bool crosses_near = false;
+			for (u32 j = 0; j < 3; ++j) {
+				const f32 *p = (const f32 *)((const char *)vertices + indices[i + j]*stride);
+				const Vector4 v = { p[0], p[1], p[2], 1.0f };
+				clip[j] = v * mvp;
+				crosses_near |= clip[j].w <= NEAR_W;
+				outside &= outcode(clip[j]);
+			}
+
+			// Triangles crossing the near plane are skipped instead of clipped.
+			if (crosses_near || outside != 0)
+				continue;
+
+			draw_triangle(ob
+				, to_screen(clip[0], width, height)
+				, to_screen(clip[1], width, height)
+				, to_screen(clip[2], width, height)
+				);
+			++ob._num_triangles;
+		}
+	}
+
+} // namespace occlusion_buffer
+
+OcclusionBuffer::OcclusionBuffer(Allocator &a)
+	: _depth(a)
+	, _width(0)
+	, _height(0)
+	, _view_proj(MATRIX4X4_IDENTITY)
+	, _num_triangles(0)
+{
+}
+
+void OcclusionBuffer::reset(u32 width, u32 height, const Matrix4x4 &view_proj)
+{
+	_width = max((width + 3) & ~3u, 4u);
+	_height = max(height, 1u);
+	_view_proj = view_proj;
+	_num_triangles = 0;
+
+	array::resize(_depth, _width*_height);
+	for (u32 i = 0; i < _width*_height; ++i)
+		_depth[i] = FLT_MAX;
+}
+
+void OcclusionBuffer::add_triangles(const Matrix4x4 &world, const void *vertices, u32 stride, const u16 *indices, u32 num)
+{
+	occlusion_buffer::add_triangles(*this, world, vertices, stride, indices, num);
+}
+
+void OcclusionBuffer::add_triangles(const Matrix4x4 &world, const void *vertices, u32 stride, const u32 *indices, u32 num)
+{
+	occlusion_buffer::add_triangles(*this, world, vertices, stride, indices, num);
+}
+
+bool OcclusionBuffer::visible(const OBB &obb) const
+{
+	if (_num_triangles == 0)
+		return true;
+
+	Vector3 vertices[8];
+	obb::to_vertices(vertices, obb);
+
+	const f32 width = f32(_width);
+	const f32 height = f32(_height);
+	f32 min_x = FLT_MAX;
+	f32 min_y = FLT_MAX;
+	f32 max_x = -FLT_MAX;
+	f32 max_y = -FLT_MAX;
+	f32 min_z = FLT_MAX;
+	for (u32 i = 0; i < countof(vertices); ++i) {
+		const Vector4 v = { vertices[i].x, vertices[i].y, vertices[i].z, 1.0f };
+		const Vector4 clip = v * _view_proj;
+		if (clip.w <= occlusion_buffer::NEAR_W)
+			return true;
+
+		const occlusion_buffer::ScreenVertex sv = occlusion_buffer::to_screen(clip, width, height);
+		min_x = min(min_x, sv.x);
+		min_y = min(min_y, sv.y);
+		max_x = max(max_x, sv.x);
+		max_y = max(max_y, sv.y);
+		min_z = min(min_z, sv.z);
+	}
+
+	// Range of pixels touched by the screen rectangle.
+	min_x = ffloor(min_x);
+	min_y = ffloor(min_y);
+	max_x = ffloor(max_x);
+	max_y = ffloor(max_y);
+	if (max_x < 0.0f || min_x > width - 1.0f || max_y < 0.0f || min_y > height - 1.0f)
+		return true;
+
+	const u32 x0 = u32(max(min_x, 0.0f));
+	const u32 x1 = u32(min(max_x, width - 1.0f));
+	const u32 y0 = u32(max(min_y, 0.0f));
+	const u32 y1 = u32(min(max_y, height - 1.0f));
+
+	// The object is hidden if every pixel has an occluder in front of it.
+#if CROWN_SIMD
+	const f32x4 min_z4 = f32x4_splat(min_z);
+	for (u32 y = y0; y <= y1; ++y) {
+		const f32 *row = array::begin(_depth) + y*_width;
+		for (u32 x = x0 & ~3u; x <= x1; x += 4) {
+			u32 lanes = 0xfu;
+			if (x < x0)
+				lanes &= 0xfu << (x0 - x);
+			if (x + 3 > x1)
+				lanes &= 0xfu >> (x + 3 - x1);
+
+			if ((f32x4_movemask(f32x4_cmpge(f32x4_load(row + x), min_z4)) & lanes) != 0)
+				return true;
+		}
+	}
+#else
+	for (u32 y = y0; y <= y1; ++y) {
+		const f32 *row = array::begin(_depth) + y*_width;
+		for (u32 x = x0; x <= x1; ++x) {
+			if (row[x] >= min_z)
+				return true;
+		}
+	}
+#endif // if CROWN_SIMD
+
+	return false;
+}
+
+} // namespace crown
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2012-2026 Daniele Bartolini et al.
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include "core/containers/types.h"
+#include "core/math/types.h"
+#include "core/memory/types.h"
+#include "core/types.h"
+
+namespace crown
+{
+/// Low resolution depth buffer of occluder triangles rasterized on the CPU.
+///
+/// Each pixel stores the depth of the nearest occluder covering it entirely,
+/// with depth being the NDC z of the projection. Pixels covered only by the
+/// union of several triangles, such as those along the shared edges of a
+/// mesh, are not occluded. Triangles crossing the near plane are not
+/// rasterized and objects crossing it are never occluded, so the buffer only
+/// ever errs on the side of visibility. Rows are processed four pixels at a
+/// time with the SIMD kernels when available.
+///
+/// @ingroup World
+struct OcclusionBuffer
+{
+	Array<f32> _depth;
+	u32 _width;
+	u32 _height;
+	Matrix4x4 _view_proj;
+	u32 _num_triangles;
+
+	///
+	explicit OcclusionBuffer(Allocator &a);
+
+	/// Clears the buffer and resizes it to @a width x @a height pixels. @a width
+	/// is rounded up to a multiple of 4. Occluders and objects are projected with
+	/// @a view_proj.
+	void reset(u32 width, u32 height, const Matrix4x4 &view_proj);
+
+	/// Rasterizes the @a num indices of the triangle list (@a vertices, @a stride, @a indices)
+	/// transformed by @a world. Vertex positions are the first 3 floats of each vertex.
+	void add_triangles(const Matrix4x4 &world, const void *vertices, u32 stride, const u16 *indices, u32 num);
+
+	/// @copydoc OcclusionBuffer::add_triangles()
+	void add_triangles(const Matrix4x4 &world, const void *vertices, u32 stride, const u32 *indices, u32 num);
+
+	/// Returns whether any part of @a obb may be visible behind the occluders.
+	bool visible(const OBB &obb) const;
+};
+
+} // namespace crown
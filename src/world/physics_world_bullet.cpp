@@ -33,6 +33,7 @@
 #include "world/physics_world.h"
 #include "world/scene_graph.h"
 #include "world/unit_manager.h"
+#include "world/unit_map.inl"
 #if CROWN_COMPILER_MSVC
 #pragma warning(push)
 #pragma warning(disable:4244) // conversion from 'double' to 'float', possible loss of data
@@ -1367,10 +1368,10 @@ struct PhysicsWorldImpl
 	Allocator *_allocator;
 	UnitManager *_unit_manager;
 
-	HashMap<UnitId, u32> _collider_map;
-	HashMap<UnitId, u32> _actor_map;
-	HashMap<UnitId, u32> _mover_map;
-	HashMap<UnitId, u32> _joint_map;
+	UnitMap<u32> _collider_map;
+	UnitMap<u32> _actor_map;
+	UnitMap<u32> _mover_map;
+	UnitMap<u32> _joint_map;
 	HashMap<u64, u32> _collider_shape_map;
 	Array<ColliderShapeData> _collider_shape;
 	Array<ColliderInstanceData> _collider;
@@ -1444,6 +1445,7 @@ struct PhysicsWorldImpl
 		_dynamics_world->getPairCache()->setOverlapFilterCallback(&_filter_callback);
 
 		_unit_destroy_callback.destroy = PhysicsWorldImpl::unit_destroyed_callback;
+		_unit_destroy_callback.destroy_batch = NULL;
 		_unit_destroy_callback.user_data = this;
 		_unit_destroy_callback.node.next = NULL;
 		_unit_destroy_callback.node.prev = NULL;
@@ -1544,13 +1546,13 @@ struct PhysicsWorldImpl
 			part.m_vertexStride        = sizeof(Vector3);
 			part.m_numVertices         = num_points;
 			part.m_triangleIndexBase   = (const unsigned char *)indices;
-			part.m_triangleIndexStride = sizeof(u16)*3;
+			part.m_triangleIndexStride = sizeof(u32)*3;
 			part.m_numTriangles        = num_indices/3;
-			part.m_indexType           = PHY_SHORT;
+			part.m_indexType           = PHY_INTEGER;
 
 			csd.allocator = _allocator;
 			csd.vertex_array = CE_NEW(*csd.allocator, btTriangleIndexVertexArray)();
-			csd.vertex_array->addIndexedMesh(part, PHY_SHORT);
+			csd.vertex_array->addIndexedMesh(part, PHY_INTEGER);
 
 			const btVector3 aabb_min(-1000.0f, -1000.0f, -1000.0f);
 			const btVector3 aabb_max(1000.0f, 1000.0f, 1000.0f);
@@ -1633,7 +1635,7 @@ struct PhysicsWorldImpl
 
 			const u32 last = array::size(_collider);
 			array::push_back(_collider, cid);
-			hash_map::set(_collider_map, unit, last);
+			unit_map::set(_collider_map, unit, last);
 		}
 	}
 
@@ -1649,17 +1651,17 @@ struct PhysicsWorldImpl
 
 		if (collider.i != last) {
 			_collider[collider.i] = _collider[last];
-			hash_map::set(_collider_map, last_u, collider.i);
+			unit_map::set(_collider_map, last_u, collider.i);
 		}
 
 		array::pop_back(_collider);
 
-		hash_map::remove(_collider_map, u);
+		unit_map::remove(_collider_map, u);
 	}
 
 	ColliderId collider_instance(UnitId unit)
 	{
-		return make_collider_instance(hash_map::get(_collider_map, unit, UINT32_MAX));
+		return make_collider_instance(unit_map::get(_collider_map, unit, UINT32_MAX));
 	}
 
 	void actor_create_instances(const void *components_data, u32 num, const UnitId *unit_lookup, const u32 *unit_index)
@@ -1672,7 +1674,7 @@ struct PhysicsWorldImpl
 
 		for (u32 i = 0; i < num; ++i) {
 			UnitId unit = unit_lookup[unit_index[i]];
-			CE_ASSERT(!hash_map::has(_actor_map, unit), "Unit already has an actor component");
+			CE_ASSERT(!unit_map::has(_actor_map, unit), "Unit already has an actor component");
 
 			TransformId ti = _scene_graph->instance(unit);
 			Matrix4x4 tm = _scene_graph->world_pose(ti);
@@ -1752,7 +1754,7 @@ struct PhysicsWorldImpl
 			aid.resource = &actors[i];
 
 			array::push_back(_actor, aid);
-			hash_map::set(_actor_map, unit, last);
+			unit_map::set(_actor_map, unit, last);
 		}
 	}
 
@@ -1769,17 +1771,17 @@ struct PhysicsWorldImpl
 		if (actor.i != last) {
 			_actor[actor.i] = _actor[last];
 			_actor[actor.i].body->m_userObjectPointer = ((void *)(uintptr_t)actor.i);
-			hash_map::set(_actor_map, last_u, actor.i);
+			unit_map::set(_actor_map, last_u, actor.i);
 		}
 
 		array::pop_back(_actor);
 
-		hash_map::remove(_actor_map, u);
+		unit_map::remove(_actor_map, u);
 	}
 
 	ActorId actor(UnitId unit)
 	{
-		return make_actor_instance(hash_map::get(_actor_map, unit, UINT32_MAX));
+		return make_actor_instance(unit_map::get(_actor_map, unit, UINT32_MAX));
 	}
 
 	Vector3 actor_world_position(ActorId actor) const
@@ -2030,7 +2032,7 @@ struct PhysicsWorldImpl
 
 		for (u32 i = 0; i < num; ++i) {
 			UnitId unit = unit_lookup[unit_index[i]];
-			CE_ASSERT(!hash_map::has(_mover_map, unit), "Unit already has a mover component");
+			CE_ASSERT(!unit_map::has(_mover_map, unit), "Unit already has a mover component");
 
 			const Matrix4x4 tm = _scene_graph->world_pose(_scene_graph->instance(unit));
 			const PhysicsCollisionFilter *f = &filters[physics_config_resource::filter_index(filters, _config_resource->num_filters, movers[i].collision_filter)];
@@ -2067,7 +2069,7 @@ struct PhysicsWorldImpl
 
 			const u32 last = array::size(_mover);
 			array::push_back(_mover, { unit, ghost, mover });
-			hash_map::set(_mover_map, unit, last);
+			unit_map::set(_mover_map, unit, last);
 		}
 	}
 
@@ -2081,13 +2083,13 @@ struct PhysicsWorldImpl
 		_mover[mover.i] = _mover[last];
 		array::pop_back(_mover);
 
-		hash_map::set(_mover_map, last_u, mover.i);
-		hash_map::remove(_mover_map, u);
+		unit_map::set(_mover_map, last_u, mover.i);
+		unit_map::remove(_mover_map, u);
 	}
 
 	MoverId mover(UnitId unit)
 	{
-		return make_mover_instance(hash_map::get(_mover_map, unit, UINT32_MAX));
+		return make_mover_instance(unit_map::get(_mover_map, unit, UINT32_MAX));
 	}
 
 	void mover_set_height(MoverId mover, float height)
@@ -2372,7 +2374,7 @@ struct PhysicsWorldImpl
 
 	JointId joint_instance(UnitId unit)
 	{
-		return make_joint_instance(hash_map::get(_joint_map, unit, UINT32_MAX));
+		return make_joint_instance(unit_map::get(_joint_map, unit, UINT32_MAX));
 	}
 
 	void joint_create_instances(const void *components_data, u32 num, const UnitId *unit_lookup, const u32 *unit_index)
@@ -2399,7 +2401,7 @@ struct PhysicsWorldImpl
 			CE_ASSERT(!has_actor || actor.i < array::size(_actor), "Index out of bounds");
 			CE_ASSERT(!has_other_actor || other_actor.i < array::size(_actor), "Index out of bounds");
 			CE_ASSERT(owner_unit != UNIT_INVALID, "Joint must have an owner unit");
-			CE_ASSERT(!hash_map::has(_joint_map, owner_unit), "Unit already has a joint component");
+			CE_ASSERT(!unit_map::has(_joint_map, owner_unit), "Unit already has a joint component");
 
 			btRigidBody *body = has_actor ? _actor[actor.i].body : NULL;
 			btRigidBody *other_body = has_other_actor ? _actor[other_actor.i].body : NULL;
@@ -2613,7 +2615,7 @@ struct PhysicsWorldImpl
 			_dynamics_world->addConstraint(joint);
 			const u32 last = array::size(_joints);
 			array::push_back(_joints, joint);
-			hash_map::set(_joint_map, owner_unit, last);
+			unit_map::set(_joint_map, owner_unit, last);
 		}
 	}
 
@@ -2631,8 +2633,8 @@ struct PhysicsWorldImpl
 		array::pop_back(_joints);
 
 		if (i.i != last)
-			hash_map::set(_joint_map, last_unit, i.i);
-		hash_map::remove(_joint_map, unit);
+			unit_map::set(_joint_map, last_unit, i.i);
+		unit_map::remove(_joint_map, unit);
 	}
 
 	void joint_set_break_force(JointId joint, f32 force)
@@ -3137,7 +3139,7 @@ struct PhysicsWorldImpl
 		for (; begin != end; ++begin, ++begin_world) {
 			u32 inst;
 
-			if ((inst = hash_map::get(_actor_map, *begin, UINT32_MAX)) != UINT32_MAX) {
+			if ((inst = unit_map::get(_actor_map, *begin, UINT32_MAX)) != UINT32_MAX) {
 				btRigidBody *body = _actor[inst].body;
 
 				// http://www.bulletphysics.org/mediawiki-1.5.8/index.php/MotionStates
@@ -4,7 +4,6 @@
  */
 
 #include "core/containers/array.inl"
-#include "core/containers/hash_map.inl"
 #include "core/list.inl"
 #include "core/math/aabb.h"
 #include "core/math/color4.inl"
@@ -18,6 +17,7 @@
 #include "core/memory/temp_allocator.inl"
 #include "core/strings/string_id.inl"
 #include "core/profiler.h"
+#include "core/thread/job_system.h"
 #include "device/log.h"
 #include "device/pipeline.h"
 #include "resource/mesh_resource.h"
@@ -31,9 +31,11 @@
 #include "world/scene_graph.h"
 #include "world/shader_manager.h"
 #include "world/unit_manager.h"
+#include "world/unit_map.inl"
 #include <algorithm> // std::sort
 #include <bgfx/bgfx.h>
 #include <bx/math.h>
+#include <bx/sort.h>
 #include <float.h> // FLT_MAX
 
 LOG_SYSTEM(RENDER_WORLD, "render_world")
@@ -161,256 +163,55 @@ static void calculate_shadow_region(ConvexPolyhedron &polyhedron
 
 namespace culling_set
 {
-	static u32 find_object(const CullingSet &set, CullableType::Enum type, u32 object_id)
+	static u32 query(CullingSet &set, const Frustum &frustum)
 	{
-		u32 num_objects = array::size(set.id);
-
-		u32 i;
-		for (i = 0; i < num_objects; ++i) {
-			if (set.id[i] == object_id && set.type[i] == type)
-				break;
-		}
-
-		if (i == num_objects)
-			return UINT32_MAX;
-		return i;
-	}
-
-	static void add(CullingSet &set, const Cullable &object)
-	{
-		Sphere sw;
-		sphere::transform(sw, object.sphere, object.world);
-
-		OBB obbw;
-		obb::transform(obbw, object.obb, object.world);
-
-		array::push_back(set.sphere_w, sw);
-		array::push_back(set.obb_w, obbw);
-		array::push_back(set.id, object.id);
-		array::push_back(set.type, object.type);
-		array::push_back(set.visible, UINT32_MAX);
-	}
-
-	static void clear(CullingSet &set)
-	{
-		array::clear(set.sphere_w);
-		array::clear(set.obb_w);
-		array::clear(set.id);
-		array::clear(set.type);
-		array::clear(set.visible);
-		array::clear(set.render);
-	}
-
-	static void remove(CullingSet &set, CullableType::Enum type, u32 object_id)
-	{
-		u32 ind = find_object(set, type, object_id);
-		if (ind == UINT32_MAX)
-			return;
-
-		u32 last = array::size(set.id) - 1;
-
-		set.id[ind]       = set.id[last];
-		set.type[ind]     = set.type[last];
-		set.visible[ind]  = set.visible[last];
-		set.sphere_w[ind] = set.sphere_w[last];
-		set.obb_w[ind]    = set.obb_w[last];
-
-		array::pop_back(set.id);
-		array::pop_back(set.type);
-		array::pop_back(set.visible);
-		array::pop_back(set.sphere_w);
-		array::pop_back(set.obb_w);
-	}
-
-	// Fix culling set indices when an instance at index inst is destroyed and the last instance is
-	// moved into its slot.
-	static void fixup(CullingSet &set, CullableType::Enum type, u32 inst, u32 last)
-	{
-		// Remove any entry that still points at the destroyed index.
-		culling_set::remove(set, type, inst);
-
-		// If we destroyed the last element, there is nothing else to fix.
-		if (inst == last)
-			return;
-
-		// Any entry that referred to the former last index must now point to inst.
-		const u32 num = array::size(set.id);
-		for (u32 i = 0; i < num; ++i) {
-			if (set.id[i] == last && set.type[i] == type)
-				set.id[i] = inst;
-		}
-	}
-
-	static void sync_dirty(CullingSet &set, const RenderWorld &rw)
-	{
-		ENTER_PROFILE_SCOPE(__func__);
-
-		const RenderWorld::MeshManager::MeshInstanceData &mid = rw._mesh_manager._data;
-		const RenderWorld::SpriteManager::SpriteInstanceData &sid = rw._sprite_manager._data;
-		const RenderWorld::LodGroupManager::LodGroupInstanceData &lgid = rw._lod_group_manager._data;
-		const RenderWorld::LightManager::LightInstanceData &lid = rw._light_manager._data;
-		const u32 num_objects = array::size(set.id);
-		for (u32 i = 0; i < num_objects; ++i) {
-			const u32 object_id = set.id[i];
-
-			switch (set.type[i]) {
-			case CullableType::MESH:
-				CE_ASSERT(object_id < mid.size, "Index out of bounds");
-				if ((mid.flags[object_id] & RenderableFlags::DIRTY) != 0) {
-					sphere::transform(set.sphere_w[i], mid.sphere[object_id], mid.world[object_id]);
-					obb::transform(set.obb_w[i], mid.obb[object_id], mid.world[object_id]);
-				}
-				break;
-
-			case CullableType::SPRITE:
-				CE_ASSERT(object_id < sid.size, "Index out of bounds");
-				if ((sid.flags[object_id] & RenderableFlags::DIRTY) != 0) {
-					sphere::transform(set.sphere_w[i], sid.sphere[object_id], sid.world[object_id]);
-					obb::transform(set.obb_w[i], sid.obb[object_id], sid.world[object_id]);
-				}
-				break;
-
-			case CullableType::LOD_GROUP:
-				CE_ASSERT(object_id < lgid.size, "Index out of bounds");
-				if ((lgid.flags[object_id] & RenderableFlags::DIRTY) != 0) {
-					sphere::transform(set.sphere_w[i], lgid.sphere[object_id], lgid.world[object_id]);
-					obb::transform(set.obb_w[i], lgid.obb[object_id], lgid.world[object_id]);
-				}
-				break;
-
-			case CullableType::LIGHT:
-				CE_ASSERT(object_id < lid.size, "Index out of bounds");
-				if ((lid.flag[object_id] & RenderableFlags::DIRTY) != 0)
-					sphere::transform(set.sphere_w[i], local_sphere(rw._light_manager, object_id), lid.world[object_id]);
-				break;
-			}
-		}
-
-		LEAVE_PROFILE_SCOPE();
-	}
-
-	static void cull_spheres(CullingSet &set, const Plane3 *planes, u32 num_planes, u32 offset, u32 count)
-	{
-		ENTER_PROFILE_SCOPE(__func__);
-
-		const u32 num = offset + count;
-		for (u32 i = offset; i < num; ++i) {
-			Sphere &sphere_w = set.sphere_w[i];
-
-			u32 inside = UINT32_MAX;
-			for (u32 j = 0; j < num_planes; ++j) {
-				const Plane3 &plane = planes[j];
-
-				f32 n_dot_c = dot(plane.n, sphere_w.c);
-				inside &= u32(n_dot_c + sphere_w.r >= plane.d);
-			}
-
-			set.visible[i] = inside;
-		}
-
-		LEAVE_PROFILE_SCOPE();
-	}
-
-	static void cull_spheres(CullingSet &set, const Frustum &frustum, u32 offset, u32 count)
-	{
-		cull_spheres(set, frustum.planes, countof(frustum.planes), offset, count);
+		return query(set, frustum.planes, countof(frustum.planes));
 	}
 
-	static void cull_spheres(CullingSet &set, const ConvexPolyhedron &polyhedron, u32 offset, u32 count)
+	static u32 query(CullingSet &set, const ConvexPolyhedron &polyhedron)
 	{
-		cull_spheres(set, polyhedron.planes, polyhedron.num_planes, offset, count);
+		return query(set, polyhedron.planes, polyhedron.num_planes);
 	}
 
-	static void cull_spheres(CullingSet &set, const Sphere &sphere, u32 offset, u32 count)
+	/// Tests the OBBs of the @a count objects at @a indices against @a planes
+	/// and stores the results in set.visible.
+	static void cull_obbs(CullingSet &set, const Plane3 *planes, u32 num_planes, const u32 *indices, u32 count)
 	{
 		ENTER_PROFILE_SCOPE(__func__);
 
-		const u32 num = offset + count;
-		for (u32 i = offset; i < num; ++i) {
-			Sphere &sphere_w = set.sphere_w[i];
-
-			const f32 dist_sq = length_squared(sphere.c - sphere_w.c);
-			const f32 r_sum = sphere.r + sphere_w.r;
-			set.visible[i] = (u32)dist_sq <= (r_sum * r_sum);
-		}
-
-		LEAVE_PROFILE_SCOPE();
-	}
-
-	static void cull_obbs(CullingSet &set, const Plane3 *planes, u32 num_planes, const u32 *indices, u32 offset, u32 count)
-	{
-		ENTER_PROFILE_SCOPE(__func__);
-
-		const u32 num = offset + count;
-		for (u32 i = offset; i < num; ++i) {
-			const u32 index = indices[i];
-			const OBB &obb_w = set.obb_w[index];
-			const Vector3 center = translation(obb_w.tm);
-			const Vector3 axis_x = x(obb_w.tm) * obb_w.half_extents.x;
-			const Vector3 axis_y = y(obb_w.tm) * obb_w.half_extents.y;
-			const Vector3 axis_z = z(obb_w.tm) * obb_w.half_extents.z;
-
-			u32 inside = UINT32_MAX;
-			for (u32 j = 0; j < num_planes; ++j) {
-				const Plane3 &plane = planes[j];
-				const f32 radius = fabs(dot(plane.n, axis_x))
-					+ fabs(dot(plane.n, axis_y))
-					+ fabs(dot(plane.n, axis_z))
-					;
-				inside &= u32(dot(plane.n, center) + radius >= plane.d);
-			}
-
-			set.visible[i] = inside;
+		array::resize(set.visible, (count + 31) / 32);
+		if (count != 0) {
+			obbs_intersect_planes(array::begin(set.visible)
+				, array::begin(set.obb_w)
+				, indices
+				, count
+				, planes
+				, num_planes
+				);
 		}
 
 		LEAVE_PROFILE_SCOPE();
 	}
 
-	static void cull_obbs(CullingSet &set, const ConvexPolyhedron &polyhedron, const u32 *indices, u32 offset, u32 count)
+	static void cull_obbs(CullingSet &set, const ConvexPolyhedron &polyhedron, const u32 *indices, u32 count)
 	{
-		cull_obbs(set, polyhedron.planes, polyhedron.num_planes, indices, offset, count);
+		cull_obbs(set, polyhedron.planes, polyhedron.num_planes, indices, count);
 	}
 
-	static void cull_obbs(CullingSet &set, const Matrix4x4 &view_proj, const u32 *indices, u32 offset, u32 count)
+	/// Tests the OBBs of the @a count objects at @a indices against the clip
+	/// planes of @a view_proj and stores the results in set.visible.
+	static void cull_obbs(CullingSet &set, const Matrix4x4 &view_proj, const u32 *indices, u32 count)
 	{
 		ENTER_PROFILE_SCOPE(__func__);
 
-		const u32 num = offset + count;
-		for (u32 i = offset; i < num; ++i) {
-			const u32 index = indices[i];
-			const OBB &obb_w = set.obb_w[index];
-
-			Vector3 vertices[8];
-			obb::to_vertices(vertices, obb_w);
-
-			// An OBB is outside the frustum if all its vertices are outside
-			// any one of the six homogeneous clip planes.
-			u32 outside_left   = UINT32_MAX;
-			u32 outside_right  = UINT32_MAX;
-			u32 outside_bottom = UINT32_MAX;
-			u32 outside_top    = UINT32_MAX;
-			u32 outside_near   = UINT32_MAX;
-			u32 outside_far    = UINT32_MAX;
-			for (u32 j = 0; j < countof(vertices); ++j) {
-				const Vector3 &v = vertices[j];
-				const Vector4 vertex = { v.x, v.y, v.z, 1.0f };
-				const Vector4 clip = vertex * view_proj;
-
-				outside_left   &= u32(clip.x < -clip.w);
-				outside_right  &= u32(clip.x > clip.w);
-				outside_bottom &= u32(clip.y < -clip.w);
-				outside_top    &= u32(clip.y > clip.w);
-				outside_near   &= u32(clip.z < -clip.w);
-				outside_far    &= u32(clip.z > clip.w);
-			}
-
-			set.visible[i] = (outside_left
-				| outside_right
-				| outside_bottom
-				| outside_top
-				| outside_near
-				| outside_far
-				) == 0;
+		array::resize(set.visible, (count + 31) / 32);
+		if (count != 0) {
+			obbs_intersect_clip_space(array::begin(set.visible)
+				, array::begin(set.obb_w)
+				, indices
+				, count
+				, view_proj
+				);
 		}
 
 		LEAVE_PROFILE_SCOPE();
@@ -421,16 +222,17 @@ namespace culling_set
 		, const Vector4 &viewport
 		, f32 threshold
 		, const u32 *indices
-		, u32 offset
 		, u32 count
 		)
 	{
 		ENTER_PROFILE_SCOPE(__func__);
 
+		array::resize(set.visible, (count + 31) / 32);
+		memset(array::begin(set.visible), 0, array::size(set.visible)*sizeof(u32));
+
 		const f32 viewport_max_x = viewport.x + viewport.z;
 		const f32 viewport_max_y = viewport.y + viewport.w;
-		const u32 num = offset + count;
-		for (u32 i = offset; i < num; ++i) {
+		for (u32 i = 0; i < count; ++i) {
 			const u32 index = indices[i];
 
 			Vector3 vertices[8];
@@ -450,7 +252,7 @@ namespace culling_set
 
 			// Unclipped corners do not bound a near-plane intersection.
 			if (intersects_near) {
-				set.visible[i] = UINT32_MAX;
+				set.visible[i / 32] |= 1u << (i % 32);
 				continue;
 			}
 
@@ -474,12 +276,48 @@ namespace culling_set
 
 			const f32 size_w = max_screen.x - min_screen.x;
 			const f32 size_h = max_screen.y - min_screen.y;
-			set.visible[i] = size_w >= threshold || size_h >= threshold;
+			set.visible[i / 32] |= u32(size_w >= threshold || size_h >= threshold) << (i % 32);
 		}
 
 		LEAVE_PROFILE_SCOPE();
 	}
 
+	/// Tests the OBBs of the @a count objects at @a indices against the occluders in @a ob
+	/// and stores the results in set.visible. Sprites and the occluders themselves, whose
+	/// @a mesh_flags have RenderableFlags::OCCLUDER set, are always visible. Returns the
+	/// number of objects tested.
+	static u32 cull_occluded(CullingSet &set
+		, const OcclusionBuffer &ob
+		, const u32 *mesh_flags
+		, const u32 *indices
+		, u32 count
+		)
+	{
+		ENTER_PROFILE_SCOPE(__func__);
+
+		array::resize(set.visible, (count + 31) / 32);
+		memset(array::begin(set.visible), 0, array::size(set.visible)*sizeof(u32));
+
+		u32 num_tested = 0;
+		for (u32 i = 0; i < count; ++i) {
+			const u32 index = indices[i];
+			const CullableType::Enum type = set.type[index];
+
+			bool visible = true;
+			if (type != CullableType::SPRITE
+				&& (type != CullableType::MESH || (mesh_flags[set.id[index]] & RenderableFlags::OCCLUDER) == 0)
+				) {
+				visible = ob.visible(set.obb_w[index]);
+				++num_tested;
+			}
+
+			set.visible[i / 32] |= u32(visible) << (i % 32);
+		}
+
+		LEAVE_PROFILE_SCOPE();
+		return num_tested;
+	}
+
 	/// Removes culled objects from @a indices and returns the number of objects left.
 	/// If @a indices is NULL, uses [0, @a count) as input.
 	static u32 remove_culled(CullingSet &set
@@ -495,7 +333,7 @@ namespace culling_set
 			array::resize(set.render, count);
 
 		for (u32 i = 0; i < count; ++i) {
-			if (set.visible[i] != 0)
+			if ((set.visible[i / 32] & (1u << (i % 32))) != 0)
 				set.render[num_visible++] = indices != NULL ? indices[i] : i;
 		}
 
@@ -505,11 +343,102 @@ namespace culling_set
 
 } // namespace culling_set
 
+namespace shadow_cache
+{
+	static void invalidate(ShadowCacheTile &tile)
+	{
+		tile.view_proj = MATRIX4X4_IDENTITY;
+		tile.volume = { VECTOR3_ZERO, 0.0f };
+		tile.light = UINT32_MAX;
+		tile.frame = 0;
+		tile.valid = false;
+	}
+
+	/// Returns whether @a tile holds the static casters seen by @a view_proj.
+	static bool is_valid(const ShadowCacheTile &tile, const Matrix4x4 &view_proj)
+	{
+		return tile.valid && memcmp(&tile.view_proj, &view_proj, sizeof(view_proj)) == 0;
+	}
+
+	/// Returns whether any of the @a num spheres intersects the volume bounded by @a planes.
+	static bool intersects(const Plane3 *planes, u32 num_planes, const Sphere *spheres, u32 num)
+	{
+		for (u32 i = 0; i < num; ++i) {
+			u32 j = 0;
+			for (; j < num_planes; ++j) {
+				if (plane3::distance_to_point(planes[j], spheres[i].c) < -spheres[i].r)
+					break;
+			}
+
+			if (j == num_planes)
+				return true;
+		}
+
+		return false;
+	}
+
+	/// Returns whether any of the @a num spheres intersects @a volume.
+	static bool intersects(const Sphere &volume, const Sphere *spheres, u32 num)
+	{
+		for (u32 i = 0; i < num; ++i) {
+			const f32 r_sum = volume.r + spheres[i].r;
+			if (length_squared(volume.c - spheres[i].c) <= r_sum*r_sum)
+				return true;
+		}
+
+		return false;
+	}
+
+	/// Returns the tile to render @a light into at @a frame. Lights keep the tile
+	/// they had, other lights take the least recently used one.
+	static u32 find_tile(ShadowCacheTile *tiles, u32 num, u32 light, u32 frame)
+	{
+		u32 best = UINT32_MAX;
+		for (u32 i = 0; i < num; ++i) {
+			if (tiles[i].frame == frame)
+				continue;
+
+			if (tiles[i].light == light) {
+				best = i;
+				break;
+			}
+
+			if (best == UINT32_MAX || tiles[i].frame < tiles[best].frame)
+				best = i;
+		}
+		CE_ENSURE(best != UINT32_MAX);
+
+		ShadowCacheTile &tile = tiles[best];
+		if (tile.light != light) {
+			tile.light = light;
+			tile.valid = false;
+		}
+		tile.frame = frame;
+		return best;
+	}
+
+	/// Appends the world spheres of the @a num @a meshes that are in @a set to @a spheres.
+	static void collect_dirty(Array<Sphere> &spheres, const CullingSet &set, const u32 *meshes, u32 num)
+	{
+		for (u32 i = 0; i < num; ++i) {
+			const u32 ci = culling_set::find_object(set, CullableType::MESH, meshes[i]);
+			if (ci != UINT32_MAX)
+				array::push_back(spheres, set.sphere_w[ci]);
+		}
+	}
+
+} // namespace shadow_cache
+
 static void unit_destroyed_callback_bridge(UnitId unit, void *user_ptr)
 {
 	((RenderWorld *)user_ptr)->unit_destroyed_callback(unit);
 }
 
+static void units_destroyed_callback_bridge(const UnitId *units, u32 num, void *user_ptr)
+{
+	((RenderWorld *)user_ptr)->units_destroyed_callback(units, num);
+}
+
 RenderWorld::RenderWorld(Allocator &a
 	, ResourceManager &rm
 	, ShaderManager &sm
@@ -530,15 +459,24 @@ RenderWorld::RenderWorld(Allocator &a
 	, _sprite_manager(a, this)
 	, _lod_group_manager(a, this)
 	, _light_manager(a, this)
+	, _renderables(a)
+	, _sphere_w(a)
 	, _cullable_objects(a)
 	, _cullable_shadow_casters(a)
+	, _cullable_static_shadow_casters(a)
 	, _cullable_lights(a)
+	, _occlusion_buffer(a)
+	, _light_clusters(a)
+	, _shadow_cache_invalid(a)
+	, _shadow_cache_epoch(0)
+	, _shadow_cache_frame(0)
 	, _fog_unit(UNIT_INVALID)
 	, _global_lighting_unit(UNIT_INVALID)
 	, _bloom_unit(UNIT_INVALID)
 	, _color_grading_unit(UNIT_INVALID)
 {
 	_unit_destroy_callback.destroy = unit_destroyed_callback_bridge;
+	_unit_destroy_callback.destroy_batch = units_destroyed_callback_bridge;
 	_unit_destroy_callback.user_data = this;
 	_unit_destroy_callback.node.next = NULL;
 	_unit_destroy_callback.node.prev = NULL;
@@ -563,6 +501,12 @@ RenderWorld::RenderWorld(Allocator &a
 	// Tonemap.
 	memset((void *)&_tonemap_desc, 0, sizeof(_tonemap_desc));
 	_tonemap_desc.type = TonemapType::REINHARD;
+
+	// Static shadow casters cache.
+	for (u32 i = 0; i < countof(_sun_shadow_cache); ++i)
+		shadow_cache::invalidate(_sun_shadow_cache[i]);
+	for (u32 i = 0; i < countof(_local_lights_shadow_cache); ++i)
+		shadow_cache::invalidate(_local_lights_shadow_cache[i]);
 }
 
 RenderWorld::~RenderWorld()
@@ -574,6 +518,9 @@ RenderWorld::~RenderWorld()
 	_lod_group_manager.destroy();
 	_light_manager.destroy();
 
+	if (_pipeline->_shadow_cache_owner == this)
+		_pipeline->_shadow_cache_owner = NULL;
+
 	_marker = 0;
 }
 
@@ -641,8 +588,7 @@ void RenderWorld::mesh_set_visible(MeshId mesh, bool visible)
 	else
 		_mesh_manager._data.flags[mesh_i] &= ~RenderableFlags::VISIBLE;
 
-	_mesh_manager._data.flags[mesh_i] |= RenderableFlags::DIRTY;
-	_mesh_manager._dirty = true;
+	_mesh_manager.set_dirty(mesh_i);
 }
 
 void RenderWorld::mesh_set_cast_shadows(MeshId mesh, bool cast_shadows)
@@ -659,8 +605,7 @@ void RenderWorld::mesh_set_cast_shadows(MeshId mesh, bool cast_shadows)
 	else
 		_mesh_manager._data.flags[mesh_i] &= ~RenderableFlags::SHADOW_CASTER;
 
-	_mesh_manager._data.flags[mesh_i] |= RenderableFlags::DIRTY;
-	_mesh_manager._dirty = true;
+	_mesh_manager.set_dirty(mesh_i);
 }
 
 OBB RenderWorld::mesh_obb(MeshId mesh)
@@ -680,14 +625,10 @@ OBB RenderWorld::mesh_obb(MeshId mesh)
 f32 RenderWorld::mesh_cast_ray(MeshId mesh, const Vector3 &from, const Vector3 &dir)
 {
 	const u32 mesh_i = _mesh_manager.index(mesh);
-	const MeshGeometry *mg = _mesh_manager._data.geometry[mesh_i];
-	return ray_mesh_intersection(from
-		, dir
+	return mesh_geometry::cast_ray(*_mesh_manager._data.geometry[mesh_i]
 		, _mesh_manager._data.world[mesh_i]
-		, mg->vertices.data
-		, mg->vertices.stride
-		, (u16 *)mg->indices.data
-		, mg->indices.num
+		, from
+		, dir
 		);
 }
 
@@ -717,8 +658,7 @@ void RenderWorld::sprite_set_sprite(SpriteId sprite, StringId64 sprite_resource_
 
 	_sprite_manager._data.obb[sprite.i] = resource->obb;
 	_sprite_manager._data.sphere[sprite.i] = resource->sphere;
-	_sprite_manager._data.flags[sprite.i] |= RenderableFlags::DIRTY;
-	_sprite_manager._dirty = true;
+	_sprite_manager.set_dirty(sprite.i);
 }
 
 Material *RenderWorld::sprite_material(SpriteId sprite)
@@ -757,8 +697,7 @@ void RenderWorld::sprite_set_visible(SpriteId sprite, bool visible)
 	else
 		_sprite_manager._data.flags[sprite.i] &= ~RenderableFlags::VISIBLE;
 
-	_sprite_manager._data.flags[sprite.i] |= RenderableFlags::DIRTY;
-	_sprite_manager._dirty = true;
+	_sprite_manager.set_dirty(sprite.i);
 }
 
 void RenderWorld::sprite_flip_x(SpriteId sprite, bool flip)
@@ -892,8 +831,7 @@ void RenderWorld::lod_group_set_obb(LodGroupId lod_group, const OBB &obb)
 
 	_lod_group_manager._data.obb[lod_group.i] = obb;
 	_lod_group_manager._data.sphere[lod_group.i] = obb_sphere(_lod_group_manager._data.obb[lod_group.i]);
-	_lod_group_manager._data.flags[lod_group.i] |= RenderableFlags::DIRTY;
-	_lod_group_manager._dirty = true;
+	_lod_group_manager.set_dirty(lod_group.i);
 }
 
 void RenderWorld::lod_group_set_level(LodGroupId lod_group, s32 level)
@@ -985,16 +923,14 @@ void RenderWorld::light_set_type(LightId light, LightType::Enum type)
 		return;
 
 	_light_manager._data.type[light.i] = type;
-	_light_manager._data.flag[light.i] |= RenderableFlags::DIRTY;
-	_light_manager._dirty = true;
+	_light_manager.set_dirty(light.i);
 }
 
 void RenderWorld::light_set_range(LightId light, f32 range)
 {
 	CE_ASSERT(light.i < _light_manager._data.size, "Index out of bounds");
 	_light_manager._data.shader[light.i].range = range;
-	_light_manager._data.flag[light.i] |= RenderableFlags::DIRTY;
-	_light_manager._dirty = true;
+	_light_manager.set_dirty(light.i);
 }
 
 void RenderWorld::light_set_intensity(LightId light, f32 intensity)
@@ -1007,8 +943,7 @@ void RenderWorld::light_set_spot_angle(LightId light, f32 angle)
 {
 	CE_ASSERT(light.i < _light_manager._data.size, "Index out of bounds");
 	_light_manager._data.shader[light.i].spot_angle = angle;
-	_light_manager._data.flag[light.i] |= RenderableFlags::DIRTY;
-	_light_manager._dirty = true;
+	_light_manager.set_dirty(light.i);
 }
 
 void RenderWorld::light_set_shadow_bias(LightId light, f32 bias)
@@ -1031,7 +966,7 @@ void RenderWorld::light_set_cast_shadows(LightId light, bool cast_shadows)
 	else
 		_light_manager._data.flag[light.i] &= ~RenderableFlags::SHADOW_CASTER;
 
-	_light_manager._dirty = true;
+	_light_manager.set_dirty(light.i);
 }
 
 void RenderWorld::light_debug_draw(LightId light, DebugLine &dl, bool draw_bounds)
@@ -1349,6 +1284,24 @@ void RenderWorld::tonemap_set_type(TonemapType::Enum type)
 	_tonemap_desc.type = (f32)type;
 }
 
+static const RenderableSlots RENDERABLE_SLOTS_NONE = { { UINT32_MAX, UINT32_MAX, UINT32_MAX, UINT32_MAX } };
+CE_STATIC_ASSERT(countof(RENDERABLE_SLOTS_NONE.index) == CullableType::COUNT);
+
+void RenderWorld::set_renderable(UnitId unit, CullableType::Enum type, u32 index)
+{
+	RenderableSlots slots = unit_map::get(_renderables, unit, RENDERABLE_SLOTS_NONE);
+	slots.index[type] = index;
+
+	for (u32 i = 0; i < countof(slots.index); ++i) {
+		if (slots.index[i] != UINT32_MAX) {
+			unit_map::set(_renderables, unit, slots);
+			return;
+		}
+	}
+
+	unit_map::remove(_renderables, unit);
+}
+
 void RenderWorld::update_transforms(const UnitId *begin, const UnitId *end, const Matrix4x4 *world)
 {
 	MeshManager::MeshInstanceData &mid = _mesh_manager._data;
@@ -1357,44 +1310,38 @@ void RenderWorld::update_transforms(const UnitId *begin, const UnitId *end, cons
 	LodGroupManager::LodGroupInstanceData &lgd = _lod_group_manager._data;
 
 	for (; begin != end; ++begin, ++world) {
-		if (_mesh_manager.has(*begin)) {
-			MeshId mesh = _mesh_manager.mesh(*begin);
-			const u32 mesh_i = _mesh_manager.index(mesh);
-			mid.world[mesh_i] = *world;
+		const RenderableSlots &slots = unit_map::get(_renderables, *begin, RENDERABLE_SLOTS_NONE);
 
-			_mesh_manager._data.flags[mesh_i] |= RenderableFlags::DIRTY;
-			_mesh_manager._dirty = true;
+		const u32 mesh_i = slots.index[CullableType::MESH];
+		if (mesh_i != UINT32_MAX) {
+			mid.world[mesh_i] = *world;
+			_mesh_manager.set_dirty(mesh_i);
 		}
 
-		if (_sprite_manager.has(*begin)) {
-			SpriteId sprite = _sprite_manager.sprite(*begin);
-			sid.world[sprite.i] = *world;
-
-			_sprite_manager._data.flags[sprite.i] |= RenderableFlags::DIRTY;
-			_sprite_manager._dirty = true;
+		const u32 sprite_i = slots.index[CullableType::SPRITE];
+		if (sprite_i != UINT32_MAX) {
+			sid.world[sprite_i] = *world;
+			_sprite_manager.set_dirty(sprite_i);
 		}
 
-		if (_lod_group_manager.has(*begin)) {
-			LodGroupId lod_group = _lod_group_manager.lod_group(*begin);
-			lgd.world[lod_group.i] = *world;
-			lgd.flags[lod_group.i] |= RenderableFlags::DIRTY;
-			_lod_group_manager._dirty = true;
+		const u32 lod_group_i = slots.index[CullableType::LOD_GROUP];
+		if (lod_group_i != UINT32_MAX) {
+			lgd.world[lod_group_i] = *world;
+			_lod_group_manager.set_dirty(lod_group_i);
 		}
 
-		if (_light_manager.has(*begin)) {
-			LightId light = _light_manager.light(*begin);
-
-			lid.world[light.i] = *world;
+		const u32 light_i = slots.index[CullableType::LIGHT];
+		if (light_i != UINT32_MAX) {
+			lid.world[light_i] = *world;
 
 			Vector3 pos = translation(*world);
 			Vector3 dir = -z(*world);
 			normalize(dir);
 
-			lid.shader[light.i].position = pos;
-			lid.shader[light.i].direction = dir;
+			lid.shader[light_i].position = pos;
+			lid.shader[light_i].direction = dir;
 
-			lid.flag[light.i] |= RenderableFlags::DIRTY;
-			_light_manager._dirty = true;
+			_light_manager.set_dirty(light_i);
 		}
 	}
 }
@@ -1431,6 +1378,23 @@ static void mtxYawPitchRoll(f32 *_result
 	_result[15] = 1.0f;
 }
 
+// Removes the stale and duplicate entries from the @a dirty list of an instance manager
+// and clears the DIRTY flag of the remaining ones.
+static void compact_dirty(Array<u32> &dirty, u32 *flags, u32 size)
+{
+	u32 n = 0;
+	for (u32 i = 0; i < array::size(dirty); ++i) {
+		const u32 inst = dirty[i];
+		if (inst >= size || (flags[inst] & RenderableFlags::DIRTY) == 0)
+			continue;
+
+		flags[inst] &= ~RenderableFlags::DIRTY;
+		dirty[n++] = inst;
+	}
+
+	array::resize(dirty, n);
+}
+
 void RenderWorld::sync_cullable_sets()
 {
 	ENTER_PROFILE_SCOPE(__func__);
@@ -1439,123 +1403,180 @@ void RenderWorld::sync_cullable_sets()
 	SpriteManager::SpriteInstanceData &sid = _sprite_manager._data;
 	LodGroupManager::LodGroupInstanceData &lgid = _lod_group_manager._data;
 	LightManager::LightInstanceData &lid = _light_manager._data;
-	bool cullable_objects_dirty = _lod_group_manager._dirty;
-	bool cullable_shadow_casters_dirty = false;
 
-	// Keep DIRTY set until every culling set has consumed it.
-
-	if (_mesh_manager._dirty) {
-		for (u32 i = 0; i < mid.size; ++i) {
-			if ((mid.flags[i] & RenderableFlags::DIRTY) == 0)
-				continue;
+	// Skip the changed instances that have since been destroyed or listed twice.
+	compact_dirty(_mesh_manager._dirty, mid.flags, mid.size);
+	compact_dirty(_sprite_manager._dirty, sid.flags, sid.size);
+	compact_dirty(_lod_group_manager._dirty, lgid.flags, lgid.size);
+	compact_dirty(_light_manager._dirty, lid.flag, lid.size);
+
+	const u32 *dirty_meshes = array::begin(_mesh_manager._dirty);
+	const u32 num_dirty_meshes = array::size(_mesh_manager._dirty);
+
+	// Static casters that change invalidate the cached shadows they overlap,
+	// both where they were and where they are now.
+	shadow_cache::collect_dirty(_shadow_cache_invalid, _cullable_static_shadow_casters, dirty_meshes, num_dirty_meshes);
+
+	// Rebuild the world spheres of the changed meshes in one batch.
+	array::reserve(_sphere_w, num_dirty_meshes);
+	array::resize(_sphere_w, num_dirty_meshes);
+	sphere::transform(array::begin(_sphere_w), mid.sphere, mid.world, dirty_meshes, num_dirty_meshes);
+
+	for (u32 j = 0; j < num_dirty_meshes; ++j) {
+		const u32 i = dirty_meshes[j];
+		const u32 flags = mid.flags[i];
+		const u32 prev_flags = mid.prev_flags[i];
+		const u32 cull_flags = (flags &RenderableFlags::LOD_LEVEL) == 0 ? flags : 0;
+		const u32 prev_cull_flags = (prev_flags &RenderableFlags::LOD_LEVEL) == 0 ? prev_flags : 0;
+		const u32 changed = (cull_flags ^ prev_cull_flags)
+			& (RenderableFlags::VISIBLE | RenderableFlags::SHADOW_CASTER | RenderableFlags::STATIC_SHADOW)
+			;
+		const bool is_static_caster = (cull_flags &RenderableFlags::STATIC_SHADOW) != 0;
+		const Cullable object = { mid.world[i], mid.sphere[i], mid.obb[i], i, CullableType::MESH };
+
+		OBB obb_w;
+		obb::transform(obb_w, mid.obb[i], mid.world[i]);
+		culling_set::update(_cullable_objects, CullableType::MESH, i, _sphere_w[j], obb_w);
+		culling_set::update(_cullable_shadow_casters, CullableType::MESH, i, _sphere_w[j], obb_w);
+		culling_set::update(_cullable_static_shadow_casters, CullableType::MESH, i, _sphere_w[j], obb_w);
+
+		if ((changed &RenderableFlags::VISIBLE) != 0) {
+			if ((cull_flags &RenderableFlags::VISIBLE) != 0)
+				culling_set::add(_cullable_objects, object);
+			else
+				culling_set::remove(_cullable_objects, CullableType::MESH, i);
+		}
 
-			const u32 flags = mid.flags[i] & ~RenderableFlags::DIRTY;
-			const u32 prev_flags = mid.prev_flags[i] & ~RenderableFlags::DIRTY;
-			const u32 cull_flags = (flags &RenderableFlags::LOD_LEVEL) == 0 ? flags : 0;
-			const u32 prev_cull_flags = (prev_flags &RenderableFlags::LOD_LEVEL) == 0 ? prev_flags : 0;
-			const u32 changed = (cull_flags ^ prev_cull_flags)
-				& (RenderableFlags::VISIBLE | RenderableFlags::SHADOW_CASTER)
-				;
-			cullable_objects_dirty |= (cull_flags &RenderableFlags::VISIBLE) != 0;
-			cullable_shadow_casters_dirty |= (cull_flags &RenderableFlags::SHADOW_CASTER) != 0;
-
-			if ((changed &RenderableFlags::VISIBLE) != 0) {
-				if ((cull_flags &RenderableFlags::VISIBLE) != 0)
-					culling_set::add(_cullable_objects, { mid.world[i], mid.sphere[i], mid.obb[i], i, CullableType::MESH });
-				else
-					culling_set::remove(_cullable_objects, CullableType::MESH, i);
+		if ((changed & (RenderableFlags::SHADOW_CASTER | RenderableFlags::STATIC_SHADOW)) != 0) {
+			if ((prev_cull_flags &RenderableFlags::SHADOW_CASTER) != 0) {
+				CullingSet &prev_casters = (prev_cull_flags &RenderableFlags::STATIC_SHADOW) != 0
+					? _cullable_static_shadow_casters
+					: _cullable_shadow_casters
+					;
+				culling_set::remove(prev_casters, CullableType::MESH, i);
 			}
 
-			if ((changed &RenderableFlags::SHADOW_CASTER) != 0) {
-				if ((cull_flags &RenderableFlags::SHADOW_CASTER) != 0)
-					culling_set::add(_cullable_shadow_casters, { mid.world[i], mid.sphere[i], mid.obb[i], i, CullableType::MESH });
-				else
-					culling_set::remove(_cullable_shadow_casters, CullableType::MESH, i);
+			if ((cull_flags &RenderableFlags::SHADOW_CASTER) != 0) {
+				CullingSet &casters = is_static_caster
+					? _cullable_static_shadow_casters
+					: _cullable_shadow_casters
+					;
+				culling_set::add(casters, object);
 			}
-
-			mid.prev_flags[i] = flags;
 		}
+
+		mid.prev_flags[i] = flags;
 	}
 
-	if (_sprite_manager._dirty) {
-		for (u32 i = 0; i < sid.size; ++i) {
-			if ((sid.flags[i] & RenderableFlags::DIRTY) == 0)
-				continue;
+	shadow_cache::collect_dirty(_shadow_cache_invalid, _cullable_static_shadow_casters, dirty_meshes, num_dirty_meshes);
 
-			const u32 flags = sid.flags[i] & ~RenderableFlags::DIRTY;
-			const u32 prev_flags = sid.prev_flags[i] & ~RenderableFlags::DIRTY;
-			const bool visibility_changed = ((flags ^ prev_flags) & RenderableFlags::VISIBLE) != 0;
-			cullable_objects_dirty |= (flags &RenderableFlags::VISIBLE) != 0;
+	const u32 *dirty_sprites = array::begin(_sprite_manager._dirty);
+	const u32 num_dirty_sprites = array::size(_sprite_manager._dirty);
 
-			if (visibility_changed) {
-				if ((flags &RenderableFlags::VISIBLE) != 0)
-					culling_set::add(_cullable_objects, { sid.world[i], sid.sphere[i], sid.obb[i], i, CullableType::SPRITE });
-				else
-					culling_set::remove(_cullable_objects, CullableType::SPRITE, i);
-			}
+	array::reserve(_sphere_w, num_dirty_sprites);
+	array::resize(_sphere_w, num_dirty_sprites);
+	sphere::transform(array::begin(_sphere_w), sid.sphere, sid.world, dirty_sprites, num_dirty_sprites);
 
-			sid.prev_flags[i] = flags;
+	for (u32 j = 0; j < num_dirty_sprites; ++j) {
+		const u32 i = dirty_sprites[j];
+		const u32 flags = sid.flags[i];
+		const u32 prev_flags = sid.prev_flags[i];
+		const bool visibility_changed = ((flags ^ prev_flags) & RenderableFlags::VISIBLE) != 0;
+		const Cullable object = { sid.world[i], sid.sphere[i], sid.obb[i], i, CullableType::SPRITE };
+
+		OBB obb_w;
+		obb::transform(obb_w, sid.obb[i], sid.world[i]);
+		culling_set::update(_cullable_objects, CullableType::SPRITE, i, _sphere_w[j], obb_w);
+
+		if (visibility_changed) {
+			if ((flags &RenderableFlags::VISIBLE) != 0)
+				culling_set::add(_cullable_objects, object);
+			else
+				culling_set::remove(_cullable_objects, CullableType::SPRITE, i);
 		}
+
+		sid.prev_flags[i] = flags;
 	}
 
-	if (_light_manager._dirty) {
-		culling_set::clear(_cullable_lights);
+	for (u32 j = 0; j < array::size(_lod_group_manager._dirty); ++j) {
+		const u32 i = _lod_group_manager._dirty[j];
+		culling_set::update(_cullable_objects, { lgid.world[i], lgid.sphere[i], lgid.obb[i], i, CullableType::LOD_GROUP });
+	}
 
-		for (u32 i = 0; i < lid.size; ++i) {
-			const bool is_local_light = lid.type[i] == LightType::OMNI
-				|| lid.type[i] == LightType::SPOT
-				;
-			if (is_local_light) {
-				const Sphere sphere = local_sphere(_light_manager, i);
-				culling_set::add(_cullable_lights, { lid.world[i], sphere, { MATRIX4X4_IDENTITY, VECTOR3_ZERO }, i, CullableType::LIGHT });
-			}
+	for (u32 j = 0; j < array::size(_light_manager._dirty); ++j) {
+		const u32 i = _light_manager._dirty[j];
+		const bool is_local_light = lid.type[i] == LightType::OMNI
+			|| lid.type[i] == LightType::SPOT
+			;
 
-			lid.prev_flags[i] = lid.flag[i] & ~RenderableFlags::DIRTY;
+		if (is_local_light) {
+			const Cullable light = { lid.world[i], local_sphere(_light_manager, i), { MATRIX4X4_IDENTITY, VECTOR3_ZERO }, i, CullableType::LIGHT };
+			if (culling_set::find_object(_cullable_lights, CullableType::LIGHT, i) == UINT32_MAX)
+				culling_set::add(_cullable_lights, light);
+			else
+				culling_set::update(_cullable_lights, light);
+		} else {
+			culling_set::remove(_cullable_lights, CullableType::LIGHT, i);
 		}
-	}
 
-	if (cullable_objects_dirty)
-		culling_set::sync_dirty(_cullable_objects, *this);
-	if (cullable_shadow_casters_dirty)
-		culling_set::sync_dirty(_cullable_shadow_casters, *this);
-
-	if (_mesh_manager._dirty) {
-		for (u32 i = 0; i < mid.size; ++i)
-			mid.flags[i] &= ~RenderableFlags::DIRTY;
-		_mesh_manager._dirty = false;
+		lid.prev_flags[i] = lid.flag[i];
 	}
 
-	if (_sprite_manager._dirty) {
-		for (u32 i = 0; i < sid.size; ++i)
-			sid.flags[i] &= ~RenderableFlags::DIRTY;
-		_sprite_manager._dirty = false;
-	}
+	array::clear(_mesh_manager._dirty);
+	array::clear(_sprite_manager._dirty);
+	array::clear(_lod_group_manager._dirty);
+	array::clear(_light_manager._dirty);
 
-	if (_lod_group_manager._dirty) {
-		for (u32 i = 0; i < lgid.size; ++i)
-			lgid.flags[i] &= ~RenderableFlags::DIRTY;
-		_lod_group_manager._dirty = false;
-	}
+	LEAVE_PROFILE_SCOPE();
+}
 
-	if (_light_manager._dirty) {
-		for (u32 i = 0; i < lid.size; ++i)
-			lid.flag[i] &= ~RenderableFlags::DIRTY;
-		_light_manager._dirty = false;
+/// Culls the casters in @a set against the @a shadow_region of a cascade and, if
+/// @a contribution_view_proj is not NULL, the casters smaller than @a threshold
+/// pixels in @a viewport. Returns the number of casters left in set.render.
+static u32 cull_cascade_shadow_casters(CullingSet &set
+	, const ConvexPolyhedron &shadow_region
+	, const Matrix4x4 *contribution_view_proj
+	, const Vector4 &viewport
+	, f32 threshold
+	)
+{
+	u32 nv = culling_set::query(set, shadow_region);
+	culling_set::cull_obbs(set
+		, shadow_region
+		, array::begin(set.render)
+		, nv
+		);
+	nv = culling_set::remove_culled(set
+		, array::begin(set.render)
+		, nv
+		);
+
+	if (contribution_view_proj != NULL) {
+		culling_set::cull_contributions(set
+			, *contribution_view_proj
+			, viewport
+			, threshold
+			, array::begin(set.render)
+			, nv
+			);
+		nv = culling_set::remove_culled(set
+			, array::begin(set.render)
+			, nv
+			);
 	}
 
-	LEAVE_PROFILE_SCOPE();
+	return nv;
 }
 
-static void draw_mesh(RenderWorld::MeshManager &mesh
-	, u32 object_id
-	, Pipeline *pipeline
+static void set_mesh_lighting(Pipeline *pipeline
 	, const FogDesc &fog_desc
 	, GlobalLightingDesc &global_lighting_desc
-	, SceneGraph *scene_graph
 	, Matrix4x4 *cascaded_lights
 	)
 {
 	bgfx::setTexture(LIGHTS_DATA_SLOT, pipeline->_lights_data, pipeline->_lights_data_texture);
+	bgfx::setTexture(LIGHT_CLUSTERS_SLOT, pipeline->_light_clusters, pipeline->_light_clusters_texture);
+	bgfx::setTexture(LIGHT_INDICES_SLOT, pipeline->_light_indices, pipeline->_light_indices_texture);
 	bgfx::setTexture(CASCADED_SHADOW_MAP_SLOT, pipeline->_u_cascaded_shadow_map, pipeline->_sun_shadow_map_texture);
 	bgfx::setUniform(pipeline->_u_cascaded_lights, &cascaded_lights[0], MAX_NUM_CASCADES);
 	bgfx::setUniform(pipeline->_u_shadow_map_params
@@ -1566,9 +1587,58 @@ static void draw_mesh(RenderWorld::MeshManager &mesh
 	pipeline->set_local_lights_params_uniform();
 	pipeline->set_global_lighting_params(&global_lighting_desc);
 	bgfx::setTexture(LOCAL_LIGHTS_SHADOW_MAP_SLOT, pipeline->_u_local_lights_shadow_map, pipeline->_local_lights_shadow_map_texture);
+}
+
+/// Draws the @a num @a meshes, sorted by MeshManager::sort_batch(), drawing runs of meshes
+/// sharing geometry and material with one instanced draw call each. Returns the number of
+/// material binds skipped because consecutive draws shared the same material.
+static u32 draw_meshes(RenderWorld::MeshManager &mesh
+	, const u32 *meshes
+	, u32 num
+	, Pipeline *pipeline
+	, const FogDesc &fog_desc
+	, GlobalLightingDesc &global_lighting_desc
+	, Matrix4x4 *cascaded_lights
+	)
+{
+	// Textures, uniforms and state are kept across draw calls that share the same material.
+	const u8 keep_material = BGFX_DISCARD_ALL & ~(BGFX_DISCARD_BINDINGS | BGFX_DISCARD_STATE);
+	const Material *bound = NULL;
+	u32 skipped_binds = 0;
+
+	for (u32 ii = 0; ii < num;) {
+		const u32 mesh_i = meshes[ii];
+		const Material *material = mesh._data.material[mesh_i];
 
-	mesh.set_instance_data(object_id, *scene_graph);
-	mesh._data.material[object_id]->bind(View::MESH);
+		u32 num_set = 0;
+		if (mesh.can_instance(mesh_i, false))
+			num_set = mesh.set_instance_data(meshes + ii, mesh.batch_size(meshes + ii, num - ii, true));
+
+		const bool instanced = num_set != 0;
+		if (!instanced) {
+			mesh.set_instance_data(mesh_i);
+			num_set = 1;
+		}
+		ii += num_set;
+
+		const u8 discard = ii < num && mesh._data.material[meshes[ii]] == material
+			? keep_material
+			: BGFX_DISCARD_ALL
+			;
+
+		if (material == bound) {
+			material->submit(View::MESH, 0u, instanced, discard);
+			++skipped_binds;
+		} else {
+			set_mesh_lighting(pipeline, fog_desc, global_lighting_desc, cascaded_lights);
+			material->bind(View::MESH, 0u, instanced, discard);
+		}
+
+		bound = discard == keep_material ? material : NULL;
+		++mesh._num_draws;
+	}
+
+	return skipped_binds;
 }
 
 void RenderWorld::render(f32 dt
@@ -1585,6 +1655,8 @@ void RenderWorld::render(f32 dt
 
 	// Reset matrix cache.
 	memset(_mesh_manager._data.matrix_cache, UINT32_MAX, sizeof(u32)*_mesh_manager._data.size);
+	_mesh_manager._num_draws = 0;
+	_mesh_manager.update_skinning_palettes(*_scene_graph);
 
 	const bgfx::Caps *caps = bgfx::getCaps();
 	Matrix4x4 inv_view = view;
@@ -1599,8 +1671,7 @@ void RenderWorld::render(f32 dt
 
 		// Copy camera pos to skydome.
 		_mesh_manager._data.world[skydome_mesh_i] = from_translation(camera_pos);
-		_mesh_manager._data.flags[skydome_mesh_i] |= RenderableFlags::DIRTY;
-		_mesh_manager._dirty = true;
+		_mesh_manager.set_dirty(skydome_mesh_i);
 
 		Material *skydome_material = mesh_material(skydome_mesh);
 		skydome_material->set_matrix4x4(STRING_ID_32("u_persp", UINT32_C(0x404ac2c2)), persp);
@@ -1617,12 +1688,10 @@ void RenderWorld::render(f32 dt
 	// Frustum culling of visible objects.
 	Frustum view_frustum;
 	frustum::from_matrix(view_frustum, view_proj, true, bx::Handedness::Right);
-	culling_set::cull_spheres(_cullable_objects, view_frustum, 0, array::size(_cullable_objects.id));
-	u32 visible_objects = culling_set::remove_culled(_cullable_objects);
+	u32 visible_objects = culling_set::query(_cullable_objects, view_frustum);
 	culling_set::cull_obbs(_cullable_objects
 		, view_proj
 		, array::begin(_cullable_objects.render)
-		, 0
 		, visible_objects
 		);
 	visible_objects = culling_set::remove_culled(_cullable_objects
@@ -1638,7 +1707,6 @@ void RenderWorld::render(f32 dt
 			, viewport
 			, object_contribution_threshold
 			, array::begin(_cullable_objects.render)
-			, 0
 			, visible_objects
 			);
 		visible_objects = culling_set::remove_culled(_cullable_objects
@@ -1646,6 +1714,66 @@ void RenderWorld::render(f32 dt
 			, visible_objects
 			);
 	}
+
+	// Occlusion culling of visible objects. Visible occluders are rasterized first.
+	if (_pipeline->_render_settings.flags & RenderSettingsFlags::OCCLUSION_CULLING) {
+		ENTER_PROFILE_SCOPE("occlusion_culling");
+		_occlusion_buffer.reset((u32)_pipeline->_render_settings.occlusion_buffer_size.x
+			, (u32)_pipeline->_render_settings.occlusion_buffer_size.y
+			, view_proj
+			);
+
+		const MeshManager::MeshInstanceData &mid = _mesh_manager._data;
+		u32 num_occluders = 0;
+		for (u32 ii = 0; ii < visible_objects; ++ii) {
+			const u32 i = _cullable_objects.render[ii];
+			if (_cullable_objects.type[i] != CullableType::MESH)
+				continue;
+
+			const u32 mesh_i = _cullable_objects.id[i];
+			if ((mid.flags[mesh_i] & RenderableFlags::OCCLUDER) == 0)
+				continue;
+
+			const MeshGeometry *mg = mid.geometry[mesh_i];
+			if (mg->indices.stride == sizeof(u32)) {
+				_occlusion_buffer.add_triangles(mid.world[mesh_i]
+					, mg->positions.data
+					, mg->positions.stride
+					, (u32 *)mg->indices.data
+					, mg->indices.num
+					);
+			} else {
+				_occlusion_buffer.add_triangles(mid.world[mesh_i]
+					, mg->positions.data
+					, mg->positions.stride
+					, (u16 *)mg->indices.data
+					, mg->indices.num
+					);
+			}
+			++num_occluders;
+		}
+
+		u32 num_tested = 0;
+		u32 num_occluded = 0;
+		if (num_occluders != 0) {
+			num_tested = culling_set::cull_occluded(_cullable_objects
+				, _occlusion_buffer
+				, mid.flags
+				, array::begin(_cullable_objects.render)
+				, visible_objects
+				);
+			const u32 num_visible = culling_set::remove_culled(_cullable_objects
+				, array::begin(_cullable_objects.render)
+				, visible_objects
+				);
+			num_occluded = visible_objects - num_visible;
+			visible_objects = num_visible;
+		}
+
+		RECORD_FLOAT("world.occlusion_tested_objects", (f32)num_tested);
+		RECORD_FLOAT("world.occluded_objects", (f32)num_occluded);
+		LEAVE_PROFILE_SCOPE();
+	}
 	RECORD_FLOAT("world.visible_objects", (f32)visible_objects);
 
 	// Limit shadow rendering independently from the camera far plane.
@@ -1703,6 +1831,8 @@ void RenderWorld::render(f32 dt
 	array::clear(lm._local_lights_omni);
 	array::clear(lm._lights_data);
 	u32 num_lights = 0; // Total lights to render this frame.
+	const bool light_clustering = (_pipeline->_render_settings.flags & RenderSettingsFlags::LIGHT_CLUSTERING) != 0;
+	const u32 max_num_lights = light_clustering ? MAX_NUM_LIGHTS : MAX_NUM_UNCLUSTERED_LIGHTS;
 
 	// Collect indices to all directional lights.
 	for (u32 i = 0; i < lid.size; ++i) {
@@ -1713,12 +1843,41 @@ void RenderWorld::render(f32 dt
 	// Sort directional lights by intensity.
 	std::sort(array::begin(lm._directional_lights)
 		, array::end(lm._directional_lights)
-		, [lm](const u32 &in_a, const u32 &in_b) {
+		, [&lm](const u32 &in_a, const u32 &in_b) {
 			return lm._data.shader[in_a].intensity > lm._data.shader[in_b].intensity;
 		});
 
+	// Static shadow casters are rendered into the pipeline's cache textures,
+	// which are copied into the shadow maps before dynamic casters are drawn.
+	const bool shadow_caching = _pipeline->shadow_caching_enabled();
+	bool sun_shadows_cached = false;
+	bool sun_shadows_use_cache = false;
+	u32 num_shadow_cache_misses = 0;
+	if (shadow_caching) {
+		// The cache textures were re-created or used by another world.
+		if (_pipeline->_shadow_cache_owner != this || _pipeline->_shadow_cache_epoch != _shadow_cache_epoch) {
+			for (u32 i = 0; i < countof(_sun_shadow_cache); ++i)
+				shadow_cache::invalidate(_sun_shadow_cache[i]);
+			for (u32 i = 0; i < countof(_local_lights_shadow_cache); ++i)
+				shadow_cache::invalidate(_local_lights_shadow_cache[i]);
+
+			_pipeline->_shadow_cache_owner = this;
+			_shadow_cache_epoch = _pipeline->_shadow_cache_epoch;
+		}
+
+		++_shadow_cache_frame;
+
+		// Local lights tiles keep their light even when it is not rendered
+		// this frame, so test them all.
+		for (u32 i = 0; i < countof(_local_lights_shadow_cache); ++i) {
+			ShadowCacheTile &tile = _local_lights_shadow_cache[i];
+			if (tile.valid && shadow_cache::intersects(tile.volume, array::begin(_shadow_cache_invalid), array::size(_shadow_cache_invalid)))
+				tile.valid = false;
+		}
+	}
+
 	// Render directional lights.
-	for (u32 i = 0; i < array::size(lm._directional_lights) && num_lights < MAX_NUM_LIGHTS; ++i) {
+	for (u32 i = 0; i < array::size(lm._directional_lights) && num_lights < max_num_lights; ++i) {
 		const u32 L = lm._directional_lights[i];
 		const bool cast_shadows = (lid.flag[L] & RenderableFlags::SHADOW_CASTER) != 0;
 		const bool sun_shadows = (_pipeline->_render_settings.flags & RenderSettingsFlags::SUN_SHADOWS) != 0;
@@ -1776,9 +1935,32 @@ void RenderWorld::render(f32 dt
 					vertices[j] = vertices[j] * light_view; // To light space.
 				}
 
-				// Compute frustum bounding box in light space.
+				const f32 tile_size_x = 0.5f * _pipeline->_render_settings.sun_shadow_map_size.x;
+				const f32 tile_size_y = 0.5f * _pipeline->_render_settings.sun_shadow_map_size.y;
+
+				// Fit the cascade to the bounding sphere of the split, whose quantized radius
+				// does not change as the camera rotates, and snap its center to shadow map
+				// texels, so that the cascade only moves in whole texels. Stable cascades do not
+				// shimmer and keep matching their shadow cache tile.
+				Vector3 center = VECTOR3_ZERO;
+				for (u32 j = 0; j < countof(vertices); ++j)
+					center += vertices[j];
+				center *= 1.0f / countof(vertices);
+
+				f32 radius = 0.0f;
+				for (u32 j = 0; j < countof(vertices); ++j)
+					radius = max(radius, length(vertices[j] - center));
+				radius = fceil(radius * 16.0f) / 16.0f;
+
+				const f32 texel_size_x = 2.0f * radius / tile_size_x;
+				const f32 texel_size_y = 2.0f * radius / tile_size_y;
+				center.x = ffloor(center.x / texel_size_x) * texel_size_x;
+				center.y = ffloor(center.y / texel_size_y) * texel_size_y;
+
+				// Compute cascade bounding box in light space.
 				AABB box;
-				aabb::from_points(box, countof(vertices), vertices);
+				box.min = { center.x - radius, center.y - radius, center.z - radius };
+				box.max = { center.x + radius, center.y + radius, center.z + radius };
 				// debug_draw_box(box, get_inverted(light_view), _lines, COLOR4_YELLOW); // Debug draw in world space.
 
 				bx::mtxOrtho(to_float_ptr(light_proj)
@@ -1806,8 +1988,6 @@ void RenderWorld::render(f32 dt
 				//   |                +------>
 				// (0;h)            (0;0)  (1;0)
 				//
-				const f32 tile_size_x = 0.5f * _pipeline->_render_settings.sun_shadow_map_size.x;
-				const f32 tile_size_y = 0.5f * _pipeline->_render_settings.sun_shadow_map_size.y;
 				Vector4 rects[] =
 				{
 					{           0, tile_size_y, tile_size_x, tile_size_y },
@@ -1838,20 +2018,11 @@ void RenderWorld::render(f32 dt
 					, light_dir
 					, _pipeline->_render_settings.sun_shadow_max_caster_distance
 					);
-				culling_set::cull_spheres(_cullable_shadow_casters, shadow_region, 0, array::size(_cullable_shadow_casters.id));
-				u32 nv = culling_set::remove_culled(_cullable_shadow_casters);
-				culling_set::cull_obbs(_cullable_shadow_casters
-					, shadow_region
-					, array::begin(_cullable_shadow_casters.render)
-					, 0
-					, nv
-					);
-				nv = culling_set::remove_culled(_cullable_shadow_casters
-					, array::begin(_cullable_shadow_casters.render)
-					, nv
-					);
 
 				const f32 contribution_threshold = _pipeline->_render_settings.sun_shadow_contribution_culling_min_screen_size;
+				const Vector4 viewport = { 0.0f, 0.0f, tile_size_x, tile_size_y };
+				Matrix4x4 light_view_proj;
+				const Matrix4x4 *contribution_view_proj = NULL;
 				if ((_pipeline->_render_settings.flags & RenderSettingsFlags::SUN_SHADOW_CONTRIBUTION_CULLING)
 					&& contribution_threshold > 0.0f
 					) {
@@ -1867,26 +2038,76 @@ void RenderWorld::render(f32 dt
 						, true
 						, bx::Handedness::Right
 						);
-					const Matrix4x4 light_view_proj = light_view*cull_light_proj;
-					const Vector4 viewport = { 0.0f, 0.0f, tile_size_x, tile_size_y };
-					culling_set::cull_contributions(_cullable_shadow_casters
-						, light_view_proj
+					light_view_proj = light_view*cull_light_proj;
+					contribution_view_proj = &light_view_proj;
+				}
+
+				u32 nv = cull_cascade_shadow_casters(_cullable_shadow_casters
+					, shadow_region
+					, contribution_view_proj
+					, viewport
+					, contribution_threshold
+					);
+				_mesh_manager.draw_shadow_casters(View::CASCADE_0 + i, _cullable_shadow_casters);
+
+				// Static casters are rendered into the cache only when a static caster
+				// inside the cascade changed or when the cascade stopped moving. While it
+				// moves, they are rendered straight into the shadow map.
+				bgfx::ViewId static_view = View::CASCADE_0 + i;
+				bool render_static = true;
+				bool use_cache = false;
+				if (shadow_caching) {
+					ShadowCacheTile &tile = _sun_shadow_cache[i];
+					const Matrix4x4 view_proj = light_view * light_proj;
+					const bool moved = memcmp(&tile.view_proj, &view_proj, sizeof(view_proj)) != 0;
+					render_static = !shadow_cache::is_valid(tile, view_proj)
+						|| shadow_cache::intersects(shadow_region.planes
+							, shadow_region.num_planes
+							, array::begin(_shadow_cache_invalid)
+							, array::size(_shadow_cache_invalid)
+							)
+						;
+					use_cache = !moved;
+
+					if (render_static) {
+						if (use_cache) {
+							static_view = View::CASCADE_CACHE_0 + i;
+							bgfx::setViewRect(static_view
+								, (u16)rects[i].x
+								, (u16)rects[i].y
+								, (u16)rects[i].z
+								, (u16)rects[i].w
+								);
+							bgfx::setViewTransform(static_view, to_float_ptr(light_view), to_float_ptr(light_proj));
+							bgfx::touch(static_view);
+						}
+
+						tile.view_proj = view_proj;
+						tile.valid = use_cache;
+						++num_shadow_cache_misses;
+					}
+					tile.frame = _shadow_cache_frame;
+
+					// The cache is copied over the whole shadow map, clear the
+					// cascades that do not use it.
+					bgfx::setViewClear(View::CASCADE_0 + i, use_cache ? BGFX_CLEAR_NONE : BGFX_CLEAR_DEPTH, 0xffffffff, 1.0f, 0);
+					sun_shadows_use_cache |= use_cache;
+				}
+
+				if (render_static) {
+					nv += cull_cascade_shadow_casters(_cullable_static_shadow_casters
+						, shadow_region
+						, contribution_view_proj
 						, viewport
 						, contribution_threshold
-						, array::begin(_cullable_shadow_casters.render)
-						, 0
-						, nv
-						);
-					nv = culling_set::remove_culled(_cullable_shadow_casters
-						, array::begin(_cullable_shadow_casters.render)
-						, nv
 						);
+					_mesh_manager.draw_shadow_casters(static_view, _cullable_static_shadow_casters);
 				}
 
 				RECORD_FLOAT(csm_names[i], (f32)nv);
-
-				_mesh_manager.draw_shadow_casters(View::CASCADE_0 + i, *_scene_graph);
 			}
+
+			sun_shadows_cached = shadow_caching;
 		}
 
 		lid.shader[L].cast_shadows = f32(render_shadow);
@@ -1895,10 +2116,18 @@ void RenderWorld::render(f32 dt
 		++num_lights;
 	}
 
+	if (sun_shadows_use_cache)
+		bgfx::blit(View::CASCADE_CLEAR, _pipeline->_sun_shadow_map_texture, 0, 0, _pipeline->_sun_shadow_cache_texture);
+
+	// Changes to static casters are only tracked while cascades are rendered.
+	if (!sun_shadows_cached) {
+		for (u32 i = 0; i < countof(_sun_shadow_cache); ++i)
+			shadow_cache::invalidate(_sun_shadow_cache[i]);
+	}
+
 	// Render local lights.
 	if (_pipeline->_render_settings.flags & RenderSettingsFlags::LOCAL_LIGHTS) {
-		culling_set::cull_spheres(_cullable_lights, view_frustum, 0, array::size(_cullable_lights.id));
-		culling_set::remove_culled(_cullable_lights);
+		culling_set::query(_cullable_lights, view_frustum);
 
 		// Sort culled lights by distance to camera, retaining the culling-set
 		// index so the bounds computed during culling can be reused below.
@@ -1918,10 +2147,11 @@ void RenderWorld::render(f32 dt
 		u32 num_tiles = 0;
 		u32 cur_tile;
 		u32 sm_local_view_id = View::SM_LOCAL_0;
+		u32 sm_local_cache_view_id = View::SM_LOCAL_CACHE_0;
 
 		// Render local lights. Shadow maps are generated only for the first
 		// LOCAL_LIGHTS_MAX_SHADOW_CASTERS lights that can cast shadows.
-		for (u32 i = 0; i < array::size(_cullable_lights.render) && num_lights < MAX_NUM_LIGHTS; ++i) {
+		for (u32 i = 0; i < array::size(_cullable_lights.render) && num_lights < max_num_lights; ++i) {
 			const u32 cull_index = _cullable_lights.render[i];
 			const u32 light_id = _cullable_lights.id[cull_index];
 			LightManager::ShaderData &shader = lid.shader[light_id];
@@ -1944,9 +2174,15 @@ void RenderWorld::render(f32 dt
 
 				if (render_shadow) {
 					cur_tile = num_tiles++;
+					if (shadow_caching) {
+						cur_tile = shadow_cache::find_tile(_local_lights_shadow_cache
+							, countof(_local_lights_shadow_cache)
+							, light_id
+							, _shadow_cache_frame
+							);
+					}
 
-					culling_set::cull_spheres(_cullable_shadow_casters, light_sphere, 0, array::size(_cullable_shadow_casters.id));
-					culling_set::remove_culled(_cullable_shadow_casters);
+					culling_set::query(_cullable_shadow_casters, light_sphere);
 
 					// Compute light view-proj matrix.
 					Matrix4x4 light_view;
@@ -1990,7 +2226,39 @@ void RenderWorld::render(f32 dt
 						, (u16)rect.w
 						);
 					bgfx::setViewTransform(sm_local_view_id, to_float_ptr(light_view), to_float_ptr(light_proj));
-					_mesh_manager.draw_shadow_casters(sm_local_view_id, *_scene_graph);
+					_mesh_manager.draw_shadow_casters(sm_local_view_id, _cullable_shadow_casters);
+
+					// Static casters are rendered into the cache only when the
+					// light moved or a static caster inside its range changed.
+					bgfx::ViewId static_view = sm_local_view_id;
+					bool render_static = true;
+					if (shadow_caching) {
+						ShadowCacheTile &tile = _local_lights_shadow_cache[cur_tile];
+						render_static = !shadow_cache::is_valid(tile, shader.mvp[0]);
+
+						if (render_static) {
+							static_view = sm_local_cache_view_id++;
+							bgfx::setViewRect(static_view
+								, (u16)rect.x
+								, (u16)rect.y
+								, (u16)rect.z
+								, (u16)rect.w
+								);
+							bgfx::setViewTransform(static_view, to_float_ptr(light_view), to_float_ptr(light_proj));
+							bgfx::setViewClear(static_view, BGFX_CLEAR_DEPTH, 0, 1.0f, 0);
+							bgfx::touch(static_view);
+
+							tile.view_proj = shader.mvp[0];
+							tile.volume = light_sphere;
+							tile.valid = true;
+							++num_shadow_cache_misses;
+						}
+					}
+
+					if (render_static) {
+						culling_set::query(_cullable_static_shadow_casters, light_sphere);
+						_mesh_manager.draw_shadow_casters(static_view, _cullable_static_shadow_casters);
+					}
 					++sm_local_view_id;
 				}
 
@@ -2007,6 +2275,13 @@ void RenderWorld::render(f32 dt
 
 				if (render_shadow) {
 					cur_tile = num_tiles++;
+					if (shadow_caching) {
+						cur_tile = shadow_cache::find_tile(_local_lights_shadow_cache
+							, countof(_local_lights_shadow_cache)
+							, light_id
+							, _shadow_cache_frame
+							);
+					}
 
 					// Compute projection matrices.
 					const f32 fovy_adj = 4.0f;
@@ -2035,8 +2310,8 @@ void RenderWorld::render(f32 dt
 						, bx::Handedness::Right
 						);
 
-					culling_set::cull_spheres(_cullable_shadow_casters, light_sphere, 0, array::size(_cullable_shadow_casters.id));
-					culling_set::remove_culled(_cullable_shadow_casters);
+					culling_set::query(_cullable_shadow_casters, light_sphere);
+					bool render_static = true;
 
 					// Render omni light shadow map as 4 strips, one per
 					// tetrahedron face, using stencil masking. Stencil pattern
@@ -2064,6 +2339,25 @@ void RenderWorld::render(f32 dt
 
 						shader.mvp[side] = light_view * light_proj[strip] * omni_bias[strip];
 
+						// Static casters are rendered into the cache only when the
+						// light moved or a static caster inside its range changed.
+						if (side == 0) {
+							if (shadow_caching) {
+								ShadowCacheTile &tile = _local_lights_shadow_cache[cur_tile];
+								render_static = !shadow_cache::is_valid(tile, shader.mvp[0]);
+
+								if (render_static) {
+									tile.view_proj = shader.mvp[0];
+									tile.volume = light_sphere;
+									tile.valid = true;
+									++num_shadow_cache_misses;
+								}
+							}
+
+							if (render_static)
+								culling_set::query(_cullable_static_shadow_casters, light_sphere);
+						}
+
 						if (false) {
 							Color4 colors[] = { COLOR4_BLUE, COLOR4_YELLOW, COLOR4_GREEN, COLOR4_RED };
 							Frustum frustum;
@@ -2111,7 +2405,26 @@ void RenderWorld::render(f32 dt
 							, (u16)rect.w
 							);
 						bgfx::setViewTransform(sm_local_view_id, to_float_ptr(light_view), to_float_ptr(light_proj[strip]));
-						_mesh_manager.draw_shadow_casters(sm_local_view_id, *_scene_graph, stencil[strip]);
+						_mesh_manager.draw_shadow_casters(sm_local_view_id, _cullable_shadow_casters, stencil[strip]);
+
+						if (render_static) {
+							bgfx::ViewId static_view = sm_local_view_id;
+							if (shadow_caching) {
+								static_view = sm_local_cache_view_id++;
+								bgfx::setViewRect(static_view
+									, (u16)rect.x
+									, (u16)rect.y
+									, (u16)rect.z
+									, (u16)rect.w
+									);
+								bgfx::setViewTransform(static_view, to_float_ptr(light_view), to_float_ptr(light_proj[strip]));
+								// The strips of sides 0 and 1 cover the whole tile.
+								bgfx::setViewClear(static_view, side < 2 ? BGFX_CLEAR_DEPTH : BGFX_CLEAR_NONE, 0, 1.0f, 0);
+								bgfx::touch(static_view);
+							}
+
+							_mesh_manager.draw_shadow_casters(static_view, _cullable_static_shadow_casters, stencil[strip]);
+						}
 						++sm_local_view_id;
 					}
 				}
@@ -2129,7 +2442,79 @@ void RenderWorld::render(f32 dt
 		for (u32 i = 0; i < array::size(lm._local_lights_spot); ++i)
 			array::push_back(lm._lights_data, lid.shader[lm._local_lights_spot[i]]);
 	}
+
+	// Assign local lights to clusters. Cluster lights are indices into the
+	// local lights: omni lights first, then spot lights.
+	Vector4 light_clusters_params[2];
+	light_clusters_params[0] = { f32(LIGHT_CLUSTERS_X), f32(LIGHT_CLUSTERS_Y), f32(LIGHT_CLUSTERS_Z), f32(light_clustering) };
+	light_clusters_params[1] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	if (light_clustering) {
+		ENTER_PROFILE_SCOPE("light_clustering");
+		_light_clusters.reset(LIGHT_CLUSTERS_X
+			, LIGHT_CLUSTERS_Y
+			, LIGHT_CLUSTERS_Z
+			, view
+			, cull_proj
+			, LIGHT_INDICES_MAX
+			);
+		for (u32 i = 0; i < array::size(lm._local_lights_omni); ++i) {
+			const LightManager::ShaderData &shader = lid.shader[lm._local_lights_omni[i]];
+			_light_clusters.add_omni({ shader.position, shader.range });
+		}
+		for (u32 i = 0; i < array::size(lm._local_lights_spot); ++i) {
+			const LightManager::ShaderData &shader = lid.shader[lm._local_lights_spot[i]];
+			_light_clusters.add_spot({ shader.position, shader.range }
+				, shader.position
+				, shader.direction
+				, shader.range
+				, shader.spot_angle
+				);
+		}
+		_light_clusters.assign();
+		light_clusters_params[1].x = _light_clusters._slice_scale;
+		light_clusters_params[1].y = _light_clusters._slice_bias;
+
+		const u32 num_clusters = _light_clusters.num_clusters();
+		const bgfx::Memory *clusters = bgfx::alloc(num_clusters*2*sizeof(f32));
+		f32 *clusters_data = (f32 *)clusters->data;
+		for (u32 i = 0; i < num_clusters; ++i) {
+			clusters_data[i*2 + 0] = f32(_light_clusters._offset[i]);
+			clusters_data[i*2 + 1] = f32(_light_clusters._count[i]);
+		}
+		bgfx::updateTexture2D(_pipeline->_light_clusters_texture
+			, 0 // layer
+			, 0 // mip
+			, 0 // x
+			, 0 // y
+			, LIGHT_CLUSTERS_X * LIGHT_CLUSTERS_Y // width
+			, LIGHT_CLUSTERS_Z // height
+			, clusters
+			);
+
+		const u32 num_indices = array::size(_light_clusters._indices);
+		if (num_indices != 0) {
+			const u32 num_rows = (num_indices + LIGHT_INDICES_WIDTH - 1) / LIGHT_INDICES_WIDTH;
+			const bgfx::Memory *indices = bgfx::alloc(num_rows*LIGHT_INDICES_WIDTH*sizeof(f32));
+			f32 *indices_data = (f32 *)indices->data;
+			for (u32 i = 0; i < num_rows*LIGHT_INDICES_WIDTH; ++i)
+				indices_data[i] = i < num_indices ? f32(_light_clusters._indices[i]) : 0.0f;
+			bgfx::updateTexture2D(_pipeline->_light_indices_texture
+				, 0 // layer
+				, 0 // mip
+				, 0 // x
+				, 0 // y
+				, LIGHT_INDICES_WIDTH // width
+				, num_rows // height
+				, indices
+				);
+		}
+		RECORD_FLOAT("world.light_cluster_indices", f32(num_indices));
+		LEAVE_PROFILE_SCOPE();
+	}
+
 	RECORD_FLOAT("world.visible_lights", f32(num_lights));
+	RECORD_FLOAT("world.shadow_cache_misses", f32(num_shadow_cache_misses));
+	array::clear(_shadow_cache_invalid);
 
 	// Send lights data to GPU.
 	Vector4 h;
@@ -2138,14 +2523,15 @@ void RenderWorld::render(f32 dt
 	h.z = (f32)array::size(lm._local_lights_spot);
 	h.w = 0.0f;
 	bgfx::setUniform(_pipeline->_lights_num, &h);
+	bgfx::setUniform(_pipeline->_light_clusters_params, light_clusters_params, countof(light_clusters_params));
 	CE_ENSURE(array::size(lm._lights_data) <= MAX_NUM_LIGHTS);
 	bgfx::updateTexture2D(_pipeline->_lights_data_texture
 		, 0 // layer
 		, 0 // mip
 		, 0 // x
 		, 0 // y
-		, LIGHT_SIZE * array::size(lm._lights_data) // width
-		, 1 // height
+		, LIGHT_SIZE // width
+		, array::size(lm._lights_data) // height
 		, bgfx::makeRef(array::begin(lm._lights_data), array::size(lm._lights_data)*sizeof(LightManager::ShaderData))
 		);
 	bgfx::touch(View::LIGHTS);
@@ -2188,6 +2574,7 @@ void RenderWorld::render(f32 dt
 
 	// Render objects and outlines.
 	const bool selection_enabled = _pipeline->selection_enabled();
+	array::clear(_mesh_manager._batch);
 	u32 sprite_slot = 0;
 	for (u32 ii = 0; ii < visible_objects; ++ii) {
 		const u32 ci = _cullable_objects.render[ii];
@@ -2195,14 +2582,7 @@ void RenderWorld::render(f32 dt
 
 		switch (_cullable_objects.type[ci]) {
 		case CullableType::MESH:
-			draw_mesh(_mesh_manager
-				, object_id
-				, _pipeline
-				, _fog_desc
-				, _global_lighting_desc
-				, _scene_graph
-				, cascaded_lights
-				);
+			array::push_back(_mesh_manager._batch, object_id);
 
 			if (selection_enabled
 				&& (_mesh_manager._data.flags[object_id] & RenderableFlags::SELECTED) != 0) {
@@ -2211,7 +2591,7 @@ void RenderWorld::render(f32 dt
 				const Vector4 data = { u2f.f, 0.0f, 0.0f, 0.0f };
 				bgfx::setUniform(_pipeline->_unit_id, &data);
 
-				_mesh_manager.set_instance_data(object_id, *_scene_graph);
+				_mesh_manager.set_instance_data(object_id);
 				bgfx::setState(_pipeline->_selection_shader.state);
 				bgfx::submit(View::SELECTION, _pipeline->_selection_shader.program);
 			}
@@ -2226,14 +2606,7 @@ void RenderWorld::render(f32 dt
 			if ((_mesh_manager._data.flags[mesh_i] & RenderableFlags::VISIBLE) == 0)
 				break;
 
-			draw_mesh(_mesh_manager
-				, mesh_i
-				, _pipeline
-				, _fog_desc
-				, _global_lighting_desc
-				, _scene_graph
-				, cascaded_lights
-				);
+			array::push_back(_mesh_manager._batch, mesh_i);
 
 			if (selection_enabled
 				&& (_lod_group_manager._data.flags[object_id] & RenderableFlags::SELECTED) != 0) {
@@ -2242,7 +2615,7 @@ void RenderWorld::render(f32 dt
 				const Vector4 data = { u2f.f, 0.0f, 0.0f, 0.0f };
 				bgfx::setUniform(_pipeline->_unit_id, &data);
 
-				_mesh_manager.set_instance_data(mesh_i, *_scene_graph);
+				_mesh_manager.set_instance_data(mesh_i);
 				bgfx::setState(_pipeline->_selection_shader.state);
 				bgfx::submit(View::SELECTION, _pipeline->_selection_shader.program);
 			}
@@ -2281,8 +2654,25 @@ void RenderWorld::render(f32 dt
 
 		case CullableType::LIGHT:
 			break;
+
+		default:
+			CE_FATAL("Unknown cullable type");
+			break;
 		}
 	}
+
+	// Draw visible meshes in sort key order.
+	_mesh_manager.sort_batch(View::MESH, camera_pos, false);
+	const u32 skipped_binds = draw_meshes(_mesh_manager
+		, array::begin(_mesh_manager._batch)
+		, array::size(_mesh_manager._batch)
+		, _pipeline
+		, _fog_desc
+		, _global_lighting_desc
+		, cascaded_lights
+		);
+	RECORD_FLOAT("world.skipped_material_binds", f32(skipped_binds));
+	RECORD_FLOAT("world.mesh_draw_calls", f32(_mesh_manager._num_draws));
 }
 
 void RenderWorld::debug_draw(DebugLine &dl)
@@ -2384,6 +2774,57 @@ void RenderWorld::unit_destroyed_callback(UnitId unit)
 	}
 }
 
+/// Sorts @a indices in descending order.
+static void render_world_sort_descending(Array<u32> &indices)
+{
+	std::sort(array::begin(indices)
+		, array::end(indices)
+		, [](const u32 &in_a, const u32 &in_b) {
+			return in_a > in_b;
+		});
+}
+
+void RenderWorld::units_destroyed_callback(const UnitId *units, u32 num)
+{
+	Array<u32> indices(*_mesh_manager._allocator);
+	array::reserve(indices, num);
+
+	for (u32 i = 0; i < num; ++i) {
+		LodGroupId lod_group = lod_group_instance(units[i]);
+		if (is_valid(lod_group))
+			array::push_back(indices, lod_group.i);
+	}
+	render_world_sort_descending(indices);
+	_lod_group_manager.destroy(array::begin(indices), array::size(indices));
+
+	array::clear(indices);
+	for (u32 i = 0; i < num; ++i) {
+		MeshId mesh = mesh_instance(units[i]);
+		if (is_valid(mesh))
+			array::push_back(indices, _mesh_manager.index(mesh));
+	}
+	render_world_sort_descending(indices);
+	_mesh_manager.destroy(array::begin(indices), array::size(indices));
+
+	array::clear(indices);
+	for (u32 i = 0; i < num; ++i) {
+		SpriteId sprite = sprite_instance(units[i]);
+		if (is_valid(sprite))
+			array::push_back(indices, sprite.i);
+	}
+	render_world_sort_descending(indices);
+	_sprite_manager.destroy(array::begin(indices), array::size(indices));
+
+	array::clear(indices);
+	for (u32 i = 0; i < num; ++i) {
+		LightId light = light_instance(units[i]);
+		if (is_valid(light))
+			array::push_back(indices, light.i);
+	}
+	render_world_sort_descending(indices);
+	_light_manager.destroy(array::begin(indices), array::size(indices));
+}
+
 void RenderWorld::reload_materials(const MaterialResource *old_resource, const MaterialResource *new_resource)
 {
 #if CROWN_CAN_RELOAD
@@ -2413,8 +2854,7 @@ void RenderWorld::reload_meshes(const MeshResource *old_resource, const MeshReso
 	for (u32 i = 0; i < _mesh_manager._data.size; ++i) {
 		if (_mesh_manager._data.resource[i] == old_resource) {
 			_mesh_manager.set_geometry(i, new_resource, _mesh_manager._data.geometry_name[i]);
-			_mesh_manager._data.flags[i] |= RenderableFlags::DIRTY;
-			_mesh_manager._dirty = true;
+			_mesh_manager.set_dirty(i);
 			reloaded = true;
 		}
 	}
@@ -2423,9 +2863,8 @@ void RenderWorld::reload_meshes(const MeshResource *old_resource, const MeshReso
 		LodGroupManager::LodGroupInstanceData &lgd = _lod_group_manager._data;
 		for (u32 i = 0; i < lgd.size; ++i) {
 			_lod_group_manager.update_bounds(i);
-			lgd.flags[i] |= RenderableFlags::DIRTY;
+			_lod_group_manager.set_dirty(i);
 		}
-		_lod_group_manager._dirty = true;
 	}
 #else
 	CE_UNUSED_2(old_resource, new_resource);
@@ -2440,8 +2879,7 @@ void RenderWorld::reload_sprites(const SpriteResource *old_resource, const Sprit
 			_sprite_manager._data.frame[i] %= new_resource->num_frames;
 			_sprite_manager._data.obb[i] = new_resource->obb;
 			_sprite_manager._data.sphere[i] = new_resource->sphere;
-			_sprite_manager._data.flags[i] |= RenderableFlags::DIRTY;
-			_sprite_manager._dirty = true;
+			_sprite_manager.set_dirty(i);
 		}
 	}
 }
@@ -2528,7 +2966,7 @@ void RenderWorld::MeshManager::create_instances(const void *components_data
 
 	for (u32 i = 0; i < num; ++i) {
 		UnitId unit = unit_lookup[unit_index[i]];
-		CE_ASSERT(!hash_map::has(_map, unit), "Unit already has a mesh component");
+		CE_ASSERT(!unit_map::has(_map, unit), "Unit already has a mesh component");
 
 		TransformId ti = _render_world->_scene_graph->instance(unit);
 		CE_ASSERT(is_valid(ti), "Mesh Component requires a Transform Component");
@@ -2561,9 +2999,10 @@ void RenderWorld::MeshManager::create_instances(const void *components_data
 		_data.material_resource[last] = mat_res;
 		_data.geometry_name[last] = meshes[i].geometry_name;
 #endif
-		_dirty = true;
+		array::push_back(_dirty, last);
 
-		hash_map::set(_map, unit, alloc_id(last));
+		unit_map::set(_map, unit, alloc_id(last));
+		_render_world->set_renderable(unit, CullableType::MESH, last);
 		++_data.size;
 	}
 }
@@ -2571,43 +3010,70 @@ void RenderWorld::MeshManager::create_instances(const void *components_data
 void RenderWorld::MeshManager::destroy(MeshId mesh)
 {
 	const u32 mesh_i = index(mesh);
+	destroy(&mesh_i, 1);
+}
+
+void RenderWorld::MeshManager::destroy(const u32 *indices, u32 num)
+{
+	const u32 size = _data.size;
 
-	const u32 last      = _data.size - 1;
-	const UnitId u      = _data.unit[mesh_i];
-
-	culling_set::fixup(_render_world->_cullable_objects, CullableType::MESH, mesh_i, last);
-	culling_set::fixup(_render_world->_cullable_shadow_casters, CullableType::MESH, mesh_i, last);
-
-	_data.unit[mesh_i]     = _data.unit[last];
-	_data.resource[mesh_i] = _data.resource[last];
-	_data.geometry[mesh_i] = _data.geometry[last];
-	_data.mesh[mesh_i].vbh = _data.mesh[last].vbh;
-	_data.mesh[mesh_i].ibh = _data.mesh[last].ibh;
-	_data.material[mesh_i] = _data.material[last];
-	_data.world[mesh_i]    = _data.world[last];
-	_data.obb[mesh_i]      = _data.obb[last];
-	_data.sphere[mesh_i]   = _data.sphere[last];
-	_data.skeleton[mesh_i] = _data.skeleton[last];
-	_data.flags[mesh_i]    = _data.flags[last];
-	_data.prev_flags[mesh_i] = _data.prev_flags[last];
-	_data.matrix_cache[mesh_i] = _data.matrix_cache[last];
+	for (u32 i = 0; i < num; ++i) {
+		const u32 mesh_i = indices[i];
+		CE_ASSERT(mesh_i < _data.size && (i == 0 || mesh_i < indices[i - 1]), "Indices must be sorted in descending order");
+
+		const u32 last      = _data.size - 1;
+		const UnitId u      = _data.unit[mesh_i];
+		const MeshId mesh   = unit_map::get(_map, u, MeshId { UINT32_MAX });
+
+		// Static casters invalidate the cached shadows they were rendered into.
+		if ((_data.flags[mesh_i] & RenderableFlags::STATIC_SHADOW) != 0) {
+			const CullingSet &casters = _render_world->_cullable_static_shadow_casters;
+			const u32 ci = culling_set::find_object(casters, CullableType::MESH, mesh_i);
+			if (ci != UINT32_MAX)
+				array::push_back(_render_world->_shadow_cache_invalid, casters.sphere_w[ci]);
+		}
+
+		_data.unit[mesh_i]     = _data.unit[last];
+		_data.resource[mesh_i] = _data.resource[last];
+		_data.geometry[mesh_i] = _data.geometry[last];
+		_data.mesh[mesh_i].vbh = _data.mesh[last].vbh;
+		_data.mesh[mesh_i].ibh = _data.mesh[last].ibh;
+		_data.material[mesh_i] = _data.material[last];
+		_data.world[mesh_i]    = _data.world[last];
+		_data.obb[mesh_i]      = _data.obb[last];
+		_data.sphere[mesh_i]   = _data.sphere[last];
+		_data.skeleton[mesh_i] = _data.skeleton[last];
+		_data.flags[mesh_i]    = _data.flags[last];
+		_data.prev_flags[mesh_i] = _data.prev_flags[last];
+		_data.matrix_cache[mesh_i] = _data.matrix_cache[last];
 #if CROWN_CAN_RELOAD
-	_data.material_resource[mesh_i] = _data.material_resource[last];
-	_data.geometry_name[mesh_i] = _data.geometry_name[last];
+		_data.material_resource[mesh_i] = _data.material_resource[last];
+		_data.geometry_name[mesh_i] = _data.geometry_name[last];
 #endif
 
-	if (mesh_i != last) {
-		const MeshId last_id = hash_map::get(_map, _data.unit[mesh_i], MeshId { UINT32_MAX });
-		_indices[last_id.i & MESH_INDEX_MASK].index = mesh_i;
-	}
+		if (mesh_i != last) {
+			const MeshId last_id = unit_map::get(_map, _data.unit[mesh_i], MeshId { UINT32_MAX });
+			_indices[last_id.i & MESH_INDEX_MASK].index = mesh_i;
 
-	const u32 slot = mesh.i & MESH_INDEX_MASK;
-	_indices[slot].index = UINT32_MAX;
-	_indices[slot].next = _free_list;
-	_free_list = slot;
+			if ((_data.flags[mesh_i] & RenderableFlags::DIRTY) != 0)
+				array::push_back(_dirty, mesh_i);
+		}
+
+		const u32 slot = mesh.i & MESH_INDEX_MASK;
+		_indices[slot].index = UINT32_MAX;
+		_indices[slot].next = _free_list;
+		_free_list = slot;
 
-	hash_map::remove(_map, u);
-	--_data.size;
+		unit_map::remove(_map, u);
+		_render_world->set_renderable(u, CullableType::MESH, UINT32_MAX);
+		if (mesh_i != last)
+			_render_world->set_renderable(_data.unit[mesh_i], CullableType::MESH, mesh_i);
+		--_data.size;
+	}
+
+	culling_set::fixup(*_allocator, _render_world->_cullable_objects, CullableType::MESH, indices, num, size);
+	culling_set::fixup(*_allocator, _render_world->_cullable_shadow_casters, CullableType::MESH, indices, num, size);
+	culling_set::fixup(*_allocator, _render_world->_cullable_static_shadow_casters, CullableType::MESH, indices, num, size);
 }
 
 void RenderWorld::MeshManager::swap(u32 inst_a, u32 inst_b)
@@ -2617,8 +3083,8 @@ void RenderWorld::MeshManager::swap(u32 inst_a, u32 inst_b)
 
 	const UnitId unit_a = _data.unit[inst_a];
 	const UnitId unit_b = _data.unit[inst_b];
-	const MeshId id_a = hash_map::get(_map, unit_a, MeshId { UINT32_MAX });
-	const MeshId id_b = hash_map::get(_map, unit_b, MeshId { UINT32_MAX });
+	const MeshId id_a = unit_map::get(_map, unit_a, MeshId { UINT32_MAX });
+	const MeshId id_b = unit_map::get(_map, unit_b, MeshId { UINT32_MAX });
 
 	exchange(_data.unit[inst_a],     _data.unit[inst_b]);
 	exchange(_data.resource[inst_a], _data.resource[inst_b]);
@@ -2639,6 +3105,13 @@ void RenderWorld::MeshManager::swap(u32 inst_a, u32 inst_b)
 
 	_indices[id_a.i & MESH_INDEX_MASK].index = inst_b;
 	_indices[id_b.i & MESH_INDEX_MASK].index = inst_a;
+	_render_world->set_renderable(unit_a, CullableType::MESH, inst_b);
+	_render_world->set_renderable(unit_b, CullableType::MESH, inst_a);
+
+	if ((_data.flags[inst_a] & RenderableFlags::DIRTY) != 0)
+		array::push_back(_dirty, inst_a);
+	if ((_data.flags[inst_b] & RenderableFlags::DIRTY) != 0)
+		array::push_back(_dirty, inst_b);
 }
 
 bool RenderWorld::MeshManager::has(UnitId unit)
@@ -2657,8 +3130,7 @@ void RenderWorld::MeshManager::set_geometry(u32 mesh_i, const MeshResource *mr,
 	_data.mesh[mesh_i].ibh = mg->index_buffer;
 	_data.obb[mesh_i]      = mg->obb;
 	_data.sphere[mesh_i]   = mg->sphere;
-	_data.flags[mesh_i]   |= RenderableFlags::DIRTY;
-	_dirty                 = true;
+	set_dirty(mesh_i);
 #if CROWN_CAN_RELOAD
 	_data.geometry_name[mesh_i] = geometry;
 #endif
@@ -2666,7 +3138,7 @@ void RenderWorld::MeshManager::set_geometry(u32 mesh_i, const MeshResource *mr,
 
 MeshId RenderWorld::MeshManager::mesh(UnitId unit)
 {
-	return hash_map::get(_map, unit, MeshId { UINT32_MAX });
+	return unit_map::get(_map, unit, MeshId { UINT32_MAX });
 }
 
 void RenderWorld::MeshManager::destroy()
@@ -2674,6 +3146,15 @@ void RenderWorld::MeshManager::destroy()
 	_allocator->deallocate(_data.buffer);
 }
 
+void RenderWorld::MeshManager::set_dirty(u32 i)
+{
+	if ((_data.flags[i] & RenderableFlags::DIRTY) != 0)
+		return;
+
+	_data.flags[i] |= RenderableFlags::DIRTY;
+	array::push_back(_dirty, i);
+}
+
 MeshId RenderWorld::MeshManager::alloc_id(u32 index)
 {
 	if (_free_list != UINT32_MAX) {
@@ -2707,48 +3188,245 @@ u32 RenderWorld::MeshManager::index(MeshId mesh)
 	return idx.index;
 }
 
-void RenderWorld::MeshManager::set_instance_data(u32 ii, SceneGraph &scene_graph)
+struct SkinningPaletteTask
+{
+	AnimationSkeletonInstance **skeletons;
+	SceneGraph *scene_graph;
+};
+
+static void skinning_palette_task(u32 begin, u32 end, void *user_data)
 {
-	if (_data.skeleton[ii] != NULL) {
+	SkinningPaletteTask *task = (SkinningPaletteTask *)user_data;
+
+	for (u32 i = begin; i < end; ++i) {
+		AnimationSkeletonInstance *skeleton = task->skeletons[i];
+
+		for (u32 b = 0; b < skeleton->num_bones; ++b)
+			skeleton->bones[b] = task->scene_graph->world_pose(skeleton->bone_transforms[b]);
+
+		multiply_n(skeleton->bones, skeleton->offsets, skeleton->bones, skeleton->num_bones);
+	}
+}
+
+void RenderWorld::MeshManager::update_skinning_palettes(SceneGraph &scene_graph)
+{
+	ENTER_PROFILE_SCOPE(__func__);
+
+	// Meshes of the same unit hierarchy share the skeleton: collect each one once.
+	++_frame;
+	array::clear(_skeletons);
+	for (u32 ii = 0; ii < _data.size; ++ii) {
 		AnimationSkeletonInstance *skeleton = (AnimationSkeletonInstance *)_data.skeleton[ii];
+		if (skeleton == NULL
+			|| (_data.flags[ii] & (RenderableFlags::VISIBLE | RenderableFlags::SHADOW_CASTER)) == 0
+			|| skeleton->frame == _frame
+			)
+			continue;
+
+		skeleton->frame = _frame;
+		array::push_back(_skeletons, skeleton);
+	}
 
-		for (u32 b = 0; b < skeleton->num_bones; ++b) {
-			TransformId bone_ti = scene_graph.instance(skeleton->bone_lookup[b]);
-			skeleton->bones[b] = skeleton->offsets[b] * scene_graph.world_pose(bone_ti);
-		}
+	if (array::size(_skeletons) != 0) {
+		SkinningPaletteTask task;
+		task.skeletons = array::begin(_skeletons);
+		task.scene_graph = &scene_graph;
+		job_system::parallel_for(array::size(_skeletons), 8, skinning_palette_task, &task, "render_world.skinning");
+	}
 
-		TransformId ti = scene_graph.instance(_data.unit[ii]);
-		Matrix4x4 world_pose = scene_graph.world_pose(ti);
-		skeleton->bones[0] = world_pose;
+	RECORD_FLOAT("world.skinning_palettes", f32(array::size(_skeletons)));
+	LEAVE_PROFILE_SCOPE();
+}
 
-		bgfx::setTransform(skeleton->bones, skeleton->num_bones);
-	} else {
-		if (_data.matrix_cache[ii] == UINT32_MAX)
+void RenderWorld::MeshManager::set_instance_data(u32 ii)
+{
+	AnimationSkeletonInstance *skeleton = (AnimationSkeletonInstance *)_data.skeleton[ii];
+
+	if (_data.matrix_cache[ii] == UINT32_MAX) {
+		if (skeleton != NULL) {
+			// The first bone holds the world pose of the mesh itself.
+			skeleton->bones[0] = _data.world[ii];
+			_data.matrix_cache[ii] = bgfx::setTransform(skeleton->bones, skeleton->num_bones);
+		} else {
 			_data.matrix_cache[ii] = bgfx::setTransform(to_float_ptr(_data.world[ii]));
-		else
-			bgfx::setTransform(_data.matrix_cache[ii]);
+		}
+	} else {
+		bgfx::setTransform(_data.matrix_cache[ii], skeleton != NULL ? skeleton->num_bones : 1);
 	}
 
+	bgfx::setUniform(_render_world->_pipeline->_mesh_position_decode, _data.geometry[ii]->position_decode, 2);
 	bgfx::setVertexBuffer(0, _data.mesh[ii].vbh);
 	bgfx::setIndexBuffer(_data.mesh[ii].ibh);
 }
 
-void RenderWorld::MeshManager::draw_shadow_casters(u8 view_id, SceneGraph &scene_graph, u32 stencil)
+u32 RenderWorld::MeshManager::set_instance_data(const u32 *meshes, u32 num)
 {
-	u32 num = array::size(_render_world->_cullable_shadow_casters.render);
+	const u32 avail = bgfx::getAvailInstanceDataBuffer(num, sizeof(Matrix4x4));
+	if (avail == 0)
+		return 0;
+
+	bgfx::InstanceDataBuffer idb;
+	bgfx::allocInstanceDataBuffer(&idb, avail, sizeof(Matrix4x4));
+
+	for (u32 ii = 0; ii < avail; ++ii) {
+		CE_ENSURE(_data.skeleton[meshes[ii]] == NULL);
+		memcpy(idb.data + ii*sizeof(Matrix4x4), &_data.world[meshes[ii]], sizeof(Matrix4x4));
+	}
+
+	bgfx::setInstanceDataBuffer(&idb);
+	bgfx::setUniform(_render_world->_pipeline->_mesh_position_decode, _data.geometry[meshes[0]]->position_decode, 2);
+	bgfx::setVertexBuffer(0, _data.mesh[meshes[0]].vbh);
+	bgfx::setIndexBuffer(_data.mesh[meshes[0]].ibh);
+	return avail;
+}
+
+bool RenderWorld::MeshManager::can_instance(u32 ii, bool shadow)
+{
+	if (_data.skeleton[ii] != NULL || (bgfx::getCaps()->supported & BGFX_CAPS_INSTANCING) == 0)
+		return false;
+
+	return shadow
+		? bgfx::isValid(_render_world->_pipeline->_shadow_instancing_shader.program)
+		: _data.material[ii]->has_instanced_shader()
+		;
+}
+
+// Sort key layout, from most to least significant bits:
+// view (8) | blend (1) | program (9) | material (11) | vertex buffer (12) | index buffer (12) | depth (11).
+// Blended meshes are drawn after opaque ones and back-to-front, so their depth comes first:
+// view (8) | blend (1) | inverted depth (24) | program (9) | material (11) | unused (11).
+#define MESH_SORT_KEY_SHIFT_VIEW           56
+#define MESH_SORT_KEY_SHIFT_BLEND          55
+#define MESH_SORT_KEY_SHIFT_PROGRAM        46
+#define MESH_SORT_KEY_SHIFT_MATERIAL       35
+#define MESH_SORT_KEY_SHIFT_VB             23
+#define MESH_SORT_KEY_SHIFT_IB             11
+#define MESH_SORT_KEY_SHIFT_BLEND_DEPTH    31
+#define MESH_SORT_KEY_SHIFT_BLEND_PROGRAM  22
+#define MESH_SORT_KEY_SHIFT_BLEND_MATERIAL 11
+
+void RenderWorld::MeshManager::sort_batch(u8 view, const Vector3 &camera_pos, bool shadow)
+{
+	const u32 num = array::size(_batch);
+	if (num < 2)
+		return;
+
+	array::resize(_batch_tmp, num);
+	array::resize(_sort_keys, num*2);
+	u64 *keys = array::begin(_sort_keys);
+	const Pipeline *pl = _render_world->_pipeline;
 
 	for (u32 ii = 0; ii < num; ++ii) {
-		u32 mesh_id = _render_world->_cullable_shadow_casters.id[_render_world->_cullable_shadow_casters.render[ii]];
+		const u32 mi = _batch[ii];
+		const bool instanced = can_instance(mi, shadow);
+
+		bgfx::ProgramHandle program;
+		u32 material_id;
+		bool blend;
+		u32 dist_bits;
+		if (shadow) {
+			if (instanced)
+				program = pl->_shadow_instancing_shader.program;
+			else if (_data.skeleton[mi] != NULL)
+				program = pl->_shadow_skinning_shader.program;
+			else
+				program = pl->_shadow_shader.program;
+			material_id = 0;
+			blend = false;
+			dist_bits = 0;
+		} else {
+			const Material *material = _data.material[mi];
+			program = instanced ? material->_instanced_shader.program : material->_shader.program;
+			material_id = material->_id;
+			blend = (material->_shader.state & BGFX_STATE_BLEND_MASK) != 0;
+
+			// The bits of a positive float sort like the float itself.
+			union { f32 f; u32 u; } dist;
+			dist.f = length(translation(_data.world[mi]) - camera_pos);
+			dist_bits = dist.u;
+		}
+
+		if (blend) {
+			// Back-to-front: exponent and top 16 mantissa bits of the distance, inverted.
+			const u32 depth = ~(dist_bits >> 7) & 0xffffff;
+			keys[ii] = 0
+				| (u64(view) << MESH_SORT_KEY_SHIFT_VIEW)
+				| (u64(1) << MESH_SORT_KEY_SHIFT_BLEND)
+				| (u64(depth) << MESH_SORT_KEY_SHIFT_BLEND_DEPTH)
+				| (u64(program.idx & 0x1ff) << MESH_SORT_KEY_SHIFT_BLEND_PROGRAM)
+				| (u64(material_id & 0x7ff) << MESH_SORT_KEY_SHIFT_BLEND_MATERIAL)
+				;
+		} else {
+			// Front-to-back: exponent and top 3 mantissa bits of the distance.
+			const u32 depth = (dist_bits >> 20) & 0x7ff;
+			keys[ii] = 0
+				| (u64(view) << MESH_SORT_KEY_SHIFT_VIEW)
+				| (u64(program.idx & 0x1ff) << MESH_SORT_KEY_SHIFT_PROGRAM)
+				| (u64(material_id & 0x7ff) << MESH_SORT_KEY_SHIFT_MATERIAL)
+				| (u64(_data.mesh[mi].vbh.idx & 0xfff) << MESH_SORT_KEY_SHIFT_VB)
+				| (u64(_data.mesh[mi].ibh.idx & 0xfff) << MESH_SORT_KEY_SHIFT_IB)
+				| u64(depth)
+				;
+		}
+	}
 
-		set_instance_data(mesh_id, scene_graph);
+	bx::radixSort(keys, keys + num, array::begin(_batch), array::begin(_batch_tmp), num);
+}
+
+u32 RenderWorld::MeshManager::batch_size(const u32 *meshes, u32 num, bool by_material)
+{
+	const u32 first = meshes[0];
+
+	u32 ii = 1;
+	for (; ii < num; ++ii) {
+		const u32 mi = meshes[ii];
+		if (_data.mesh[mi].vbh.idx != _data.mesh[first].vbh.idx
+			|| _data.mesh[mi].ibh.idx != _data.mesh[first].ibh.idx
+			|| (by_material && _data.material[mi] != _data.material[first])
+			)
+			break;
+	}
+
+	return ii;
+}
+
+void RenderWorld::MeshManager::draw_shadow_casters(u8 view_id, const CullingSet &casters, u32 stencil)
+{
+	const Pipeline *pl = _render_world->_pipeline;
+
+	array::clear(_batch);
+	for (u32 ii = 0; ii < array::size(casters.render); ++ii)
+		array::push_back(_batch, casters.id[casters.render[ii]]);
+	sort_batch(view_id, VECTOR3_ZERO, true);
+
+	const u32 *batch = array::begin(_batch);
+	const u32 num = array::size(_batch);
+
+	for (u32 ii = 0; ii < num;) {
+		const u32 mesh_id = batch[ii];
+		const ShaderData *sd;
+		u32 num_set = 0;
+
+		// Shadow shaders ignore the material: batch by geometry only.
+		if (can_instance(mesh_id, true)) {
+			num_set = set_instance_data(batch + ii, batch_size(batch + ii, num - ii, false));
+			sd = &pl->_shadow_instancing_shader;
+		}
+
+		if (num_set == 0) {
+			set_instance_data(mesh_id);
+			sd = _data.skeleton[mesh_id] != NULL
+				? &pl->_shadow_skinning_shader
+				: &pl->_shadow_shader
+				;
+			num_set = 1;
+		}
 
-		ShaderData sd = _data.skeleton[mesh_id] != NULL
-			? _render_world->_pipeline->_shadow_skinning_shader
-			: _render_world->_pipeline->_shadow_shader
-			;
 		bgfx::setStencil(stencil);
-		bgfx::setState(sd.state);
-		bgfx::submit(view_id, sd.program);
+		bgfx::setState(sd->state);
+		bgfx::submit(view_id, sd->program);
+		++_num_draws;
+		ii += num_set;
 	}
 }
 
@@ -2828,7 +3506,7 @@ void RenderWorld::SpriteManager::create_instances(const void *components_data
 
 	for (u32 i = 0; i < num; ++i) {
 		UnitId unit = unit_lookup[unit_index[i]];
-		CE_ASSERT(!hash_map::has(_map, unit), "Unit already has a sprite component");
+		CE_ASSERT(!unit_map::has(_map, unit), "Unit already has a sprite component");
 
 		TransformId ti = _render_world->_scene_graph->instance(unit);
 		CE_ASSERT(is_valid(ti), "Sprite Component requires a Transform Component");
@@ -2857,40 +3535,58 @@ void RenderWorld::SpriteManager::create_instances(const void *components_data
 		_data.material_resource[last] = mat_res;
 #endif
 
-		hash_map::set(_map, unit, last);
+		unit_map::set(_map, unit, last);
+		_render_world->set_renderable(unit, CullableType::SPRITE, last);
 		++_data.size;
-		_dirty = true;
+		array::push_back(_dirty, last);
 	}
 }
 
 void RenderWorld::SpriteManager::destroy(SpriteId inst)
 {
 	CE_ASSERT(inst.i < _data.size, "Index out of bounds");
+	destroy(&inst.i, 1);
+}
 
-	const u32 last      = _data.size - 1;
-	const UnitId u      = _data.unit[inst.i];
-	const UnitId last_u = _data.unit[last];
-
-	culling_set::fixup(_render_world->_cullable_objects, CullableType::SPRITE, inst.i, last);
-
-	_data.unit[inst.i]       = _data.unit[last];
-	_data.resource[inst.i]   = _data.resource[last];
-	_data.material[inst.i]   = _data.material[last];
-	_data.frame[inst.i]      = _data.frame[last];
-	_data.world[inst.i]      = _data.world[last];
-	_data.obb[inst.i]        = _data.obb[last];
-	_data.sphere[inst.i]     = _data.sphere[last];
-	_data.flags[inst.i]      = _data.flags[last];
-	_data.prev_flags[inst.i] = _data.prev_flags[last];
-	_data.layer[inst.i]      = _data.layer[last];
-	_data.depth[inst.i]      = _data.depth[last];
+void RenderWorld::SpriteManager::destroy(const u32 *indices, u32 num)
+{
+	const u32 size = _data.size;
+
+	for (u32 i = 0; i < num; ++i) {
+		const u32 inst_i = indices[i];
+		CE_ASSERT(inst_i < _data.size && (i == 0 || inst_i < indices[i - 1]), "Indices must be sorted in descending order");
+
+		const u32 last      = _data.size - 1;
+		const UnitId u      = _data.unit[inst_i];
+		const UnitId last_u = _data.unit[last];
+
+		_data.unit[inst_i]       = _data.unit[last];
+		_data.resource[inst_i]   = _data.resource[last];
+		_data.material[inst_i]   = _data.material[last];
+		_data.frame[inst_i]      = _data.frame[last];
+		_data.world[inst_i]      = _data.world[last];
+		_data.obb[inst_i]        = _data.obb[last];
+		_data.sphere[inst_i]     = _data.sphere[last];
+		_data.flags[inst_i]      = _data.flags[last];
+		_data.prev_flags[inst_i] = _data.prev_flags[last];
+		_data.layer[inst_i]      = _data.layer[last];
+		_data.depth[inst_i]      = _data.depth[last];
 #if CROWN_CAN_RELOAD
-	_data.material_resource[inst.i] = _data.material_resource[last];
+		_data.material_resource[inst_i] = _data.material_resource[last];
 #endif
 
-	hash_map::set(_map, last_u, inst.i);
-	hash_map::remove(_map, u);
-	--_data.size;
+		if (inst_i != last && (_data.flags[inst_i] & RenderableFlags::DIRTY) != 0)
+			array::push_back(_dirty, inst_i);
+
+		unit_map::set(_map, last_u, inst_i);
+		unit_map::remove(_map, u);
+		_render_world->set_renderable(u, CullableType::SPRITE, UINT32_MAX);
+		if (inst_i != last)
+			_render_world->set_renderable(last_u, CullableType::SPRITE, inst_i);
+		--_data.size;
+	}
+
+	culling_set::fixup(*_allocator, _render_world->_cullable_objects, CullableType::SPRITE, indices, num, size);
 }
 
 void RenderWorld::SpriteManager::swap(u32 inst_a, u32 inst_b)
@@ -2916,8 +3612,15 @@ void RenderWorld::SpriteManager::swap(u32 inst_a, u32 inst_b)
 	exchange(_data.material_resource[inst_a], _data.material_resource[inst_b]);
 #endif
 
-	hash_map::set(_map, unit_a, inst_b);
-	hash_map::set(_map, unit_b, inst_a);
+	unit_map::set(_map, unit_a, inst_b);
+	unit_map::set(_map, unit_b, inst_a);
+	_render_world->set_renderable(unit_a, CullableType::SPRITE, inst_b);
+	_render_world->set_renderable(unit_b, CullableType::SPRITE, inst_a);
+
+	if ((_data.flags[inst_a] & RenderableFlags::DIRTY) != 0)
+		array::push_back(_dirty, inst_a);
+	if ((_data.flags[inst_b] & RenderableFlags::DIRTY) != 0)
+		array::push_back(_dirty, inst_b);
 }
 
 bool RenderWorld::SpriteManager::has(UnitId unit)
@@ -2927,7 +3630,7 @@ bool RenderWorld::SpriteManager::has(UnitId unit)
 
 SpriteId RenderWorld::SpriteManager::sprite(UnitId unit)
 {
-	return make_instance(hash_map::get(_map, unit, UINT32_MAX));
+	return make_instance(unit_map::get(_map, unit, UINT32_MAX));
 }
 
 void RenderWorld::SpriteManager::destroy()
@@ -2935,6 +3638,15 @@ void RenderWorld::SpriteManager::destroy()
 	_allocator->deallocate(_data.buffer);
 }
 
+void RenderWorld::SpriteManager::set_dirty(u32 i)
+{
+	if ((_data.flags[i] & RenderableFlags::DIRTY) != 0)
+		return;
+
+	_data.flags[i] |= RenderableFlags::DIRTY;
+	array::push_back(_dirty, i);
+}
+
 void RenderWorld::SpriteManager::set_instance_data(f32 **vdata_, u16 **idata_, bgfx::TransientVertexBuffer &tvb, bgfx::TransientIndexBuffer &tib, u32 sprite_id, u32 slot)
 {
 	f32 *vdata = *vdata_;
@@ -3003,6 +3715,11 @@ void RenderWorld::SpriteManager::set_instance_data(f32 **vdata_, u16 **idata_, b
 
 	*idata_ += 6;
 
+	// The selection and fallback shaders are shared with meshes: sprite
+	// positions are never quantized.
+	const Vector4 position_decode[] = { { 0.0f, 0.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 1.0f, 0.0f } };
+	bgfx::setUniform(_render_world->_pipeline->_mesh_position_decode, position_decode, countof(position_decode));
+
 	bgfx::setTransform(to_float_ptr(_data.world[sprite_id]));
 	bgfx::setVertexBuffer(0, &tvb);
 	bgfx::setIndexBuffer(&tib, slot*6, 6);
@@ -3073,6 +3790,10 @@ void RenderWorld::LodGroupManager::grow()
 	allocate(_data.capacity * 2 + 1);
 }
 
+/// Largest simplification error, as a fraction of the screen height, of the
+/// LOD levels whose screen_size is derived from the mesh. One pixel at 1080p.
+static const f32 LOD_MAX_SCREEN_ERROR = 1.0f / 1080.0f;
+
 void RenderWorld::LodGroupManager::create_instances(const void *components_data
 	, u32 num
 	, const UnitId *unit_lookup
@@ -3089,7 +3810,7 @@ void RenderWorld::LodGroupManager::create_instances(const void *components_data
 
 		CE_ASSERT(desc->num_levels > 0, "LOD group must have at least one level");
 		CE_ASSERT(desc->level == -1 || (u32)desc->level < desc->num_levels, "Invalid LOD group level");
-		CE_ASSERT(!hash_map::has(_map, unit), "Unit already has a LOD group component");
+		CE_ASSERT(!unit_map::has(_map, unit), "Unit already has a LOD group component");
 
 		TransformId ti = _render_world->_scene_graph->instance(unit);
 		CE_ASSERT(is_valid(ti), "LOD Group Component requires a Transform Component");
@@ -3112,6 +3833,7 @@ void RenderWorld::LodGroupManager::create_instances(const void *components_data
 
 		u32 first_entry_idx = UINT32_MAX;
 		u32 prev_entry_idx = UINT32_MAX;
+		f32 prev_screen_size = 1.0f;
 		u32 l = 0;
 
 		// Allocate LOD entries.
@@ -3139,13 +3861,29 @@ void RenderWorld::LodGroupManager::create_instances(const void *components_data
 
 					entry.levels[slot].mesh = mesh;
 
-					_render_world->_mesh_manager._data.flags[mesh_i] |= RenderableFlags::LOD_LEVEL | RenderableFlags::DIRTY;
-					_render_world->_mesh_manager._dirty = true;
+					_render_world->_mesh_manager._data.flags[mesh_i] |= RenderableFlags::LOD_LEVEL;
+					_render_world->_mesh_manager.set_dirty(mesh_i);
 
 					culling_set::remove(_render_world->_cullable_objects, CullableType::MESH, mesh_i);
 					culling_set::remove(_render_world->_cullable_shadow_casters, CullableType::MESH, mesh_i);
+					culling_set::remove(_render_world->_cullable_static_shadow_casters, CullableType::MESH, mesh_i);
+
+					// Switch to a simplified level when its error drops below
+					// LOD_MAX_SCREEN_ERROR. The screen size is about twice the
+					// projected bounding sphere radius.
+					if (levels[l].screen_size < 0.0f) {
+						const f32 error = _render_world->_mesh_manager._data.geometry[mesh_i]->lod_error;
+						entry.levels[slot].screen_size = error > 0.0f
+							? min(prev_screen_size, 2.0f*LOD_MAX_SCREEN_ERROR / error)
+							: prev_screen_size
+							;
+					}
 				}
 
+				if (entry.levels[slot].screen_size < 0.0f)
+					entry.levels[slot].screen_size = 0.0f;
+
+				prev_screen_size = entry.levels[slot].screen_size;
 				++l;
 			}
 
@@ -3164,7 +3902,8 @@ void RenderWorld::LodGroupManager::create_instances(const void *components_data
 			}
 			);
 
-		hash_map::set(_map, unit, group_idx);
+		unit_map::set(_map, unit, group_idx);
+		_render_world->set_renderable(unit, CullableType::LOD_GROUP, group_idx);
 
 		data = (const char *)(levels + desc->num_levels);
 	}
@@ -3225,53 +3964,69 @@ void RenderWorld::LodGroupManager::update_bounds(u32 lod_group)
 void RenderWorld::LodGroupManager::destroy(LodGroupId lod_group)
 {
 	CE_ASSERT(lod_group.i < _data.size, "Index out of bounds");
+	destroy(&lod_group.i, 1);
+}
 
-	const u32 last = _data.size - 1;
-	const UnitId u = _data.unit[lod_group.i];
-	const UnitId last_u = _data.unit[last];
-
-	culling_set::fixup(_render_world->_cullable_objects, CullableType::LOD_GROUP, lod_group.i, last);
+void RenderWorld::LodGroupManager::destroy(const u32 *indices, u32 num)
+{
+	const u32 size = _data.size;
 
-	u32 entry_idx = _data.first_entry[lod_group.i];
-	while (entry_idx != UINT32_MAX) {
-		LodGroupEntry &entry = _entries[entry_idx];
+	for (u32 i = 0; i < num; ++i) {
+		const u32 inst_i = indices[i];
+		CE_ASSERT(inst_i < _data.size && (i == 0 || inst_i < indices[i - 1]), "Indices must be sorted in descending order");
 
-		for (u32 i = 0; i < entry.count; ++i) {
-			const MeshId mesh = entry.levels[i].mesh;
-			if (!is_valid(mesh))
-				continue;
+		const u32 last = _data.size - 1;
+		const UnitId u = _data.unit[inst_i];
+		const UnitId last_u = _data.unit[last];
 
-			const u32 mesh_i = _render_world->_mesh_manager.index(mesh);
-			_render_world->_mesh_manager._data.flags[mesh_i] &= ~RenderableFlags::LOD_LEVEL;
-			_render_world->_mesh_manager._data.flags[mesh_i] |= RenderableFlags::DIRTY;
-			_render_world->_mesh_manager._data.prev_flags[mesh_i] = 0u;
-		}
+		u32 entry_idx = _data.first_entry[inst_i];
+		while (entry_idx != UINT32_MAX) {
+			LodGroupEntry &entry = _entries[entry_idx];
 
-		entry_idx = entry.next;
-	}
-	_render_world->_mesh_manager._dirty = true;
+			for (u32 j = 0; j < entry.count; ++j) {
+				const MeshId mesh = entry.levels[j].mesh;
+				if (!is_valid(mesh))
+					continue;
 
-	free_entry_chain(_data.first_entry[lod_group.i]);
+				const u32 mesh_i = _render_world->_mesh_manager.index(mesh);
+				_render_world->_mesh_manager._data.flags[mesh_i] &= ~RenderableFlags::LOD_LEVEL;
+				_render_world->_mesh_manager._data.prev_flags[mesh_i] = 0u;
+				_render_world->_mesh_manager.set_dirty(mesh_i);
+			}
 
-	_data.unit[lod_group.i] = _data.unit[last];
-	_data.first_entry[lod_group.i] = _data.first_entry[last];
-	_data.level_count[lod_group.i] = _data.level_count[last];
-	_data.level[lod_group.i] = _data.level[last];
-	_data.fade_mode[lod_group.i] = _data.fade_mode[last];
-	_data.world[lod_group.i] = _data.world[last];
-	_data.obb[lod_group.i] = _data.obb[last];
-	_data.sphere[lod_group.i] = _data.sphere[last];
-	_data.current_level[lod_group.i] = _data.current_level[last];
-	_data.previous_level[lod_group.i] = _data.previous_level[last];
-	_data.previous_mesh[lod_group.i] = _data.previous_mesh[last];
-	_data.fade_time[lod_group.i] = _data.fade_time[last];
-	_data.selected_mesh[lod_group.i] = _data.selected_mesh[last];
-	_data.flags[lod_group.i] = _data.flags[last];
+			entry_idx = entry.next;
+		}
 
-	--_data.size;
+		free_entry_chain(_data.first_entry[inst_i]);
+
+		_data.unit[inst_i] = _data.unit[last];
+		_data.first_entry[inst_i] = _data.first_entry[last];
+		_data.level_count[inst_i] = _data.level_count[last];
+		_data.level[inst_i] = _data.level[last];
+		_data.fade_mode[inst_i] = _data.fade_mode[last];
+		_data.world[inst_i] = _data.world[last];
+		_data.obb[inst_i] = _data.obb[last];
+		_data.sphere[inst_i] = _data.sphere[last];
+		_data.current_level[inst_i] = _data.current_level[last];
+		_data.previous_level[inst_i] = _data.previous_level[last];
+		_data.previous_mesh[inst_i] = _data.previous_mesh[last];
+		_data.fade_time[inst_i] = _data.fade_time[last];
+		_data.selected_mesh[inst_i] = _data.selected_mesh[last];
+		_data.flags[inst_i] = _data.flags[last];
+
+		if (inst_i != last && (_data.flags[inst_i] & RenderableFlags::DIRTY) != 0)
+			array::push_back(_dirty, inst_i);
+
+		--_data.size;
+
+		unit_map::set(_map, last_u, inst_i);
+		unit_map::remove(_map, u);
+		_render_world->set_renderable(u, CullableType::LOD_GROUP, UINT32_MAX);
+		if (inst_i != last)
+			_render_world->set_renderable(last_u, CullableType::LOD_GROUP, inst_i);
+	}
 
-	hash_map::set(_map, last_u, lod_group.i);
-	hash_map::remove(_map, u);
+	culling_set::fixup(*_allocator, _render_world->_cullable_objects, CullableType::LOD_GROUP, indices, num, size);
 }
 
 bool RenderWorld::LodGroupManager::has(UnitId unit)
@@ -3281,7 +4036,7 @@ bool RenderWorld::LodGroupManager::has(UnitId unit)
 
 LodGroupId RenderWorld::LodGroupManager::lod_group(UnitId unit)
 {
-	return make_instance(hash_map::get(_map, unit, UINT32_MAX));
+	return make_instance(unit_map::get(_map, unit, UINT32_MAX));
 }
 
 void RenderWorld::LodGroupManager::select_level(u32 lod_group, const Matrix4x4 &view_proj, f32 dt)
@@ -3397,6 +4152,15 @@ void RenderWorld::LodGroupManager::destroy()
 	_allocator->deallocate(_data.buffer);
 }
 
+void RenderWorld::LodGroupManager::set_dirty(u32 i)
+{
+	if ((_data.flags[i] & RenderableFlags::DIRTY) != 0)
+		return;
+
+	_data.flags[i] |= RenderableFlags::DIRTY;
+	array::push_back(_dirty, i);
+}
+
 u32 RenderWorld::LodGroupManager::alloc_entry()
 {
 	if (_free_list != UINT32_MAX) {
@@ -3480,7 +4244,7 @@ void RenderWorld::LightManager::create_instances(const void *components_data
 
 	for (u32 i = 0; i < num; ++i) {
 		UnitId unit = unit_lookup[unit_index[i]];
-		CE_ASSERT(!hash_map::has(_map, unit), "Unit already has a mesh component");
+		CE_ASSERT(!unit_map::has(_map, unit), "Unit already has a mesh component");
 
 		TransformId ti = _render_world->_scene_graph->instance(unit);
 		CE_ASSERT(is_valid(ti), "Light Component requires a Transform Component");
@@ -3513,35 +4277,53 @@ void RenderWorld::LightManager::create_instances(const void *components_data
 		_data.shader[last].mvp[1]      = MATRIX4X4_IDENTITY;
 		_data.shader[last].mvp[2]      = MATRIX4X4_IDENTITY;
 		_data.shader[last].mvp[3]      = MATRIX4X4_IDENTITY;
-		_dirty                         = true;
+		array::push_back(_dirty, last);
 
 		++_data.size;
 
-		hash_map::set(_map, unit, last);
+		unit_map::set(_map, unit, last);
+		_render_world->set_renderable(unit, CullableType::LIGHT, last);
 	}
 }
 
 void RenderWorld::LightManager::destroy(LightId light)
 {
 	CE_ASSERT(light.i < _data.size, "Index out of bounds");
+	destroy(&light.i, 1);
+}
 
-	const u32 last      = _data.size - 1;
-	const UnitId u      = _data.unit[light.i];
-	const UnitId last_u = _data.unit[last];
-
-	culling_set::fixup(_render_world->_cullable_lights, CullableType::LIGHT, light.i, last);
-
-	_data.unit[light.i] = _data.unit[last];
-	_data.flag[light.i] = _data.flag[last];
-	_data.prev_flags[light.i] = _data.prev_flags[last];
-	_data.type[light.i] = _data.type[last];
-	_data.world[light.i] = _data.world[last];
-	_data.shader[light.i] = _data.shader[last];
+void RenderWorld::LightManager::destroy(const u32 *indices, u32 num)
+{
+	const u32 size = _data.size;
 
-	--_data.size;
+	for (u32 i = 0; i < num; ++i) {
+		const u32 inst_i = indices[i];
+		CE_ASSERT(inst_i < _data.size && (i == 0 || inst_i < indices[i - 1]), "Indices must be sorted in descending order");
+
+		const u32 last      = _data.size - 1;
+		const UnitId u      = _data.unit[inst_i];
+		const UnitId last_u = _data.unit[last];
+
+		_data.unit[inst_i] = _data.unit[last];
+		_data.flag[inst_i] = _data.flag[last];
+		_data.prev_flags[inst_i] = _data.prev_flags[last];
+		_data.type[inst_i] = _data.type[last];
+		_data.world[inst_i] = _data.world[last];
+		_data.shader[inst_i] = _data.shader[last];
+
+		if (inst_i != last && (_data.flag[inst_i] & RenderableFlags::DIRTY) != 0)
+			array::push_back(_dirty, inst_i);
+
+		--_data.size;
+
+		unit_map::set(_map, last_u, inst_i);
+		unit_map::remove(_map, u);
+		_render_world->set_renderable(u, CullableType::LIGHT, UINT32_MAX);
+		if (inst_i != last)
+			_render_world->set_renderable(last_u, CullableType::LIGHT, inst_i);
+	}
 
-	hash_map::set(_map, last_u, light.i);
-	hash_map::remove(_map, u);
+	culling_set::fixup(*_allocator, _render_world->_cullable_lights, CullableType::LIGHT, indices, num, size);
 }
 
 bool RenderWorld::LightManager::has(UnitId unit)
@@ -3551,7 +4333,7 @@ bool RenderWorld::LightManager::has(UnitId unit)
 
 LightId RenderWorld::LightManager::light(UnitId unit)
 {
-	return make_instance(hash_map::get(_map, unit, UINT32_MAX));
+	return make_instance(unit_map::get(_map, unit, UINT32_MAX));
 }
 
 void RenderWorld::LightManager::destroy()
@@ -3559,6 +4341,15 @@ void RenderWorld::LightManager::destroy()
 	_allocator->deallocate(_data.buffer);
 }
 
+void RenderWorld::LightManager::set_dirty(u32 i)
+{
+	if ((_data.flag[i] & RenderableFlags::DIRTY) != 0)
+		return;
+
+	_data.flag[i] |= RenderableFlags::DIRTY;
+	array::push_back(_dirty, i);
+}
+
 void RenderWorld::LightManager::debug_draw(u32 offset, u32 count, DebugLine &dl, bool draw_bounds)
 {
 	for (u32 i = offset; i < offset + count; ++i) {
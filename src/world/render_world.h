@@ -13,49 +13,22 @@
 #include "resource/mesh_skeleton_resource.h"
 #include "resource/shader_resource.h"
 #include "resource/types.h"
+#include "world/culling_set.h"
+#include "world/light_clusters.h"
+#include "world/occlusion_buffer.h"
 #include "world/types.h"
 #include <bgfx/bgfx.h>
 
 namespace crown
 {
-struct CullableType
+/// Shadow map tile holding cached static shadow casters.
+struct ShadowCacheTile
 {
-	enum Enum
-	{
-		MESH,
-		SPRITE,
-		LOD_GROUP,
-		LIGHT
-	};
-};
-
-struct Cullable
-{
-	Matrix4x4 world;          ///< World pose of the object.
-	Sphere sphere;            ///< Culling sphere of the object in local space.
-	OBB obb;
-	u32 id;                   ///< ID of the object.
-	CullableType::Enum type;  ///< Type of the object.
-};
-
-struct CullingSet
-{
-	Array<Sphere> sphere_w;
-	Array<OBB> obb_w;
-	Array<u32> id;
-	Array<CullableType::Enum> type;
-	Array<u32> visible;
-	Array<u32> render;
-
-	explicit CullingSet(Allocator &a)
-		: sphere_w(a)
-		, obb_w(a)
-		, id(a)
-		, type(a)
-		, visible(a)
-		, render(a)
-	{
-	}
+	Matrix4x4 view_proj; ///< Light view-projection the casters were rendered with.
+	Sphere volume;       ///< Bounds of the light's volume, for local lights only.
+	u32 light;           ///< Light rendered into the tile, or UINT32_MAX.
+	u32 frame;           ///< Last frame the tile was used.
+	bool valid;          ///< Whether the tile holds the casters seen by view_proj.
 };
 
 struct LodLevelData
@@ -71,6 +44,12 @@ struct LodGroupEntry
 	u32 next;               ///< Next chunk index, or UINT32_MAX.
 };
 
+/// Instances of the renderable components of a unit.
+struct RenderableSlots
+{
+	u32 index[CullableType::COUNT]; ///< Instance index in the manager of each CullableType, or UINT32_MAX.
+};
+
 /// Manages graphics objects in a World.
 ///
 /// @ingroup World
@@ -384,6 +363,10 @@ struct RenderWorld
 	///
 	void tonemap_set_type(TonemapType::Enum type);
 
+	/// Sets the instance @a index of the renderable component @a type of @a unit.
+	/// UINT32_MAX removes the component.
+	void set_renderable(UnitId unit, CullableType::Enum type, u32 index);
+
 	///
 	void update_transforms(const UnitId *begin, const UnitId *end, const Matrix4x4 *world);
 
@@ -412,6 +395,9 @@ struct RenderWorld
 	///
 	void unit_destroyed_callback(UnitId unit);
 
+	///
+	void units_destroyed_callback(const UnitId *units, u32 num);
+
 	///
 	void reload_materials(const MaterialResource *old_resource, const MaterialResource *new_resource);
 
@@ -473,11 +459,17 @@ struct RenderWorld
 			MESH_ID_ADD     = MAX_MESHES
 		};
 
-		HashMap<UnitId, MeshId> _map;
+		UnitMap<MeshId> _map;
 		Array<Index> _indices;
 		u32 _free_list;
 		MeshInstanceData _data;
-		bool _dirty;
+		Array<u32> _batch;     ///< Meshes to be drawn by the current pass.
+		Array<u32> _batch_tmp; ///< Scratch values for radix sorting _batch.
+		Array<u64> _sort_keys; ///< Sort keys of _batch followed by scratch keys.
+		Array<AnimationSkeletonInstance *> _skeletons; ///< Skeletons whose bones are computed this frame.
+		u32 _frame;
+		Array<u32> _dirty; ///< Instances flagged DIRTY since the last sync of the culling sets.
+		u32 _num_draws;    ///< Mesh draw calls submitted by the current frame.
 
 		///
 		MeshManager(Allocator &a, RenderWorld *rw)
@@ -486,7 +478,13 @@ struct RenderWorld
 			, _map(a)
 			, _indices(a)
 			, _free_list(UINT32_MAX)
-			, _dirty(true)
+			, _batch(a)
+			, _batch_tmp(a)
+			, _sort_keys(a)
+			, _skeletons(a)
+			, _frame(0)
+			, _dirty(a)
+			, _num_draws(0)
 		{
 			memset(&_data, 0, sizeof(_data));
 		}
@@ -507,6 +505,10 @@ struct RenderWorld
 		///
 		void destroy(MeshId mesh);
 
+		/// Destroys the @a num instances at @a indices, which must be sorted
+		/// in descending order.
+		void destroy(const u32 *indices, u32 num);
+
 		///
 		bool has(UnitId unit);
 
@@ -519,6 +521,9 @@ struct RenderWorld
 		///
 		void destroy();
 
+		/// Flags the instance @a i as changed since the last sync of the culling sets.
+		void set_dirty(u32 i);
+
 		///
 		void swap(u32 inst_a, u32 inst_b);
 
@@ -528,11 +533,35 @@ struct RenderWorld
 		///
 		u32 index(MeshId mesh);
 
-		///
-		void set_instance_data(u32 ii, SceneGraph &scene_graph);
+		/// Computes the bones of the skeletons of visible meshes, at most once per
+		/// skeleton and in parallel, so that all the passes of a frame share them.
+		void update_skinning_palettes(SceneGraph &scene_graph);
 
-		///
-		void draw_shadow_casters(u8 view, SceneGraph &scene_graph, u32 stencil = BGFX_STENCIL_NONE);
+		/// Sets the geometry and the world matrix, or the bones if it has a skeleton, of
+		/// the mesh @a ii. The matrices are uploaded only once per frame.
+		void set_instance_data(u32 ii);
+
+		/// Sets the geometry of @a meshes[0] and the world matrices of up to @a num @a meshes
+		/// as instance data. All @a meshes must share the same geometry and have no skeleton.
+		/// Returns the number of instances set, which is less than @a num when the instance
+		/// data buffer runs out of space.
+		u32 set_instance_data(const u32 *meshes, u32 num);
+
+		/// Returns whether the mesh @a ii can be drawn with instancing in the shadow pass (if
+		/// @a shadow is true) or in the mesh pass.
+		bool can_instance(u32 ii, bool shadow);
+
+		/// Sorts _batch by a 64-bit key made of @a view, program, material (unless @a shadow is
+		/// true), geometry and distance from @a camera_pos, so that meshes that can be drawn
+		/// together are contiguous. Blended meshes come after opaque ones, back-to-front.
+		void sort_batch(u8 view, const Vector3 &camera_pos, bool shadow);
+
+		/// Returns the number of meshes at the start of @a meshes that share the geometry (and
+		/// the material, if @a by_material is true) of @a meshes[0].
+		u32 batch_size(const u32 *meshes, u32 num, bool by_material);
+
+		/// Draws the meshes in casters.render into the shadow map of @a view.
+		void draw_shadow_casters(u8 view, const CullingSet &casters, u32 stencil = BGFX_STENCIL_NONE);
 
 		///
 	};
@@ -564,16 +593,16 @@ struct RenderWorld
 
 		Allocator *_allocator;
 		RenderWorld *_render_world;
-		HashMap<UnitId, u32> _map;
+		UnitMap<u32> _map;
 		SpriteInstanceData _data;
-		bool _dirty;
+		Array<u32> _dirty; ///< Instances flagged DIRTY since the last sync of the culling sets.
 
 		///
 		SpriteManager(Allocator &a, RenderWorld *rw)
 			: _allocator(&a)
 			, _render_world(rw)
 			, _map(a)
-			, _dirty(true)
+			, _dirty(a)
 		{
 			memset(&_data, 0, sizeof(_data));
 		}
@@ -588,6 +617,10 @@ struct RenderWorld
 		///
 		void destroy(SpriteId sprite);
 
+		/// Destroys the @a num instances at @a indices, which must be sorted
+		/// in descending order.
+		void destroy(const u32 *indices, u32 num);
+
 		///
 		bool has(UnitId unit);
 
@@ -603,6 +636,9 @@ struct RenderWorld
 		///
 		void destroy();
 
+		/// Flags the instance @a i as changed since the last sync of the culling sets.
+		void set_dirty(u32 i);
+
 		///
 		void swap(u32 inst_a, u32 inst_b);
 
@@ -645,8 +681,8 @@ struct RenderWorld
 		LodGroupInstanceData _data;
 		Array<LodGroupEntry> _entries;
 		u32 _free_list;
-		HashMap<UnitId, u32> _map;
-		bool _dirty;
+		UnitMap<u32> _map;
+		Array<u32> _dirty; ///< Instances flagged DIRTY since the last sync of the culling sets.
 
 		///
 		LodGroupManager(Allocator &a, RenderWorld *rw)
@@ -655,7 +691,7 @@ struct RenderWorld
 			, _entries(a)
 			, _free_list(UINT32_MAX)
 			, _map(a)
-			, _dirty(false)
+			, _dirty(a)
 		{
 			memset(&_data, 0, sizeof(_data));
 		}
@@ -679,6 +715,10 @@ struct RenderWorld
 		///
 		void destroy(LodGroupId lod_group);
 
+		/// Destroys the @a num instances at @a indices, which must be sorted
+		/// in descending order.
+		void destroy(const u32 *indices, u32 num);
+
 		///
 		bool has(UnitId unit);
 
@@ -691,6 +731,9 @@ struct RenderWorld
 		///
 		void destroy();
 
+		/// Flags the instance @a i as changed since the last sync of the culling sets.
+		void set_dirty(u32 i);
+
 		///
 		u32 alloc_entry();
 
@@ -741,9 +784,9 @@ struct RenderWorld
 
 		Allocator *_allocator;
 		RenderWorld *_render_world;
-		HashMap<UnitId, u32> _map;
+		UnitMap<u32> _map;
 		LightInstanceData _data;
-		bool _dirty;
+		Array<u32> _dirty; ///< Instances flagged DIRTY since the last sync of the culling sets.
 		Array<ShaderData> _lights_data; // Shader array to send to GPU.
 		Array<u32> _directional_lights; // Indices to directional lights sorted by intensity.
 		Array<u32> _local_lights_omni;  // Indices to spot lights that will be rendered this frame.
@@ -754,7 +797,7 @@ struct RenderWorld
 			: _allocator(&a)
 			, _render_world(rw)
 			, _map(a)
-			, _dirty(true)
+			, _dirty(a)
 			, _lights_data(a)
 			, _directional_lights(a)
 			, _local_lights_omni(a)
@@ -773,6 +816,10 @@ struct RenderWorld
 		///
 		void destroy(LightId light);
 
+		/// Destroys the @a num instances at @a indices, which must be sorted
+		/// in descending order.
+		void destroy(const u32 *indices, u32 num);
+
 		///
 		bool has(UnitId unit);
 
@@ -791,6 +838,9 @@ struct RenderWorld
 		///
 		void destroy();
 
+		/// Flags the instance @a i as changed since the last sync of the culling sets.
+		void set_dirty(u32 i);
+
 		///
 		LightId make_instance(u32 i)
 		{
@@ -811,10 +861,22 @@ struct RenderWorld
 	SpriteManager _sprite_manager;
 	LodGroupManager _lod_group_manager;
 	LightManager _light_manager;
+	UnitMap<RenderableSlots> _renderables; ///< Renderable instances of each unit, patched by update_transforms().
+	Array<Sphere> _sphere_w;               ///< World spheres of the instances being synced.
 
 	CullingSet _cullable_objects;
 	CullingSet _cullable_shadow_casters;
+	CullingSet _cullable_static_shadow_casters;
 	CullingSet _cullable_lights;
+	OcclusionBuffer _occlusion_buffer;
+	LightClusters _light_clusters;
+
+	// Static shadow casters cache.
+	Array<Sphere> _shadow_cache_invalid; ///< World spheres of static casters changed since the last render.
+	ShadowCacheTile _sun_shadow_cache[MAX_NUM_CASCADES];
+	ShadowCacheTile _local_lights_shadow_cache[LOCAL_LIGHTS_MAX_SHADOW_CASTERS];
+	u32 _shadow_cache_epoch;
+	u32 _shadow_cache_frame;
 
 	UnitDestroyCallback _unit_destroy_callback;
 
@@ -4,20 +4,26 @@
  */
 
 #include "core/containers/array.inl"
-#include "core/containers/hash_map.inl"
 #include "core/math/constants.h"
 #include "core/math/matrix3x3.inl"
 #include "core/math/matrix4x4.inl"
 #include "core/math/quaternion.inl"
 #include "core/math/vector3.inl"
+#include "core/math/vector4.inl"
 #include "core/memory/allocator.h"
+#include "core/memory/memory.inl"
 #include "core/strings/string_id.inl"
+#include "core/thread/job_system.h"
 #include "world/debug_line.h"
 #include "world/scene_graph.h"
 #include "world/unit_manager.h"
+#include "world/unit_map.inl"
 #include <stdint.h> // UINT_MAX
 #include <string.h> // memcpy
 
+#define SCENE_GRAPH_MAX_TASKS 64u
+#define SCENE_GRAPH_MIN_NODES_PER_TASK 1024u
+
 namespace crown
 {
 static void unit_destroyed_callback_bridge(UnitId unit, void *user_ptr)
@@ -25,26 +31,190 @@ static void unit_destroyed_callback_bridge(UnitId unit, void *user_ptr)
 	((SceneGraph *)user_ptr)->unit_destroyed_callback(unit);
 }
 
-SceneGraph::Pose &SceneGraph::Pose::operator=(const Matrix4x4 &m)
+static void units_destroyed_callback_bridge(const UnitId *units, u32 num, void *user_ptr)
 {
-	Matrix3x3 rotm = to_matrix3x3(m);
-	normalize(rotm.x);
-	normalize(rotm.y);
-	normalize(rotm.z);
+	((SceneGraph *)user_ptr)->units_destroyed_callback(units, num);
+}
 
+SceneGraph::Pose &SceneGraph::Pose::operator=(const Matrix4x4 &m)
+{
 	position = translation(m);
-	rotation = rotm;
+	rotation = crown::rotation(m);
 	scale = crown::scale(m);
 	return *this;
 }
 
+/// Returns the matrix representation of @a pose.
+static inline Matrix4x4 pose_matrix(const SceneGraph::Pose &pose)
+{
+	Matrix4x4 tm = from_quaternion_translation(pose.rotation, pose.position);
+	tm.x *= pose.scale.x;
+	tm.y *= pose.scale.y;
+	tm.z *= pose.scale.z;
+	return tm;
+}
+
+/// Returns the index of the node referenced by @a transform.
+static inline u32 scene_graph_index(const SceneGraph &sg, TransformId transform)
+{
+	CE_ASSERT(transform.i < array::size(sg._index) && sg._index[transform.i] != UINT32_MAX, "Index out of bounds");
+	return sg._index[transform.i];
+}
+
+/// Returns the TransformId of the node at index @a i.
+static inline TransformId scene_graph_handle(const SceneGraph &sg, u32 i)
+{
+	TransformId inst = { i == UINT32_MAX ? UINT32_MAX : sg._data.handle[i] };
+	return inst;
+}
+
+/// Returns the index of the root of the tree containing the node @a i.
+static u32 scene_graph_root(const SceneGraph &sg, u32 i)
+{
+	while (sg._data.parent[i] != UINT32_MAX)
+		i = sg._data.parent[i];
+	return i;
+}
+
+/// Returns the world pose of the node @a i, taking into account any pending
+/// change to the local pose of the node or its ancestors.
+static Matrix4x4 scene_graph_world_pose(const SceneGraph &sg, u32 i)
+{
+	if (sg._first_dirty == UINT32_MAX)
+		return sg._data.world[i];
+
+	// Find the top-most dirty node in the path to the root.
+	u32 top = UINT32_MAX;
+	for (u32 cur = i; cur != UINT32_MAX; cur = sg._data.parent[cur]) {
+		if (sg._data.dirty[cur])
+			top = cur;
+	}
+
+	if (top == UINT32_MAX)
+		return sg._data.world[i];
+
+	Matrix4x4 tm = pose_matrix(sg._data.local[i]);
+	for (u32 cur = i; cur != top;) {
+		cur = sg._data.parent[cur];
+		tm = tm * pose_matrix(sg._data.local[cur]);
+	}
+
+	const u32 parent = sg._data.parent[top];
+	return parent == UINT32_MAX ? tm : tm * sg._data.world[parent];
+}
+
+/// Flags the node @a i as changed.
+static inline void scene_graph_set_changed(SceneGraph &sg, u32 i)
+{
+	if (sg._data.changed[i])
+		return;
+
+	sg._data.changed[i] = true;
+	array::push_back(sg._changed, sg._data.handle[i]);
+}
+
+/// Reorders the elements of @a data in the range [first, first + num)
+/// so that the j-th element is moved from index order[j].
+template<typename T>
+static void scene_graph_gather(Allocator &a, T *data, const u32 *order, u32 first, u32 num)
+{
+	T *tmp = (T *)a.allocate(num*sizeof(T));
+	for (u32 j = 0; j < num; ++j)
+		tmp[j] = data[order[j]];
+	memcpy(data + first, tmp, num*sizeof(T));
+	a.deallocate(tmp);
+}
+
+/// Moves the nodes in the range [_num_sorted, size) into depth-first order.
+/// Nodes outside the range are never referenced by nodes inside the range
+/// and vice versa, so the nodes before _num_sorted are left untouched.
+static void scene_graph_sort(SceneGraph &sg)
+{
+	SceneGraph::InstanceData &data = sg._data;
+	const u32 first = sg._num_sorted;
+	const u32 num = data.size - first;
+
+	if (num == 0)
+		return;
+
+	Array<u32> order(*sg._allocator);
+	Array<u32> remap(*sg._allocator);
+	array::resize(order, num);
+	array::resize(remap, num);
+
+	// Visit the trees in pre-order, without recursion.
+	u32 n = 0;
+	for (u32 root = first; root < data.size; ++root) {
+		if (data.parent[root] != UINT32_MAX)
+			continue;
+
+		u32 cur = root;
+		for (;;) {
+			order[n++] = cur;
+
+			if (data.first_child[cur] != UINT32_MAX) {
+				cur = data.first_child[cur];
+				continue;
+			}
+
+			while (cur != root && data.next_sibling[cur] == UINT32_MAX)
+				cur = data.parent[cur];
+
+			if (cur == root)
+				break;
+
+			cur = data.next_sibling[cur];
+		}
+	}
+	CE_ENSURE(n == num);
+
+	for (u32 j = 0; j < num; ++j)
+		remap[order[j] - first] = first + j;
+
+	scene_graph_gather(*sg._allocator, data.unit, array::begin(order), first, num);
+	scene_graph_gather(*sg._allocator, data.world, array::begin(order), first, num);
+	scene_graph_gather(*sg._allocator, data.local, array::begin(order), first, num);
+	scene_graph_gather(*sg._allocator, data.parent, array::begin(order), first, num);
+	scene_graph_gather(*sg._allocator, data.first_child, array::begin(order), first, num);
+	scene_graph_gather(*sg._allocator, data.next_sibling, array::begin(order), first, num);
+	scene_graph_gather(*sg._allocator, data.prev_sibling, array::begin(order), first, num);
+	scene_graph_gather(*sg._allocator, data.handle, array::begin(order), first, num);
+	scene_graph_gather(*sg._allocator, data.changed, array::begin(order), first, num);
+	scene_graph_gather(*sg._allocator, data.dirty, array::begin(order), first, num);
+
+	for (u32 i = first; i < data.size; ++i) {
+		if (data.parent[i] != UINT32_MAX)
+			data.parent[i] = remap[data.parent[i] - first];
+		if (data.first_child[i] != UINT32_MAX)
+			data.first_child[i] = remap[data.first_child[i] - first];
+		if (data.next_sibling[i] != UINT32_MAX)
+			data.next_sibling[i] = remap[data.next_sibling[i] - first];
+		if (data.prev_sibling[i] != UINT32_MAX)
+			data.prev_sibling[i] = remap[data.prev_sibling[i] - first];
+
+		sg._index[data.handle[i]] = i;
+	}
+
+	if (sg._first_dirty != UINT32_MAX && sg._first_dirty > first)
+		sg._first_dirty = first;
+
+	sg._num_sorted = data.size;
+}
+
 SceneGraph::SceneGraph(Allocator &a, UnitManager &um)
 	: _marker(SCENE_GRAPH_MARKER)
 	, _allocator(&a)
 	, _unit_manager(&um)
 	, _map(a)
+	, _index(a)
+	, _free_handles(a)
+	, _changed(a)
+	, _dead_handles(a)
+	, _num_sorted(0)
+	, _first_dirty(UINT32_MAX)
 {
 	_unit_destroy_callback.destroy = unit_destroyed_callback_bridge;
+	_unit_destroy_callback.destroy_batch = units_destroyed_callback_bridge;
 	_unit_destroy_callback.user_data = this;
 	_unit_destroy_callback.node.next = NULL;
 	_unit_destroy_callback.node.prev = NULL;
@@ -73,7 +243,8 @@ void SceneGraph::allocate(u32 num)
 		+ num*sizeof(UnitId) + alignof(UnitId)
 		+ num*sizeof(Matrix4x4) + alignof(Matrix4x4)
 		+ num*sizeof(Pose) + alignof(Pose)
-		+ num*sizeof(TransformId) * 4 + alignof(TransformId)
+		+ num*sizeof(u32) * 5 + alignof(u32)
+		+ num*sizeof(bool) + alignof(bool)
 		+ num*sizeof(bool) + alignof(bool)
 		;
 
@@ -82,23 +253,27 @@ void SceneGraph::allocate(u32 num)
 	new_data.capacity = num;
 	new_data.buffer = _allocator->allocate(bytes);
 
-	new_data.unit         = (UnitId *           )memory::align_top(new_data.buffer,             alignof(UnitId));
-	new_data.world        = (Matrix4x4 *        )memory::align_top(new_data.unit + num,         alignof(Matrix4x4));
-	new_data.local        = (Pose *             )memory::align_top(new_data.world + num,        alignof(Pose));
-	new_data.parent       = (TransformId *)memory::align_top(new_data.local + num,        alignof(TransformId));
-	new_data.first_child  = (TransformId *)memory::align_top(new_data.parent + num,       alignof(TransformId));
-	new_data.next_sibling = (TransformId *)memory::align_top(new_data.first_child + num,  alignof(TransformId));
-	new_data.prev_sibling = (TransformId *)memory::align_top(new_data.next_sibling + num, alignof(TransformId));
-	new_data.changed      = (bool *             )memory::align_top(new_data.prev_sibling + num, alignof(bool));
+	new_data.unit         = (UnitId *   )memory::align_top(new_data.buffer,             alignof(UnitId));
+	new_data.world        = (Matrix4x4 *)memory::align_top(new_data.unit + num,         alignof(Matrix4x4));
+	new_data.local        = (Pose *     )memory::align_top(new_data.world + num,        alignof(Pose));
+	new_data.parent       = (u32 *      )memory::align_top(new_data.local + num,        alignof(u32));
+	new_data.first_child  = (u32 *      )memory::align_top(new_data.parent + num,       alignof(u32));
+	new_data.next_sibling = (u32 *      )memory::align_top(new_data.first_child + num,  alignof(u32));
+	new_data.prev_sibling = (u32 *      )memory::align_top(new_data.next_sibling + num, alignof(u32));
+	new_data.handle       = (u32 *      )memory::align_top(new_data.prev_sibling + num, alignof(u32));
+	new_data.changed      = (bool *     )memory::align_top(new_data.handle + num,       alignof(bool));
+	new_data.dirty        = (bool *     )memory::align_top(new_data.changed + num,      alignof(bool));
 
 	memcpy(new_data.unit, _data.unit, _data.size * sizeof(UnitId));
 	memcpy(new_data.world, _data.world, _data.size * sizeof(Matrix4x4));
 	memcpy(new_data.local, _data.local, _data.size * sizeof(Pose));
-	memcpy(new_data.parent, _data.parent, _data.size * sizeof(TransformId));
-	memcpy(new_data.first_child, _data.first_child, _data.size * sizeof(TransformId));
-	memcpy(new_data.next_sibling, _data.next_sibling, _data.size * sizeof(TransformId));
-	memcpy(new_data.prev_sibling, _data.prev_sibling, _data.size * sizeof(TransformId));
+	memcpy(new_data.parent, _data.parent, _data.size * sizeof(u32));
+	memcpy(new_data.first_child, _data.first_child, _data.size * sizeof(u32));
+	memcpy(new_data.next_sibling, _data.next_sibling, _data.size * sizeof(u32));
+	memcpy(new_data.prev_sibling, _data.prev_sibling, _data.size * sizeof(u32));
+	memcpy(new_data.handle, _data.handle, _data.size * sizeof(u32));
 	memcpy(new_data.changed, _data.changed, _data.size * sizeof(bool));
+	memcpy(new_data.dirty, _data.dirty, _data.size * sizeof(bool));
 
 	_allocator->deallocate(_data.buffer);
 	_data = new_data;
@@ -111,6 +286,20 @@ void SceneGraph::unit_destroyed_callback(UnitId unit)
 		destroy(inst);
 }
 
+void SceneGraph::units_destroyed_callback(const UnitId *units, u32 num)
+{
+	Array<TransformId> transforms(*_allocator);
+	array::reserve(transforms, num);
+
+	for (u32 i = 0; i < num; ++i) {
+		TransformId inst = instance(units[i]);
+		if (is_valid(inst))
+			array::push_back(transforms, inst);
+	}
+
+	destroy(array::begin(transforms), array::size(transforms));
+}
+
 void SceneGraph::create_instances(const void *components_data
 	, u32 num
 	, const UnitId *unit_lookup
@@ -126,35 +315,47 @@ void SceneGraph::create_instances(const void *components_data
 
 	for (u32 i = 0; i < num; ++i) {
 		UnitId unit = unit_lookup[unit_index[i]];
-		CE_ASSERT(!hash_map::has(_map, unit), "Unit already has a transform component");
+		CE_ASSERT(!unit_map::has(_map, unit), "Unit already has a transform component");
 
-		if (_data.capacity == 0 || _data.capacity - 1 == _data.size)
+		if (_data.capacity == _data.size)
 			grow();
 
 		const u32 last = _data.size;
 
+		u32 handle;
+		if (array::empty(_free_handles)) {
+			handle = array::size(_index);
+			array::push_back(_index, last);
+		} else {
+			handle = array::back(_free_handles);
+			array::pop_back(_free_handles);
+			_index[handle] = last;
+		}
+
 		Matrix4x4 pose;
 		set_identity(pose);
 		set_translation(pose, spawn_flags & SpawnFlags::OVERRIDE_POSITION ? pos : transforms[i].position);
 		set_rotation(pose, spawn_flags & SpawnFlags::OVERRIDE_ROTATION ? rot : transforms[i].rotation);
 		set_scale(pose, spawn_flags & SpawnFlags::OVERRIDE_SCALE ? scl : transforms[i].scale);
 
-		_data.unit[last]           = unit;
-		_data.world[last]          = pose;
-		_data.local[last]          = pose;
-		_data.parent[last].i       = UINT32_MAX;
-		_data.first_child[last].i  = UINT32_MAX;
-		_data.next_sibling[last].i = UINT32_MAX;
-		_data.prev_sibling[last].i = UINT32_MAX;
-		_data.changed[last]        = false;
+		_data.unit[last]         = unit;
+		_data.world[last]        = pose;
+		_data.local[last]        = pose;
+		_data.parent[last]       = UINT32_MAX;
+		_data.first_child[last]  = UINT32_MAX;
+		_data.next_sibling[last] = UINT32_MAX;
+		_data.prev_sibling[last] = UINT32_MAX;
+		_data.handle[last]       = handle;
+		_data.changed[last]      = false;
+		_data.dirty[last]        = false;
 
 		++_data.size;
 
-		hash_map::set(_map, unit, last);
+		unit_map::set(_map, unit, handle);
 
 		if (unit_parents[unit_index[i]] != UINT32_MAX) {
 			TransformId parent_ti = instance(unit_lookup[unit_parents[unit_index[i]]]);
-			link(parent_ti, make_instance(last), transforms[i].position, transforms[i].rotation, transforms[i].scale);
+			link(parent_ti, make_instance(handle), transforms[i].position, transforms[i].rotation, transforms[i].scale);
 		}
 	}
 }
@@ -173,26 +374,26 @@ TransformId SceneGraph::create(UnitId unit, const Vector3 &pos, const Quaternion
 
 /// Moves the node data from index @a src to index @a dst, while preserving
 /// internal links between nodes.
-static void scene_graph_move_data(const SceneGraph &sg, u32 dst, u32 src)
+static void scene_graph_move_data(SceneGraph &sg, u32 dst, u32 src)
 {
 	// Any node can be referenced by its children.
-	TransformId cur = sg._data.first_child[src];
-	while (is_valid(cur)) {
-		sg._data.parent[cur.i].i = dst;
-		cur = sg._data.next_sibling[cur.i];
+	u32 cur = sg._data.first_child[src];
+	while (cur != UINT32_MAX) {
+		sg._data.parent[cur] = dst;
+		cur = sg._data.next_sibling[cur];
 	}
 
-	if (sg._data.parent[src].i != UINT32_MAX) {
+	if (sg._data.parent[src] != UINT32_MAX) {
 		// Child node can also be referenced by its parent (if it is the parent's
 		// first child)...
-		if (sg._data.first_child[sg._data.parent[src].i].i == src)
-			sg._data.first_child[sg._data.parent[src].i].i = dst;
+		if (sg._data.first_child[sg._data.parent[src]] == src)
+			sg._data.first_child[sg._data.parent[src]] = dst;
 
 		// ... and (at most) by its two closest siblings.
-		if (sg._data.next_sibling[src].i != UINT32_MAX)
-			sg._data.prev_sibling[sg._data.next_sibling[src].i].i = dst;
-		if (sg._data.prev_sibling[src].i != UINT32_MAX)
-			sg._data.next_sibling[sg._data.prev_sibling[src].i].i = dst;
+		if (sg._data.next_sibling[src] != UINT32_MAX)
+			sg._data.prev_sibling[sg._data.next_sibling[src]] = dst;
+		if (sg._data.prev_sibling[src] != UINT32_MAX)
+			sg._data.next_sibling[sg._data.prev_sibling[src]] = dst;
 	}
 
 	sg._data.unit[dst]         = sg._data.unit[src];
@@ -202,148 +403,279 @@ static void scene_graph_move_data(const SceneGraph &sg, u32 dst, u32 src)
 	sg._data.first_child[dst]  = sg._data.first_child[src];
 	sg._data.next_sibling[dst] = sg._data.next_sibling[src];
 	sg._data.prev_sibling[dst] = sg._data.prev_sibling[src];
+	sg._data.handle[dst]       = sg._data.handle[src];
 	sg._data.changed[dst]      = sg._data.changed[src];
-}
-
-/// Swaps the transforms @a aa and @a bb.
-static void scene_graph_swap(const SceneGraph &sg, TransformId aa, TransformId bb)
-{
-	// Index of the temporary storage slot. Memory access past size-1 is allowed
-	// because we allocate one extra slot in SceneGraph::grow().
-	const u32 tt = sg._data.size;
+	sg._data.dirty[dst]        = sg._data.dirty[src];
 
-	scene_graph_move_data(sg, tt, aa.i);
-	scene_graph_move_data(sg, aa.i, bb.i);
-	scene_graph_move_data(sg, bb.i, tt);
+	sg._index[sg._data.handle[dst]] = dst;
 }
 
 void SceneGraph::destroy(TransformId transform)
 {
-	CE_ASSERT(transform.i < _data.size, "Index out of bounds");
+	const u32 ii = scene_graph_index(*this, transform);
 
 	// Unlink all children.
-	TransformId cur = _data.first_child[transform.i];
-	while (is_valid(cur)) {
-		TransformId next_sibling = _data.next_sibling[cur.i];
-		unlink(cur);
+	u32 cur = _data.first_child[ii];
+	while (cur != UINT32_MAX) {
+		const u32 next_sibling = _data.next_sibling[cur];
+		unlink(scene_graph_handle(*this, cur));
 		cur = next_sibling;
 	}
 	unlink(transform);
 
+	// The node is now a root without children: fill its slot with the last
+	// node. The moved node is out of order, so it will be sorted later.
 	const u32 last = _data.size - 1;
-	const UnitId u = _data.unit[transform.i];
-	const UnitId last_u = _data.unit[last];
+	const UnitId u = _data.unit[ii];
+	const bool changed = _data.changed[ii];
 
-	if (last != transform.i) {
-		scene_graph_swap(*this, transform, make_instance(last));
-		hash_map::set(_map, last_u, transform.i);
+	if (last != ii) {
+		scene_graph_move_data(*this, ii, last);
+
+		if (_data.dirty[ii])
+			_first_dirty = min(_first_dirty, ii);
 	}
-	hash_map::remove(_map, u);
+	_num_sorted = min(_num_sorted, ii);
+
+	unit_map::remove(_map, u);
+	_index[transform.i] = UINT32_MAX;
+
+	// Do not recycle the handle while it is still in the changed list.
+	if (changed)
+		array::push_back(_dead_handles, transform.i);
+	else
+		array::push_back(_free_handles, transform.i);
 
 	--_data.size;
 }
 
+void SceneGraph::destroy(const TransformId *transforms, u32 num)
+{
+	if (num == 0)
+		return;
+
+	const u32 size = _data.size;
+
+	// Maps node indices to their index after compaction, or UINT32_MAX if
+	// the node is destroyed.
+	u32 *remap = (u32 *)_allocator->allocate(size*sizeof(u32));
+	memset(remap, 0, size*sizeof(u32));
+
+	u32 first = UINT32_MAX;
+	for (u32 i = 0; i < num; ++i) {
+		const u32 ii = scene_graph_index(*this, transforms[i]);
+		remap[ii] = UINT32_MAX;
+		first = min(first, ii);
+	}
+
+	// Unlink the destroyed nodes from the surviving ones. Links between
+	// destroyed nodes are simply dropped.
+	for (u32 i = 0; i < num; ++i) {
+		const u32 ii = scene_graph_index(*this, transforms[i]);
+
+		u32 cur = _data.first_child[ii];
+		while (cur != UINT32_MAX) {
+			const u32 next_sibling = _data.next_sibling[cur];
+			if (remap[cur] != UINT32_MAX)
+				unlink(scene_graph_handle(*this, cur));
+			cur = next_sibling;
+		}
+
+		const u32 parent = _data.parent[ii];
+		if (parent != UINT32_MAX && remap[parent] != UINT32_MAX)
+			unlink(transforms[i]);
+	}
+
+	// Remove the destroyed nodes and move the others down, preserving their
+	// order so that the sorted prefix stays sorted.
+	u32 num_sorted = first;
+	u32 first_dirty = first;
+	u32 n = first;
+	for (u32 i = first; i < size; ++i) {
+		if (remap[i] == UINT32_MAX) {
+			const u32 handle = _data.handle[i];
+			unit_map::remove(_map, _data.unit[i]);
+			_index[handle] = UINT32_MAX;
+
+			// Do not recycle the handle while it is still in the changed list.
+			if (_data.changed[i])
+				array::push_back(_dead_handles, handle);
+			else
+				array::push_back(_free_handles, handle);
+			continue;
+		}
+
+		if (i < _num_sorted)
+			num_sorted = n + 1;
+		if (i < _first_dirty)
+			first_dirty = n + 1;
+
+		remap[i] = n;
+		if (n != i) {
+			_data.unit[n]         = _data.unit[i];
+			_data.world[n]        = _data.world[i];
+			_data.local[n]        = _data.local[i];
+			_data.parent[n]       = _data.parent[i];
+			_data.first_child[n]  = _data.first_child[i];
+			_data.next_sibling[n] = _data.next_sibling[i];
+			_data.prev_sibling[n] = _data.prev_sibling[i];
+			_data.handle[n]       = _data.handle[i];
+			_data.changed[n]      = _data.changed[i];
+			_data.dirty[n]        = _data.dirty[i];
+			_index[_data.handle[n]] = n;
+		}
+		++n;
+	}
+
+	// Nodes before the first destroyed one did not move, but they can
+	// reference nodes that did.
+	for (u32 i = 0; i < first; ++i)
+		remap[i] = i;
+
+	for (u32 i = 0; i < n; ++i) {
+		if (_data.parent[i] != UINT32_MAX)
+			_data.parent[i] = remap[_data.parent[i]];
+		if (_data.first_child[i] != UINT32_MAX)
+			_data.first_child[i] = remap[_data.first_child[i]];
+		if (_data.next_sibling[i] != UINT32_MAX)
+			_data.next_sibling[i] = remap[_data.next_sibling[i]];
+		if (_data.prev_sibling[i] != UINT32_MAX)
+			_data.prev_sibling[i] = remap[_data.prev_sibling[i]];
+	}
+
+	_num_sorted = min(_num_sorted, num_sorted);
+	if (_first_dirty != UINT32_MAX)
+		_first_dirty = min(_first_dirty, first_dirty);
+	_data.size = n;
+
+	_allocator->deallocate(remap);
+}
+
 TransformId SceneGraph::instance(UnitId unit)
 {
-	return make_instance(hash_map::get(_map, unit, UINT32_MAX));
+	return make_instance(unit_map::get(_map, unit, UINT32_MAX));
 }
 
 UnitId SceneGraph::owner(TransformId transform)
 {
-	CE_ASSERT(transform.i < _data.size, "Index out of bounds");
-	return _data.unit[transform.i];
+	return _data.unit[scene_graph_index(*this, transform)];
 }
 
 bool SceneGraph::has(UnitId unit)
 {
-	return hash_map::has(_map, unit);
+	return unit_map::has(_map, unit);
 }
 
 void SceneGraph::set_local_position(TransformId transform, const Vector3 &pos)
 {
-	CE_ASSERT(transform.i < _data.size, "Index out of bounds");
-	_data.local[transform.i].position = pos;
-	set_local(transform);
+	const u32 ii = scene_graph_index(*this, transform);
+	_data.local[ii].position = pos;
+	set_local(ii);
 }
 
 void SceneGraph::set_local_rotation(TransformId transform, const Quaternion &rot)
 {
-	CE_ASSERT(transform.i < _data.size, "Index out of bounds");
-	_data.local[transform.i].rotation = from_quaternion(rot);
-	set_local(transform);
+	const u32 ii = scene_graph_index(*this, transform);
+	_data.local[ii].rotation = rot;
+	normalize(_data.local[ii].rotation);
+	set_local(ii);
 }
 
 void SceneGraph::set_local_scale(TransformId transform, const Vector3 &scale)
 {
-	CE_ASSERT(transform.i < _data.size, "Index out of bounds");
-	_data.local[transform.i].scale = scale;
-	set_local(transform);
+	const u32 ii = scene_graph_index(*this, transform);
+	_data.local[ii].scale = scale;
+	set_local(ii);
 }
 
 void SceneGraph::set_local_pose(TransformId transform, const Matrix4x4 &pose)
 {
-	CE_ASSERT(transform.i < _data.size, "Index out of bounds");
-	_data.local[transform.i] = pose;
-	set_local(transform);
+	const u32 ii = scene_graph_index(*this, transform);
+	_data.local[ii] = pose;
+	set_local(ii);
+}
+
+void SceneGraph::set_local_positions(const TransformId *transforms, const Vector3 *positions, u32 num)
+{
+	u32 first_dirty = _first_dirty;
+
+	for (u32 i = 0; i < num; ++i) {
+		const u32 ii = scene_graph_index(*this, transforms[i]);
+		_data.local[ii].position = positions[i];
+		_data.dirty[ii] = true;
+		first_dirty = min(first_dirty, ii);
+	}
+
+	_first_dirty = first_dirty;
+}
+
+void SceneGraph::set_local_rotations(const TransformId *transforms, const Quaternion *rotations, u32 num)
+{
+	u32 first_dirty = _first_dirty;
+
+	for (u32 i = 0; i < num; ++i) {
+		const u32 ii = scene_graph_index(*this, transforms[i]);
+		_data.local[ii].rotation = rotations[i];
+		normalize(_data.local[ii].rotation);
+		_data.dirty[ii] = true;
+		first_dirty = min(first_dirty, ii);
+	}
+
+	_first_dirty = first_dirty;
 }
 
 Vector3 SceneGraph::local_position(TransformId transform)
 {
-	CE_ASSERT(transform.i < _data.size, "Index out of bounds");
-	return _data.local[transform.i].position;
+	return _data.local[scene_graph_index(*this, transform)].position;
 }
 
 Quaternion SceneGraph::local_rotation(TransformId transform)
 {
-	CE_ASSERT(transform.i < _data.size, "Index out of bounds");
-	return rotation(_data.local[transform.i].rotation);
+	return _data.local[scene_graph_index(*this, transform)].rotation;
 }
 
 Vector3 SceneGraph::local_scale(TransformId transform)
 {
-	CE_ASSERT(transform.i < _data.size, "Index out of bounds");
-	return _data.local[transform.i].scale;
+	return _data.local[scene_graph_index(*this, transform)].scale;
 }
 
 Matrix4x4 SceneGraph::local_pose(TransformId transform)
 {
-	CE_ASSERT(transform.i < _data.size, "Index out of bounds");
-	Matrix4x4 tr = from_quaternion_translation(quaternion(_data.local[transform.i].rotation), _data.local[transform.i].position);
-	set_scale(tr, _data.local[transform.i].scale);
-	return tr;
+	return pose_matrix(_data.local[scene_graph_index(*this, transform)]);
 }
 
 Vector3 SceneGraph::world_position(TransformId transform)
 {
-	CE_ASSERT(transform.i < _data.size, "Index out of bounds");
-	return translation(_data.world[transform.i]);
+	return translation(scene_graph_world_pose(*this, scene_graph_index(*this, transform)));
 }
 
 Quaternion SceneGraph::world_rotation(TransformId transform)
 {
-	CE_ASSERT(transform.i < _data.size, "Index out of bounds");
-	return rotation(_data.world[transform.i]);
+	return rotation(scene_graph_world_pose(*this, scene_graph_index(*this, transform)));
 }
 
 Matrix4x4 SceneGraph::world_pose(TransformId transform)
 {
-	CE_ASSERT(transform.i < _data.size, "Index out of bounds");
-	return _data.world[transform.i];
+	return scene_graph_world_pose(*this, scene_graph_index(*this, transform));
 }
 
 void SceneGraph::set_world_pose(TransformId transform, const Matrix4x4 &pose)
 {
-	CE_ASSERT(transform.i < _data.size, "Index out of bounds");
-	_data.world[transform.i] = pose;
-	_data.changed[transform.i] = true;
+	update_world_transforms();
+
+	const u32 ii = scene_graph_index(*this, transform);
+	_data.world[ii] = pose;
+	scene_graph_set_changed(*this, ii);
 }
 
 void SceneGraph::set_world_pose_and_rescale(TransformId transform, const Matrix4x4 &pose)
 {
-	CE_ASSERT(transform.i < _data.size, "Index out of bounds");
-	_data.world[transform.i] = pose;
-	set_scale(_data.world[transform.i], _data.local[transform.i].scale);
-	_data.changed[transform.i] = true;
+	update_world_transforms();
+
+	const u32 ii = scene_graph_index(*this, transform);
+	_data.world[ii] = pose;
+	set_scale(_data.world[ii], _data.local[ii].scale);
+	scene_graph_set_changed(*this, ii);
 }
 
 u32 SceneGraph::num_nodes() const
@@ -358,122 +690,241 @@ void SceneGraph::link(TransformId parent
 	, const Vector3 &child_local_scale
 	)
 {
-	CE_ASSERT(child.i < _data.size, "Index out of bounds");
-	CE_ASSERT(parent.i < _data.size, "Index out of bounds");
-
 	unlink(child);
 
+	const u32 pp = scene_graph_index(*this, parent);
+	const u32 cc = scene_graph_index(*this, child);
+
 	// Append child transform to the parent's children list.
-	if (!is_valid(_data.first_child[parent.i])) {
-		_data.first_child[parent.i] = child;
+	if (_data.first_child[pp] == UINT32_MAX) {
+		_data.first_child[pp] = cc;
 	} else {
-		TransformId prev = { UINT32_MAX };
-		TransformId node = _data.first_child[parent.i];
-		while (is_valid(node)) {
+		u32 prev = UINT32_MAX;
+		u32 node = _data.first_child[pp];
+		while (node != UINT32_MAX) {
 			prev = node;
-			node = _data.next_sibling[node.i];
+			node = _data.next_sibling[node];
 		}
 
-		_data.next_sibling[prev.i] = child;
-		_data.next_sibling[child.i].i = UINT32_MAX;
-		_data.prev_sibling[child.i] = prev;
+		_data.next_sibling[prev] = cc;
+		_data.next_sibling[cc] = UINT32_MAX;
+		_data.prev_sibling[cc] = prev;
 	}
 
-	_data.local[child.i].position = child_local_position;
-	_data.local[child.i].rotation = from_quaternion(child_local_rotation);
-	_data.local[child.i].scale    = child_local_scale;
-	_data.parent[child.i] = parent;
+	_data.local[cc].position = child_local_position;
+	_data.local[cc].rotation = child_local_rotation;
+	_data.local[cc].scale    = child_local_scale;
+	_data.parent[cc] = pp;
 
-	transform(_data.world[parent.i], child);
+	// The child's subtree must be moved next to the parent's one.
+	_num_sorted = min(_num_sorted, cc, scene_graph_root(*this, pp));
+
+	set_local(cc);
 }
 
 void SceneGraph::unlink(TransformId child)
 {
-	CE_ASSERT(child.i < _data.size, "Index out of bounds");
+	const u32 cc = scene_graph_index(*this, child);
+	const u32 pp = _data.parent[cc];
 
-	if (!is_valid(_data.parent[child.i]))
+	if (pp == UINT32_MAX)
 		return;
 
-	if (_data.first_child[_data.parent[child.i].i].i == child.i)
-		_data.first_child[_data.parent[child.i].i] = _data.next_sibling[child.i];
+	const Matrix4x4 world = scene_graph_world_pose(*this, cc);
+
+	// The child's subtree must be moved out of the parent's one.
+	_num_sorted = min(_num_sorted, scene_graph_root(*this, cc));
+
+	if (_data.first_child[pp] == cc)
+		_data.first_child[pp] = _data.next_sibling[cc];
 	else
-		_data.next_sibling[_data.prev_sibling[child.i].i] = _data.next_sibling[child.i];
+		_data.next_sibling[_data.prev_sibling[cc]] = _data.next_sibling[cc];
 
-	if (is_valid(_data.next_sibling[child.i]))
-		_data.prev_sibling[_data.next_sibling[child.i].i] = _data.prev_sibling[child.i];
+	if (_data.next_sibling[cc] != UINT32_MAX)
+		_data.prev_sibling[_data.next_sibling[cc]] = _data.prev_sibling[cc];
 
-	_data.local[child.i].position = translation(_data.world[child.i]);
-	_data.local[child.i].rotation = from_quaternion(rotation(_data.world[child.i]));
-	_data.local[child.i].scale = scale(_data.world[child.i]);
-	_data.parent[child.i].i = UINT32_MAX;
-	_data.next_sibling[child.i].i = UINT32_MAX;
-	_data.prev_sibling[child.i].i = UINT32_MAX;
+	_data.local[cc] = world;
+	_data.parent[cc] = UINT32_MAX;
+	_data.next_sibling[cc] = UINT32_MAX;
+	_data.prev_sibling[cc] = UINT32_MAX;
+
+	// The world pose of the subtree may be out of date.
+	set_local(cc);
 }
 
 TransformId SceneGraph::parent(TransformId child)
 {
-	CE_ASSERT(child.i < _data.size, "Index out of bounds");
-	return _data.parent[child.i];
+	return scene_graph_handle(*this, _data.parent[scene_graph_index(*this, child)]);
 }
 
 TransformId SceneGraph::first_child(TransformId parent)
 {
-	CE_ASSERT(parent.i < _data.size, "Index out of bounds");
-	return _data.first_child[parent.i];
+	return scene_graph_handle(*this, _data.first_child[scene_graph_index(*this, parent)]);
 }
 
 TransformId SceneGraph::next_sibling(TransformId child)
 {
-	CE_ASSERT(child.i < _data.size, "Index out of bounds");
-	return _data.next_sibling[child.i];
+	return scene_graph_handle(*this, _data.next_sibling[scene_graph_index(*this, child)]);
 }
 
 void SceneGraph::clear_changed()
 {
-	for (u32 i = 0; i < _data.size; ++i) {
-		_data.changed[i] = false;
+	for (u32 i = 0; i < array::size(_changed); ++i) {
+		const u32 ii = _index[_changed[i]];
+		if (ii != UINT32_MAX)
+			_data.changed[ii] = false;
 	}
+	array::clear(_changed);
+
+	array::push(_free_handles, array::begin(_dead_handles), array::size(_dead_handles));
+	array::clear(_dead_handles);
 }
 
 void SceneGraph::get_changed(Array<UnitId> &units, Array<Matrix4x4> &world_poses)
 {
-	for (u32 i = 0; i < _data.size; ++i) {
-		if (_data.changed[i]) {
-			array::push_back(units, _data.unit[i]);
-			array::push_back(world_poses, _data.world[i]);
+	update_world_transforms();
+
+	const u32 num = array::size(_changed);
+	array::reserve(units, array::size(units) + num);
+	array::reserve(world_poses, array::size(world_poses) + num);
+
+	for (u32 i = 0; i < num; ++i) {
+		const u32 ii = _index[_changed[i]];
+		if (ii == UINT32_MAX)
+			continue; // Destroyed.
+
+		array::push_back(units, _data.unit[ii]);
+		array::push_back(world_poses, _data.world[ii]);
+	}
+}
+
+void SceneGraph::set_local(u32 i)
+{
+	_data.dirty[i] = true;
+	_first_dirty = min(_first_dirty, i);
+}
+
+/// Recomputes the world poses of the dirty nodes in the range [begin, end)
+/// and writes the TransformIds of the newly changed nodes to @a changed.
+/// Returns the number of TransformIds written.
+static u32 scene_graph_update_range(SceneGraph &sg, u32 begin, u32 end, u32 *changed)
+{
+	SceneGraph::InstanceData &data = sg._data;
+	u32 num_changed = 0;
+
+	// Parents always precede their children, so a single sweep is enough to
+	// propagate the changes down the trees.
+	for (u32 i = begin; i < end; ++i) {
+		const u32 parent = data.parent[i];
+
+		if (parent == UINT32_MAX) {
+			if (!data.dirty[i])
+				continue;
+
+			data.world[i] = pose_matrix(data.local[i]);
+		} else {
+			if (!data.dirty[i] && !data.dirty[parent])
+				continue;
+
+			data.dirty[i] = true;
+			data.world[i] = pose_matrix(data.local[i]) * data.world[parent];
+		}
+
+		if (!data.changed[i]) {
+			data.changed[i] = true;
+			changed[num_changed++] = data.handle[i];
 		}
 	}
+
+	return num_changed;
 }
 
-void SceneGraph::set_local(TransformId transform)
+struct SceneGraphUpdateTask
 {
-	TransformId parent = _data.parent[transform.i];
-	Matrix4x4 parent_tm = is_valid(parent) ? _data.world[parent.i] : MATRIX4X4_IDENTITY;
-	SceneGraph::transform(parent_tm, transform);
+	SceneGraph *sg;
+	u32 begin;
+	u32 end;
+	u32 *changed;
+	u32 num_changed;
+};
 
-	_data.changed[transform.i] = true;
+static void scene_graph_update_task(void *user_data)
+{
+	SceneGraphUpdateTask *task = (SceneGraphUpdateTask *)user_data;
+	task->num_changed = scene_graph_update_range(*task->sg, task->begin, task->end, task->changed);
 }
 
-void SceneGraph::transform(const Matrix4x4 &parent, TransformId transform)
+void SceneGraph::update_world_transforms(u32 num_tasks)
 {
-	_data.world[transform.i] = local_pose(transform) * parent;
-	_data.changed[transform.i] = true;
+	if (_first_dirty >= _data.size) {
+		_first_dirty = UINT32_MAX;
+		return;
+	}
+
+	scene_graph_sort(*this);
 
-	TransformId child = _data.first_child[transform.i];
-	while (is_valid(child)) {
-		SceneGraph::transform(_data.world[transform.i], child);
-		child = _data.next_sibling[child.i];
+	const u32 first = _first_dirty;
+	const u32 num = _data.size - first;
+	num_tasks = min(num_tasks, SCENE_GRAPH_MAX_TASKS, num / SCENE_GRAPH_MIN_NODES_PER_TASK);
+
+	// Each task writes at most one TransformId per node in its range.
+	const u32 old_size = array::size(_changed);
+	array::resize(_changed, old_size + num);
+	u32 *changed = array::begin(_changed) + old_size;
+
+	if (num_tasks <= 1) {
+		const u32 num_changed = scene_graph_update_range(*this, first, _data.size, changed);
+		array::resize(_changed, old_size + num_changed);
+	} else {
+		SceneGraphUpdateTask tasks[SCENE_GRAPH_MAX_TASKS];
+		Job jobs[SCENE_GRAPH_MAX_TASKS];
+
+		// Split the range at root boundaries, so that tasks never read
+		// the poses written by other tasks.
+		u32 begin = first;
+		for (u32 t = 0; t < num_tasks; ++t) {
+			u32 end = t == num_tasks - 1 ? _data.size : max(begin, first + u32(u64(num) * (t + 1) / num_tasks));
+			while (end < _data.size && _data.parent[end] != UINT32_MAX)
+				++end;
+
+			tasks[t].sg = this;
+			tasks[t].begin = begin;
+			tasks[t].end = end;
+			tasks[t].changed = changed + (begin - first);
+			tasks[t].num_changed = 0;
+			jobs[t].function = scene_graph_update_task;
+			jobs[t].user_data = &tasks[t];
+			jobs[t].name = "scene_graph.update";
+			begin = end;
+		}
+
+		JobCounter counter;
+		job_system::run(&jobs[1], num_tasks - 1, counter);
+		scene_graph_update_task(&tasks[0]);
+		job_system::wait(counter);
+
+		// Merge the per-task changed lists in node order.
+		u32 num_changed = tasks[0].num_changed;
+		for (u32 t = 1; t < num_tasks; ++t) {
+			memmove(changed + num_changed, tasks[t].changed, tasks[t].num_changed * sizeof(u32));
+			num_changed += tasks[t].num_changed;
+		}
+		array::resize(_changed, old_size + num_changed);
 	}
+
+	memset(_data.dirty + first, 0, num * sizeof(bool));
+	_first_dirty = UINT32_MAX;
 }
 
 void SceneGraph::grow()
 {
-	// Allocate one extra slot to be used as a temporary storage.
-	allocate(2 + _data.capacity*2);
+	allocate(1 + _data.capacity*2);
 }
 
 void SceneGraph::debug_draw(DebugLine &debug_line)
 {
+	update_world_transforms();
+
 	for (u32 i = 0; i < _data.size; ++i)
 		debug_line.add_axes(_data.world[i], 1.0f);
 }
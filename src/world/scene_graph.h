@@ -16,13 +16,19 @@ namespace crown
 {
 /// Represents a collection of nodes, possibly linked together to form a tree.
 ///
+/// Node data is stored in SoA form and kept in depth-first order, so that
+/// every parent precedes its children and each root is immediately followed
+/// by its whole subtree. World poses can then be computed in a single linear
+/// sweep. Nodes are moved around to maintain the ordering, so TransformIds are
+/// handles that indirectly reference the node data.
+///
 /// @ingroup World
 struct SceneGraph
 {
 	struct Pose
 	{
 		Vector3 position;
-		Matrix3x3 rotation;
+		Quaternion rotation;
 		Vector3 scale;
 
 		Pose &operator=(const Matrix4x4 &m);
@@ -41,7 +47,9 @@ struct SceneGraph
 			, first_child(NULL)
 			, next_sibling(NULL)
 			, prev_sibling(NULL)
+			, handle(NULL)
 			, changed(NULL)
+			, dirty(NULL)
 		{
 		}
 
@@ -52,18 +60,26 @@ struct SceneGraph
 		UnitId *unit;
 		Matrix4x4 *world;
 		Pose *local;
-		TransformId *parent;
-		TransformId *first_child;
-		TransformId *next_sibling;
-		TransformId *prev_sibling;
+		u32 *parent;       ///< Index of the parent node or UINT32_MAX.
+		u32 *first_child;  ///< Index of the first child node or UINT32_MAX.
+		u32 *next_sibling; ///< Index of the next sibling node or UINT32_MAX.
+		u32 *prev_sibling; ///< Index of the previous sibling node or UINT32_MAX.
+		u32 *handle;       ///< TransformId of the node.
 		bool *changed;
+		bool *dirty;
 	};
 
 	u32 _marker;
 	Allocator *_allocator;
 	UnitManager *_unit_manager;
 	InstanceData _data;
-	HashMap<UnitId, u32> _map;
+	UnitMap<u32> _map;
+	Array<u32> _index;        ///< Maps TransformIds to node indices.
+	Array<u32> _free_handles;
+	Array<u32> _changed;      ///< TransformIds of the nodes whose changed flag is set.
+	Array<u32> _dead_handles; ///< TransformIds of destroyed nodes still referenced by _changed.
+	u32 _num_sorted;          ///< Number of nodes at the beginning of _data that are in depth-first order.
+	u32 _first_dirty;         ///< Index of the first dirty node or UINT32_MAX.
 	UnitDestroyCallback _unit_destroy_callback;
 
 	///
@@ -90,6 +106,10 @@ struct SceneGraph
 	/// Destroys the @a transform.
 	void destroy(TransformId transform);
 
+	/// Destroys the @a num @a transforms. The remaining nodes are compacted
+	/// once and keep their relative order.
+	void destroy(const TransformId *transforms, u32 num);
+
 	/// Returns the ID of the transform owned by the *unit*.
 	TransformId instance(UnitId unit);
 
@@ -100,6 +120,9 @@ struct SceneGraph
 	bool has(UnitId unit);
 
 	/// Sets the local position, rotation, scale or pose of the @a transform.
+	/// The world pose of @a transform and its descendants is not recomputed
+	/// until the next call to update_world_transforms() or to any function
+	/// that reads world poses.
 	void set_local_position(TransformId transform, const Vector3 &pos);
 
 	/// @copydoc SceneGraph::set_local_position()
@@ -111,6 +134,14 @@ struct SceneGraph
 	/// @copydoc SceneGraph::set_local_position()
 	void set_local_pose(TransformId transform, const Matrix4x4 &pose);
 
+	/// Sets the local positions of @a num transforms at once.
+	/// @a positions[i] is assigned to @a transforms[i].
+	void set_local_positions(const TransformId *transforms, const Vector3 *positions, u32 num);
+
+	/// Sets the local rotations of @a num transforms at once.
+	/// @a rotations[i] is assigned to @a transforms[i].
+	void set_local_rotations(const TransformId *transforms, const Quaternion *rotations, u32 num);
+
 	/// Returns the local position, rotation or pose of the @a transform.
 	Vector3 local_position(TransformId transform);
 
@@ -168,17 +199,30 @@ struct SceneGraph
 	/// instance if @a child has no sibling.
 	TransformId next_sibling(TransformId child);
 
+	/// Recomputes the world poses of all the transforms whose local pose
+	/// has changed since the last call. Nodes are visited in a single linear
+	/// sweep starting from the first dirty one. Independent trees are split
+	/// across up to @a num_tasks jobs; the results do not depend on the
+	/// number of jobs used.
+	void update_world_transforms(u32 num_tasks = 1);
+
 	/// Adds all the world transforms in the graph to @a debug_line.
 	void debug_draw(DebugLine &debug_line);
 
+	/// Resets the list of transforms changed since the last call.
 	void clear_changed();
+
+	/// Appends the units and the world poses of the transforms changed since
+	/// the last call to clear_changed(). The cost is proportional to the number
+	/// of changed transforms, not to the size of the graph.
 	void get_changed(Array<UnitId> &units, Array<Matrix4x4> &world_poses);
-	void set_local(TransformId transform);
-	void transform(const Matrix4x4 &parent, TransformId transform);
+
+	void set_local(u32 i);
 	void grow();
 	void allocate(u32 num);
 	TransformId make_instance(u32 i);
 	void unit_destroyed_callback(UnitId unit);
+	void units_destroyed_callback(const UnitId *units, u32 num);
 };
 
 } // namespace crown
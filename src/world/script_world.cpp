@@ -12,6 +12,7 @@
 #include "resource/resource_manager.h"
 #include "world/script_world.h"
 #include "world/unit_manager.h"
+#include "world/unit_map.inl"
 #include <algorithm> // std::sort
 
 namespace crown
@@ -110,7 +111,7 @@ namespace script_world
 
 		for (u32 i = 0; i < num; ++i) {
 			UnitId unit = unit_lookup[unit_index[i]];
-			CE_ASSERT(!hash_map::has(sw._map, unit), "Unit already has a script component");
+			CE_ASSERT(!unit_map::has(sw._map, unit), "Unit already has a script component");
 
 			u32 script_i = hash_map::get(sw._cache
 				, scripts[i].script_resource
@@ -138,7 +139,7 @@ namespace script_world
 
 			u32 instance_i = array::size(sw._data);
 			array::push_back(sw._data, data);
-			hash_map::set(sw._map, unit, instance_i);
+			unit_map::set(sw._map, unit, instance_i);
 		}
 	}
 
@@ -158,13 +159,13 @@ namespace script_world
 		sw._data[inst.i] = sw._data[last_i];
 		array::pop_back(sw._data);
 
-		hash_map::set(sw._map, last, inst.i);
-		hash_map::remove(sw._map, unit);
+		unit_map::set(sw._map, last, inst.i);
+		unit_map::remove(sw._map, unit);
 	}
 
 	ScriptId instance(ScriptWorld &sw, UnitId unit)
 	{
-		return script_world_internal::make_instance(hash_map::get(sw._map, unit, UINT32_MAX));
+		return script_world_internal::make_instance(unit_map::get(sw._map, unit, UINT32_MAX));
 	}
 
 	void broadcast(ScriptWorld &sw
@@ -269,7 +270,7 @@ namespace script_world
 	void units_with_script(ScriptWorld &sw, Array<Index> &index, const UnitId *units, u32 num)
 	{
 		for (u32 i = 0; i < num; ++i) {
-			const u32 unit_i = hash_map::get(sw._map, units[i], UINT32_MAX);
+			const u32 unit_i = unit_map::get(sw._map, units[i], UINT32_MAX);
 
 			if (unit_i == UINT32_MAX)
 				continue;
@@ -354,6 +355,7 @@ ScriptWorld::ScriptWorld(Allocator &a, UnitManager &um, ResourceManager &rm, Lua
 	, _disable_callbacks(false)
 {
 	_unit_destroy_callback.destroy = script_world_internal::unit_destroyed_callback_bridge;
+	_unit_destroy_callback.destroy_batch = NULL;
 	_unit_destroy_callback.user_data = this;
 	_unit_destroy_callback.node.next = NULL;
 	_unit_destroy_callback.node.prev = NULL;
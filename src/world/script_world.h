@@ -29,7 +29,7 @@ struct ScriptWorld
 	u32 _marker;
 	Array<ScriptData> _script;
 	Array<InstanceData> _data;
-	HashMap<UnitId, u32> _map;
+	UnitMap<u32> _map;
 	HashMap<StringId64, u32> _cache;
 
 	UnitManager *_unit_manager;
@@ -246,4 +246,9 @@ ShaderData ShaderManager::shader(StringId32 name)
 	return hash_map::get(_shader_map, name, fallback);
 }
 
+bool ShaderManager::has(StringId32 name)
+{
+	return hash_map::has(_shader_map, name);
+}
+
 } // namespace crown
@@ -41,6 +41,9 @@ struct ShaderManager
 
 	///
 	ShaderData shader(StringId32 name);
+
+	/// Returns whether the shader @a name exists.
+	bool has(StringId32 name);
 };
 
 } // namespace crown
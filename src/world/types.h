@@ -8,6 +8,7 @@
 #include "core/functional.h"
 #include "core/list.h"
 #include "core/math/types.h"
+#include "core/memory/types.h"
 #include "core/strings/string_id.h"
 #include "core/types.h"
 
@@ -176,6 +177,8 @@ struct RenderableFlags
 		LOD_LEVEL     = u32(1) << 2,
 		SPRITE_FLIP_X = u32(1) << 3,
 		SPRITE_FLIP_Y = u32(1) << 4,
+		OCCLUDER      = u32(1) << 5,
+		STATIC_SHADOW = u32(1) << 6,
 
 		SELECTED      = u32(1) << 30,
 		DIRTY         = u32(1) << 31,
@@ -274,6 +277,36 @@ struct hash<UnitId>
 	}
 };
 
+#define UNIT_MAP_PAGE_BITS 10
+#define UNIT_MAP_PAGE_SIZE (1u << UNIT_MAP_PAGE_BITS)
+
+/// Maps units to values.
+///
+/// Entries are stored in pages indexed directly by UnitId::index(), so
+/// lookups take constant time without hashing or probing. Pages are
+/// allocated the first time a unit in their range is added.
+///
+/// @ingroup World
+template<typename T>
+struct UnitMap
+{
+	struct Entry
+	{
+		UnitId unit; ///< UNIT_INVALID if the entry is free.
+		T value;
+	};
+
+	Allocator *_allocator;
+	Entry **_pages;
+	u32 _num_pages;
+	u32 _size;
+
+	explicit UnitMap(Allocator &a);
+	~UnitMap();
+	UnitMap(const UnitMap &) = delete;
+	UnitMap &operator=(const UnitMap &) = delete;
+};
+
 /// Spawn flags.
 ///
 /// @ingroup World
@@ -301,10 +334,12 @@ struct PlaySoundFlags
 };
 
 typedef void (*UnitDestroyFunction)(UnitId unit, void *user_data);
+typedef void (*UnitDestroyBatchFunction)(const UnitId *units, u32 num, void *user_data);
 
 struct UnitDestroyCallback
 {
 	UnitDestroyFunction destroy;
+	UnitDestroyBatchFunction destroy_batch; ///< If not NULL, it is called instead of destroy() when many units are destroyed at once.
 	void *user_data;
 	ListNode node;
 };
@@ -379,7 +414,7 @@ struct LodGroupDesc
 struct LodDesc
 {
 	u32 unit_index;  ///< Index of unit that owns the mesh renderer component, or UINT32_MAX.
-	f32 screen_size; ///< Screen-height threshold in [0, 1].
+	f32 screen_size; ///< Screen-height threshold in [0, 1], or -1 to derive it from the mesh LOD error.
 };
 
 /// Animation state machine description.
@@ -804,7 +839,9 @@ struct AnimationSkeletonInstance
 	u32 num_bones;
 	const Matrix4x4 *offsets;
 	UnitId *bone_lookup;
+	TransformId *bone_transforms; ///< Transforms of the units in bone_lookup.
 	Matrix4x4 *bones;
+	u32 frame;                    ///< Render frame bones were last computed in.
 };
 
 struct UnitEvent
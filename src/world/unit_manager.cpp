@@ -57,6 +57,19 @@ void UnitManager::destroy(UnitId unit)
 	trigger_destroy_callbacks(unit);
 }
 
+void UnitManager::destroy(const UnitId *units, u32 num)
+{
+	for (u32 i = 0; i < num; ++i) {
+		CE_ASSERT(alive(units[i]), "Unit (%u.%u) has been destroyed already", units[i].id(), units[i].index());
+
+		const u32 idx = units[i].index();
+		++_generation[idx];
+		queue::push_back(_free_indices, idx);
+	}
+
+	trigger_destroy_callbacks(units, num);
+}
+
 void UnitManager::register_destroy_callback(UnitDestroyCallback *udc)
 {
 	list::add(udc->node, _callbacks.node);
@@ -77,4 +90,20 @@ void UnitManager::trigger_destroy_callbacks(UnitId unit)
 	}
 }
 
+void UnitManager::trigger_destroy_callbacks(const UnitId *units, u32 num)
+{
+	ListNode *cur;
+	list_for_each(cur, &_callbacks.node)
+	{
+		UnitDestroyCallback *udc = (UnitDestroyCallback *)container_of(cur, UnitDestroyCallback, node);
+
+		if (udc->destroy_batch != NULL) {
+			udc->destroy_batch(units, num, udc->user_data);
+		} else {
+			for (u32 i = 0; i < num; ++i)
+				udc->destroy(units[i], udc->user_data);
+		}
+	}
+}
+
 } // namespace crown
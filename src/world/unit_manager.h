@@ -36,6 +36,9 @@ struct UnitManager
 	/// Destroys the unit @a id.
 	void destroy(UnitId unit);
 
+	/// Destroys the @a num @a units.
+	void destroy(const UnitId *units, u32 num);
+
 	///
 	void register_destroy_callback(UnitDestroyCallback *udc);
 
@@ -44,6 +47,10 @@ struct UnitManager
 
 	///
 	void trigger_destroy_callbacks(UnitId unit);
+
+	/// Notifies the destroy callbacks that the @a num @a units have been
+	/// destroyed. Callbacks without a batch function are called once per unit.
+	void trigger_destroy_callbacks(const UnitId *units, u32 num);
 };
 
 } // namespace crown
@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2012-2026 Daniele Bartolini et al.
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include "core/error/error.inl"
+#include "core/memory/allocator.h"
+#include "world/types.h"
+#include <string.h> // memcpy
+
+namespace crown
+{
+/// Functions to manipulate UnitMap.
+///
+/// @ingroup World
+namespace unit_map
+{
+	/// Returns the number of items in the map @a m.
+	template<typename T> u32 size(const UnitMap<T> &m);
+
+	/// Returns whether the @a unit exists in the map @a m.
+	template<typename T> bool has(const UnitMap<T> &m, UnitId unit);
+
+	/// Returns the value for the specified @a unit or @a deffault if
+	/// the unit does not exist in the map.
+	template<typename T> const T &get(const UnitMap<T> &m, UnitId unit, const T &deffault);
+
+	/// Sets the @a value for the @a unit in the map.
+	template<typename T> void set(UnitMap<T> &m, UnitId unit, const T &value);
+
+	/// Removes the @a unit from the map if it exists.
+	template<typename T> void remove(UnitMap<T> &m, UnitId unit);
+
+	/// Removes all the items in the map.
+	template<typename T> void clear(UnitMap<T> &m);
+
+} // namespace unit_map
+
+namespace unit_map_internal
+{
+	/// Returns the entry for the index of @a unit or NULL if its page does not exist.
+	template<typename T>
+	inline typename UnitMap<T>::Entry *find(const UnitMap<T> &m, UnitId unit)
+	{
+		const u32 page = unit.index() >> UNIT_MAP_PAGE_BITS;
+		if (page >= m._num_pages || m._pages[page] == NULL)
+			return NULL;
+
+		return &m._pages[page][unit.index() & (UNIT_MAP_PAGE_SIZE - 1)];
+	}
+
+	/// Returns the entry for the index of @a unit, allocating its page if needed.
+	template<typename T>
+	typename UnitMap<T>::Entry *find_or_make(UnitMap<T> &m, UnitId unit)
+	{
+		typedef typename UnitMap<T>::Entry Entry;
+		const u32 page = unit.index() >> UNIT_MAP_PAGE_BITS;
+
+		if (page >= m._num_pages) {
+			const u32 num_pages = page + 1;
+			Entry **pages = (Entry **)m._allocator->allocate(num_pages*sizeof(Entry *), alignof(Entry *));
+			if (m._num_pages > 0)
+				memcpy(pages, m._pages, m._num_pages*sizeof(Entry *));
+			for (u32 i = m._num_pages; i < num_pages; ++i)
+				pages[i] = NULL;
+
+			m._allocator->deallocate(m._pages);
+			m._pages = pages;
+			m._num_pages = num_pages;
+		}
+
+		if (m._pages[page] == NULL) {
+			Entry *entries = (Entry *)m._allocator->allocate(UNIT_MAP_PAGE_SIZE*sizeof(Entry), alignof(Entry));
+			for (u32 i = 0; i < UNIT_MAP_PAGE_SIZE; ++i)
+				entries[i].unit = UNIT_INVALID;
+			m._pages[page] = entries;
+		}
+
+		return &m._pages[page][unit.index() & (UNIT_MAP_PAGE_SIZE - 1)];
+	}
+
+} // namespace unit_map_internal
+
+namespace unit_map
+{
+	template<typename T>
+	inline u32 size(const UnitMap<T> &m)
+	{
+		return m._size;
+	}
+
+	template<typename T>
+	inline bool has(const UnitMap<T> &m, UnitId unit)
+	{
+		const typename UnitMap<T>::Entry *e = unit_map_internal::find(m, unit);
+		return e != NULL && e->unit == unit;
+	}
+
+	template<typename T>
+	inline const T &get(const UnitMap<T> &m, UnitId unit, const T &deffault)
+	{
+		const typename UnitMap<T>::Entry *e = unit_map_internal::find(m, unit);
+		return e != NULL && e->unit == unit ? e->value : deffault;
+	}
+
+	template<typename T>
+	void set(UnitMap<T> &m, UnitId unit, const T &value)
+	{
+		CE_ASSERT(unit != UNIT_INVALID, "Invalid unit");
+		typename UnitMap<T>::Entry *e = unit_map_internal::find_or_make(m, unit);
+
+		if (e->unit == UNIT_INVALID)
+			++m._size;
+
+		e->unit = unit;
+		e->value = value;
+	}
+
+	template<typename T>
+	void remove(UnitMap<T> &m, UnitId unit)
+	{
+		typename UnitMap<T>::Entry *e = unit_map_internal::find(m, unit);
+		if (e == NULL || e->unit != unit)
+			return;
+
+		e->unit = UNIT_INVALID;
+		--m._size;
+	}
+
+	template<typename T>
+	void clear(UnitMap<T> &m)
+	{
+		for (u32 i = 0; i < m._num_pages; ++i) {
+			m._allocator->deallocate(m._pages[i]);
+			m._pages[i] = NULL;
+		}
+
+		m._size = 0;
+	}
+
+} // namespace unit_map
+
+template<typename T>
+inline UnitMap<T>::UnitMap(Allocator &a)
+	: _allocator(&a)
+	, _pages(NULL)
+	, _num_pages(0)
+	, _size(0)
+{
+}
+
+template<typename T>
+inline UnitMap<T>::~UnitMap()
+{
+	unit_map::clear(*this);
+	_allocator->deallocate(_pages);
+}
+
+} // namespace crown
@@ -3,7 +3,7 @@
  * SPDX-License-Identifier: MIT
  */
 
-#include "core/containers/hash_map.inl"
+#include "core/containers/hash_set.inl"
 #include "core/error/error.h"
 #include "core/event_stream.inl"
 #include "core/list.inl"
@@ -12,6 +12,7 @@
 #include "core/math/vector4.inl"
 #include "core/memory/temp_allocator.inl"
 #include "core/strings/string_id.inl"
+#include "core/thread/job_system.h"
 #include "device/device.h"
 #include "device/log.h"
 #include "lua/lua_environment.h"
@@ -28,6 +29,7 @@
 #include "world/script_world.h"
 #include "world/sound_world.h"
 #include "world/unit_manager.h"
+#include "world/unit_map.inl"
 #include "world/world.h"
 #include <bgfx/bgfx.h>
 #include <bx/math.h>
@@ -36,13 +38,28 @@ LOG_SYSTEM(WORLD, "world")
 
 namespace crown
 {
+/// Makes room for @a num more instances in the component @a manager.
+template<typename T>
+static void reserve_instances(T &manager, u32 num)
+{
+	const u32 size = manager._data.size + num;
+	if (size > manager._data.capacity)
+		manager.allocate(size);
+}
+
+/// Creates the components of @a count instances of the unit resource @a ur.
+/// The IDs of the units in the i-th instance are stored at
+/// @a unit_lookup[i*ur->num_units]. @a pos, @a rot and @a scl contain
+/// @a count elements each and are only read if the corresponding
+/// @a spawn_flags are set.
 static void create_components(World &w
 	, const UnitResource *ur
 	, const UnitId *unit_lookup
+	, u32 count
 	, u32 spawn_flags
-	, const Vector3 &pos
-	, const Quaternion &rot
-	, const Vector3 &scl
+	, const Vector3 *pos
+	, const Quaternion *rot
+	, const Vector3 *scl
 	)
 {
 	SceneGraph *scene_graph = w._scene_graph;
@@ -58,53 +75,76 @@ static void create_components(World &w
 		const char *data = unit_resource::component_payload(component);
 
 		if (component->type == STRING_ID_32("transform", UINT32_C(0xad9b5315))) {
-			scene_graph->create_instances(data
-				, component->num_instances
-				, unit_lookup
-				, unit_index
-				, unit_parents
-				, spawn_flags
-				, pos
-				, rot
-				, scl
-				);
+			reserve_instances(*scene_graph, component->num_instances * count);
+			for (u32 i = 0; i < count; ++i) {
+				scene_graph->create_instances(data
+					, component->num_instances
+					, unit_lookup + i*ur->num_units
+					, unit_index
+					, unit_parents
+					, spawn_flags
+					, spawn_flags & SpawnFlags::OVERRIDE_POSITION ? pos[i] : VECTOR3_ZERO
+					, spawn_flags & SpawnFlags::OVERRIDE_ROTATION ? rot[i] : QUATERNION_IDENTITY
+					, spawn_flags & SpawnFlags::OVERRIDE_SCALE ? scl[i] : VECTOR3_ONE
+					);
+			}
 		} else if (component->type == STRING_ID_32("camera", UINT32_C(0x31822dc7))) {
-			w.camera_create_instances(data, component->num_instances, unit_lookup, unit_index);
+			for (u32 i = 0; i < count; ++i)
+				w.camera_create_instances(data, component->num_instances, unit_lookup + i*ur->num_units, unit_index);
 		} else if (component->type == STRING_ID_32("collider", UINT32_C(0x2129d74e))) {
-			physics_world->collider_create_instances(data, component->num_instances, unit_lookup, unit_index);
+			for (u32 i = 0; i < count; ++i)
+				physics_world->collider_create_instances(data, component->num_instances, unit_lookup + i*ur->num_units, unit_index);
 		} else if (component->type == STRING_ID_32("actor", UINT32_C(0x374cf583))) {
-			physics_world->actor_create_instances(data, component->num_instances, unit_lookup, unit_index);
+			for (u32 i = 0; i < count; ++i)
+				physics_world->actor_create_instances(data, component->num_instances, unit_lookup + i*ur->num_units, unit_index);
 		} else if (component->type == STRING_ID_32("mover", UINT32_C(0xac07d371))) {
-			physics_world->mover_create_instances(data, component->num_instances, unit_lookup, unit_index);
+			for (u32 i = 0; i < count; ++i)
+				physics_world->mover_create_instances(data, component->num_instances, unit_lookup + i*ur->num_units, unit_index);
 		} else if (component->type == STRING_ID_32("fixed_joint", UINT32_C(0x9ada03c1))
 			|| component->type == STRING_ID_32("hinge_joint", UINT32_C(0xbb32c4e8))
 			|| component->type == STRING_ID_32("spherical_joint", UINT32_C(0x066c63e3))
 			|| component->type == STRING_ID_32("limb_joint", UINT32_C(0x7068fff7))
 			|| component->type == STRING_ID_32("spring_joint", UINT32_C(0x6ccbbba7))
 			|| component->type == STRING_ID_32("d6_joint", UINT32_C(0x1099cc71))) {
-			physics_world->joint_create_instances(data, component->num_instances, unit_lookup, unit_index);
+			for (u32 i = 0; i < count; ++i)
+				physics_world->joint_create_instances(data, component->num_instances, unit_lookup + i*ur->num_units, unit_index);
 		} else if (component->type == STRING_ID_32("mesh_renderer", UINT32_C(0xdf017893))) {
-			render_world->_mesh_manager.create_instances(data, component->num_instances, unit_lookup, unit_index);
+			reserve_instances(render_world->_mesh_manager, component->num_instances * count);
+			for (u32 i = 0; i < count; ++i)
+				render_world->_mesh_manager.create_instances(data, component->num_instances, unit_lookup + i*ur->num_units, unit_index);
 		} else if (component->type == STRING_ID_32("sprite_renderer", UINT32_C(0x6a1c2a3b))) {
-			render_world->_sprite_manager.create_instances(data, component->num_instances, unit_lookup, unit_index);
+			reserve_instances(render_world->_sprite_manager, component->num_instances * count);
+			for (u32 i = 0; i < count; ++i)
+				render_world->_sprite_manager.create_instances(data, component->num_instances, unit_lookup + i*ur->num_units, unit_index);
 		} else if (component->type == STRING_ID_32("lod_group", UINT32_C(0x22a1a9f0))) {
-			render_world->_lod_group_manager.create_instances(data, component->num_instances, unit_lookup, unit_index);
+			reserve_instances(render_world->_lod_group_manager, component->num_instances * count);
+			for (u32 i = 0; i < count; ++i)
+				render_world->_lod_group_manager.create_instances(data, component->num_instances, unit_lookup + i*ur->num_units, unit_index);
 		} else if (component->type == STRING_ID_32("light", UINT32_C(0xbb9f08c2))) {
-			render_world->_light_manager.create_instances(data, component->num_instances, unit_lookup, unit_index);
+			reserve_instances(render_world->_light_manager, component->num_instances * count);
+			for (u32 i = 0; i < count; ++i)
+				render_world->_light_manager.create_instances(data, component->num_instances, unit_lookup + i*ur->num_units, unit_index);
 		} else if (component->type == STRING_ID_32("fog", UINT32_C(0xf007ef0d))) {
-			render_world->fog_create_instances(data, component->num_instances, unit_lookup, unit_index);
+			for (u32 i = 0; i < count; ++i)
+				render_world->fog_create_instances(data, component->num_instances, unit_lookup + i*ur->num_units, unit_index);
 		} else if (component->type == STRING_ID_32("global_lighting", UINT32_C(0x718af7fe))) {
-			render_world->global_lighting_create_instances(data, component->num_instances, unit_lookup, unit_index);
+			for (u32 i = 0; i < count; ++i)
+				render_world->global_lighting_create_instances(data, component->num_instances, unit_lookup + i*ur->num_units, unit_index);
 		} else if (component->type == STRING_ID_32("bloom", UINT32_C(0x995dd31c))) {
-			render_world->bloom_create_instances(data, component->num_instances, unit_lookup, unit_index);
+			for (u32 i = 0; i < count; ++i)
+				render_world->bloom_create_instances(data, component->num_instances, unit_lookup + i*ur->num_units, unit_index);
 		} else if (component->type == STRING_ID_32("color_grading", UINT32_C(0x486057e5))) {
-			render_world->color_grading_create_instances(data, component->num_instances, unit_lookup, unit_index);
+			for (u32 i = 0; i < count; ++i)
+				render_world->color_grading_create_instances(data, component->num_instances, unit_lookup + i*ur->num_units, unit_index);
 		} else if (component->type == STRING_ID_32("tonemap", UINT32_C(0x7089b06b))) {
-			render_world->tonemap_create_instances(data, component->num_instances, unit_lookup, unit_index);
+			for (u32 i = 0; i < count; ++i)
+				render_world->tonemap_create_instances(data, component->num_instances, unit_lookup + i*ur->num_units, unit_index);
 		} else if (component->type == STRING_ID_32("script", UINT32_C(0xd18f8ad6))) {
-			script_world::create_instances(*script_world, data, component->num_instances, unit_lookup, unit_index);
+			for (u32 i = 0; i < count; ++i)
+				script_world::create_instances(*script_world, data, component->num_instances, unit_lookup + i*ur->num_units, unit_index);
 		} else if (component->type == STRING_ID_32("animation_state_machine", UINT32_C(0xe87992ac))) {
-			animation_state_machine->create_instances(data, component->num_instances, unit_lookup, unit_index);
+			for (u32 i = 0; i < count; ++i)
+				animation_state_machine->create_instances(data, component->num_instances, unit_lookup + i*ur->num_units, unit_index);
 		} else {
 			CE_FATAL("Unknown component type");
 		}
@@ -190,6 +230,7 @@ World::World(Allocator &a
 	_node.prev = NULL;
 
 	_unit_destroy_callback.destroy = unit_destroyed_callback_bridge;
+	_unit_destroy_callback.destroy_batch = NULL;
 	_unit_destroy_callback.user_data = this;
 	_unit_destroy_callback.node.next = NULL;
 	_unit_destroy_callback.node.prev = NULL;
@@ -231,39 +272,74 @@ World::~World()
 	destroy_debug_line(*_lines);
 
 	// Destroy units.
-	for (u32 i = 0; i < array::size(_units); ++i) {
+	for (u32 i = 0; i < array::size(_units); ++i)
 		CE_ENSURE(_unit_manager->alive(_units[i]));
-		_unit_manager->destroy(_units[i]);
-	}
+	_unit_manager->destroy(array::begin(_units), array::size(_units));
 
 	_marker = 0;
 }
 
 UnitId World::spawn_unit(const UnitResource *ur, u32 flags, const Vector3 &pos, const Quaternion &rot, const Vector3 &scl)
 {
-	UnitId *unit_lookup = (UnitId *)default_scratch_allocator().allocate(sizeof(*unit_lookup) * ur->num_units);
-	for (u32 i = 0; i < ur->num_units; ++i)
+	UnitId root_unit;
+	spawn_units(ur
+		, 1
+		, flags & SpawnFlags::OVERRIDE_POSITION ? &pos : NULL
+		, flags & SpawnFlags::OVERRIDE_ROTATION ? &rot : NULL
+		, flags & SpawnFlags::OVERRIDE_SCALE ? &scl : NULL
+		, &root_unit
+		);
+	return root_unit;
+}
+
+UnitId World::spawn_unit(StringId64 name, u32 flags, const Vector3 &pos, const Quaternion &rot, const Vector3 &scl)
+{
+	const UnitResource *ur = (UnitResource *)_resource_manager->get(RESOURCE_TYPE_UNIT, name);
+	return spawn_unit(ur, flags, pos, rot, scl);
+}
+
+void World::spawn_units(const UnitResource *ur, u32 count, const Vector3 *pos, const Quaternion *rot, const Vector3 *scl, UnitId *units)
+{
+	if (count == 0)
+		return;
+
+	u32 flags = SpawnFlags::NONE;
+	if (pos != NULL)
+		flags |= SpawnFlags::OVERRIDE_POSITION;
+	if (rot != NULL)
+		flags |= SpawnFlags::OVERRIDE_ROTATION;
+	if (scl != NULL)
+		flags |= SpawnFlags::OVERRIDE_SCALE;
+
+	const u32 num_units = ur->num_units * count;
+
+	Array<UnitId> unit_lookup(*_allocator);
+	array::resize(unit_lookup, num_units);
+	for (u32 i = 0; i < num_units; ++i)
 		unit_lookup[i] = _unit_manager->create();
 
-	create_components(*this, ur, unit_lookup, flags, pos, rot, scl);
+	create_components(*this, ur, array::begin(unit_lookup), count, flags, pos, rot, scl);
 
-	array::push(_units, unit_lookup, ur->num_units);
+	array::push(_units, array::begin(unit_lookup), num_units);
 #if CROWN_CAN_RELOAD
-	array::push_back(_unit_resources, ur);
-	for (u32 i = 0; i < ur->num_units - 1; ++i)
-		array::push_back(_unit_resources, (const UnitResource *)NULL);
+	array::reserve(_unit_resources, array::size(_unit_resources) + num_units);
+	for (u32 i = 0; i < count; ++i) {
+		array::push_back(_unit_resources, ur);
+		for (u32 j = 0; j < ur->num_units - 1; ++j)
+			array::push_back(_unit_resources, (const UnitResource *)NULL);
+	}
 #endif
-	post_unit_spawned_events(unit_lookup, ur->num_units);
 
-	UnitId root_unit = unit_lookup[0];
-	default_scratch_allocator().deallocate(unit_lookup);
-	return root_unit;
+	post_unit_spawned_events(array::begin(unit_lookup), num_units);
+
+	for (u32 i = 0; i < count; ++i)
+		units[i] = unit_lookup[i*ur->num_units];
 }
 
-UnitId World::spawn_unit(StringId64 name, u32 flags, const Vector3 &pos, const Quaternion &rot, const Vector3 &scl)
+void World::spawn_units(StringId64 name, u32 count, const Vector3 *pos, const Quaternion *rot, const Vector3 *scl, UnitId *units)
 {
 	const UnitResource *ur = (UnitResource *)_resource_manager->get(RESOURCE_TYPE_UNIT, name);
-	return spawn_unit(ur, flags, pos, rot, scl);
+	spawn_units(ur, count, pos, rot, scl, units);
 }
 
 UnitId World::spawn_empty_unit()
@@ -293,6 +369,27 @@ void World::destroy_unit(UnitId unit)
 	post_unit_destroyed_events(array::begin(unit_lookup), array::size(unit_lookup));
 }
 
+void World::destroy_units(const UnitId *units, u32 num)
+{
+	Array<UnitId> unit_lookup(*_allocator);
+	for (u32 i = 0; i < num; ++i)
+		collect_units(&unit_lookup, _scene_graph, units[i]);
+
+	// Units may be listed together with their ancestors: remove duplicates
+	// while preserving the order in which units have been collected.
+	HashSet<UnitId> collected(*_allocator);
+	u32 num_unique = 0;
+	for (u32 i = 0; i < array::size(unit_lookup); ++i) {
+		if (hash_set::has(collected, unit_lookup[i]))
+			continue;
+
+		hash_set::insert(collected, unit_lookup[i]);
+		unit_lookup[num_unique++] = unit_lookup[i];
+	}
+
+	post_unit_destroyed_events(array::begin(unit_lookup), num_unique);
+}
+
 u32 World::num_units() const
 {
 	return array::size(_units);
@@ -362,11 +459,14 @@ void World::process_world_events()
 
 				script_world::unspawned(*_script_world, units, num_alive);
 
+				u32 num_destroyed = 0;
 				for (u32 i = 0; i < num_alive; ++i) {
 					if (_unit_manager->alive(units[i]))
-						_unit_manager->destroy(units[i]);
+						units[num_destroyed++] = units[i];
 				}
 
+				_unit_manager->destroy(units, num_destroyed);
+
 				remove_dead_units();
 				break;
 			}
@@ -435,6 +535,9 @@ void World::update_scene(f32 dt)
 		array::clear(events);
 	}
 
+	// Resolve all the local poses written by animations and scripts in a
+	// single pass, before physics and rendering consume the changed list.
+	_scene_graph->update_world_transforms(job_system::num_threads());
 	_scene_graph->get_changed(_changed_units, _changed_world);
 
 	_physics_world->update_actor_world_poses(array::begin(_changed_units)
@@ -673,7 +776,7 @@ void World::camera_create_instances(const void *data, u32 num, const UnitId *uni
 
 	for (u32 i = 0; i < num; ++i) {
 		UnitId unit = unit_lookup[unit_index[i]];
-		CE_ASSERT(!hash_map::has(_camera_map, unit), "Unit already has a camera component");
+		CE_ASSERT(!unit_map::has(_camera_map, unit), "Unit already has a camera component");
 
 		Camera c;
 		c.unit            = unit;
@@ -686,7 +789,7 @@ void World::camera_create_instances(const void *data, u32 num, const UnitId *uni
 		const u32 last = array::size(_camera);
 		array::push_back(_camera, c);
 
-		hash_map::set(_camera_map, unit, last);
+		unit_map::set(_camera_map, unit, last);
 	}
 }
 
@@ -706,13 +809,13 @@ void World::camera_destroy(CameraId camera)
 	_camera[camera.i] = _camera[last];
 	array::pop_back(_camera);
 
-	hash_map::set(_camera_map, last_u, camera.i);
-	hash_map::remove(_camera_map, u);
+	unit_map::set(_camera_map, last_u, camera.i);
+	unit_map::remove(_camera_map, u);
 }
 
 CameraId World::camera_instance(UnitId unit)
 {
-	return camera_make_instance(hash_map::get(_camera_map, unit, UINT32_MAX));
+	return camera_make_instance(unit_map::get(_camera_map, unit, UINT32_MAX));
 }
 
 void World::camera_set_projection_type(CameraId camera, ProjectionType::Enum type)
@@ -992,7 +1095,7 @@ Level *World::load_level(StringId64 name, u32 flags, const Vector3 &pos, const Q
 	for (u32 i = 0; i < ur->num_units; ++i)
 		level->_unit_lookup[i] = _unit_manager->create();
 
-	create_components(*this, ur, level->_unit_lookup, flags, pos, rot, VECTOR3_ONE);
+	create_components(*this, ur, level->_unit_lookup, 1, flags, &pos, &rot, &VECTOR3_ONE);
 
 	array::push(_units, level->_unit_lookup, ur->num_units);
 #if CROWN_CAN_RELOAD
@@ -1104,8 +1207,7 @@ void World::reload_units(const UnitResource *old_unit, const UnitResource *new_u
 			Array<UnitId> unit_lookup(default_scratch_allocator());
 			collect_units(&unit_lookup, _scene_graph, _units[i]);
 
-			for (u32 j = 0; j < array::size(unit_lookup); ++j)
-				_unit_manager->trigger_destroy_callbacks(unit_lookup[j]);
+			_unit_manager->trigger_destroy_callbacks(array::begin(unit_lookup), array::size(unit_lookup));
 
 			// Create or destroy IDs if new_unit has different number of units.
 			u32 n = array::size(unit_lookup);
@@ -1124,12 +1226,13 @@ void World::reload_units(const UnitResource *old_unit, const UnitResource *new_u
 			create_components(*this
 				, new_unit
 				, array::begin(unit_lookup)
+				, 1
 				, SpawnFlags::OVERRIDE_POSITION
 				| SpawnFlags::OVERRIDE_ROTATION
 				| SpawnFlags::OVERRIDE_SCALE
-				, pos
-				, rot
-				, scl
+				, &pos
+				, &rot
+				, &scl
 				);
 			_unit_resources[i] = new_unit;
 		}
@@ -58,7 +58,7 @@ struct World
 
 	Array<UnitId> _units;
 	Array<Camera> _camera;
-	HashMap<UnitId, u32> _camera_map;
+	UnitMap<u32> _camera_map;
 
 	EventStream _events[2];
 	EventStream *_events_write;
@@ -114,6 +114,28 @@ struct World
 		, const Vector3 &scl = VECTOR3_ONE
 		);
 
+	/// Spawns @a count instances of the unit @a ur and stores their root
+	/// units in @a units. If not NULL, @a pos, @a rot and @a scl must
+	/// contain @a count elements each and override the position, rotation
+	/// and scale of the i-th instance. Components are created one type at
+	/// a time for all the instances.
+	void spawn_units(const UnitResource *ur
+		, u32 count
+		, const Vector3 *pos
+		, const Quaternion *rot
+		, const Vector3 *scl
+		, UnitId *units
+		);
+
+	/// @copydoc World::spawn_units().
+	void spawn_units(StringId64 name
+		, u32 count
+		, const Vector3 *pos
+		, const Quaternion *rot
+		, const Vector3 *scl
+		, UnitId *units
+		);
+
 	/// Spawns a new empty unit and returns its id.
 	UnitId spawn_empty_unit();
 
@@ -123,6 +145,9 @@ struct World
 	/// Destroys the unit with the specified @a id.
 	void destroy_unit(UnitId unit);
 
+	/// Destroys the @a num @a units and their children at once.
+	void destroy_units(const UnitId *units, u32 num);
+
 	/// Returns the number of units in the world.
 	u32 num_units() const;
 
@@ -242,6 +242,20 @@ public static void create_object_types(Database database)
 			tooltip = _("Enable geometry shadow rendering."),
 		},
 		PropertyDefinition()
+		{
+			type = PropertyType.BOOL,
+			name = "data.static_shadows",
+			deffault = false,
+			tooltip = _("Cache the geometry shadows. Only enable on geometry that rarely moves."),
+		},
+		PropertyDefinition()
+		{
+			type = PropertyType.BOOL,
+			name = "data.occluder",
+			deffault = false,
+			tooltip = _("Use the geometry to hide other objects when occlusion culling is enabled."),
+		},
+		PropertyDefinition()
 		{
 			type = PropertyType.DOUBLE,
 			name = "spawn_order",